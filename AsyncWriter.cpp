@@ -0,0 +1,135 @@
+#include "AsyncWriter.h"
+#include <chrono>
+#include <exception>
+
+namespace {
+
+/// Spin briefly, then yield, then sleep
+void backoff(int& attempt)
+{
+    if (attempt < 64) {
+        ++attempt;
+    }
+    else if (attempt < 128) {
+        ++attempt;
+        std::this_thread::yield();
+    }
+    else {
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    }
+}
+
+} // namespace
+
+CAsyncWriter::CAsyncWriter(size_t queue_size, bool threaded)
+    : queue_(queue_size > 0 ? queue_size : 1)
+{
+    if (threaded) {
+        thread_ = std::thread(&CAsyncWriter::run, this);
+    }
+}
+
+CAsyncWriter::~CAsyncWriter()
+{
+    close();
+}
+
+void CAsyncWriter::submit(Job job)
+{
+    if (!thread_.joinable()) {
+        execute(job);
+        return;
+    }
+
+    submitted_.fetch_add(1, std::memory_order_relaxed);
+    if (!queue_.tryPush(std::move(job))) {
+        // Queue full: wait for the writer to make room
+        ++stalls_;
+        int attempt = 0;
+        while (!queue_.tryPush(std::move(job))) {
+            backoff(attempt);
+        }
+    }
+    wakeWriter();
+}
+
+void CAsyncWriter::wakeWriter()
+{
+    // Pairs with the fence in run(): either the writer sees the new job or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed)) {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_.notify_one();
+    }
+}
+
+void CAsyncWriter::flush()
+{
+    const long target = submitted_.load(std::memory_order_relaxed);
+    int attempt = 0;
+    while (completed_.load(std::memory_order_acquire) < target) {
+        backoff(attempt);
+    }
+}
+
+void CAsyncWriter::close()
+{
+    if (!thread_.joinable()) {
+        return;
+    }
+    flush();
+    stop_.store(true, std::memory_order_release);
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        wake_.notify_one();
+    }
+    thread_.join();
+}
+
+std::string CAsyncWriter::error() const
+{
+    std::lock_guard<std::mutex> lock(error_mutex_);
+    return error_;
+}
+
+void CAsyncWriter::run()
+{
+    Job job;
+    int attempt = 0;
+    while (true) {
+        if (queue_.tryPop(job)) {
+            execute(job);
+            job = nullptr;
+            completed_.fetch_add(1, std::memory_order_release);
+            attempt = 0;
+        }
+        else if (stop_.load(std::memory_order_acquire)) {
+            break;
+        }
+        else if (attempt < 128) {
+            backoff(attempt);
+        }
+        else {
+            // Idle: block instead of polling so the writer does not compete with the sampler
+            std::unique_lock<std::mutex> lock(wake_mutex_);
+            sleeping_.store(true, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (queue_.empty() && !stop_.load(std::memory_order_acquire)) {
+                wake_.wait_for(lock, std::chrono::milliseconds(50));
+            }
+            sleeping_.store(false, std::memory_order_relaxed);
+            attempt = 0;
+        }
+    }
+}
+
+void CAsyncWriter::execute(Job& job)
+{
+    try {
+        job();
+    }
+    catch (const std::exception& e) {
+        std::lock_guard<std::mutex> lock(error_mutex_);
+        if (error_.empty()) error_ = e.what();
+    }
+}
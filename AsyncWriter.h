@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Bounded lock-free single-producer/single-consumer ring buffer
+ *
+ * One thread may call tryPush() and one other thread tryPop(). The head
+ * and tail indices live on separate cache lines; each side only writes its
+ * own index, publishing slot contents with release/acquire ordering.
+ */
+template<class T>
+class CSpscQueue
+{
+public:
+    explicit CSpscQueue(size_t capacity)
+        : slots_(capacity + 1)
+    {
+    }
+
+    CSpscQueue(const CSpscQueue&) = delete;
+    CSpscQueue& operator=(const CSpscQueue&) = delete;
+
+    bool tryPush(T&& item)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        const size_t next = increment(tail);
+        if (next == head_.load(std::memory_order_acquire)) {
+            return false;  // full
+        }
+        slots_[tail] = std::move(item);
+        tail_.store(next, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& item)
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) {
+            return false;  // empty
+        }
+        item = std::move(slots_[head]);
+        slots_[head] = T();
+        head_.store(increment(head), std::memory_order_release);
+        return true;
+    }
+
+    bool empty() const
+    {
+        return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+    }
+
+    size_t capacity() const { return slots_.size() - 1; }
+
+private:
+    size_t increment(size_t index) const { return index + 1 == slots_.size() ? 0 : index + 1; }
+
+    std::vector<T> slots_;
+    alignas(64) std::atomic<size_t> head_{0};
+    alignas(64) std::atomic<size_t> tail_{0};
+};
+
+/**
+ * @brief Runs output jobs on a dedicated thread
+ *
+ * The producer (e.g. the sampling loop) submits jobs that format and write
+ * output; a writer thread executes them in submission order. When the
+ * queue is full submit() waits for the writer (back-pressure), so memory
+ * use stays bounded if the disk is slower than the sampler. flush() blocks
+ * until every submitted job has run, close() drains the queue and joins the
+ * thread. With threaded = false jobs run inline in submit(). An idle
+ * writer blocks on a condition variable that submit() signals only while
+ * the writer is asleep.
+ *
+ * Exceptions thrown by a job are caught on the writer thread; the first
+ * message is kept and reported by error(). Only one thread may submit.
+ */
+class CAsyncWriter
+{
+public:
+    using Job = std::function<void()>;
+
+    explicit CAsyncWriter(size_t queue_size = 1024, bool threaded = true);
+    ~CAsyncWriter();
+
+    CAsyncWriter(const CAsyncWriter&) = delete;
+    CAsyncWriter& operator=(const CAsyncWriter&) = delete;
+
+    void submit(Job job);
+
+    /**
+     * @brief Wait until all submitted jobs have completed
+     */
+    void flush();
+
+    /**
+     * @brief Drain the queue and stop the writer thread
+     */
+    void close();
+
+    /**
+     * @brief First error raised by a job, empty if none
+     */
+    std::string error() const;
+
+    /**
+     * @brief Number of times submit() had to wait for a full queue
+     */
+    long stalls() const { return stalls_; }
+
+private:
+    void run();
+    void execute(Job& job);
+    void wakeWriter();
+
+    CSpscQueue<Job> queue_;
+    std::thread thread_;
+    std::atomic<bool> stop_{false};
+    std::atomic<long> submitted_{0};
+    std::atomic<long> completed_{0};
+    long stalls_ = 0;
+
+    // Used only to put an idle writer to sleep; the data path is lock-free
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<bool> sleeping_{false};
+
+    mutable std::mutex error_mutex_;
+    std::string error_;
+};
@@ -0,0 +1,651 @@
+#include "BatchRunner.h"
+#include "GWA.h"
+#include "GA.h"
+#include "MCMC.h"
+#include "MCMCEngine.h"
+#include "MultiStartLM.h"
+#include "SensitivityMatrix.h"
+#include "GlobalSensitivity.h"
+#include "PosteriorPredictive.h"
+#include "FitnessCache.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <thread>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+namespace {
+
+using Properties = std::vector<std::pair<std::string, std::string>>;
+
+/// "key value" lines of a .gasettings or .mcmcsettings file; a missing file gives none
+Properties readSettingsFile(const std::string& filename)
+{
+    Properties properties;
+    std::ifstream file(filename);
+    std::string line;
+    while (std::getline(file, line)) {
+        std::istringstream tokens(line);
+        std::string key, value;
+        if (tokens >> key >> value) {
+            properties.emplace_back(key, value);
+        }
+    }
+    return properties;
+}
+
+/// Settings file next to the project: <dir>/<name><extension>
+std::string settingsFilename(const std::string& project, const std::string& extension)
+{
+    std::filesystem::path path(project);
+    return (path.parent_path() / (path.stem().string() + extension)).string();
+}
+
+/// Apply properties that the engine must recognize; stops at the first one it rejects
+template<class Engine>
+bool applyProperties(Engine& engine, const Properties& properties, std::string& message)
+{
+    for (const auto& property : properties) {
+        if (!engine.SetProperty(property.first, property.second)) {
+            message = engine.getLastError();
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Keys of a shared settings file that another engine reads (same prefixes the GUI dispatches on)
+bool otherEngineKey(const std::string& key, std::initializer_list<const char*> prefixes)
+{
+    for (const char* prefix : prefixes) {
+        if (key.rfind(prefix, 0) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/// Wildcard match with * (any run of characters) and ? (one character)
+bool wildcardMatch(const char* pattern, const char* name)
+{
+    const char* star = nullptr;
+    const char* resume = nullptr;
+    while (*name) {
+        if (*pattern == '?' || *pattern == *name) {
+            ++pattern;
+            ++name;
+        }
+        else if (*pattern == '*') {
+            star = pattern++;
+            resume = name;
+        }
+        else if (star) {
+            pattern = star + 1;
+            name = ++resume;
+        }
+        else {
+            return false;
+        }
+    }
+    while (*pattern == '*') ++pattern;
+    return *pattern == '\0';
+}
+
+/// One block per series: a "# name" line, a header and the values
+bool writeSeries(const std::string& filename, const TimeSeriesSet<double>& set)
+{
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << std::setprecision(8);
+    for (size_t j = 0; j < set.size(); ++j) {
+        file << "# " << set.getSeriesName(static_cast<int>(j)) << "\n" << "t, value\n";
+        for (size_t i = 0; i < set[j].size(); ++i) {
+            file << set[j].getTime(i) << ", " << set[j].getValue(i) << "\n";
+        }
+        file << "\n";
+    }
+    return file.good();
+}
+
+/// Quote a CSV field that contains a separator, quote or line break
+std::string csvField(const std::string& value)
+{
+    if (value.find_first_of(",\"\r\n") == std::string::npos) {
+        return value;
+    }
+    std::string quoted = "\"";
+    for (char c : value) {
+        if (c == '"') quoted += '"';
+        quoted += c;
+    }
+    return quoted + "\"";
+}
+
+/// Path used to recognize the same project given in different ways
+std::string projectKey(const std::string& project)
+{
+    std::error_code ec;
+    const std::filesystem::path path = std::filesystem::weakly_canonical(project, ec);
+    return ec ? project : path.string();
+}
+
+std::string formatValue(double value)
+{
+    std::ostringstream out;
+    out << std::setprecision(6) << value;
+    return out.str();
+}
+
+/// Copy the parameter values of an optimized model copy into the model
+void copyParameterValues(CGWA& source, CGWA& model)
+{
+    Parameter_Set& params = model.Parameters();
+    Parameter_Set& best = source.Parameters();
+    for (size_t i = 0; i < params.size() && i < best.size(); ++i) {
+        params[i]->SetValue(best[i]->GetValue());
+    }
+}
+
+} // namespace
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+CBatchRunner::CBatchRunner()
+{
+}
+
+bool CBatchRunner::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "command") {
+            if (value != "forward" && value != "project" && value != "ga" && value != "lm" &&
+                value != "mcmc" && value != "sensitivity") {
+                throw std::invalid_argument(value);
+            }
+            settings_.command = value;
+        }
+        else if (key == "jobs") settings_.jobs = std::max(0, std::stoi(value));
+        else if (key == "threads") settings_.threads = std::max(0, std::stoi(value));
+        else if (key == "clean") settings_.clean = (value != "no" && value != "false" && value != "0");
+        else if (key == "save_project") settings_.save_project = (value != "no" && value != "false" && value != "0");
+        else if (key == "global") settings_.global = (value != "no" && value != "false" && value != "0");
+        else if (key == "summary") settings_.summary_filename = value;
+        else if (key == "set") {
+            const size_t separator = value.find('=');
+            if (separator == 0 || separator == std::string::npos) throw std::invalid_argument(value);
+            settings_.overrides.emplace_back(value.substr(0, separator), value.substr(separator + 1));
+        }
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Projects
+// ============================================================================
+
+std::vector<std::string> CBatchRunner::ExpandPattern(const std::string& pattern)
+{
+    std::vector<std::string> files;
+    std::filesystem::path path(pattern);
+    const std::string name = path.filename().string();
+
+    if (name.find_first_of("*?") == std::string::npos) {
+        if (std::filesystem::is_regular_file(path)) {
+            files.push_back(pattern);
+        }
+        return files;
+    }
+
+    const std::filesystem::path directory = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+    std::error_code error;
+    for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+        if (entry.is_regular_file() && wildcardMatch(name.c_str(), entry.path().filename().string().c_str())) {
+            files.push_back((path.has_parent_path() ? entry.path() : entry.path().filename()).string());
+        }
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+bool CBatchRunner::AddProjects(const std::string& argument)
+{
+    std::vector<std::string> patterns;
+    if (!argument.empty() && argument[0] == '@') {
+        std::ifstream list(argument.substr(1));
+        if (!list.is_open()) {
+            last_error_ = "Cannot read project list " + argument.substr(1);
+            return false;
+        }
+        std::string line;
+        while (std::getline(list, line)) {
+            const size_t first = line.find_first_not_of(" \t\r");
+            if (first == std::string::npos || line[first] == '#') continue;
+            const size_t last = line.find_last_not_of(" \t\r");
+            patterns.push_back(line.substr(first, last - first + 1));
+        }
+    }
+    else {
+        patterns.push_back(argument);
+    }
+
+    for (const std::string& pattern : patterns) {
+        const std::vector<std::string> files = ExpandPattern(pattern);
+        if (files.empty()) {
+            last_error_ = "No project matches " + pattern;
+            return false;
+        }
+        // A project listed twice (e.g. relative and absolute) would run twice into the same output folder
+        for (const std::string& file : files) {
+            const std::string key = projectKey(file);
+            if (std::none_of(projects_.begin(), projects_.end(),
+                             [&key](const std::string& project) { return projectKey(project) == key; })) {
+                projects_.push_back(file);
+            }
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Running
+// ============================================================================
+
+int CBatchRunner::run()
+{
+    results_.clear();
+    if (settings_.command.empty()) {
+        last_error_ = "No command given";
+        return -1;
+    }
+    if (projects_.empty()) {
+        last_error_ = "No projects given";
+        return -1;
+    }
+    if ((settings_.command == "forward" || settings_.command == "project") && !settings_.overrides.empty()) {
+        last_error_ = "The " + settings_.command + " command takes no settings";
+        return -1;
+    }
+
+    // Job pool and per-project thread budget
+    const int n = static_cast<int>(projects_.size());
+    const int cores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    const int jobs = std::min(n, settings_.jobs > 0 ? settings_.jobs : cores);
+    const int threads = settings_.threads > 0 ? settings_.threads : std::max(1, cores / jobs);
+
+    std::cout << "Running " << settings_.command << " on " << n << " project(s): "
+              << jobs << " at a time, " << threads << " thread(s) each" << std::endl;
+
+#ifdef _OPENMP
+    const int levels = omp_get_max_active_levels();
+    omp_set_max_active_levels(2);
+#endif
+
+    results_.resize(n);
+    int finished = 0;
+
+#pragma omp parallel for schedule(dynamic, 1) num_threads(jobs)
+    for (int k = 0; k < n; ++k) {
+        results_[k] = runProject(projects_[k], threads);
+
+#pragma omp critical(batch_output)
+        {
+            ++finished;
+            const BatchResult& result = results_[k];
+            std::cout << "[" << finished << "/" << n << "] " << result.project << ": "
+                      << (result.success ? "done" : "FAILED") << " (" << result.message << ", "
+                      << std::fixed << std::setprecision(1) << result.seconds << " s)"
+                      << std::defaultfloat << std::endl;
+        }
+    }
+
+#ifdef _OPENMP
+    omp_set_max_active_levels(levels);
+#endif
+
+    const int failed = static_cast<int>(std::count_if(results_.begin(), results_.end(),
+                                                      [](const BatchResult& r) { return !r.success; }));
+    std::cout << n - failed << " of " << n << " project(s) completed" << std::endl;
+
+    if (!settings_.summary_filename.empty() && !writeSummary()) {
+        last_error_ = "Cannot write " + settings_.summary_filename;
+        std::cerr << "Error: " << last_error_ << std::endl;
+    }
+    return failed;
+}
+
+std::string CBatchRunner::outputFolderName(const std::string& base_name) const
+{
+    // Same folders as the GUI; Levenberg-Marquardt shares the GA folder
+    const std::string& command = settings_.command;
+    if (command == "forward") return base_name + "_Forward_output";
+    if (command == "project") return base_name + "_Projection_output";
+    if (command == "ga" || command == "lm") return base_name + "_GA_output";
+    if (command == "mcmc") return base_name + "_MCMC_output";
+    return base_name + (settings_.global ? "_Sensitivity_output" : "_SensitivityMatrix_output");
+}
+
+BatchResult CBatchRunner::runProject(const std::string& project, int threads) const
+{
+    const auto start = std::chrono::steady_clock::now();
+    BatchResult result;
+    result.project = project;
+
+    try {
+        const std::filesystem::path projectPath(project);
+        const std::filesystem::path folder = projectPath.parent_path() / outputFolderName(projectPath.stem().string());
+        result.output_path = folder.string() + "/";
+
+        CGWA model;
+        if (!model.loadFromFile(project)) {
+            result.message = "cannot load project";
+        }
+        else {
+            if (settings_.clean && std::filesystem::exists(folder)) {
+                for (const auto& entry : std::filesystem::directory_iterator(folder)) {
+                    std::filesystem::remove_all(entry.path());
+                }
+            }
+            std::filesystem::create_directories(folder);
+
+            model.SetOutputPath(result.output_path);
+            const std::string& command = settings_.command;
+            if (command == "forward") result.success = runForward(model, result.output_path, result.message);
+            else if (command == "project") result.success = runProjection(model, result.output_path, result.message);
+            else if (command == "ga") result.success = runGA(model, project, result.output_path, threads, result.message);
+            else if (command == "lm") result.success = runLM(model, project, result.output_path, threads, result.message);
+            else if (command == "mcmc") result.success = runMCMC(model, project, result.output_path, threads, result.message);
+            else result.success = runSensitivity(model, project, result.output_path, threads, result.message);
+        }
+    }
+    catch (const std::exception& e) {
+        result.success = false;
+        result.message = e.what();
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return result;
+}
+
+bool CBatchRunner::runForward(CGWA& model, const std::string& path, std::string& message) const
+{
+    // calculateLogLikelihood() runs the model once and leaves the modeled data in place
+    const double log_likelihood = model.calculateLogLikelihood();
+    if (!writeSeries(path + "Modeled.txt", model.getModeledData())) {
+        message = "cannot write Modeled.txt";
+        return false;
+    }
+    message = "log-likelihood " + formatValue(log_likelihood);
+    return true;
+}
+
+bool CBatchRunner::runProjection(CGWA& model, const std::string& path, std::string& message) const
+{
+    if (!model.getSettings().project_enabled) {
+        message = "projection is not enabled in the project (project_start)";
+        return false;
+    }
+    const TimeSeriesSet<double> projected = model.runProjection();
+    if (!writeSeries(path + "Projected.txt", projected)) {
+        message = "cannot write Projected.txt";
+        return false;
+    }
+    message = std::to_string(projected.size()) + " projected series";
+    return true;
+}
+
+bool CBatchRunner::runGA(CGWA& model, const std::string& project, const std::string& path, int threads,
+                         std::string& message) const
+{
+    CGA<CGWA> ga(&model);
+
+    // Same keys as the GUI; the other engines' keys share the file
+    const std::string filename = settingsFilename(project, ".gasettings");
+    int cacheSize = 100000;
+    for (const auto& property : readSettingsFile(filename)) {
+        const std::string& key = property.first;
+        if (key == "fitness_cache_size") {
+            cacheSize = std::max(0, std::atoi(property.second.c_str()));
+        }
+        else if (!otherEngineKey(key, {"cmaes_", "island_", "lm_"}) && !ga.SetProperty(key, property.second)) {
+            message = "unknown GA setting " + key + " in " + filename;
+            return false;
+        }
+    }
+    for (const auto& property : settings_.overrides) {
+        if (property.first == "fitness_cache_size") {
+            cacheSize = std::max(0, std::atoi(property.second.c_str()));
+        }
+        else if (!ga.SetProperty(property.first, property.second)) {
+            message = "unknown GA setting " + property.first;
+            return false;
+        }
+    }
+    const Properties run = {{"numthreads", std::to_string(threads)}, {"pathname", path}, {"outputfile", "ga_results.txt"}};
+    for (const auto& property : run) {
+        if (!ga.SetProperty(property.first, property.second)) {
+            message = "GA does not accept " + property.first;
+            return false;
+        }
+    }
+
+    // Duplicate chromosomes are looked up instead of re-running the model
+    if (cacheSize > 0) {
+        model.SetFitnessCache(std::make_shared<CFitnessCache>(cacheSize));
+    }
+
+    ga.initFromModel(&model);
+    ga.initialize();
+    ga.optimize();
+    model.SetFitnessCache(nullptr);
+
+    CGWA* bestModel = ga.getBestModel();
+    if (bestModel == nullptr) {
+        message = "no result";
+        return false;
+    }
+    copyParameterValues(*bestModel, model);
+    message = "best fitness " + formatValue(ga.getMaxFitness());
+
+    if (settings_.save_project && !model.exportToFile(project)) {
+        message += ", cannot save project";
+        return false;
+    }
+    return true;
+}
+
+bool CBatchRunner::runLM(CGWA& model, const std::string& project, const std::string& path, int threads,
+                         std::string& message) const
+{
+    CMultiStartLM<CGWA> lm(&model);
+    Properties properties;
+    for (const auto& property : readSettingsFile(settingsFilename(project, ".gasettings"))) {
+        if (property.first.rfind("lm_", 0) == 0) {
+            properties.push_back(property);
+        }
+    }
+    properties.insert(properties.end(), settings_.overrides.begin(), settings_.overrides.end());
+    properties.insert(properties.end(), {{"numthreads", std::to_string(threads)}, {"pathname", path},
+                                         {"outputfile", "lm_multistart.txt"}});
+    if (!applyProperties(lm, properties, message)) {
+        return false;
+    }
+
+    lm.optimize();
+    CGWA* bestModel = lm.getBestModel();
+    if (bestModel == nullptr) {
+        message = lm.getLastError();
+        return false;
+    }
+    copyParameterValues(*bestModel, model);
+    message = "best fitness " + formatValue(lm.getMaxFitness()) + ", " +
+              std::to_string(lm.getBasins().size()) + " basin(s)";
+
+    if (settings_.save_project && !model.exportToFile(project)) {
+        message += ", cannot save project";
+        return false;
+    }
+    return true;
+}
+
+bool CBatchRunner::runMCMC(CGWA& model, const std::string& project, const std::string& path, int threads,
+                           std::string& message) const
+{
+    // As in the GUI, both samplers read the file and the sampler key picks one
+    CMCMC<CGWA> mcmc(&model);
+    CMCMCEngine<CGWA> engine(&model);
+    const std::string filename = settingsFilename(project, ".mcmcsettings");
+    for (const auto& property : readSettingsFile(filename)) {
+        if (otherEngineKey(property.first, {"laplace_", "esmda_", "smc_", "reweight_", "gsa_", "sensitivity_",
+                                            "profile_", "scenario_"})) {
+            continue;
+        }
+        const bool standard = mcmc.SetProperty(property.first, property.second);
+        const bool adaptive = engine.SetProperty(property.first, property.second);
+        if (!standard && !adaptive) {
+            message = engine.getLastError() + " in " + filename;
+            return false;
+        }
+    }
+    for (const auto& property : settings_.overrides) {
+        const bool standard = mcmc.SetProperty(property.first, property.second);
+        const bool adaptive = engine.SetProperty(property.first, property.second);
+        if (!standard && !adaptive) {
+            message = engine.getLastError();
+            return false;
+        }
+    }
+
+    const MCMCSettings& settings = mcmc.GetSettings();
+    if (!engine.IsEnabled()) {
+        if (!mcmc.SetProperty("number_of_threads", std::to_string(threads)) ||
+            !mcmc.SetProperty("samples_filename", "mcmc_samples.txt")) {
+            message = "MCMC does not accept number_of_threads or samples_filename";
+            return false;
+        }
+        mcmc.Initialize(false);
+        mcmc.Perform();
+        // The legacy sampler reports no status; a run that failed or was stopped leaves no samples
+        if (mcmc.GetParameterSamples().empty()) {
+            message = "MCMC drew no samples";
+            return false;
+        }
+        message = "acceptance rate " + formatValue(mcmc.GetAcceptanceRate());
+        return true;
+    }
+
+    const Properties run = {{"number_of_threads", std::to_string(threads)}, {"samples_filename", ""},
+                            {"output_path", path}, {"checkpoint_filename", "mcmc_checkpoint.bin"}};
+    if (!applyProperties(engine, run, message)) {
+        return false;
+    }
+    if (!engine.Initialize(false) || !engine.Perform()) {
+        message = engine.getLastError();
+        return false;
+    }
+    message = "acceptance rate " + formatValue(engine.GetAcceptanceRate());
+    if (engine.StoppedOnConvergence()) {
+        message += ", converged";
+    }
+
+    if (settings.number_of_post_estimate_realizations > 0 && engine.GetSampleCount() > settings.burnout_samples) {
+        std::vector<std::vector<double>> samples;
+        if (!engine.GetPosteriorSamples(samples)) {
+            message += ", realizations failed: " + engine.getLastError();
+            return false;
+        }
+        CPosteriorPredictive predictive(&model);
+        const Properties realizations = {
+            {"number_of_realizations", std::to_string(settings.number_of_post_estimate_realizations)},
+            {"output_path", path}, {"number_of_threads", std::to_string(threads)}};
+        if (!applyProperties(predictive, realizations, message)) {
+            return false;
+        }
+        if (!predictive.Generate(samples)) {
+            message += ", realizations failed: " + predictive.getLastError();
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CBatchRunner::runSensitivity(CGWA& model, const std::string& project, const std::string& path, int threads,
+                                  std::string& message) const
+{
+    const Properties properties = readSettingsFile(settingsFilename(project, ".mcmcsettings"));
+
+    if (settings_.global) {
+        CGlobalSensitivity gsa(&model);
+        Properties selected;
+        for (const auto& property : properties) {
+            if (property.first.rfind("gsa_", 0) == 0) selected.push_back(property);
+        }
+        selected.insert(selected.end(), settings_.overrides.begin(), settings_.overrides.end());
+        selected.insert(selected.end(), {{"numthreads", std::to_string(threads)}, {"pathname", path}});
+        if (!applyProperties(gsa, selected, message)) {
+            return false;
+        }
+        if (!gsa.run()) {
+            message = gsa.getLastError();
+            return false;
+        }
+        message = std::to_string(gsa.getModelEvaluations()) + " model runs";
+        return true;
+    }
+
+    CSensitivityMatrix<CGWA> sensitivity(&model);
+    Properties selected;
+    for (const auto& property : properties) {
+        if (property.first.rfind("sensitivity_", 0) == 0) selected.push_back(property);
+    }
+    selected.insert(selected.end(), settings_.overrides.begin(), settings_.overrides.end());
+    selected.insert(selected.end(), {{"numthreads", std::to_string(threads)}, {"pathname", path}});
+    if (!applyProperties(sensitivity, selected, message)) {
+        return false;
+    }
+    if (!sensitivity.compute()) {
+        message = sensitivity.getLastError();
+        return false;
+    }
+    message = "collinearity index " + formatValue(sensitivity.getCollinearityIndex());
+    return true;
+}
+
+bool CBatchRunner::writeSummary() const
+{
+    std::ofstream file(settings_.summary_filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "project, status, seconds, output, result\n";
+    for (const BatchResult& result : results_) {
+        file << csvField(result.project) << ", " << (result.success ? "done" : "failed") << ", "
+             << std::fixed << std::setprecision(1) << result.seconds << ", "
+             << csvField(result.output_path) << ", " << csvField(result.message) << "\n";
+    }
+    return file.good();
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+
+class CGWA;
+
+/**
+ * @brief Settings for CBatchRunner
+ */
+struct BatchSettings
+{
+    std::string command;                 ///< forward | project | ga | lm | mcmc | sensitivity
+    int jobs = 0;                        ///< Projects run at once (0 = one per core, at most one per project)
+    int threads = 0;                     ///< Threads per project (0 = cores divided among the jobs)
+    bool clean = false;                  ///< Empty each output folder before its run
+    bool save_project = false;           ///< ga, lm: write the optimized values back to the project file
+    bool global = false;                 ///< sensitivity: Sobol/Morris instead of the sensitivity matrix
+    std::vector<std::pair<std::string, std::string>> overrides; ///< Applied after the settings files
+    std::string summary_filename;        ///< Batch summary, one line per project (empty = none)
+};
+
+/**
+ * @brief Outcome of one project in a batch
+ */
+struct BatchResult
+{
+    std::string project;
+    std::string output_path;
+    bool success = false;
+    std::string message;                 ///< Key result or the error
+    double seconds = 0.0;
+};
+
+/**
+ * @brief Headless runner for a command over many projects
+ *
+ * Every project (.gwa file) is loaded into its own model and processed
+ * with the settings the GUI would use: <name>.gasettings for ga and lm,
+ * <name>.mcmcsettings for mcmc and sensitivity, both next to the project.
+ * Overrides (key=value) are applied on top and must be recognized by the
+ * engine. Output goes to the same per-project folders as in the GUI
+ * (<name>_GA_output, <name>_MCMC_output, ...).
+ *
+ * Projects are scheduled dynamically over a pool of jobs threads, so long
+ * and short runs balance out. Each project gets threads worker threads for
+ * its engine (nested parallelism); by default the cores are divided among
+ * the jobs, so one project uses the whole machine and a large batch runs
+ * one project per core. Thread counts in the settings files are replaced
+ * by this budget. A failing project is reported and does not stop the
+ * others.
+ *
+ * Commands:
+ * - forward: forward run, modeled observations to Modeled.txt
+ * - project: projection, projected series to Projected.txt
+ * - ga: genetic algorithm (CGA, with the fitness cache)
+ * - lm: multi-start Levenberg-Marquardt (CMultiStartLM)
+ * - mcmc: CMCMC or, for the adaptive samplers, CMCMCEngine with
+ *   posterior predictive realizations
+ * - sensitivity: CSensitivityMatrix, or CGlobalSensitivity if global
+ */
+class CBatchRunner
+{
+public:
+    CBatchRunner();
+
+    /**
+     * @brief Set a property by name (command, jobs, threads, clean,
+     *        save_project, global, summary, set)
+     *
+     * set takes key=value and adds an override.
+     * @return true if the property is recognized
+     */
+    bool SetProperty(const std::string& prop, const std::string& value);
+
+    const BatchSettings& GetSettings() const { return settings_; }
+
+    /**
+     * @brief Add projects from a file name, a wildcard pattern or a list file
+     *
+     * Patterns may use * and ? in the file name (not in directories).
+     * An argument starting with @ names a text file with one project or
+     * pattern per line; empty lines and lines starting with # are skipped.
+     * Projects already in the batch (same canonical path) are not added again.
+     * @return false if a pattern matches nothing or a list cannot be read
+     */
+    bool AddProjects(const std::string& argument);
+
+    const std::vector<std::string>& GetProjects() const { return projects_; }
+
+    /**
+     * @brief Files matching a pattern with * and ? in the file name, sorted
+     */
+    static std::vector<std::string> ExpandPattern(const std::string& pattern);
+
+    /**
+     * @brief Run the command on all projects
+     * @return Number of failed projects, or -1 if the batch cannot start
+     */
+    int run();
+
+    const std::vector<BatchResult>& GetResults() const { return results_; }
+
+    std::string getLastError() const { return last_error_; }
+
+private:
+    BatchResult runProject(const std::string& project, int threads) const;
+    std::string outputFolderName(const std::string& base_name) const;
+
+    bool runForward(CGWA& model, const std::string& path, std::string& message) const;
+    bool runProjection(CGWA& model, const std::string& path, std::string& message) const;
+    bool runGA(CGWA& model, const std::string& project, const std::string& path, int threads, std::string& message) const;
+    bool runLM(CGWA& model, const std::string& project, const std::string& path, int threads, std::string& message) const;
+    bool runMCMC(CGWA& model, const std::string& project, const std::string& path, int threads, std::string& message) const;
+    bool runSensitivity(CGWA& model, const std::string& project, const std::string& path, int threads, std::string& message) const;
+
+    bool writeSummary() const;
+
+    BatchSettings settings_;
+    std::vector<std::string> projects_;
+    std::vector<BatchResult> results_;
+    std::string last_error_;
+};
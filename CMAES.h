@@ -0,0 +1,204 @@
+#pragma once
+
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <armadillo>
+#include "ParameterSpace.h"
+
+#ifdef Q_GUI_SUPPORT
+class ProgressWindow;
+#endif
+
+/**
+ * @brief Settings for CCMAES
+ *
+ * maxpop, ngen and numthreads are the keys of the GA settings file; together
+ * they define the default evaluation budget (maxpop x ngen) so switching
+ * from CGA to CMA-ES keeps the same cost limit.
+ */
+struct CMAESSettings
+{
+    int maxpop = 100;                    ///< GA population size (budget only)
+    int ngen = 100;                      ///< GA generations (budget only)
+    int numthreads = 1;                  ///< Threads evaluating a population
+    long max_evaluations = 0;            ///< Evaluation budget over all restarts (0 = maxpop x ngen)
+    int population = 0;                  ///< Initial population lambda (0 = 4 + 3 ln n)
+    double sigma0 = 0.3;                 ///< Initial step size as fraction of the parameter range
+    int restarts = 9;                    ///< Maximum number of IPOP restarts
+    double population_increase = 2.0;   ///< Population factor per restart
+    double tolfun = 1e-10;               ///< Stop a run when the objective stalls within this range
+    double tolx = 1e-10;                 ///< Stop a run when steps fall below this fraction of the range
+    unsigned long random_seed = 0;       ///< 0 = seed from random_device
+    int checkpoint_interval = 0;         ///< Generations between checkpoints (0 = off)
+    std::string checkpoint_filename = "cmaes_checkpoint.bin";
+    std::string outputfile = "cmaes_results.txt";
+    std::string pathname;                ///< Directory for output files
+};
+
+/**
+ * @brief Covariance Matrix Adaptation Evolution Strategy with IPOP restarts
+ *
+ * Maximizes the model objective (GetObjectiveFunctionValue()) with
+ * (mu/mu_w, lambda)-CMA-ES (Hansen 2016): candidates are drawn from a
+ * multivariate normal whose mean, step size (cumulative step-size
+ * adaptation) and covariance (rank-one and rank-mu updates) are learned
+ * from the ranked population. When a run converges or stagnates the
+ * search restarts from a random point with the population size multiplied
+ * by population_increase (IPOP-CMA-ES, Auger & Hansen 2005), until the
+ * restart limit or the evaluation budget is reached.
+ *
+ * The search takes place in the space defined by CParameterSpace (log
+ * space for log-normal parameters), scaled so every parameter range maps
+ * to [0, 1]. Candidates outside the range are redrawn a few times and then
+ * reflected into it. Each thread evaluates its share of the population on
+ * a private model copy; fitness values do not depend on the thread count.
+ *
+ * With checkpoint_interval > 0 the state of the current run (mean,
+ * covariance and its eigendecomposition, step size, evolution paths,
+ * stagnation history), the restart count, the evaluation count, the best
+ * point and the random number generator are written to
+ * checkpoint_filename every checkpoint_interval generations and on
+ * cancellation; Resume() continues exactly as the uninterrupted run.
+ *
+ * @tparam T Model type providing Parameters(), setAllParameterValues() and
+ *           GetObjectiveFunctionValue()
+ */
+template<class T>
+class CCMAES
+{
+public:
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CCMAES();
+    explicit CCMAES(T* model);
+
+    /**
+     * @brief Set the model whose parameters will be optimized
+     */
+    void SetModel(T* model) { model_ = model; }
+
+    // ========================================================================
+    // Settings
+    // ========================================================================
+
+    /**
+     * @brief Set a property by name (GA settings keys plus cmaes_* keys)
+     * @return true if the property is recognized
+     */
+    bool SetProperty(const std::string& prop, const std::string& value);
+
+    const CMAESSettings& GetSettings() const { return settings_; }
+
+    /**
+     * @brief All settings as (key, value) pairs accepted by SetProperty()
+     */
+    std::vector<std::pair<std::string, std::string>> GetProperties() const;
+
+    std::string getLastError() const { return last_error_; }
+
+#ifdef Q_GUI_SUPPORT
+    void SetProgressWindow(ProgressWindow* window) { rtw_ = window; }
+#endif
+
+    // ========================================================================
+    // Optimization
+    // ========================================================================
+
+    /**
+     * @brief Run CMA-ES with restarts starting from the model's current values
+     * @return true if the run completed without cancellation or errors
+     */
+    bool optimize();
+
+    /**
+     * @brief Continue an interrupted run from a checkpoint written by optimize()
+     * @param checkpoint_filename Checkpoint file (see checkpoint_interval)
+     * @return true if the run completed without cancellation or errors
+     *
+     * Restores the settings and the search state and appends to the
+     * results file from the checkpointed position.
+     */
+    bool Resume(const std::string& checkpoint_filename);
+
+    // ========================================================================
+    // Results
+    // ========================================================================
+
+    /**
+     * @brief Model copy holding the best parameters found (nullptr before optimize())
+     */
+    T* getBestModel() { return best_model_valid_ ? &best_model_ : nullptr; }
+
+    const std::vector<double>& getFinalParams() const { return best_params_; }
+    double getMaxFitness() const { return best_fitness_; }
+    const std::vector<std::string>& getParamNames() const { return space_.getNames(); }
+    long getEvaluations() const { return evaluations_; }
+    int getRestarts() const { return restarts_done_; }
+    long getEvaluationBudget() const;
+
+private:
+    /// State of one CMA-ES run between generations
+    struct RunState
+    {
+        int lambda = 0;
+        long generation = 0;          ///< Generations completed in this run
+        arma::vec mean;
+        arma::vec pc;                 ///< Evolution path of the covariance
+        arma::vec ps;                 ///< Evolution path of the step size
+        arma::mat C;
+        arma::mat B;                  ///< Eigenvectors of C
+        arma::vec D;                  ///< Square roots of the eigenvalues of C
+        double sigma = 0.0;
+        std::deque<double> best_history;
+    };
+
+    RunState startRun(int lambda, const arma::vec& x0) const;
+
+    /**
+     * @brief Restarts from first_restart, continuing state first
+     * @return true if the search completed without cancellation
+     */
+    bool search(int first_restart, RunState state, std::ofstream& log);
+
+    /**
+     * @brief Continue one CMA-ES run from its state
+     * @return false if the optimization must stop (budget, cancel, checkpoint error)
+     */
+    bool run(RunState& state, std::ofstream& log);
+
+    bool writeCheckpoint(const std::string& filename, const RunState& state, std::ofstream& log);
+    bool readCheckpoint(const std::string& filename, RunState& state, long long& log_offset);
+
+    std::vector<double> evaluate(const std::vector<arma::vec>& population);
+    std::vector<double> toPhysical(const arma::vec& x) const;
+    arma::vec sample(const arma::vec& mean, double sigma, const arma::mat& BD);
+
+    T* model_ = nullptr;
+    CMAESSettings settings_;
+    CParameterSpace space_;
+    std::vector<T> workers_;
+    std::mt19937_64 rng_;
+    std::string last_error_;
+    bool cancelled_ = false;
+
+    long evaluations_ = 0;
+    int restarts_done_ = 0;
+    long generation_ = 0;         ///< Generations over all runs (chart x-axis)
+
+    T best_model_;
+    bool best_model_valid_ = false;
+    std::vector<double> best_params_;
+    double best_fitness_ = 0.0;
+
+#ifdef Q_GUI_SUPPORT
+    ProgressWindow* rtw_ = nullptr;
+#endif
+};
+
+#include "CMAES.hpp"
@@ -0,0 +1,593 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <deque>
+#include <sstream>
+#include <filesystem>
+#include "Checkpoint.h"
+#include "ParallelWorkers.h"
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#endif
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+template<class T>
+CCMAES<T>::CCMAES()
+{
+}
+
+template<class T>
+CCMAES<T>::CCMAES(T* model)
+    : model_(model)
+{
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+template<class T>
+bool CCMAES<T>::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "maxpop") settings_.maxpop = std::max(1, std::stoi(value));
+        else if (key == "ngen") settings_.ngen = std::max(1, std::stoi(value));
+        else if (key == "numthreads") settings_.numthreads = std::max(1, std::stoi(value));
+        else if (key == "outputfile") settings_.outputfile = value;
+        else if (key == "pathname") settings_.pathname = value;
+        else if (key == "cmaes_max_evaluations") settings_.max_evaluations = std::max(0L, std::stol(value));
+        else if (key == "cmaes_population") settings_.population = std::max(0, std::stoi(value));
+        else if (key == "cmaes_sigma0") settings_.sigma0 = std::max(1e-12, std::stod(value));
+        else if (key == "cmaes_restarts") settings_.restarts = std::max(0, std::stoi(value));
+        else if (key == "cmaes_population_increase") settings_.population_increase = std::max(1.0, std::stod(value));
+        else if (key == "cmaes_tolfun") settings_.tolfun = std::stod(value);
+        else if (key == "cmaes_tolx") settings_.tolx = std::stod(value);
+        else if (key == "cmaes_random_seed") settings_.random_seed = std::stoul(value);
+        else if (key == "cmaes_checkpoint_interval") settings_.checkpoint_interval = std::max(0, std::stoi(value));
+        else if (key == "cmaes_checkpoint_filename") settings_.checkpoint_filename = value;
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+template<class T>
+std::vector<std::pair<std::string, std::string>> CCMAES<T>::GetProperties() const
+{
+    auto num = [](double value) {
+        std::ostringstream out;
+        out << std::setprecision(17) << value;
+        return out.str();
+    };
+    const CMAESSettings& st = settings_;
+    return {
+        {"maxpop", std::to_string(st.maxpop)},
+        {"ngen", std::to_string(st.ngen)},
+        {"numthreads", std::to_string(st.numthreads)},
+        {"cmaes_max_evaluations", std::to_string(st.max_evaluations)},
+        {"cmaes_population", std::to_string(st.population)},
+        {"cmaes_sigma0", num(st.sigma0)},
+        {"cmaes_restarts", std::to_string(st.restarts)},
+        {"cmaes_population_increase", num(st.population_increase)},
+        {"cmaes_tolfun", num(st.tolfun)},
+        {"cmaes_tolx", num(st.tolx)},
+        {"cmaes_random_seed", std::to_string(st.random_seed)},
+        {"cmaes_checkpoint_interval", std::to_string(st.checkpoint_interval)},
+        {"cmaes_checkpoint_filename", st.checkpoint_filename},
+        {"outputfile", st.outputfile},
+        {"pathname", st.pathname},
+    };
+}
+
+template<class T>
+long CCMAES<T>::getEvaluationBudget() const
+{
+    if (settings_.max_evaluations > 0) {
+        return settings_.max_evaluations;
+    }
+    return static_cast<long>(settings_.maxpop) * settings_.ngen;
+}
+
+// ============================================================================
+// Optimization
+// ============================================================================
+
+template<class T>
+bool CCMAES<T>::optimize()
+{
+    if (!model_) {
+        last_error_ = "No model assigned to CMA-ES";
+        return false;
+    }
+
+    space_ = CParameterSpace(model_->Parameters());
+    const size_t n = space_.size();
+    if (n == 0) {
+        last_error_ = "No parameters to optimize";
+        return false;
+    }
+
+    unsigned long seed = settings_.random_seed;
+    if (seed == 0) {
+        seed = std::random_device{}();
+    }
+    rng_.seed(seed);
+
+    last_error_.clear();
+    cancelled_ = false;
+    evaluations_ = 0;
+    restarts_done_ = 0;
+    generation_ = 0;
+    best_model_valid_ = false;
+    best_params_.clear();
+    best_fitness_ = -std::numeric_limits<double>::infinity();
+    workers_.assign(std::max(1, settings_.numthreads), *model_);
+
+    // First run starts from the model's current values
+    std::vector<double> u_current = space_.toSampling(model_->getParameterValues());
+    arma::vec x0(n);
+    for (size_t i = 0; i < n; ++i) {
+        double width = space_.getSamplingHigh(i) - space_.getSamplingLow(i);
+        double x = width > 0.0 ? (u_current[i] - space_.getSamplingLow(i)) / width : 0.5;
+        x0(i) = std::isfinite(x) ? std::min(1.0, std::max(0.0, x)) : 0.5;
+    }
+
+    std::ofstream log(settings_.pathname + settings_.outputfile);
+    if (log.is_open()) {
+        log << std::setprecision(10);
+        log << "restart, lambda, generation, evaluations, sigma, best_fitness, best_fitness_so_far\n";
+    }
+
+    int lambda = settings_.population > 0
+                     ? settings_.population
+                     : 4 + static_cast<int>(std::floor(3.0 * std::log(static_cast<double>(n))));
+    lambda = std::max(lambda, 2);
+
+    return search(0, startRun(lambda, x0), log);
+}
+
+template<class T>
+bool CCMAES<T>::Resume(const std::string& checkpoint_filename)
+{
+    if (!model_) {
+        last_error_ = "No model assigned to CMA-ES";
+        return false;
+    }
+
+    last_error_.clear();
+    cancelled_ = false;
+    best_model_valid_ = false;
+
+    RunState state;
+    long long log_offset = -1;
+    if (!readCheckpoint(checkpoint_filename, state, log_offset)) {
+        return false;
+    }
+    workers_.assign(std::max(1, settings_.numthreads), *model_);
+
+    // Drop log lines written after the checkpoint so the file continues exactly
+    std::ofstream log;
+    if (log_offset >= 0) {
+        const std::string filename = settings_.pathname + settings_.outputfile;
+        std::error_code ec;
+        std::filesystem::resize_file(filename, static_cast<std::uintmax_t>(log_offset), ec);
+        if (ec) {
+            last_error_ = "Cannot truncate results file " + filename + ": " + ec.message();
+            return false;
+        }
+        log.open(filename, std::ios::app);
+        log << std::setprecision(10);
+    }
+
+    return search(restarts_done_, state, log);
+}
+
+template<class T>
+typename CCMAES<T>::RunState CCMAES<T>::startRun(int lambda, const arma::vec& x0) const
+{
+    const arma::uword n = x0.n_elem;
+    RunState state;
+    state.lambda = lambda;
+    state.mean = x0;
+    state.pc.zeros(n);
+    state.ps.zeros(n);
+    state.C.eye(n, n);
+    state.B.eye(n, n);
+    state.D.ones(n);
+    state.sigma = settings_.sigma0;
+    return state;
+}
+
+template<class T>
+bool CCMAES<T>::search(int first_restart, RunState state, std::ofstream& log)
+{
+    const size_t n = space_.size();
+
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    for (int restart = first_restart; restart <= settings_.restarts; ++restart) {
+        if (restart > first_restart) {
+            arma::vec start(n);
+            for (size_t i = 0; i < n; ++i) start(i) = unif(rng_);
+            state = startRun(static_cast<int>(std::ceil(state.lambda * settings_.population_increase)), start);
+        }
+
+        restarts_done_ = restart;
+        if (state.generation == 0) {
+#ifdef Q_GUI_SUPPORT
+            if (rtw_) {
+                rtw_->AppendLog(QString("CMA-ES run %1: population %2").arg(restart + 1).arg(state.lambda));
+                QApplication::processEvents();
+            }
+#endif
+            if (log.is_open()) {
+                log << "# run " << restart + 1 << ", population " << state.lambda << "\n";
+            }
+        }
+
+        if (!run(state, log)) {
+            break;
+        }
+    }
+
+    if (!best_params_.empty()) {
+        best_model_ = *model_;
+        best_model_.setAllParameterValues(best_params_);
+        best_model_valid_ = true;
+    }
+
+    if (log.is_open()) {
+        log << "\n# Evaluations: " << evaluations_ << "\n";
+        log << "# Best fitness: " << best_fitness_ << "\n";
+        for (size_t i = 0; i < best_params_.size(); ++i) {
+            log << space_.getName(i) << ", " << best_params_[i] << "\n";
+        }
+    }
+
+    if (!best_model_valid_ && last_error_.empty()) {
+        last_error_ = "No parameter set with a finite objective was found";
+    }
+    return !cancelled_ && best_model_valid_;
+}
+
+template<class T>
+bool CCMAES<T>::run(RunState& state, std::ofstream& log)
+{
+    const int n = static_cast<int>(space_.size());
+    const int lambda = state.lambda;
+    const long budget = getEvaluationBudget();
+    if (state.generation == 0 && evaluations_ + lambda > budget && evaluations_ > 0) {
+        return false;
+    }
+
+    // Strategy parameters (Hansen 2016, Table 1)
+    const int mu = lambda / 2;
+    arma::vec w(mu);
+    for (int i = 0; i < mu; ++i) {
+        w(i) = std::log(mu + 0.5) - std::log(i + 1.0);
+    }
+    w /= arma::accu(w);
+    const double mueff = 1.0 / arma::accu(w % w);
+    const double cc = (4.0 + mueff / n) / (n + 4.0 + 2.0 * mueff / n);
+    const double cs = (mueff + 2.0) / (n + mueff + 5.0);
+    const double c1 = 2.0 / ((n + 1.3) * (n + 1.3) + mueff);
+    const double cmu = std::min(1.0 - c1, 2.0 * (mueff - 2.0 + 1.0 / mueff) / ((n + 2.0) * (n + 2.0) + mueff));
+    const double damps = 1.0 + 2.0 * std::max(0.0, std::sqrt((mueff - 1.0) / (n + 1.0)) - 1.0) + cs;
+    const double chiN = std::sqrt(static_cast<double>(n)) * (1.0 - 1.0 / (4.0 * n) + 1.0 / (21.0 * n * n));
+    const long eigen_interval = std::max(1L, static_cast<long>(lambda / ((c1 + cmu) * n * 10.0)));
+    const long max_generations = 100 + static_cast<long>(50.0 * (n + 3) * (n + 3) / std::sqrt(static_cast<double>(lambda)));
+    const size_t history_length = 10 + static_cast<size_t>(std::ceil(30.0 * n / lambda));
+
+    arma::vec& mean = state.mean;
+    arma::vec& pc = state.pc;
+    arma::vec& ps = state.ps;
+    arma::mat& C = state.C;
+    arma::mat& B = state.B;
+    arma::vec& D = state.D;
+    double& sigma = state.sigma;
+    std::deque<double>& best_history = state.best_history;
+
+    std::vector<arma::vec> population(lambda);
+    while (state.generation < max_generations) {
+        const long gen = state.generation;
+        if (evaluations_ + lambda > budget) {
+            return false;
+        }
+
+        const arma::mat BD = B * arma::diagmat(D);
+        for (int k = 0; k < lambda; ++k) {
+            population[k] = sample(mean, sigma, BD);
+        }
+
+        std::vector<double> f = evaluate(population);
+        evaluations_ += lambda;
+        ++generation_;
+
+        std::vector<int> order(lambda);
+        std::iota(order.begin(), order.end(), 0);
+        std::stable_sort(order.begin(), order.end(), [&f](int a, int b) { return f[a] < f[b]; });
+
+        const double gen_best = f[order[0]];
+        if (std::isfinite(gen_best) && -gen_best > best_fitness_) {
+            best_fitness_ = -gen_best;
+            best_params_ = toPhysical(population[order[0]]);
+        }
+
+        // Mean, evolution paths and covariance
+        const arma::vec m_old = mean;
+        mean.zeros();
+        for (int i = 0; i < mu; ++i) {
+            mean += w(i) * population[order[i]];
+        }
+        const arma::vec y_w = (mean - m_old) / sigma;
+        const arma::mat inv_sqrt_C = B * arma::diagmat(1.0 / D) * B.t();
+
+        ps = (1.0 - cs) * ps + std::sqrt(cs * (2.0 - cs) * mueff) * (inv_sqrt_C * y_w);
+        const double ps_norm = arma::norm(ps, 2);
+        const bool hsig = ps_norm / std::sqrt(1.0 - std::pow(1.0 - cs, 2.0 * (gen + 1))) / chiN <
+                          1.4 + 2.0 / (n + 1.0);
+        pc = (1.0 - cc) * pc + (hsig ? std::sqrt(cc * (2.0 - cc) * mueff) : 0.0) * y_w;
+
+        arma::mat steps(n, mu);
+        for (int i = 0; i < mu; ++i) {
+            steps.col(i) = (population[order[i]] - m_old) / sigma;
+        }
+        C = (1.0 - c1 - cmu) * C +
+            c1 * (pc * pc.t() + (hsig ? 0.0 : cc * (2.0 - cc)) * C) +
+            cmu * steps * arma::diagmat(w) * steps.t();
+
+        sigma *= std::exp((cs / damps) * (ps_norm / chiN - 1.0));
+
+        // Flat fitness: enlarge the step to escape the plateau
+        if (f[order[0]] == f[order[std::min(lambda - 1, static_cast<int>(std::ceil(0.7 * lambda)))]]) {
+            sigma *= std::exp(0.2 + cs / damps);
+        }
+        sigma = std::min(sigma, 2.0);
+
+        if (gen % eigen_interval == 0) {
+            C = arma::symmatu(C);
+            arma::vec eigval;
+            if (!arma::eig_sym(eigval, B, C)) {
+                return true;  // numerically broken run: restart
+            }
+            D.set_size(n);
+            for (int i = 0; i < n; ++i) D(i) = std::sqrt(std::max(eigval(i), 1e-300));
+        }
+
+        best_history.push_back(gen_best);
+        if (best_history.size() > history_length) {
+            best_history.pop_front();
+        }
+        state.generation = gen + 1;
+
+        if (log.is_open()) {
+            log << restarts_done_ + 1 << ", " << lambda << ", " << gen + 1 << ", " << evaluations_ << ", "
+                << sigma << ", " << -gen_best << ", " << best_fitness_ << "\n";
+        }
+
+#ifdef Q_GUI_SUPPORT
+        if (rtw_) {
+            rtw_->SetProgress(std::min(1.0, static_cast<double>(evaluations_) / budget));
+            if (std::isfinite(best_fitness_)) {
+                rtw_->AddPrimaryChartPoint(generation_, best_fitness_);
+            }
+            rtw_->AddSecondaryChartPoint(generation_, sigma * D.max());
+            QApplication::processEvents();
+            if (rtw_->IsCancelRequested()) {
+                rtw_->AppendLog("CMA-ES cancelled by user.");
+                cancelled_ = true;
+            }
+        }
+#endif
+
+        // Termination of this run (Hansen 2016, Appendix B.3)
+        const double f_range = *std::max_element(f.begin(), f.end()) - gen_best;
+        const double history_range = *std::max_element(best_history.begin(), best_history.end()) -
+                                     *std::min_element(best_history.begin(), best_history.end());
+        const bool converged =
+            (best_history.size() == history_length && history_range < settings_.tolfun && f_range < settings_.tolfun) ||
+            (sigma * arma::max(arma::sqrt(C.diag())) < settings_.tolx &&
+             sigma * arma::max(arma::abs(pc)) < settings_.tolx) ||
+            D.max() > 1e7 * D.min();
+
+        // A cancelled run can be resumed from this generation unless it just ended
+        if (cancelled_) {
+            if (settings_.checkpoint_interval > 0 && !converged) {
+                writeCheckpoint(settings_.pathname + settings_.checkpoint_filename, state, log);
+            }
+            return false;
+        }
+        if (converged) {
+            return true;
+        }
+
+        if (settings_.checkpoint_interval > 0 && generation_ % settings_.checkpoint_interval == 0) {
+            if (!writeCheckpoint(settings_.pathname + settings_.checkpoint_filename, state, log)) {
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Checkpoints
+// ============================================================================
+
+template<class T>
+bool CCMAES<T>::writeCheckpoint(const std::string& filename, const RunState& state, std::ofstream& log)
+{
+    try {
+        // The results file is truncated to this size on resume
+        int64_t log_offset = -1;
+        if (log.is_open()) {
+            log.flush();
+            std::error_code ec;
+            std::uintmax_t size = std::filesystem::file_size(settings_.pathname + settings_.outputfile, ec);
+            if (!ec) log_offset = static_cast<int64_t>(size);
+        }
+
+        CCheckpointWriter out(filename, "cmaes");
+
+        std::vector<std::string> keys, values;
+        for (const auto& property : GetProperties()) {
+            keys.push_back(property.first);
+            values.push_back(property.second);
+        }
+        out.write(keys);
+        out.write(values);
+        out.write(space_.getNames());
+
+        out.write(static_cast<int64_t>(restarts_done_));
+        out.write(static_cast<int64_t>(evaluations_));
+        out.write(static_cast<int64_t>(generation_));
+        out.write(rng_);
+        out.write(best_fitness_);
+        out.write(best_params_);
+        out.write(log_offset);
+
+        out.write(static_cast<int64_t>(state.lambda));
+        out.write(static_cast<int64_t>(state.generation));
+        out.write(state.mean);
+        out.write(state.pc);
+        out.write(state.ps);
+        out.write(state.C);
+        out.write(state.B);
+        out.write(state.D);
+        out.write(state.sigma);
+        out.write(std::vector<double>(state.best_history.begin(), state.best_history.end()));
+
+        out.close();
+    }
+    catch (const std::exception& e) {
+        last_error_ = e.what();
+        return false;
+    }
+    return true;
+}
+
+template<class T>
+bool CCMAES<T>::readCheckpoint(const std::string& filename, RunState& state, long long& log_offset)
+{
+    try {
+        CCheckpointReader in(filename, "cmaes");
+
+        // Settings of the interrupted run take precedence
+        std::vector<std::string> keys = in.readStringVector();
+        std::vector<std::string> values = in.readStringVector();
+        for (size_t i = 0; i < keys.size() && i < values.size(); ++i) {
+            if (!SetProperty(keys[i], values[i])) {
+                return false;
+            }
+        }
+
+        space_ = CParameterSpace(model_->Parameters());
+        if (in.readStringVector() != space_.getNames()) {
+            last_error_ = "Checkpoint parameters do not match the model";
+            return false;
+        }
+
+        restarts_done_ = static_cast<int>(in.readInt());
+        evaluations_ = static_cast<long>(in.readInt());
+        generation_ = static_cast<long>(in.readInt());
+        in.readRng(rng_);
+        best_fitness_ = in.readDouble();
+        best_params_ = in.readDoubleVector();
+        log_offset = static_cast<long long>(in.readInt());
+
+        state.lambda = static_cast<int>(in.readInt());
+        state.generation = static_cast<long>(in.readInt());
+        state.mean = arma::vectorise(in.readMat());
+        state.pc = arma::vectorise(in.readMat());
+        state.ps = arma::vectorise(in.readMat());
+        state.C = in.readMat();
+        state.B = in.readMat();
+        state.D = arma::vectorise(in.readMat());
+        state.sigma = in.readDouble();
+        std::vector<double> history = in.readDoubleVector();
+        state.best_history.assign(history.begin(), history.end());
+
+        if (state.mean.n_elem != space_.size() || state.C.n_rows != space_.size() || state.lambda < 2) {
+            last_error_ = "Corrupt search state in checkpoint " + filename;
+            return false;
+        }
+    }
+    catch (const std::exception& e) {
+        last_error_ = e.what();
+        return false;
+    }
+    return true;
+}
+
+template<class T>
+arma::vec CCMAES<T>::sample(const arma::vec& mean, double sigma, const arma::mat& BD)
+{
+    std::normal_distribution<double> normal(0.0, 1.0);
+    arma::vec z(mean.n_elem);
+    arma::vec x;
+
+    // Redraw infeasible candidates a few times before reflecting into [0, 1]
+    for (int attempt = 0; attempt < 10; ++attempt) {
+        for (arma::uword i = 0; i < z.n_elem; ++i) z(i) = normal(rng_);
+        x = mean + sigma * (BD * z);
+        if (x.min() >= 0.0 && x.max() <= 1.0) {
+            return x;
+        }
+    }
+
+    for (arma::uword i = 0; i < x.n_elem; ++i) {
+        double v = std::fmod(std::abs(x(i)), 2.0);
+        x(i) = v > 1.0 ? 2.0 - v : v;
+    }
+    return x;
+}
+
+template<class T>
+std::vector<double> CCMAES<T>::evaluate(const std::vector<arma::vec>& population)
+{
+    const long count = static_cast<long>(population.size());
+    std::vector<double> f(count, std::numeric_limits<double>::infinity());
+
+    parallelForWorkers(workers_, 0, count, [&](T& worker, long k) {
+        try {
+            worker.setAllParameterValues(toPhysical(population[k]));
+            double value = worker.GetObjectiveFunctionValue();
+            if (std::isfinite(value)) {
+                f[k] = -value;
+            }
+        }
+        catch (const std::exception&) {
+            // Failed forward run ranks last
+        }
+    });
+    return f;
+}
+
+template<class T>
+std::vector<double> CCMAES<T>::toPhysical(const arma::vec& x) const
+{
+    std::vector<double> u(x.n_elem);
+    for (size_t i = 0; i < u.size(); ++i) {
+        u[i] = space_.getSamplingLow(i) + x(i) * (space_.getSamplingHigh(i) - space_.getSamplingLow(i));
+    }
+    return space_.fromSampling(u);
+}
@@ -0,0 +1,229 @@
+#include "Checkpoint.h"
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+const char kMagic[8] = {'C', 'G', 'W', 'C', 'K', 'P', 'T', '\0'};
+const int64_t kVersion = 3;
+
+} // namespace
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+CCheckpointWriter::CCheckpointWriter(const std::string& filename, const std::string& kind)
+    : filename_(filename)
+    , temp_filename_(filename + ".tmp")
+    , out_(temp_filename_, std::ios::binary | std::ios::trunc)
+{
+    if (!out_.is_open()) {
+        throw std::runtime_error("Cannot create checkpoint file: " + temp_filename_);
+    }
+    writeRaw(kMagic, sizeof(kMagic));
+    write(kVersion);
+    write(kind);
+}
+
+CCheckpointWriter::~CCheckpointWriter()
+{
+    // An unfinished checkpoint is discarded; the previous one stays valid
+    if (!closed_) {
+        out_.close();
+        std::remove(temp_filename_.c_str());
+    }
+}
+
+void CCheckpointWriter::write(double value) { writeRaw(&value, sizeof(value)); }
+void CCheckpointWriter::write(int64_t value) { writeRaw(&value, sizeof(value)); }
+
+void CCheckpointWriter::write(bool value)
+{
+    uint8_t byte = value ? 1 : 0;
+    writeRaw(&byte, 1);
+}
+
+void CCheckpointWriter::write(const std::string& value)
+{
+    write(static_cast<int64_t>(value.size()));
+    writeRaw(value.data(), value.size());
+}
+
+void CCheckpointWriter::write(const std::vector<double>& values)
+{
+    write(static_cast<int64_t>(values.size()));
+    writeRaw(values.data(), values.size() * sizeof(double));
+}
+
+void CCheckpointWriter::write(const std::vector<int64_t>& values)
+{
+    write(static_cast<int64_t>(values.size()));
+    writeRaw(values.data(), values.size() * sizeof(int64_t));
+}
+
+void CCheckpointWriter::write(const std::vector<std::string>& values)
+{
+    write(static_cast<int64_t>(values.size()));
+    for (const auto& value : values) write(value);
+}
+
+void CCheckpointWriter::write(const std::vector<std::vector<double>>& values)
+{
+    write(static_cast<int64_t>(values.size()));
+    for (const auto& row : values) write(row);
+}
+
+void CCheckpointWriter::write(const arma::mat& matrix)
+{
+    write(static_cast<int64_t>(matrix.n_rows));
+    write(static_cast<int64_t>(matrix.n_cols));
+    writeRaw(matrix.memptr(), matrix.n_elem * sizeof(double));
+}
+
+void CCheckpointWriter::write(const std::mt19937_64& rng)
+{
+    // The standard textual state representation is portable between builds
+    std::ostringstream state;
+    state << rng;
+    write(state.str());
+}
+
+void CCheckpointWriter::close()
+{
+    out_.flush();
+    bool ok = out_.good();
+    out_.close();
+    if (!ok) {
+        std::remove(temp_filename_.c_str());
+        throw std::runtime_error("Failed writing checkpoint file: " + temp_filename_);
+    }
+
+    std::remove(filename_.c_str());
+    if (std::rename(temp_filename_.c_str(), filename_.c_str()) != 0) {
+        throw std::runtime_error("Cannot replace checkpoint file: " + filename_);
+    }
+    closed_ = true;
+}
+
+void CCheckpointWriter::writeRaw(const void* data, size_t bytes)
+{
+    out_.write(static_cast<const char*>(data), static_cast<std::streamsize>(bytes));
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+CCheckpointReader::CCheckpointReader(const std::string& filename, const std::string& kind)
+    : in_(filename, std::ios::binary)
+{
+    if (!in_.is_open()) {
+        throw std::runtime_error("Cannot open checkpoint file: " + filename);
+    }
+
+    char magic[sizeof(kMagic)];
+    readRaw(magic, sizeof(magic));
+    if (!std::equal(magic, magic + sizeof(magic), kMagic)) {
+        throw std::runtime_error("Not a checkpoint file: " + filename);
+    }
+    int64_t version = readInt();
+    if (version != kVersion) {
+        throw std::runtime_error("Unsupported checkpoint version " + std::to_string(version));
+    }
+    std::string file_kind = readString();
+    if (file_kind != kind) {
+        throw std::runtime_error("Checkpoint holds '" + file_kind + "', expected '" + kind + "'");
+    }
+}
+
+double CCheckpointReader::readDouble()
+{
+    double value;
+    readRaw(&value, sizeof(value));
+    return value;
+}
+
+int64_t CCheckpointReader::readInt()
+{
+    int64_t value;
+    readRaw(&value, sizeof(value));
+    return value;
+}
+
+bool CCheckpointReader::readBool()
+{
+    uint8_t byte;
+    readRaw(&byte, 1);
+    return byte != 0;
+}
+
+std::string CCheckpointReader::readString()
+{
+    int64_t size = readInt();
+    std::string value(static_cast<size_t>(size), '\0');
+    readRaw(&value[0], value.size());
+    return value;
+}
+
+std::vector<double> CCheckpointReader::readDoubleVector()
+{
+    int64_t size = readInt();
+    std::vector<double> values(static_cast<size_t>(size));
+    readRaw(values.data(), values.size() * sizeof(double));
+    return values;
+}
+
+std::vector<int64_t> CCheckpointReader::readIntVector()
+{
+    int64_t size = readInt();
+    std::vector<int64_t> values(static_cast<size_t>(size));
+    readRaw(values.data(), values.size() * sizeof(int64_t));
+    return values;
+}
+
+std::vector<std::string> CCheckpointReader::readStringVector()
+{
+    int64_t size = readInt();
+    std::vector<std::string> values;
+    for (int64_t i = 0; i < size; ++i) values.push_back(readString());
+    return values;
+}
+
+std::vector<std::vector<double>> CCheckpointReader::readDoubleMatrix()
+{
+    int64_t size = readInt();
+    std::vector<std::vector<double>> values;
+    values.reserve(static_cast<size_t>(size));
+    for (int64_t i = 0; i < size; ++i) values.push_back(readDoubleVector());
+    return values;
+}
+
+arma::mat CCheckpointReader::readMat()
+{
+    int64_t rows = readInt();
+    int64_t cols = readInt();
+    arma::mat matrix(static_cast<arma::uword>(rows), static_cast<arma::uword>(cols));
+    readRaw(matrix.memptr(), matrix.n_elem * sizeof(double));
+    return matrix;
+}
+
+void CCheckpointReader::readRng(std::mt19937_64& rng)
+{
+    std::istringstream state(readString());
+    state >> rng;
+    if (state.fail()) {
+        throw std::runtime_error("Corrupt random number generator state in checkpoint");
+    }
+}
+
+void CCheckpointReader::readRaw(void* data, size_t bytes)
+{
+    if (bytes == 0) return;
+    in_.read(static_cast<char*>(data), static_cast<std::streamsize>(bytes));
+    if (!in_) {
+        throw std::runtime_error("Unexpected end of checkpoint file");
+    }
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+#include <armadillo>
+
+/**
+ * @brief Binary checkpoint file writer
+ *
+ * A checkpoint starts with a magic string, a format version and a kind
+ * tag (e.g. "mcmc_engine") followed by raw little-endian values in the
+ * order the owner writes them. Data go to "<filename>.tmp" which replaces
+ * the target only in close(), so an interrupted write never destroys the
+ * previous checkpoint.
+ */
+class CCheckpointWriter
+{
+public:
+    /**
+     * @brief Open a checkpoint for writing
+     * @throws std::runtime_error if the temporary file cannot be created
+     */
+    CCheckpointWriter(const std::string& filename, const std::string& kind);
+    ~CCheckpointWriter();
+
+    void write(double value);
+    void write(int64_t value);
+    void write(bool value);
+    void write(const std::string& value);
+    void write(const std::vector<double>& values);
+    void write(const std::vector<int64_t>& values);
+    void write(const std::vector<std::string>& values);
+    void write(const std::vector<std::vector<double>>& values);
+    void write(const arma::mat& matrix);
+    void write(const std::mt19937_64& rng);
+    void write(const char*) = delete;        ///< Would silently bind to write(bool)
+
+    /**
+     * @brief Flush and atomically replace the target file
+     * @throws std::runtime_error on I/O failure
+     */
+    void close();
+
+private:
+    void writeRaw(const void* data, size_t bytes);
+
+    std::string filename_;
+    std::string temp_filename_;
+    std::ofstream out_;
+    bool closed_ = false;
+};
+
+/**
+ * @brief Binary checkpoint file reader
+ *
+ * Values must be read in the order they were written. Every read throws
+ * std::runtime_error if the file is truncated.
+ */
+class CCheckpointReader
+{
+public:
+    /**
+     * @brief Open a checkpoint and verify magic, version and kind
+     * @throws std::runtime_error if the file is not a checkpoint of this kind
+     */
+    CCheckpointReader(const std::string& filename, const std::string& kind);
+
+    double readDouble();
+    int64_t readInt();
+    bool readBool();
+    std::string readString();
+    std::vector<double> readDoubleVector();
+    std::vector<int64_t> readIntVector();
+    std::vector<std::string> readStringVector();
+    std::vector<std::vector<double>> readDoubleMatrix();
+    arma::mat readMat();
+    void readRng(std::mt19937_64& rng);
+
+private:
+    void readRaw(void* data, size_t bytes);
+
+    std::ifstream in_;
+};
@@ -1,4 +1,5 @@
 TEMPLATE = app
+TARGET = chronogw
 CONFIG += console c++17
 CONFIG -= app_bundle
 CONFIG -= qt
@@ -22,6 +23,19 @@ SOURCES += \
     InverseModeling/src/GA/GADistribution.cpp \
     InverseModeling/src/GA/Individual.cpp \
     LIDconfig.cpp \
+    AsyncWriter.cpp \
+    BatchRunner.cpp \
+    Checkpoint.cpp \
+    FitnessCache.cpp \
+    GlobalSensitivity.cpp \
+    LikelihoodSurrogate.cpp \
+    MCMCDiagnostics.cpp \
+    ParameterSpace.cpp \
+    PosteriorPredictive.cpp \
+    PosteriorSummary.cpp \
+    QuantileSketch.cpp \
+    SampleStore.cpp \
+    ScenarioProjection.cpp \
     Tracer.cpp \
     Utilities/Distribution.cpp \
     Utilities/Matrix.cpp \
@@ -36,6 +50,7 @@ SOURCES += \
 
 HEADERS += \
     GA.h \
+    GlobalSensitivity.h \
     GWA.h \
     InverseModeling/include/GA/Binary.h \
     InverseModeling/include/GA/Distribution.h \
@@ -50,6 +65,39 @@ HEADERS += \
     InverseModeling/observation.h \
     InverseModeling/parameter.h \
     InverseModeling/parameter_set.h \
+    AsyncWriter.h \
+    BatchRunner.h \
+    CMAES.h \
+    CMAES.hpp \
+    Checkpoint.h \
+    ESMDA.h \
+    ESMDA.hpp \
+    FitnessCache.h \
+    IslandGA.h \
+    IslandGA.hpp \
+    LaplaceApproximation.h \
+    LaplaceApproximation.hpp \
+    LikelihoodSurrogate.h \
+    MCMCDiagnostics.h \
+    MCMCEngine.h \
+    MCMCEngine.hpp \
+    MultiStartLM.h \
+    MultiStartLM.hpp \
+    ParallelWorkers.h \
+    ParameterSpace.h \
+    PosteriorPredictive.h \
+    PosteriorReweighting.h \
+    PosteriorReweighting.hpp \
+    PosteriorSummary.h \
+    ProfileLikelihood.h \
+    ProfileLikelihood.hpp \
+    QuantileSketch.h \
+    SampleStore.h \
+    ScenarioProjection.h \
+    SensitivityMatrix.h \
+    SensitivityMatrix.hpp \
+    SMCSampler.h \
+    SMCSampler.hpp \
     Tracer.h \
     Utilities/Distribution.h \
     Utilities/Matrix.h \
@@ -94,6 +94,18 @@ SOURCES += \
     InverseModeling/src/GA/GADistribution.cpp \
     InverseModeling/src/GA/Individual.cpp \
     LIDconfig.cpp \
+    AsyncWriter.cpp \
+    Checkpoint.cpp \
+    FitnessCache.cpp \
+    GlobalSensitivity.cpp \
+    LikelihoodSurrogate.cpp \
+    MCMCDiagnostics.cpp \
+    ParameterSpace.cpp \
+    PosteriorPredictive.cpp \
+    PosteriorSummary.cpp \
+    QuantileSketch.cpp \
+    SampleStore.cpp \
+    ScenarioProjection.cpp \
     MCMCSettingsDialog.cpp \
     ProgressWindow.cpp \
     TimeSeriesChartWidget.cpp \
@@ -131,6 +143,7 @@ HEADERS += \
     AboutDialog.h \
     GA.h \
     GASettingsDialog.h \
+    GlobalSensitivity.h \
     GWA.h \
     IconListWidget.h \
     InverseModeling/include/GA/Binary.h \
@@ -146,6 +159,38 @@ HEADERS += \
     InverseModeling/observation.h \
     InverseModeling/parameter.h \
     InverseModeling/parameter_set.h \
+    AsyncWriter.h \
+    CMAES.h \
+    CMAES.hpp \
+    Checkpoint.h \
+    ESMDA.h \
+    ESMDA.hpp \
+    FitnessCache.h \
+    IslandGA.h \
+    IslandGA.hpp \
+    LaplaceApproximation.h \
+    LaplaceApproximation.hpp \
+    LikelihoodSurrogate.h \
+    MCMCDiagnostics.h \
+    MCMCEngine.h \
+    MCMCEngine.hpp \
+    MultiStartLM.h \
+    MultiStartLM.hpp \
+    ParallelWorkers.h \
+    ParameterSpace.h \
+    PosteriorPredictive.h \
+    PosteriorReweighting.h \
+    PosteriorReweighting.hpp \
+    PosteriorSummary.h \
+    ProfileLikelihood.h \
+    ProfileLikelihood.hpp \
+    QuantileSketch.h \
+    SampleStore.h \
+    ScenarioProjection.h \
+    SensitivityMatrix.h \
+    SensitivityMatrix.hpp \
+    SMCSampler.h \
+    SMCSampler.hpp \
     MCMCSettingsDialog.h \
     ProgressWindow.h \
     TimeSeriesChartWidget.h \
@@ -0,0 +1,140 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <random>
+#include <armadillo>
+#include "ParameterSpace.h"
+
+#ifdef Q_GUI_SUPPORT
+class ProgressWindow;
+#endif
+
+/**
+ * @brief Settings for CESMDA
+ */
+struct ESMDASettings
+{
+    int ensemble_size = 200;             ///< Ensemble members
+    int assimilations = 4;               ///< Data assimilation steps
+    double inflation_ratio = 1.0;        ///< Ratio between successive inflation factors (1 = constant)
+    int numthreads = 1;                  ///< Threads running forward models
+    unsigned long random_seed = 0;       ///< 0 = seed from random_device
+    std::string samples_filename = "esmda_ensemble.txt";
+    std::string pathname;                ///< Directory for output files
+};
+
+/**
+ * @brief Ensemble smoother with multiple data assimilation (ES-MDA)
+ *
+ * Emerick & Reynolds (2013). An ensemble drawn from the prior is updated
+ * assimilations times with the Kalman-type update
+ *   m_j += C_md (C_dd + alpha_i C_D)^-1 (d_obs + sqrt(alpha_i) e_j - d_j)
+ * where C_md and C_dd are ensemble covariances of the parameters and the
+ * modeled data, and the inflation factors alpha_i satisfy
+ * sum(1/alpha_i) = 1. With inflation_ratio r > 1 they decrease
+ * geometrically (alpha_i proportional to r^(N_a - 1 - i)), so early steps
+ * take smaller moves.
+ *
+ * The modeled data enter through the weighted residuals
+ * (calculateWeightedResiduals()), (modeled - observed) / std, so C_D is
+ * the identity and the observations are the zero vector. Each update
+ * needs one forward run per member, all independent and run in parallel.
+ *
+ * Parameters are updated in the CParameterSpace sampling space (log for
+ * log-transformed parameters), scaled to [0, 1] and mapped through a logit,
+ * so members always stay within the bounds. The prior is uniform over the
+ * ranges. Error standard deviation parameters are held at their current
+ * values.
+ *
+ * Writes the final ensemble to samples_filename and the standard
+ * Posterior_Percentiles.txt and Posterior_Distributions.txt.
+ *
+ * @tparam T Model type providing Parameters(), getParameterValues(),
+ *           setAllParameterValues(), calculateWeightedResiduals() and
+ *           isErrorStdParameter()
+ */
+template<class T>
+class CESMDA
+{
+public:
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CESMDA();
+    explicit CESMDA(T* model);
+
+    void SetModel(T* model) { model_ = model; }
+
+    // ========================================================================
+    // Settings
+    // ========================================================================
+
+    /**
+     * @brief Set a property by name (esmda_* keys plus numthreads, pathname)
+     * @return true if the property is recognized
+     */
+    bool SetProperty(const std::string& prop, const std::string& value);
+
+    const ESMDASettings& GetSettings() const { return settings_; }
+
+    std::string getLastError() const { return last_error_; }
+
+#ifdef Q_GUI_SUPPORT
+    void SetProgressWindow(ProgressWindow* window) { rtw_ = window; }
+#endif
+
+    // ========================================================================
+    // Inversion
+    // ========================================================================
+
+    /**
+     * @brief Draw the prior ensemble and run all assimilation steps
+     * @return true if the run completed and output was written
+     */
+    bool run();
+
+    // ========================================================================
+    // Results
+    // ========================================================================
+
+    /**
+     * @brief Final ensemble in physical units, one row per member
+     */
+    const std::vector<std::vector<double>>& getEnsemble() const { return ensemble_; }
+
+    /**
+     * @brief Ensemble-mean cost 0.5 * |r|^2 before each update and after the last one
+     */
+    const std::vector<double>& getCostHistory() const { return cost_history_; }
+
+    const std::vector<std::string>& getParamNames() const { return space_.getNames(); }
+    long getModelEvaluations() const { return evaluations_; }
+    long getFailedRuns() const { return failed_runs_; }
+
+private:
+    bool forward(arma::mat& Z, arma::mat& R);
+    std::vector<double> toPhysical(const arma::vec& z) const;
+    bool writeOutput(const arma::mat& R) const;
+
+    T* model_ = nullptr;
+    std::vector<T> workers_;
+    ESMDASettings settings_;
+    CParameterSpace space_;
+    std::vector<size_t> free_;                ///< Indices of updated parameters
+    std::vector<double> fixed_;               ///< Sampling-space values of all parameters at the start
+    std::mt19937_64 rng_;
+    std::string last_error_;
+
+    std::vector<std::vector<double>> ensemble_;
+    std::vector<double> cost_history_;
+    long evaluations_ = 0;
+    long failed_runs_ = 0;
+
+#ifdef Q_GUI_SUPPORT
+    ProgressWindow* rtw_ = nullptr;
+#endif
+};
+
+#include "ESMDA.hpp"
@@ -0,0 +1,293 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <iomanip>
+#include <algorithm>
+#include <fstream>
+#include <numeric>
+#include "ParallelWorkers.h"
+#include "PosteriorSummary.h"
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#endif
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+template<class T>
+CESMDA<T>::CESMDA()
+{
+}
+
+template<class T>
+CESMDA<T>::CESMDA(T* model)
+    : model_(model)
+{
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+template<class T>
+bool CESMDA<T>::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "esmda_ensemble_size") settings_.ensemble_size = std::max(3, std::stoi(value));
+        else if (key == "esmda_assimilations") settings_.assimilations = std::max(1, std::stoi(value));
+        else if (key == "esmda_inflation_ratio") settings_.inflation_ratio = std::max(1e-3, std::stod(value));
+        else if (key == "esmda_random_seed") settings_.random_seed = std::stoul(value);
+        else if (key == "esmda_samples_filename") settings_.samples_filename = value;
+        else if (key == "numthreads") settings_.numthreads = std::max(1, std::stoi(value));
+        else if (key == "pathname") settings_.pathname = value;
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Inversion
+// ============================================================================
+
+template<class T>
+bool CESMDA<T>::run()
+{
+    if (!model_) {
+        last_error_ = "No model assigned to ES-MDA";
+        return false;
+    }
+
+    space_ = CParameterSpace(model_->Parameters());
+    const size_t n = space_.size();
+    free_.clear();
+    for (size_t i = 0; i < n; ++i) {
+        if (!model_->isErrorStdParameter(i) && space_.getSamplingHigh(i) > space_.getSamplingLow(i)) {
+            free_.push_back(i);
+        }
+    }
+    if (free_.empty()) {
+        last_error_ = "No parameters to estimate";
+        return false;
+    }
+
+    last_error_.clear();
+    ensemble_.clear();
+    cost_history_.clear();
+    evaluations_ = 0;
+    failed_runs_ = 0;
+    fixed_ = space_.toSampling(model_->getParameterValues());
+    workers_.assign(std::max(1, settings_.numthreads), *model_);
+
+    unsigned long seed = settings_.random_seed;
+    if (seed == 0) {
+        seed = std::random_device{}();
+    }
+    rng_.seed(seed);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    // Inflation factors: alpha_i proportional to r^(Na - 1 - i) with sum(1 / alpha_i) = 1
+    const int na = settings_.assimilations;
+    std::vector<double> alpha(na);
+    double inverse_sum = 0.0;
+    for (int i = 0; i < na; ++i) {
+        alpha[i] = std::pow(settings_.inflation_ratio, na - 1 - i);
+        inverse_sum += 1.0 / alpha[i];
+    }
+    for (double& a : alpha) a *= inverse_sum;
+
+    // Prior ensemble: Latin hypercube over the ranges, in logit coordinates
+    const size_t m = free_.size();
+    const int N = settings_.ensemble_size;
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    arma::mat Z(m, N);
+    std::vector<int> strata(N);
+    for (size_t j = 0; j < m; ++j) {
+        std::iota(strata.begin(), strata.end(), 0);
+        std::shuffle(strata.begin(), strata.end(), rng_);
+        for (int k = 0; k < N; ++k) {
+            double x = std::min(1.0 - 1e-9, std::max(1e-9, (strata[k] + unif(rng_)) / N));
+            Z(j, k) = std::log(x / (1.0 - x));
+        }
+    }
+
+    arma::mat R;
+    bool cancelled = false;
+    for (int step = 0; step <= na && !cancelled; ++step) {
+        if (!forward(Z, R)) {
+            return false;
+        }
+
+        double mean_cost = 0.0;
+        for (int k = 0; k < N; ++k) mean_cost += 0.5 * arma::dot(R.col(k), R.col(k));
+        mean_cost /= N;
+        cost_history_.push_back(mean_cost);
+
+#ifdef Q_GUI_SUPPORT
+        if (rtw_) {
+            rtw_->AddPrimaryChartPoint(step, mean_cost);
+            rtw_->AppendLog(QString("%1: ensemble-mean cost %2")
+                                .arg(step == 0 ? QString("Prior") : QString("Assimilation %1").arg(step))
+                                .arg(mean_cost, 0, 'e', 6));
+            rtw_->SetProgress(static_cast<double>(step + 1) / (na + 1));
+            QApplication::processEvents();
+            if (rtw_->IsCancelRequested()) {
+                rtw_->AppendLog("ES-MDA cancelled by user.");
+                cancelled = true;
+            }
+        }
+#endif
+        if (step == na || cancelled) break;
+
+        // Ensemble anomalies
+        const double scale = 1.0 / std::sqrt(N - 1.0);
+        arma::mat dZ = Z;
+        arma::mat dR = R;
+        dZ.each_col() -= arma::vec(arma::mean(Z, 1));
+        dR.each_col() -= arma::vec(arma::mean(R, 1));
+        dZ *= scale;
+        dR *= scale;
+
+        // Innovations against perturbed (zero) observations
+        arma::mat D(R.n_rows, N);
+        const double sqrt_alpha = std::sqrt(alpha[step]);
+        for (arma::uword k = 0; k < D.n_elem; ++k) D(k) = sqrt_alpha * normal(rng_);
+        D -= R;
+
+        // Solve in the smaller of data and ensemble space
+        arma::mat update;
+        bool solved;
+        if (R.n_rows <= static_cast<arma::uword>(N)) {
+            arma::mat C = dR * dR.t();
+            C.diag() += alpha[step];
+            arma::mat X;
+            solved = arma::solve(X, C, D);
+            if (solved) update = dZ * (dR.t() * X);
+        }
+        else {
+            arma::mat C = dR.t() * dR;
+            C.diag() += alpha[step];
+            arma::mat X;
+            solved = arma::solve(X, C, dR.t() * D);
+            if (solved) update = dZ * X;
+        }
+        if (!solved) {
+            last_error_ = "ES-MDA update failed: singular data covariance";
+            return false;
+        }
+        Z += update;
+    }
+
+    ensemble_.clear();
+    for (int k = 0; k < N; ++k) {
+        ensemble_.push_back(toPhysical(Z.col(k)));
+    }
+
+    if (!writeOutput(R)) {
+        last_error_ = "Cannot write ES-MDA output to " + settings_.pathname;
+        return false;
+    }
+    return !cancelled;
+}
+
+template<class T>
+bool CESMDA<T>::forward(arma::mat& Z, arma::mat& R)
+{
+    const int count = static_cast<int>(Z.n_cols);
+    std::vector<std::vector<double>> residuals(count);
+    std::vector<char> valid(count, 0);
+
+    parallelForWorkers(workers_, 0, count, [&](T& worker, long k) {
+        try {
+            worker.setAllParameterValues(toPhysical(Z.col(k)));
+            residuals[k] = worker.calculateWeightedResiduals();
+            valid[k] = std::all_of(residuals[k].begin(), residuals[k].end(),
+                                   [](double r) { return std::isfinite(r); });
+        }
+        catch (const std::exception&) {
+            valid[k] = 0;
+        }
+    });
+    evaluations_ += count;
+
+    std::vector<int> good;
+    size_t rows = 0;
+    for (int k = 0; k < count; ++k) {
+        if (valid[k] && (good.empty() || residuals[k].size() == rows)) {
+            rows = residuals[k].size();
+            good.push_back(k);
+        }
+    }
+    if (good.size() < 2 || rows == 0) {
+        last_error_ = "Fewer than two ensemble members produced valid model output";
+        return false;
+    }
+
+    // Failed members are replaced by copies of successful ones
+    std::uniform_int_distribution<size_t> pick(0, good.size() - 1);
+    R.set_size(rows, count);
+    for (int k = 0; k < count; ++k) {
+        int source = k;
+        if (!valid[k] || residuals[k].size() != rows) {
+            source = good[pick(rng_)];
+            Z.col(k) = Z.col(source);
+            ++failed_runs_;
+        }
+        R.col(k) = arma::conv_to<arma::vec>::from(residuals[source]);
+    }
+    return true;
+}
+
+template<class T>
+std::vector<double> CESMDA<T>::toPhysical(const arma::vec& z) const
+{
+    std::vector<double> u = fixed_;
+    for (size_t a = 0; a < free_.size(); ++a) {
+        const size_t i = free_[a];
+        const double x = 1.0 / (1.0 + std::exp(-z(a)));
+        u[i] = space_.getSamplingLow(i) + x * (space_.getSamplingHigh(i) - space_.getSamplingLow(i));
+    }
+    return space_.fromSampling(u);
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+template<class T>
+bool CESMDA<T>::writeOutput(const arma::mat& R) const
+{
+    std::ofstream file(settings_.pathname + settings_.samples_filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "# Model evaluations: " << evaluations_ << ", failed: " << failed_runs_ << "\n";
+    file << "# Ensemble-mean cost per step:";
+    for (double c : cost_history_) file << " " << c;
+    file << "\n";
+    file << "member";
+    for (const std::string& name : space_.getNames()) file << ", " << name;
+    file << ", cost\n";
+    file << std::scientific << std::setprecision(6);
+    for (size_t k = 0; k < ensemble_.size(); ++k) {
+        file << k;
+        for (double value : ensemble_[k]) file << ", " << value;
+        file << ", " << 0.5 * arma::dot(R.col(k), R.col(k)) << "\n";
+    }
+
+    return CPosteriorSummary(space_, ensemble_).write(settings_.pathname);
+}
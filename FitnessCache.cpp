@@ -0,0 +1,115 @@
+#include "FitnessCache.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+
+namespace {
+
+uint64_t bitsOf(double value)
+{
+    if (value == 0.0) value = 0.0;  // -0.0 and 0.0 share a key
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+} // namespace
+
+CFitnessCache::CFitnessCache(size_t capacity, size_t shards)
+    : capacity_(std::max<size_t>(1, capacity))
+    , shards_(std::max<size_t>(1, std::min(shards, capacity_)))
+{
+    shard_capacity_ = std::max<size_t>(1, capacity_ / shards_.size());
+}
+
+size_t CFitnessCache::KeyHash::operator()(const std::vector<double>& key) const
+{
+    // splitmix64 finalizer folded over the bit patterns
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ key.size();
+    for (double value : key) {
+        uint64_t x = bitsOf(value) + 0x9E3779B97F4A7C15ULL + (h << 6) + (h >> 2);
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        h ^= x ^ (x >> 31);
+    }
+    return static_cast<size_t>(h);
+}
+
+bool CFitnessCache::KeyEqual::operator()(const std::vector<double>& a, const std::vector<double>& b) const
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        if (bitsOf(a[i]) != bitsOf(b[i])) return false;
+    }
+    return true;
+}
+
+bool CFitnessCache::lookup(const std::vector<double>& key, double& value)
+{
+    const size_t hash = KeyHash()(key);
+    Shard& shard = shardFor(hash);
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        auto it = shard.index.find(key);
+        if (it != shard.index.end()) {
+            shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+            value = it->second->second;
+            ++hits_;
+            return true;
+        }
+    }
+    ++misses_;
+    return false;
+}
+
+void CFitnessCache::insert(const std::vector<double>& key, double value)
+{
+    const size_t hash = KeyHash()(key);
+    Shard& shard = shardFor(hash);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+
+    auto it = shard.index.find(key);
+    if (it != shard.index.end()) {
+        // Another thread evaluated the same vector concurrently
+        it->second->second = value;
+        shard.entries.splice(shard.entries.begin(), shard.entries, it->second);
+        return;
+    }
+
+    if (shard.entries.size() >= shard_capacity_) {
+        shard.index.erase(shard.entries.back().first);
+        shard.entries.pop_back();
+        ++evictions_;
+    }
+    shard.entries.emplace_front(key, value);
+    shard.index.emplace(key, shard.entries.begin());
+}
+
+void CFitnessCache::clear()
+{
+    for (Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.index.clear();
+        shard.entries.clear();
+    }
+    hits_ = 0;
+    misses_ = 0;
+    evictions_ = 0;
+}
+
+size_t CFitnessCache::size() const
+{
+    size_t total = 0;
+    for (const Shard& shard : shards_) {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        total += shard.entries.size();
+    }
+    return total;
+}
+
+double CFitnessCache::hitRate() const
+{
+    const long h = hits_;
+    const long total = h + misses_;
+    return total > 0 ? static_cast<double>(h) / total : 0.0;
+}
@@ -0,0 +1,89 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Bounded, thread-safe cache of objective values keyed on parameter vectors
+ *
+ * Optimizers with discrete encodings (e.g. the binary-coded GA) revisit
+ * parameter vectors they have already evaluated. A model that owns a cache
+ * looks the vector up before running the forward model, so a duplicate
+ * costs a hash lookup.
+ *
+ * Keys are compared bit for bit (0.0 and -0.0 are treated as equal). The
+ * cache is split into shards, each guarded by its own mutex and evicting
+ * its least recently used entry when full, so concurrent evaluations
+ * rarely contend. Hit, miss and eviction counters can be read at any time
+ * from any thread.
+ */
+class CFitnessCache
+{
+public:
+    /**
+     * @param capacity Maximum number of entries over all shards
+     * @param shards Number of independently locked shards
+     */
+    explicit CFitnessCache(size_t capacity = 100000, size_t shards = 16);
+
+    CFitnessCache(const CFitnessCache&) = delete;
+    CFitnessCache& operator=(const CFitnessCache&) = delete;
+
+    /**
+     * @brief Look up a parameter vector
+     * @return true and the cached value in value on a hit
+     */
+    bool lookup(const std::vector<double>& key, double& value);
+
+    /**
+     * @brief Store the value of a parameter vector, evicting the oldest entry if full
+     */
+    void insert(const std::vector<double>& key, double value);
+
+    void clear();
+
+    size_t size() const;
+    size_t capacity() const { return capacity_; }
+    long hits() const { return hits_; }
+    long misses() const { return misses_; }
+    long evictions() const { return evictions_; }
+
+    /**
+     * @brief Fraction of lookups answered from the cache
+     */
+    double hitRate() const;
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const std::vector<double>& key) const;
+    };
+
+    struct KeyEqual
+    {
+        bool operator()(const std::vector<double>& a, const std::vector<double>& b) const;
+    };
+
+    using Entry = std::pair<std::vector<double>, double>;
+
+    struct Shard
+    {
+        mutable std::mutex mutex;
+        std::list<Entry> entries;   ///< Most recently used first
+        std::unordered_map<std::vector<double>, std::list<Entry>::iterator, KeyHash, KeyEqual> index;
+    };
+
+    Shard& shardFor(size_t hash) { return shards_[hash % shards_.size()]; }
+
+    size_t capacity_;
+    size_t shard_capacity_;
+    std::vector<Shard> shards_;
+    std::atomic<long> hits_{0};
+    std::atomic<long> misses_{0};
+    std::atomic<long> evictions_{0};
+};
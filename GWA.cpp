@@ -7,6 +7,7 @@
 #include <sstream>
 #include <iomanip>
 #include <set>
+#include <limits>
 
 // ============================================================================
 // Constructors
@@ -30,8 +31,10 @@ CGWA::CGWA(const CGWA& other)
     , parameters_(other.parameters_)
     , modeled_data_(other.modeled_data_)
     , projected_data_(other.projected_data_)
+    , observation_deficit_(other.observation_deficit_)
     , settings_(other.settings_)
     , inverse_enabled_(other.inverse_enabled_)
+    , fitness_cache_(other.fitness_cache_)
 {
     linkSourceTracers();
 }
@@ -45,8 +48,10 @@ CGWA& CGWA::operator=(const CGWA& other)
         parameters_ = other.parameters_;
         modeled_data_ = other.modeled_data_;
         projected_data_ = other.projected_data_;
+        observation_deficit_ = other.observation_deficit_;
         settings_ = other.settings_;
         inverse_enabled_ = other.inverse_enabled_;
+        fitness_cache_ = other.fitness_cache_;
 
         linkSourceTracers();
     }
@@ -597,7 +602,7 @@ void CGWA::setAllParameterValues(const std::vector<double>& values)
     if (values.size() == 0)
     {
         // Apply current values from parameters
-        for (int i = 0; i < parameters_.size(); ++i) {
+        for (size_t i = 0; i < parameters_.size(); ++i) {
             Parameter* param = parameters_[i];
             if (param) {
                 applyParameterToModel(i, param->GetValue());
@@ -697,33 +702,49 @@ void CGWA::runForwardModel(bool applyparameters)
             continue;
         }
 
-        const CWell& well = wells_[well_idx];
-        const CTracer& tracer = tracers_[tracer_idx];
-
         modeled_data_.setname(i, obs.GetName());
-        TimeSeries<double> modeled;
-
-        const TimeSeries<double>& observed = obs.GetObservedData();
-        for (size_t j = 0; j < observed.size(); ++j) {
-            double time = observed.getTime(j);
-            double conc = tracer.calculateConcentration(
-                time,
-                well.getYoungAgeDistribution(),
-                well.getFractionOld(),
-                well.getVzDelay(),
-                settings_.fixed_old_tracer,
-                well.getAgeOld(),
-                well.getFractionMineral()
-                );
-
-            modeled.append(time, conc);
-        }
+        TimeSeries<double> modeled = modelObservation(i);
 
         obs.SetModeledTimeSeries(modeled);
         modeled_data_[i] = modeled;
     }
 }
 
+TimeSeries<double> CGWA::modelObservation(size_t obs_index) const
+{
+    const Observation& obs = observations_[obs_index];
+    TimeSeries<double> modeled;
+
+    int well_idx = findWell(obs.GetLocation());
+    int tracer_idx = findTracer(obs.GetQuantity());
+
+    if (well_idx < 0 || well_idx >= static_cast<int>(wells_.size()) ||
+        tracer_idx < 0 || tracer_idx >= static_cast<int>(tracers_.size())) {
+        return modeled;
+    }
+
+    const CWell& well = wells_[well_idx];
+    const CTracer& tracer = tracers_[tracer_idx];
+
+    const TimeSeries<double>& observed = obs.GetObservedData();
+    for (size_t j = 0; j < observed.size(); ++j) {
+        double time = observed.getTime(j);
+        double conc = tracer.calculateConcentration(
+            time,
+            well.getYoungAgeDistribution(),
+            well.getFractionOld(),
+            well.getVzDelay(),
+            settings_.fixed_old_tracer,
+            well.getAgeOld(),
+            well.getFractionMineral()
+            );
+
+        modeled.append(time, conc);
+    }
+
+    return modeled;
+}
+
 TimeSeriesSet<double> CGWA::runProjection()
 {
     if (!settings_.project_enabled) {
@@ -810,6 +831,238 @@ double CGWA::calculateLogLikelihood()
     return log_likelihood;
 }
 
+double CGWA::GetObjectiveFunctionValue()
+{
+    if (!fitness_cache_) {
+        return calculateLogLikelihood();
+    }
+
+    const std::vector<double> key = getParameterValues();
+    double value;
+    if (fitness_cache_->lookup(key, value)) {
+        return value;
+    }
+    value = calculateLogLikelihood();
+    fitness_cache_->insert(key, value);
+    return value;
+}
+
+double CGWA::calculateLogLikelihood(double rejection_threshold, std::vector<double>* terms_out)
+{
+    setAllParameterValues();
+
+    const size_t n = observations_.size();
+    modeled_data_ = TimeSeriesSet<double>(n);
+
+    std::vector<double> bounds(n);
+    double remaining_bound = 0.0;
+    for (size_t i = 0; i < n; ++i) {
+        bounds[i] = observationLikelihoodBound(i);
+        remaining_bound += bounds[i];
+    }
+
+    double oldest_time = getOldestInputTime();
+    std::vector<bool> distribution_ready(wells_.size(), false);
+
+    std::vector<double> terms(n, 0.0);
+    double log_likelihood = 0.0;
+    for (size_t i : observationEvaluationOrder()) {
+        Observation& obs = observations_[i];
+
+        // Age distributions are built only for wells that are reached
+        int well_idx = findWell(obs.GetLocation());
+        if (well_idx >= 0 && well_idx < static_cast<int>(wells_.size()) &&
+            !distribution_ready[well_idx]) {
+            wells_[well_idx].createDistribution(oldest_time, 1000, 0.02);
+            distribution_ready[well_idx] = true;
+        }
+
+        TimeSeries<double> modeled = modelObservation(i);
+        modeled_data_.setname(i, obs.GetName());
+        obs.SetModeledTimeSeries(modeled);
+        modeled_data_[i] = modeled;
+
+        double term = calculateObservationLikelihood(i);
+        terms[i] = term;
+        log_likelihood += term;
+        remaining_bound -= bounds[i];
+
+        if (std::isfinite(term)) {
+            observation_deficit_[i] = 0.9 * observation_deficit_[i] + 0.1 * (bounds[i] - term);
+        }
+
+        if (log_likelihood + remaining_bound < rejection_threshold) {
+            return -std::numeric_limits<double>::infinity();
+        }
+    }
+
+    // Sum in observation order so the result does not depend on the
+    // evaluation order (restarted chains reproduce the same values)
+    log_likelihood = 0.0;
+    for (double term : terms) {
+        log_likelihood += term;
+    }
+    if (terms_out) {
+        *terms_out = terms;
+    }
+
+    // Check for NaN
+    if (std::isnan(log_likelihood)) {
+        log_likelihood = -30000.0;
+    }
+
+    return log_likelihood;
+}
+
+std::vector<size_t> CGWA::observationEvaluationOrder()
+{
+    const size_t n = observations_.size();
+    if (observation_deficit_.size() != n) {
+        observation_deficit_.assign(n, 0.0);
+    }
+
+    // Largest expected drop below the bound per data point first
+    std::vector<double> score(n);
+    for (size_t i = 0; i < n; ++i) {
+        double points = static_cast<double>(observations_[i].GetObservedData().size()) + 1.0;
+        score[i] = observation_deficit_[i] / points;
+    }
+
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; ++i) order[i] = i;
+    std::stable_sort(order.begin(), order.end(),
+                     [&score](size_t a, size_t b) { return score[a] > score[b]; });
+    return order;
+}
+
+double CGWA::observationLikelihoodBound(size_t obs_index) const
+{
+    const Observation& obs = observations_[obs_index];
+
+    double std_dev = obs.GetErrorStdDev();
+    if (std_dev <= 0.0) {
+        return 0.0;
+    }
+
+    // Unmodeled observations contribute zero
+    int well_idx = findWell(obs.GetLocation());
+    int tracer_idx = findTracer(obs.GetQuantity());
+    if (well_idx < 0 || well_idx >= static_cast<int>(wells_.size()) ||
+        tracer_idx < 0 || tracer_idx >= static_cast<int>(tracers_.size())) {
+        return 0.0;
+    }
+
+    // Only these structures contribute to calculateObservationLikelihood()
+    const std::string structure = obs.GetErrorStructure();
+    if (structure != "normal" && structure != "log-normal") {
+        return 0.0;
+    }
+
+    // -log(std) per modeled point at most, and there are at most as many
+    // modeled as observed points; with std >= 1 the term cannot exceed 0
+    double points = static_cast<double>(obs.GetObservedData().size());
+    double data_ratio = 1.0;
+    if (obs.GetCountMax() && !obs.HasDetectionLimit() && points > 0.0) {
+        data_ratio = 1.0 / points;
+    }
+
+    return data_ratio * std::max(0.0, -std::log(std_dev)) * points;
+}
+
+double CGWA::calculateLogPrior() const
+{
+    double log_prior = 0.0;
+
+    for (int i = 0; i < static_cast<int>(parameters_.size()); ++i) {
+        const Parameter* param = parameters_[i];
+        if (!param) continue;
+
+        double value = param->GetValue();
+        auto range = param->GetRange();
+        if (value < range.low || value > range.high) {
+            return -std::numeric_limits<double>::infinity();
+        }
+
+        std::string dist = param->GetPriorDistribution();
+        if (dist == "normal") {
+            double mean = (range.low + range.high) / 2.0;
+            double std_dev = (range.high - range.low) / 4.0;
+            if (std_dev > 0.0) {
+                double z = (value - mean) / std_dev;
+                log_prior -= 0.5 * z * z + std::log(std_dev);
+            }
+        }
+        else if (dist == "log-normal" && range.low > 0.0 && value > 0.0) {
+            double log_mean = 0.5 * (std::log(range.low) + std::log(range.high));
+            double std_dev = (std::log(range.high) - std::log(range.low)) / 4.0;
+            if (std_dev > 0.0) {
+                double z = (std::log(value) - log_mean) / std_dev;
+                log_prior -= 0.5 * z * z + std::log(std_dev) + std::log(value);
+            }
+        }
+        else if (range.high > range.low) {
+            log_prior -= std::log(range.high - range.low);
+        }
+    }
+
+    return log_prior;
+}
+
+double CGWA::calculateLogPosteriorGradient(std::vector<double>& gradient, double relative_step)
+{
+    const size_t n = static_cast<size_t>(parameters_.size());
+    gradient.assign(n, 0.0);
+
+    double log_prior = calculateLogPrior();
+    if (!std::isfinite(log_prior)) {
+        return -std::numeric_limits<double>::infinity();
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        const Parameter* param = parameters_[static_cast<int>(i)];
+        if (!param) continue;
+
+        double value = param->GetValue();
+        auto range = param->GetRange();
+        double h = relative_step * (range.high - range.low);
+        if (!(h > 0.0)) {
+            h = relative_step * std::max(1.0, std::fabs(value));
+        }
+
+        // Central difference where possible, one-sided at the bounds
+        double x_up = std::min(value + h, range.high);
+        double x_down = std::max(value - h, range.low);
+        if (x_up <= x_down) continue;
+
+        SetParameterValue(i, x_up);
+        double logl_up = calculateLogLikelihood();
+        SetParameterValue(i, x_down);
+        double logl_down = calculateLogLikelihood();
+        SetParameterValue(i, value);
+
+        gradient[i] = (logl_up - logl_down) / (x_up - x_down);
+
+        std::string dist = param->GetPriorDistribution();
+        if (dist == "normal") {
+            double mean = (range.low + range.high) / 2.0;
+            double std_dev = (range.high - range.low) / 4.0;
+            if (std_dev > 0.0) {
+                gradient[i] -= (value - mean) / (std_dev * std_dev);
+            }
+        }
+        else if (dist == "log-normal" && range.low > 0.0 && value > 0.0) {
+            double log_mean = 0.5 * (std::log(range.low) + std::log(range.high));
+            double std_dev = (std::log(range.high) - std::log(range.low)) / 4.0;
+            if (std_dev > 0.0) {
+                gradient[i] -= ((std::log(value) - log_mean) / (std_dev * std_dev) + 1.0) / value;
+            }
+        }
+    }
+
+    // Evaluate last at the original point so modeled data match the parameters
+    return calculateLogLikelihood() + log_prior;
+}
+
 double CGWA::calculateObservationLikelihood(size_t obs_index) const
 {
     if (obs_index >= observations_.size()) {
@@ -828,17 +1081,6 @@ double CGWA::calculateObservationLikelihood(size_t obs_index) const
     const TimeSeries<double>& observed = obs.GetObservedData();
     const TimeSeries<double>& modeled = modeled_data_[obs_index];
 
-    std::cout << "=== Observation Likelihood Debug ===" << std::endl;
-    std::cout << "Observation index: " << obs_index << std::endl;
-    std::cout << "std_dev (σ): " << std_dev << std::endl;
-    std::cout << "Observed data points: " << observed.size() << std::endl;
-    std::cout << "Modeled data points: " << modeled.size() << std::endl;
-    if (observed.size() > 0 && modeled.size() > 0) {
-        std::cout << "Observed[0]: t=" << observed[0].t << ", c=" << observed[0].c << std::endl;
-        std::cout << "Modeled[0]: t=" << modeled[0].t << ", c=" << modeled[0].c << std::endl;
-        std::cout << "Residual: " << (observed[0].c - modeled[0].c) << std::endl;
-    }
-
     // Data ratio for normalization
     double data_ratio = 1.0;
     if (obs.GetCountMax()) {
@@ -884,6 +1126,84 @@ double CGWA::calculateObservationLikelihood(size_t obs_index) const
     return log_p;
 }
 
+void CGWA::appendObservationResiduals(size_t obs_index, std::vector<double>& residuals) const
+{
+    const Observation& obs = observations_[obs_index];
+
+    double std_dev = obs.GetErrorStdDev();
+    if (std_dev <= 0.0) {
+        return;  // Not part of the likelihood
+    }
+
+    const TimeSeries<double>& observed = obs.GetObservedData();
+    const TimeSeries<double>& modeled = modeled_data_[obs_index];
+
+    // Same transformations as calculateObservationLikelihood()
+    double scale = 1.0 / std_dev;
+    TimeSeries<double> difference;
+    if (obs.HasDetectionLimit()) {
+        TimeSeries<double> obs_clamped = max(observed, obs.GetDetectionLimitValue());
+        TimeSeries<double> mod_clamped = max(modeled, obs.GetDetectionLimitValue());
+        if (obs.GetErrorStructure() == "normal") {
+            difference = mod_clamped > obs_clamped;
+        }
+        else if (obs.GetErrorStructure() == "log-normal") {
+            difference = mod_clamped.log(obs.GetDetectionLimitValue()) > obs_clamped.log(obs.GetDetectionLimitValue());
+        }
+    }
+    else {
+        if (obs.GetCountMax()) {
+            scale *= std::sqrt(1.0 / static_cast<double>(observed.size()));
+        }
+        if (obs.GetErrorStructure() == "normal") {
+            difference = modeled > observed;
+        }
+        else if (obs.GetErrorStructure() == "log-normal") {
+            difference = modeled.log(1e-8) > observed.log(1e-8);
+        }
+    }
+
+    for (size_t i = 0; i < static_cast<size_t>(difference.size()); ++i) {
+        residuals.push_back(scale * difference.getValue(i));
+    }
+}
+
+std::vector<double> CGWA::calculateWeightedResiduals()
+{
+    runForwardModel();
+
+    std::vector<double> residuals;
+    for (size_t i = 0; i < observations_.size(); ++i) {
+        appendObservationResiduals(i, residuals);
+    }
+    return residuals;
+}
+
+std::vector<double> CGWA::calculateObservationLogLikelihoods()
+{
+    runForwardModel();
+
+    std::vector<double> terms(observations_.size());
+    for (size_t i = 0; i < observations_.size(); ++i) {
+        terms[i] = calculateObservationLikelihood(i);
+    }
+    return terms;
+}
+
+bool CGWA::isErrorStdParameter(size_t index) const
+{
+    const Parameter* param = parameters_[static_cast<int>(index)];
+    if (!param) {
+        return false;
+    }
+    for (const auto& obs : observations_) {
+        if (obs.GetStdParameterName() == param->GetName()) {
+            return true;
+        }
+    }
+    return false;
+}
+
 // ============================================================================
 // Serialization / Output
 // ============================================================================
@@ -910,7 +1230,7 @@ std::string CGWA::parametersToString() const
     // Parameters (if inverse modeling)
     if (inverse_enabled_) {
         oss << "\nInverse Modeling Parameters (" << parameters_.size() << "):\n";
-        for (int i = 0; i < parameters_.size(); ++i) {
+        for (size_t i = 0; i < parameters_.size(); ++i) {
             const Parameter* param = parameters_[i];
             if (!param) continue;
 
@@ -957,7 +1277,7 @@ void CGWA::writeParameterValues(std::ostream& out) const
 {
     out << std::fixed << std::setprecision(8);
 
-    for (int i = 0; i < parameters_.size(); ++i) {
+    for (size_t i = 0; i < parameters_.size(); ++i) {
         const Parameter* param = parameters_[i];
         if (param) {
             out << param->GetName() << "\t" << param->GetValue() << "\n";
@@ -970,7 +1290,7 @@ const std::vector<double> CGWA::getParameterValues() const
     std::vector<double> values;
     values.reserve(parameters_.size());
 
-    for (int i = 0; i < parameters_.size(); ++i) {
+    for (size_t i = 0; i < parameters_.size(); ++i) {
         const Parameter* param = parameters_[i];
         if (param) {
             values.push_back(param->GetValue());
@@ -1013,7 +1333,7 @@ bool CGWA::exportToFile(const std::string& filename) const
 
         // Find parameters that apply to this well
         std::map<std::string, std::string> well_params;
-        for (int i = 0; i < parameters_.size(); ++i) {
+        for (size_t i = 0; i < parameters_.size(); ++i) {
             const Parameter* param = parameters_[i];
             if (!param) continue;
 
@@ -1075,7 +1395,7 @@ bool CGWA::exportToFile(const std::string& filename) const
 
         // Find parameters that apply to this tracer
         std::map<std::string, std::string> tracer_params;
-        for (int i = 0; i < parameters_.size(); ++i) {
+        for (size_t i = 0; i < parameters_.size(); ++i) {
             const Parameter* param = parameters_[i];
             if (!param) continue;
 
@@ -1224,7 +1544,7 @@ bool CGWA::exportToFile(const std::string& filename) const
     file << "\n";
 
     // Write parameters
-    for (int i = 0; i < parameters_.size(); ++i) {
+    for (size_t i = 0; i < parameters_.size(); ++i) {
         const Parameter* param = parameters_[i];
         if (!param) continue;
 
@@ -10,6 +10,7 @@
 #include <memory>
 #include "parameter_set.h"
 #include "observation.h"
+#include "FitnessCache.h"
 
 
 
@@ -204,7 +205,81 @@ public:
      * Used by MCMC and optimization algorithms
      */
     double calculateLogLikelihood();
-    double GetObjectiveFunctionValue() {return calculateLogLikelihood(); }
+
+    /**
+     * @brief Objective for optimizers: log-likelihood, memoized if a cache is set
+     *
+     * On a cache hit the forward model is not run, so modeled data keep the
+     * values of the previous evaluation.
+     */
+    double GetObjectiveFunctionValue();
+
+    /**
+     * @brief Share a fitness cache with this model and all later copies
+     * @param cache Cache keyed on parameter values, or nullptr to disable
+     */
+    void SetFitnessCache(std::shared_ptr<CFitnessCache> cache) { fitness_cache_ = cache; }
+    std::shared_ptr<CFitnessCache> getFitnessCache() const { return fitness_cache_; }
+
+    /**
+     * @brief Calculate log-likelihood with early termination
+     * @param rejection_threshold Log-likelihood below which the caller rejects
+     * @param terms If given, receives the term of each observation (as
+     *        calculateObservationLogLikelihoods()) when the full likelihood
+     *        is returned; left unchanged on early termination
+     * @return Log-likelihood, or -infinity once it is certain to fall below
+     *         the threshold
+     *
+     * Observations are modeled and evaluated one at a time, the most
+     * informative first. After each one the partial sum plus the upper bounds
+     * of the remaining terms is compared with the threshold. Modeled data are
+     * only complete when the full likelihood is returned.
+     */
+    double calculateLogLikelihood(double rejection_threshold, std::vector<double>* terms = nullptr);
+
+    /**
+     * @brief Calculate log prior density for current parameter values
+     * @return Log prior density, or -infinity if a value is outside its range
+     *
+     * Prior moments follow the same convention as loadParameters():
+     * normal and log-normal priors place +/-2 sigma at the range bounds.
+     * All priors are truncated to [low, high].
+     */
+    double calculateLogPrior() const;
+
+    /**
+     * @brief Log-posterior and its gradient for current parameter values
+     * @param gradient Receives d(log-posterior)/d(parameter value)
+     * @param relative_step Finite-difference step as a fraction of each parameter range
+     * @return Log-likelihood plus log prior, or -infinity outside the prior range
+     *
+     * The likelihood gradient is obtained by central differences (one-sided
+     * at the range bounds); the prior gradient is analytic. Costs one forward
+     * run plus two per parameter. Leaves the model at the original values.
+     */
+    double calculateLogPosteriorGradient(std::vector<double>& gradient, double relative_step = 1e-5);
+
+    /**
+     * @brief Run the forward model and return weighted residuals
+     * @return One residual per observed value, in observation order
+     *
+     * Residuals are scaled by the error standard deviation (and the data
+     * ratio when count_max is set) so that calculateLogLikelihood() equals
+     * -0.5 * sum(r^2) minus the log(std) terms. Least-squares methods such as
+     * Levenberg-Marquardt minimize their sum of squares.
+     */
+    std::vector<double> calculateWeightedResiduals();
+
+    /**
+     * @brief Run the forward model and return the log-likelihood of each observation
+     * @return One term per observation; their sum is calculateLogLikelihood()
+     */
+    std::vector<double> calculateObservationLogLikelihoods();
+
+    /**
+     * @brief Whether a parameter is the error standard deviation of an observation
+     */
+    bool isErrorStdParameter(size_t index) const;
 
     bool GetSolutionFailed() {return false; }
     /**
@@ -471,6 +546,30 @@ private:
      */
     double calculateObservationLikelihood(size_t obs_index) const;
 
+    /**
+     * @brief Append the weighted residuals of one observation (see calculateWeightedResiduals())
+     */
+    void appendObservationResiduals(size_t obs_index, std::vector<double>& residuals) const;
+
+    /**
+     * @brief Upper bound of calculateObservationLikelihood()
+     *
+     * Zero residuals at every observed point (the modeled series is never
+     * longer than the observed one); 0 for error structures the likelihood
+     * ignores and whenever std >= 1 makes every term non-positive.
+     */
+    double observationLikelihoodBound(size_t obs_index) const;
+
+    /**
+     * @brief Model one observation; well age distributions must be current
+     */
+    TimeSeries<double> modelObservation(size_t obs_index) const;
+
+    /**
+     * @brief Order in which early-rejection evaluates observations
+     */
+    std::vector<size_t> observationEvaluationOrder();
+
 
 
     // ========================================================================
@@ -489,10 +588,16 @@ private:
     TimeSeriesSet<double> modeled_data_;
     TimeSeriesSet<double> projected_data_;
 
+    // Running mean of (bound - likelihood) per observation for early rejection
+    std::vector<double> observation_deficit_;
+
     // Settings
     ModelSettings settings_;
     bool inverse_enabled_;
 
+    // Objective values shared between copies (optional)
+    std::shared_ptr<CFitnessCache> fitness_cache_;
+
     // Configuration file parser state (temporary during loading)
     struct ConfigData {
         std::vector<std::string> keywords;
@@ -0,0 +1,514 @@
+#include "GlobalSensitivity.h"
+#include "ParallelWorkers.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <random>
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#include <QString>
+#endif
+
+namespace {
+
+/// Time average of a modeled series; empty series count as constant zero
+double seriesMean(const TimeSeries<double>& series)
+{
+    if (series.size() == 0) return 0.0;
+    double sum = 0.0;
+    for (size_t i = 0; i < series.size(); ++i) sum += series.getValue(i);
+    return sum / series.size();
+}
+
+/// Additive recurrence with the generalized golden ratio of the dimension
+/// (Roberts, 2018); low discrepancy in any number of dimensions
+std::vector<double> kroneckerGenerators(size_t dimensions)
+{
+    // phi is the positive root of x^(D + 1) = x + 1
+    double phi = 2.0;
+    for (int i = 0; i < 50; ++i) {
+        phi = std::pow(1.0 + phi, 1.0 / (dimensions + 1.0));
+    }
+    std::vector<double> alpha(dimensions);
+    double power = 1.0;
+    for (size_t j = 0; j < dimensions; ++j) {
+        power /= phi;
+        alpha[j] = power - std::floor(power);
+    }
+    return alpha;
+}
+
+double percentile(std::vector<double> values, double p)
+{
+    if (values.empty()) return std::numeric_limits<double>::quiet_NaN();
+    std::sort(values.begin(), values.end());
+    double position = p * (values.size() - 1);
+    size_t lower = static_cast<size_t>(position);
+    size_t upper = std::min(lower + 1, values.size() - 1);
+    return values[lower] + (position - lower) * (values[upper] - values[lower]);
+}
+
+} // namespace
+
+// ============================================================================
+// Constructors and settings
+// ============================================================================
+
+CGlobalSensitivity::CGlobalSensitivity()
+{
+}
+
+CGlobalSensitivity::CGlobalSensitivity(CGWA* model)
+    : model_(model)
+{
+}
+
+bool CGlobalSensitivity::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "gsa_method") {
+            if (value != "sobol" && value != "morris" && value != "both") {
+                last_error_ = "Unknown sensitivity method: " + value;
+                return false;
+            }
+            settings_.method = value;
+        }
+        else if (key == "gsa_base_samples") settings_.base_samples = std::max(8, std::stoi(value));
+        else if (key == "gsa_bootstrap") settings_.bootstrap = std::max(0, std::stoi(value));
+        else if (key == "gsa_morris_trajectories") settings_.morris_trajectories = std::max(2, std::stoi(value));
+        else if (key == "gsa_morris_levels") {
+            // Even levels keep the step on the grid
+            int levels = std::max(2, std::stoi(value));
+            settings_.morris_levels = levels + levels % 2;
+        }
+        else if (key == "gsa_projections") settings_.projections = (value != "no" && value != "false" && value != "0");
+        else if (key == "gsa_batch_size") settings_.batch_size = std::max(0, std::stoi(value));
+        else if (key == "gsa_random_seed") settings_.random_seed = std::stoul(value);
+        else if (key == "numthreads") settings_.numthreads = std::max(1, std::stoi(value));
+        else if (key == "pathname") settings_.pathname = value;
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+std::vector<std::string> CGlobalSensitivity::getParamNames() const
+{
+    std::vector<std::string> names;
+    for (size_t i : free_) names.push_back(space_.getName(i));
+    return names;
+}
+
+// ============================================================================
+// Evaluation
+// ============================================================================
+
+std::vector<double> CGlobalSensitivity::toPhysical(const arma::vec& z) const
+{
+    std::vector<double> values = base_values_;
+    for (size_t k = 0; k < free_.size(); ++k) {
+        const size_t i = free_[k];
+        const double lo = space_.getSamplingLow(i);
+        const double hi = space_.getSamplingHigh(i);
+        values[i] = space_.fromSampling(i, lo + (hi - lo) * z(k));
+    }
+    return values;
+}
+
+bool CGlobalSensitivity::evaluate(CGWA& workspace, const arma::vec& z, std::vector<double>& outputs) const
+{
+    outputs.clear();
+    try {
+        workspace.setAllParameterValues(toPhysical(z));
+        workspace.runForwardModel();
+
+        const TimeSeriesSet<double>& modeled = workspace.getModeledData();
+        for (size_t i = 0; i < workspace.getObservationCount(); ++i) {
+            outputs.push_back(i < modeled.size() ? seriesMean(modeled[i]) : 0.0);
+        }
+        if (settings_.projections && workspace.getSettings().project_enabled) {
+            TimeSeriesSet<double> projected = workspace.runProjection();
+            for (size_t k = 0; k < projected.size(); ++k) {
+                outputs.push_back(seriesMean(projected[k]));
+            }
+        }
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    return std::all_of(outputs.begin(), outputs.end(), [](double v) { return std::isfinite(v); });
+}
+
+bool CGlobalSensitivity::evaluateAll(const std::vector<arma::vec>& points, arma::mat& outputs,
+                                     double progress_from, double progress_to)
+{
+    const long n = static_cast<long>(points.size());
+    const size_t m = output_names_.size();
+    const int threads = static_cast<int>(workers_.size());
+    const long batch = settings_.batch_size > 0 ? settings_.batch_size : 8L * threads;
+    outputs.set_size(n, m);
+
+    std::vector<std::vector<double>> results(std::min(batch, std::max(n, 1L)));
+    std::vector<char> valid(results.size());
+    for (long start = 0; start < n; start += batch) {
+        const long count = std::min(batch, n - start);
+
+        parallelForWorkers(workers_, 0, count, [&](CGWA& worker, long k) {
+            valid[k] = evaluate(worker, points[start + k], results[k]) && results[k].size() == m;
+        });
+
+        for (long k = 0; k < count; ++k) {
+            evaluations_++;
+            if (!valid[k]) {
+                failed_runs_++;
+                outputs.row(start + k).fill(std::numeric_limits<double>::quiet_NaN());
+                continue;
+            }
+            for (size_t j = 0; j < m; ++j) outputs(start + k, j) = results[k][j];
+        }
+
+#ifdef Q_GUI_SUPPORT
+        if (rtw_) {
+            rtw_->SetProgress(progress_from + (progress_to - progress_from) * (start + count) / n);
+            QApplication::processEvents();
+            if (rtw_->IsCancelRequested()) {
+                rtw_->AppendLog("Sensitivity analysis cancelled by user.");
+                last_error_ = "Cancelled by user";
+                return false;
+            }
+        }
+#else
+        (void)progress_from;
+        (void)progress_to;
+#endif
+    }
+    return true;
+}
+
+// ============================================================================
+// Analysis
+// ============================================================================
+
+bool CGlobalSensitivity::run()
+{
+    if (!model_) {
+        last_error_ = "No model assigned";
+        return false;
+    }
+
+    space_ = CParameterSpace(model_->Parameters());
+    base_values_ = model_->getParameterValues();
+    free_.clear();
+    for (size_t i = 0; i < space_.size(); ++i) {
+        if (!model_->isErrorStdParameter(i) && space_.getSamplingHigh(i) > space_.getSamplingLow(i)) {
+            free_.push_back(i);
+        }
+    }
+    if (free_.empty()) {
+        last_error_ = "No parameters with a range to vary";
+        return false;
+    }
+
+    seed_ = settings_.random_seed != 0 ? settings_.random_seed : std::random_device{}();
+    evaluations_ = 0;
+    failed_runs_ = 0;
+    first_order_.reset();
+    total_order_.reset();
+    first_order_ci_.reset();
+    total_order_ci_.reset();
+    mu_star_.reset();
+    mu_.reset();
+    sigma_.reset();
+
+    // A run at the range centre names the outputs (projection series vary by model)
+    workers_.assign(std::max(1, settings_.numthreads), *model_);
+    std::vector<double> reference;
+    arma::vec centre(free_.size());
+    centre.fill(0.5);
+    if (!evaluate(workers_[0], centre, reference)) {
+        last_error_ = "The model fails at the centre of the parameter ranges";
+        return false;
+    }
+    output_names_.clear();
+    for (size_t i = 0; i < model_->getObservationCount(); ++i) {
+        output_names_.push_back(model_->getObservation(i).GetName());
+    }
+    if (settings_.projections && model_->getSettings().project_enabled) {
+        TimeSeriesSet<double> projected = workers_[0].getProjectedData();
+        for (size_t k = 0; k < projected.size(); ++k) {
+            output_names_.push_back("Projection: " + projected.getSeriesName(static_cast<int>(k)));
+        }
+    }
+    if (output_names_.empty() || output_names_.size() != reference.size()) {
+        last_error_ = "The model has no observations or projections to analyse";
+        return false;
+    }
+
+    const bool sobol = settings_.method != "morris";
+    const bool morris = settings_.method != "sobol";
+    if (sobol && !runSobol()) return false;
+    if (morris && !runMorris()) return false;
+
+    bool ok = true;
+    const std::string& path = settings_.pathname;
+    if (sobol) {
+        ok = writeMatrix(path + "Sobol_First_Order.txt", first_order_) &&
+             writeMatrix(path + "Sobol_Total.txt", total_order_);
+        if (ok && settings_.bootstrap > 0) {
+            ok = writeMatrix(path + "Sobol_First_Order_CI95.txt", first_order_ci_) &&
+                 writeMatrix(path + "Sobol_Total_CI95.txt", total_order_ci_);
+        }
+    }
+    if (ok && morris) {
+        ok = writeMatrix(path + "Morris_Mu_Star.txt", mu_star_) &&
+             writeMatrix(path + "Morris_Mu.txt", mu_) &&
+             writeMatrix(path + "Morris_Sigma.txt", sigma_);
+    }
+    if (!ok) {
+        last_error_ = "Cannot write sensitivity output to " + path;
+    }
+    return ok;
+}
+
+bool CGlobalSensitivity::runSobol()
+{
+    const size_t d = free_.size();
+    const size_t N = settings_.base_samples;
+    const size_t m = output_names_.size();
+    const size_t stride = d + 2;
+
+    // Rows of A and B from one 2d-dimensional sequence; row j of AB_i is A_j with column i of B_j
+    std::mt19937_64 rng(seed_);
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    const std::vector<double> alpha = kroneckerGenerators(2 * d);
+    std::vector<double> shift(2 * d);
+    for (double& s : shift) s = unif(rng);
+
+    std::vector<arma::vec> points;
+    points.reserve(N * stride);
+    for (size_t j = 0; j < N; ++j) {
+        arma::vec a(d), b(d);
+        for (size_t i = 0; i < d; ++i) {
+            double u = shift[i] + (j + 1) * alpha[i];
+            double v = shift[d + i] + (j + 1) * alpha[d + i];
+            a(i) = u - std::floor(u);
+            b(i) = v - std::floor(v);
+        }
+        points.push_back(a);
+        points.push_back(b);
+        for (size_t i = 0; i < d; ++i) {
+            arma::vec ab = a;
+            ab(i) = b(i);
+            points.push_back(ab);
+        }
+    }
+
+#ifdef Q_GUI_SUPPORT
+    if (rtw_) {
+        rtw_->AppendLog(QString("Sobol indices: %1 base samples, %2 forward runs")
+                            .arg(static_cast<qulonglong>(N)).arg(static_cast<qulonglong>(points.size())));
+    }
+#endif
+    const double progress_to = settings_.method == "both" ? 0.8 : 1.0;
+    arma::mat outputs;
+    if (!evaluateAll(points, outputs, 0.0, progress_to)) {
+        return false;
+    }
+
+    // Base rows with every run valid
+    std::vector<size_t> rows;
+    for (size_t j = 0; j < N; ++j) {
+        bool ok = true;
+        for (size_t c = 0; c < stride && ok; ++c) ok = std::isfinite(outputs(j * stride + c, 0));
+        if (ok) rows.push_back(j);
+    }
+    if (rows.size() < 2) {
+        last_error_ = "Too few successful forward runs for Sobol indices";
+        return false;
+    }
+
+    // Indices of all outputs and parameters from a set of base rows
+    auto indices = [&](const std::vector<size_t>& use, arma::mat& first, arma::mat& total) {
+        first.zeros(m, d);
+        total.zeros(m, d);
+        const double n = static_cast<double>(use.size());
+        for (size_t o = 0; o < m; ++o) {
+            double sum = 0.0, sum2 = 0.0;
+            for (size_t j : use) {
+                const double fa = outputs(j * stride, o), fb = outputs(j * stride + 1, o);
+                sum += fa + fb;
+                sum2 += fa * fa + fb * fb;
+            }
+            const double mean = sum / (2.0 * n);
+            const double variance = sum2 / (2.0 * n) - mean * mean;
+            if (!(variance > 1e-14 * std::max(1.0, mean * mean))) continue;  // output does not vary
+            for (size_t i = 0; i < d; ++i) {
+                double s1 = 0.0, st = 0.0;
+                for (size_t j : use) {
+                    const double fa = outputs(j * stride, o), fb = outputs(j * stride + 1, o);
+                    const double fab = outputs(j * stride + 2 + i, o);
+                    s1 += fb * (fab - fa);
+                    st += (fa - fab) * (fa - fab);
+                }
+                first(o, i) = s1 / n / variance;
+                total(o, i) = st / (2.0 * n) / variance;
+            }
+        }
+    };
+    indices(rows, first_order_, total_order_);
+
+    // Percentile bootstrap over base rows; half-width of the 95% interval
+    const int B = settings_.bootstrap;
+    if (B > 0) {
+        std::vector<arma::mat> first_b(B), total_b(B);
+        std::uniform_int_distribution<size_t> pick(0, rows.size() - 1);
+        std::vector<size_t> use(rows.size());
+        for (int b = 0; b < B; ++b) {
+            for (size_t& r : use) r = rows[pick(rng)];
+            indices(use, first_b[b], total_b[b]);
+        }
+        first_order_ci_.zeros(m, d);
+        total_order_ci_.zeros(m, d);
+        std::vector<double> f(B), t(B);
+        for (size_t o = 0; o < m; ++o) {
+            for (size_t i = 0; i < d; ++i) {
+                for (int b = 0; b < B; ++b) {
+                    f[b] = first_b[b](o, i);
+                    t[b] = total_b[b](o, i);
+                }
+                first_order_ci_(o, i) = 0.5 * (percentile(f, 0.975) - percentile(f, 0.025));
+                total_order_ci_(o, i) = 0.5 * (percentile(t, 0.975) - percentile(t, 0.025));
+            }
+        }
+    }
+
+#ifdef Q_GUI_SUPPORT
+    if (rtw_ && rows.size() < N) {
+        rtw_->AppendLog(QString("Sobol: %1 of %2 base samples dropped after failed runs")
+                            .arg(static_cast<qulonglong>(N - rows.size())).arg(static_cast<qulonglong>(N)));
+    }
+#endif
+    return true;
+}
+
+bool CGlobalSensitivity::runMorris()
+{
+    const size_t d = free_.size();
+    const size_t r = settings_.morris_trajectories;
+    const size_t m = output_names_.size();
+    const int p = settings_.morris_levels;
+    const double delta = p / (2.0 * (p - 1));
+
+    // Trajectory: random grid start, then one parameter at a time in random order
+    std::mt19937_64 rng(seed_ + 1);
+    std::uniform_int_distribution<int> level(0, p - 1);
+    std::vector<arma::vec> points;
+    std::vector<size_t> moved;          // parameter changed to reach point k (unused for starts)
+    std::vector<double> step;           // signed step to reach point k
+    points.reserve(r * (d + 1));
+    for (size_t t = 0; t < r; ++t) {
+        arma::vec x(d);
+        for (size_t i = 0; i < d; ++i) x(i) = static_cast<double>(level(rng)) / (p - 1);
+        points.push_back(x);
+        moved.push_back(0);
+        step.push_back(0.0);
+
+        std::vector<size_t> order(d);
+        std::iota(order.begin(), order.end(), 0);
+        std::shuffle(order.begin(), order.end(), rng);
+        for (size_t i : order) {
+            const double s = x(i) + delta <= 1.0 + 1e-12 ? delta : -delta;
+            x(i) += s;
+            points.push_back(x);
+            moved.push_back(i);
+            step.push_back(s);
+        }
+    }
+
+#ifdef Q_GUI_SUPPORT
+    if (rtw_) {
+        rtw_->AppendLog(QString("Morris screening: %1 trajectories, %2 levels, %3 forward runs")
+                            .arg(static_cast<qulonglong>(r)).arg(p).arg(static_cast<qulonglong>(points.size())));
+    }
+#endif
+    const double progress_from = settings_.method == "both" ? 0.8 : 0.0;
+    arma::mat outputs;
+    if (!evaluateAll(points, outputs, progress_from, 1.0)) {
+        return false;
+    }
+
+    // Elementary effects in units of the parameter range
+    mu_.zeros(m, d);
+    mu_star_.zeros(m, d);
+    arma::mat sum2(m, d, arma::fill::zeros);
+    std::vector<double> count(d, 0.0);
+    for (size_t k = 0; k < points.size(); ++k) {
+        if (step[k] == 0.0) continue;
+        if (!std::isfinite(outputs(k, 0)) || !std::isfinite(outputs(k - 1, 0))) continue;
+        const size_t i = moved[k];
+        count[i] += 1.0;
+        for (size_t o = 0; o < m; ++o) {
+            const double effect = (outputs(k, o) - outputs(k - 1, o)) / step[k];
+            mu_(o, i) += effect;
+            mu_star_(o, i) += std::fabs(effect);
+            sum2(o, i) += effect * effect;
+        }
+    }
+
+    sigma_.zeros(m, d);
+    for (size_t i = 0; i < d; ++i) {
+        if (count[i] == 0.0) {
+            mu_.col(i).fill(std::numeric_limits<double>::quiet_NaN());
+            mu_star_.col(i).fill(std::numeric_limits<double>::quiet_NaN());
+            sigma_.col(i).fill(std::numeric_limits<double>::quiet_NaN());
+            continue;
+        }
+        for (size_t o = 0; o < m; ++o) {
+            const double mean = mu_(o, i) / count[i];
+            mu_(o, i) = mean;
+            mu_star_(o, i) /= count[i];
+            sigma_(o, i) = count[i] > 1.0
+                ? std::sqrt(std::max(0.0, (sum2(o, i) - count[i] * mean * mean) / (count[i] - 1.0)))
+                : 0.0;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+bool CGlobalSensitivity::writeMatrix(const std::string& filename, const arma::mat& values) const
+{
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << std::setprecision(6);
+
+    file << "output";
+    for (size_t i : free_) file << ", " << space_.getName(i);
+    file << "\n";
+    for (size_t o = 0; o < output_names_.size() && o < values.n_rows; ++o) {
+        file << output_names_[o];
+        for (arma::uword i = 0; i < values.n_cols; ++i) file << ", " << values(o, i);
+        file << "\n";
+    }
+    return true;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <armadillo>
+#include "GWA.h"
+#include "ParameterSpace.h"
+
+#ifdef Q_GUI_SUPPORT
+class ProgressWindow;
+#endif
+
+/**
+ * @brief Settings for CGlobalSensitivity
+ */
+struct GSASettings
+{
+    std::string method = "both";         ///< sobol | morris | both
+    int base_samples = 512;              ///< Sobol base sample size N (N (d + 2) forward runs)
+    int bootstrap = 100;                 ///< Bootstrap resamples for Sobol confidence intervals (0 = none)
+    int morris_trajectories = 20;        ///< Morris trajectories r (r (d + 1) forward runs)
+    int morris_levels = 4;               ///< Grid levels p of the Morris design
+    bool projections = true;             ///< Include projections when the model has them enabled
+    int numthreads = 1;                  ///< Threads running forward models
+    int batch_size = 0;                  ///< Forward runs per parallel batch (0 = 8 per thread)
+    unsigned long random_seed = 0;       ///< 0 = seed from random_device
+    std::string pathname;                ///< Directory for output files
+};
+
+/**
+ * @brief Variance-based (Sobol) and screening (Morris) global sensitivity analysis
+ *
+ * Every parameter is varied uniformly over its range, in the CParameterSpace
+ * sampling space (log space for log-transformed parameters); error standard
+ * deviation parameters do not affect the modeled values and are held fixed.
+ * The outputs are the time-averaged modeled value of every observation and,
+ * if enabled in the model, of every projected series.
+ *
+ * Sobol indices use the Saltelli design: two base matrices A and B of N
+ * points and, for each parameter i, A with column i taken from B. The base
+ * points are a randomly shifted Kronecker (golden-ratio) low-discrepancy
+ * sequence in 2d dimensions. First-order indices use the Saltelli (2010)
+ * estimator, total indices the Jansen estimator:
+ *   S_i  = mean(f_B (f_ABi - f_A)) / V
+ *   ST_i = mean((f_A - f_ABi)^2) / (2 V)
+ * with 95% bootstrap intervals over the base rows. Base rows with a failed
+ * forward run are dropped.
+ *
+ * Morris elementary effects use r one-at-a-time trajectories on a p-level
+ * grid with step p / (2 (p - 1)) in units of the range; mu* (mean absolute
+ * effect) ranks influence, sigma indicates nonlinearity or interaction.
+ *
+ * All design points are fixed up front and evaluated in batches in parallel
+ * on per-thread model copies, so results do not depend on the number of
+ * threads. Results are written as output-by-parameter matrices:
+ * Sobol_First_Order.txt, Sobol_Total.txt (with the interval half-widths in
+ * Sobol_First_Order_CI95.txt, Sobol_Total_CI95.txt), Morris_Mu_Star.txt,
+ * Morris_Mu.txt and Morris_Sigma.txt.
+ */
+class CGlobalSensitivity
+{
+public:
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CGlobalSensitivity();
+    explicit CGlobalSensitivity(CGWA* model);
+
+    void SetModel(CGWA* model) { model_ = model; }
+
+    // ========================================================================
+    // Settings
+    // ========================================================================
+
+    /**
+     * @brief Set a property by name (gsa_* keys plus numthreads, pathname)
+     * @return true if the property is recognized
+     */
+    bool SetProperty(const std::string& prop, const std::string& value);
+
+    const GSASettings& GetSettings() const { return settings_; }
+
+    std::string getLastError() const { return last_error_; }
+
+#ifdef Q_GUI_SUPPORT
+    void SetProgressWindow(ProgressWindow* window) { rtw_ = window; }
+#endif
+
+    // ========================================================================
+    // Analysis
+    // ========================================================================
+
+    /**
+     * @brief Run the configured analyses and write the result matrices
+     * @return false if the model has no varying parameters, all runs failed,
+     *         the run was cancelled or output cannot be written
+     */
+    bool run();
+
+    // ========================================================================
+    // Results (rows: outputs, columns: parameters)
+    // ========================================================================
+
+    const std::vector<std::string>& getOutputNames() const { return output_names_; }
+    std::vector<std::string> getParamNames() const;
+
+    const arma::mat& getFirstOrder() const { return first_order_; }
+    const arma::mat& getTotalOrder() const { return total_order_; }
+    const arma::mat& getFirstOrderCI() const { return first_order_ci_; }
+    const arma::mat& getTotalOrderCI() const { return total_order_ci_; }
+
+    const arma::mat& getMorrisMuStar() const { return mu_star_; }
+    const arma::mat& getMorrisMu() const { return mu_; }
+    const arma::mat& getMorrisSigma() const { return sigma_; }
+
+    long getModelEvaluations() const { return evaluations_; }
+    long getFailedRuns() const { return failed_runs_; }
+
+private:
+    bool evaluateAll(const std::vector<arma::vec>& points, arma::mat& outputs, double progress_from, double progress_to);
+    bool evaluate(CGWA& workspace, const arma::vec& z, std::vector<double>& outputs) const;
+    std::vector<double> toPhysical(const arma::vec& z) const;
+    bool runSobol();
+    bool runMorris();
+    bool writeMatrix(const std::string& filename, const arma::mat& values) const;
+
+    CGWA* model_ = nullptr;
+    std::vector<CGWA> workers_;
+    GSASettings settings_;
+    CParameterSpace space_;
+    std::string last_error_;
+
+    std::vector<size_t> free_;                      ///< Varied parameters
+    std::vector<double> base_values_;               ///< Values of the fixed parameters
+    std::vector<std::string> output_names_;
+    unsigned long seed_ = 0;
+
+    arma::mat first_order_;
+    arma::mat total_order_;
+    arma::mat first_order_ci_;
+    arma::mat total_order_ci_;
+    arma::mat mu_star_;
+    arma::mat mu_;
+    arma::mat sigma_;
+    long evaluations_ = 0;
+    long failed_runs_ = 0;
+
+#ifdef Q_GUI_SUPPORT
+    ProgressWindow* rtw_ = nullptr;
+#endif
+};
@@ -0,0 +1,220 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+#include "ParameterSpace.h"
+#include "AsyncWriter.h"
+
+#ifdef Q_GUI_SUPPORT
+class ProgressWindow;
+#endif
+
+/**
+ * @brief Settings for CIslandGA
+ *
+ * The GA keys (maxpop, ngen, pcross, pmute, shakescale, shakescalered)
+ * keep their CGA meaning; maxpop is the total over all islands, so the
+ * evaluation budget matches a CGA run with the same settings.
+ */
+struct IslandGASettings
+{
+    int maxpop = 100;                    ///< Total population over all islands
+    int ngen = 100;                      ///< Generations per island
+    double pcross = 1.0;                 ///< Crossover probability
+    double pmute = 0.02;                 ///< Per-gene mutation probability
+    double shakescale = 0.05;            ///< Initial mutation std as fraction of the range
+    double shakescalered = 0.75;         ///< Mutation std factor reached at the last generation
+    int numthreads = 1;                  ///< Default number of islands
+    int islands = 0;                     ///< Number of islands, each on its own thread (0 = numthreads)
+    int migration_interval = 10;         ///< Generations between emigrations
+    int migrants = 2;                    ///< Elites sent per migration
+    unsigned long random_seed = 0;       ///< 0 = seed from random_device
+    int checkpoint_interval = 0;         ///< Generations per island between checkpoints (0 = off)
+    std::string checkpoint_filename = "island_ga_checkpoint.bin";
+    std::string outputfile = "island_ga_results.txt";
+    std::string pathname;                ///< Directory for output files
+};
+
+/**
+ * @brief Island-model genetic algorithm with asynchronous migration
+ *
+ * The population is split into islands that evolve independently, each on
+ * its own thread with a private model copy, so a slow forward run only
+ * delays its own island instead of a generation barrier shared by all
+ * threads. Every migration_interval generations an island sends copies of
+ * its best individuals to the next island on a ring. Migrants travel
+ * through lock-free single-producer/single-consumer queues (CSpscQueue):
+ * the sender never waits, and the receiver picks them up whenever it
+ * starts its next generation, replacing its worst individuals if the
+ * migrants are fitter. Migrants that find the queue full are dropped.
+ *
+ * Individuals are real-coded in the CParameterSpace sampling space scaled
+ * to [0, 1]. Each generation keeps the island's best individual, fills the
+ * rest by binary tournament selection, blend crossover (BLX-0.5) with
+ * probability pcross and Gaussian mutation of each gene with probability
+ * pmute. The mutation std shrinks geometrically from shakescale to
+ * shakescale x shakescalered over the run.
+ *
+ * Because migration is asynchronous, results with more than one island
+ * depend on thread timing.
+ *
+ * With checkpoint_interval > 0 every island records its population, random
+ * number generator, best history and migration counts each time it
+ * completes checkpoint_interval generations, and the latest record of all
+ * islands is written to checkpoint_filename. Islands never wait for each
+ * other to checkpoint, so the records may be from different generations;
+ * Resume() continues each island from its own. Migrants in transit are not
+ * recorded and count as dropped.
+ *
+ * @tparam T Model type providing Parameters(), setAllParameterValues() and
+ *           GetObjectiveFunctionValue()
+ */
+template<class T>
+class CIslandGA
+{
+public:
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CIslandGA();
+    explicit CIslandGA(T* model);
+
+    void SetModel(T* model) { model_ = model; }
+
+    // ========================================================================
+    // Settings
+    // ========================================================================
+
+    /**
+     * @brief Set a property by name (GA settings keys plus island_* keys)
+     * @return true if the property is recognized
+     */
+    bool SetProperty(const std::string& prop, const std::string& value);
+
+    const IslandGASettings& GetSettings() const { return settings_; }
+
+    /**
+     * @brief All settings as (key, value) pairs accepted by SetProperty()
+     */
+    std::vector<std::pair<std::string, std::string>> GetProperties() const;
+
+    std::string getLastError() const { return last_error_; }
+
+#ifdef Q_GUI_SUPPORT
+    void SetProgressWindow(ProgressWindow* window) { rtw_ = window; }
+#endif
+
+    // ========================================================================
+    // Optimization
+    // ========================================================================
+
+    /**
+     * @brief Evolve all islands for ngen generations
+     * @return true if the run completed without cancellation
+     */
+    bool optimize();
+
+    /**
+     * @brief Continue an interrupted run from a checkpoint written by optimize()
+     * @param checkpoint_filename Checkpoint file (see checkpoint_interval)
+     * @return true if the run completed without cancellation
+     *
+     * Restores the settings and the recorded state of every island. A
+     * single island continues exactly as the uninterrupted run.
+     */
+    bool Resume(const std::string& checkpoint_filename);
+
+    // ========================================================================
+    // Results
+    // ========================================================================
+
+    T* getBestModel() { return best_model_valid_ ? &best_model_ : nullptr; }
+    const std::vector<double>& getFinalParams() const { return best_params_; }
+    double getMaxFitness() const { return best_fitness_; }
+    const std::vector<std::string>& getParamNames() const { return space_.getNames(); }
+    int getIslandCount() const { return static_cast<int>(islands_.size()); }
+
+    /**
+     * @brief Best fitness of each island at the end of the run
+     */
+    std::vector<double> getIslandBestFitness() const;
+
+    /**
+     * @brief Best distinct individuals over all islands, fittest first
+     * @param count Maximum number of individuals
+     * @return Physical parameter values, e.g. starting points for CMultiStartLM
+     */
+    std::vector<std::vector<double>> getBestIndividuals(size_t count) const;
+
+    long getMigrantsSent() const;
+    long getMigrantsAccepted() const;
+    long getMigrantsDropped() const;
+
+private:
+    struct Individual
+    {
+        std::vector<double> x;     ///< Genes in [0, 1]
+        double fitness = 0.0;
+    };
+
+    struct Island
+    {
+        T model;
+        std::vector<Individual> population;
+        std::mt19937_64 rng;
+        std::unique_ptr<CSpscQueue<Individual>> inbox;
+        std::vector<double> best_history;     ///< Best fitness after each generation
+        std::atomic<int> generation{0};
+        std::atomic<double> best{0.0};
+        std::atomic<long> sent{0};
+        std::atomic<long> accepted{0};
+        std::atomic<long> dropped{0};
+    };
+
+    /// Island state at a generation boundary
+    struct Snapshot
+    {
+        std::vector<Individual> population;
+        std::mt19937_64 rng;
+        std::vector<double> best_history;
+        int generation = 0;
+        long sent = 0;
+        long accepted = 0;
+        long dropped = 0;
+    };
+
+    bool run();
+    void evolve(size_t index);
+    void evaluate(Island& island, Individual& individual);
+    void immigrate(Island& island);
+    std::vector<double> toPhysical(const std::vector<double>& x) const;
+    bool writeOutput() const;
+    Snapshot snapshot(const Island& island) const;
+    bool writeCheckpoint(const std::string& filename) const;
+    bool readCheckpoint(const std::string& filename);
+
+    T* model_ = nullptr;
+    IslandGASettings settings_;
+    CParameterSpace space_;
+    std::vector<std::unique_ptr<Island>> islands_;
+    std::atomic<bool> stop_{false};
+    mutable std::string last_error_;
+    std::vector<Snapshot> snapshots_;     ///< Latest checkpoint record of each island
+    std::mutex checkpoint_mutex_;         ///< Guards snapshots_ and the checkpoint file
+
+    T best_model_;
+    bool best_model_valid_ = false;
+    std::vector<double> best_params_;
+    double best_fitness_ = 0.0;
+
+#ifdef Q_GUI_SUPPORT
+    ProgressWindow* rtw_ = nullptr;
+#endif
+};
+
+#include "IslandGA.hpp"
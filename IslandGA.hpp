@@ -0,0 +1,629 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sstream>
+#include <thread>
+#include "Checkpoint.h"
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#endif
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+template<class T>
+CIslandGA<T>::CIslandGA()
+{
+}
+
+template<class T>
+CIslandGA<T>::CIslandGA(T* model)
+    : model_(model)
+{
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+template<class T>
+bool CIslandGA<T>::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "maxpop") settings_.maxpop = std::max(2, std::stoi(value));
+        else if (key == "ngen") settings_.ngen = std::max(1, std::stoi(value));
+        else if (key == "pcross") settings_.pcross = std::stod(value);
+        else if (key == "pmute") settings_.pmute = std::stod(value);
+        else if (key == "shakescale") settings_.shakescale = std::stod(value);
+        else if (key == "shakescalered") settings_.shakescalered = std::stod(value);
+        else if (key == "numthreads") settings_.numthreads = std::max(1, std::stoi(value));
+        else if (key == "outputfile") settings_.outputfile = value;
+        else if (key == "pathname") settings_.pathname = value;
+        else if (key == "island_count") settings_.islands = std::max(0, std::stoi(value));
+        else if (key == "island_migration_interval") settings_.migration_interval = std::max(1, std::stoi(value));
+        else if (key == "island_migrants") settings_.migrants = std::max(0, std::stoi(value));
+        else if (key == "island_random_seed") settings_.random_seed = std::stoul(value);
+        else if (key == "island_checkpoint_interval") settings_.checkpoint_interval = std::max(0, std::stoi(value));
+        else if (key == "island_checkpoint_filename") settings_.checkpoint_filename = value;
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+template<class T>
+std::vector<std::pair<std::string, std::string>> CIslandGA<T>::GetProperties() const
+{
+    auto num = [](double value) {
+        std::ostringstream out;
+        out << std::setprecision(17) << value;
+        return out.str();
+    };
+    const IslandGASettings& st = settings_;
+    return {
+        {"maxpop", std::to_string(st.maxpop)},
+        {"ngen", std::to_string(st.ngen)},
+        {"pcross", num(st.pcross)},
+        {"pmute", num(st.pmute)},
+        {"shakescale", num(st.shakescale)},
+        {"shakescalered", num(st.shakescalered)},
+        {"numthreads", std::to_string(st.numthreads)},
+        {"island_count", std::to_string(st.islands)},
+        {"island_migration_interval", std::to_string(st.migration_interval)},
+        {"island_migrants", std::to_string(st.migrants)},
+        {"island_random_seed", std::to_string(st.random_seed)},
+        {"island_checkpoint_interval", std::to_string(st.checkpoint_interval)},
+        {"island_checkpoint_filename", st.checkpoint_filename},
+        {"outputfile", st.outputfile},
+        {"pathname", st.pathname},
+    };
+}
+
+// ============================================================================
+// Optimization
+// ============================================================================
+
+template<class T>
+bool CIslandGA<T>::optimize()
+{
+    if (!model_) {
+        last_error_ = "No model assigned to island GA";
+        return false;
+    }
+
+    space_ = CParameterSpace(model_->Parameters());
+    const size_t n = space_.size();
+    if (n == 0) {
+        last_error_ = "No parameters to optimize";
+        return false;
+    }
+
+    unsigned long seed = settings_.random_seed;
+    if (seed == 0) {
+        seed = std::random_device{}();
+    }
+
+    int k = settings_.islands > 0 ? settings_.islands : settings_.numthreads;
+    k = std::max(1, std::min(k, settings_.maxpop / 2));
+
+    // Initial populations: uniform in the range, plus the model's current values
+    std::vector<double> u_current = space_.toSampling(model_->getParameterValues());
+    islands_.clear();
+    for (int i = 0; i < k; ++i) {
+        auto island = std::make_unique<Island>();
+        island->model = *model_;
+        island->rng.seed(seed + 7919UL * i);
+        island->inbox = std::make_unique<CSpscQueue<Individual>>(std::max(1, 4 * settings_.migrants));
+        island->best = -std::numeric_limits<double>::infinity();
+
+        int size = settings_.maxpop / k + (i < settings_.maxpop % k ? 1 : 0);
+        std::uniform_real_distribution<double> unif(0.0, 1.0);
+        island->population.resize(std::max(2, size));
+        for (Individual& individual : island->population) {
+            individual.x.resize(n);
+            for (size_t j = 0; j < n; ++j) individual.x[j] = unif(island->rng);
+        }
+        if (i == 0) {
+            for (size_t j = 0; j < n; ++j) {
+                double width = space_.getSamplingHigh(j) - space_.getSamplingLow(j);
+                double x = width > 0.0 ? (u_current[j] - space_.getSamplingLow(j)) / width : 0.5;
+                island->population[0].x[j] = std::isfinite(x) ? std::min(1.0, std::max(0.0, x)) : 0.5;
+            }
+        }
+        islands_.push_back(std::move(island));
+    }
+
+    // Unevaluated initial state until an island reaches its first checkpoint
+    snapshots_.clear();
+    for (const auto& island : islands_) {
+        snapshots_.push_back(snapshot(*island));
+    }
+
+    return run();
+}
+
+template<class T>
+bool CIslandGA<T>::Resume(const std::string& checkpoint_filename)
+{
+    if (!model_) {
+        last_error_ = "No model assigned to island GA";
+        return false;
+    }
+    if (!readCheckpoint(checkpoint_filename)) {
+        return false;
+    }
+    return run();
+}
+
+template<class T>
+bool CIslandGA<T>::run()
+{
+    const int k = static_cast<int>(islands_.size());
+
+    last_error_.clear();
+    stop_ = false;
+    best_model_valid_ = false;
+    best_params_.clear();
+    best_fitness_ = -std::numeric_limits<double>::infinity();
+
+    std::atomic<int> finished{0};
+    std::vector<std::thread> threads;
+    for (int i = 0; i < k; ++i) {
+        threads.emplace_back([this, i, &finished]() {
+            evolve(i);
+            ++finished;
+        });
+    }
+
+#ifdef Q_GUI_SUPPORT
+    // Islands never wait for each other or for the GUI; this thread only polls
+    if (rtw_) {
+        int plotted = 0;
+        while (finished < k) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+
+            long generations = 0;
+            double best = -std::numeric_limits<double>::infinity();
+            QString info;
+            for (int i = 0; i < k; ++i) {
+                const Island& island = *islands_[i];
+                generations += island.generation;
+                best = std::max(best, island.best.load());
+                info += QString("Island %1: generation %2, best %3, migrants in %4\n")
+                            .arg(i + 1)
+                            .arg(island.generation.load())
+                            .arg(island.best.load(), 0, 'e', 4)
+                            .arg(island.accepted.load());
+            }
+
+            rtw_->SetProgress(static_cast<double>(generations) / (static_cast<double>(k) * settings_.ngen));
+            rtw_->SetInfoText(info);
+            int generation = static_cast<int>(generations / k);
+            if (generation > plotted && std::isfinite(best)) {
+                rtw_->AddPrimaryChartPoint(generation, best);
+                plotted = generation;
+            }
+            QApplication::processEvents();
+            if (!stop_ && rtw_->IsCancelRequested()) {
+                rtw_->AppendLog("Island GA cancelled by user; stopping islands...");
+                stop_ = true;
+            }
+        }
+    }
+#endif
+
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+
+    // A cancelled run can be resumed from where each island stopped
+    if (stop_ && settings_.checkpoint_interval > 0) {
+        for (int i = 0; i < k; ++i) {
+            snapshots_[i] = snapshot(*islands_[i]);
+        }
+        writeCheckpoint(settings_.pathname + settings_.checkpoint_filename);
+    }
+
+    for (const auto& island : islands_) {
+        const Individual& best = island->population.front();
+        if (std::isfinite(best.fitness) && best.fitness > best_fitness_) {
+            best_fitness_ = best.fitness;
+            best_params_ = toPhysical(best.x);
+        }
+    }
+
+    if (!best_params_.empty()) {
+        best_model_ = *model_;
+        best_model_.setAllParameterValues(best_params_);
+        best_model_valid_ = true;
+    }
+    else {
+        last_error_ = "No parameter set with a finite objective was found";
+    }
+
+    if (!writeOutput() && last_error_.empty()) {
+        last_error_ = "Cannot write " + settings_.pathname + settings_.outputfile;
+    }
+    return !stop_ && best_model_valid_;
+}
+
+template<class T>
+void CIslandGA<T>::evolve(size_t index)
+{
+    Island& island = *islands_[index];
+    CSpscQueue<Individual>& outbox = *islands_[(index + 1) % islands_.size()]->inbox;
+    std::vector<Individual>& population = island.population;
+    const size_t size = population.size();
+    const size_t n = space_.size();
+
+    auto fitter = [](const Individual& a, const Individual& b) { return a.fitness > b.fitness; };
+    auto reflect = [](double x) {
+        double v = std::fmod(std::abs(x), 2.0);
+        return v > 1.0 ? 2.0 - v : v;
+    };
+
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    std::uniform_int_distribution<size_t> pick(0, size - 1);
+    auto tournament = [&]() -> const Individual& {
+        const Individual& a = population[pick(island.rng)];
+        const Individual& b = population[pick(island.rng)];
+        return a.fitness >= b.fitness ? a : b;
+    };
+
+    // A resumed island continues from its checkpointed generation
+    if (island.generation == 0) {
+        for (Individual& individual : population) {
+            evaluate(island, individual);
+        }
+        std::stable_sort(population.begin(), population.end(), fitter);
+        island.best_history.clear();
+    }
+    island.best = population.front().fitness;
+
+    std::vector<Individual> offspring;
+    offspring.reserve(size + 1);
+
+    for (int gen = island.generation; gen < settings_.ngen && !stop_; ++gen) {
+        immigrate(island);
+
+        // Fresh each generation: no cached deviate is lost at a checkpoint
+        std::normal_distribution<double> normal(0.0, 1.0);
+
+        const double progress = settings_.ngen > 1 ? static_cast<double>(gen) / (settings_.ngen - 1) : 0.0;
+        const double mutation_std = settings_.shakescale * std::pow(settings_.shakescalered, progress);
+
+        offspring.clear();
+        offspring.push_back(population.front());   // elite
+        while (offspring.size() < size) {
+            Individual child1 = tournament();
+            Individual child2 = tournament();
+            if (unif(island.rng) < settings_.pcross) {
+                for (size_t j = 0; j < n; ++j) {
+                    double lo = std::min(child1.x[j], child2.x[j]);
+                    double d = std::abs(child1.x[j] - child2.x[j]);
+                    child1.x[j] = reflect(lo - 0.5 * d + 2.0 * d * unif(island.rng));
+                    child2.x[j] = reflect(lo - 0.5 * d + 2.0 * d * unif(island.rng));
+                }
+            }
+            for (Individual* child : {&child1, &child2}) {
+                for (size_t j = 0; j < n; ++j) {
+                    if (unif(island.rng) < settings_.pmute) {
+                        child->x[j] = reflect(child->x[j] + mutation_std * normal(island.rng));
+                    }
+                }
+                if (offspring.size() < size) {
+                    evaluate(island, *child);
+                    offspring.push_back(std::move(*child));
+                }
+            }
+        }
+
+        population.swap(offspring);
+        std::stable_sort(population.begin(), population.end(), fitter);
+        island.best_history.push_back(population.front().fitness);
+        island.best = population.front().fitness;
+        island.generation = gen + 1;
+
+        // Emigrate without waiting for the neighbour
+        if (islands_.size() > 1 && (gen + 1) % settings_.migration_interval == 0) {
+            for (int m = 0; m < settings_.migrants && m < static_cast<int>(size); ++m) {
+                Individual migrant = population[m];
+                if (outbox.tryPush(std::move(migrant))) ++island.sent;
+                else ++island.dropped;
+            }
+        }
+
+        if (settings_.checkpoint_interval > 0 && (gen + 1) % settings_.checkpoint_interval == 0 &&
+            gen + 1 < settings_.ngen) {
+            std::lock_guard<std::mutex> lock(checkpoint_mutex_);
+            snapshots_[index] = snapshot(island);
+            if (!writeCheckpoint(settings_.pathname + settings_.checkpoint_filename)) {
+                stop_ = true;
+            }
+        }
+    }
+}
+
+template<class T>
+void CIslandGA<T>::immigrate(Island& island)
+{
+    std::vector<Individual>& population = island.population;
+    Individual migrant;
+    while (island.inbox->tryPop(migrant)) {
+        if (migrant.fitness > population.back().fitness) {
+            population.back() = std::move(migrant);
+            for (size_t i = population.size() - 1; i > 0 && population[i].fitness > population[i - 1].fitness; --i) {
+                std::swap(population[i], population[i - 1]);
+            }
+            ++island.accepted;
+        }
+    }
+}
+
+template<class T>
+void CIslandGA<T>::evaluate(Island& island, Individual& individual)
+{
+    individual.fitness = -std::numeric_limits<double>::infinity();
+    try {
+        island.model.setAllParameterValues(toPhysical(individual.x));
+        double value = island.model.GetObjectiveFunctionValue();
+        if (std::isfinite(value)) {
+            individual.fitness = value;
+        }
+    }
+    catch (const std::exception&) {
+        // Failed forward run ranks last
+    }
+}
+
+template<class T>
+std::vector<double> CIslandGA<T>::toPhysical(const std::vector<double>& x) const
+{
+    std::vector<double> u(x.size());
+    for (size_t i = 0; i < u.size(); ++i) {
+        u[i] = space_.getSamplingLow(i) + x[i] * (space_.getSamplingHigh(i) - space_.getSamplingLow(i));
+    }
+    return space_.fromSampling(u);
+}
+
+// ============================================================================
+// Checkpoints
+// ============================================================================
+
+template<class T>
+typename CIslandGA<T>::Snapshot CIslandGA<T>::snapshot(const Island& island) const
+{
+    Snapshot record;
+    record.population = island.population;
+    record.rng = island.rng;
+    record.best_history = island.best_history;
+    record.generation = island.generation;
+    record.sent = island.sent;
+    record.accepted = island.accepted;
+    record.dropped = island.dropped;
+    return record;
+}
+
+template<class T>
+bool CIslandGA<T>::writeCheckpoint(const std::string& filename) const
+{
+    try {
+        CCheckpointWriter out(filename, "island_ga");
+
+        std::vector<std::string> keys, values;
+        for (const auto& property : GetProperties()) {
+            keys.push_back(property.first);
+            values.push_back(property.second);
+        }
+        out.write(keys);
+        out.write(values);
+        out.write(space_.getNames());
+
+        out.write(static_cast<int64_t>(snapshots_.size()));
+        for (const Snapshot& record : snapshots_) {
+            std::vector<std::vector<double>> genes;
+            std::vector<double> fitness;
+            for (const Individual& individual : record.population) {
+                genes.push_back(individual.x);
+                fitness.push_back(individual.fitness);
+            }
+            out.write(genes);
+            out.write(fitness);
+            out.write(record.rng);
+            out.write(record.best_history);
+            out.write(static_cast<int64_t>(record.generation));
+            out.write(static_cast<int64_t>(record.sent));
+            out.write(static_cast<int64_t>(record.accepted));
+            out.write(static_cast<int64_t>(record.dropped));
+        }
+
+        out.close();
+    }
+    catch (const std::exception& e) {
+        last_error_ = e.what();
+        return false;
+    }
+    return true;
+}
+
+template<class T>
+bool CIslandGA<T>::readCheckpoint(const std::string& filename)
+{
+    try {
+        CCheckpointReader in(filename, "island_ga");
+
+        // Settings of the interrupted run take precedence
+        std::vector<std::string> keys = in.readStringVector();
+        std::vector<std::string> values = in.readStringVector();
+        for (size_t i = 0; i < keys.size() && i < values.size(); ++i) {
+            if (!SetProperty(keys[i], values[i])) {
+                return false;
+            }
+        }
+
+        space_ = CParameterSpace(model_->Parameters());
+        if (in.readStringVector() != space_.getNames()) {
+            last_error_ = "Checkpoint parameters do not match the model";
+            return false;
+        }
+
+        snapshots_.clear();
+        snapshots_.resize(static_cast<size_t>(in.readInt()));
+        islands_.clear();
+        for (Snapshot& record : snapshots_) {
+            std::vector<std::vector<double>> genes = in.readDoubleMatrix();
+            std::vector<double> fitness = in.readDoubleVector();
+            if (genes.size() != fitness.size() || genes.size() < 2) {
+                last_error_ = "Corrupt island population in checkpoint " + filename;
+                return false;
+            }
+            record.population.resize(genes.size());
+            for (size_t j = 0; j < genes.size(); ++j) {
+                record.population[j].x = genes[j];
+                record.population[j].fitness = fitness[j];
+            }
+            in.readRng(record.rng);
+            record.best_history = in.readDoubleVector();
+            record.generation = static_cast<int>(in.readInt());
+            record.sent = static_cast<long>(in.readInt());
+            record.accepted = static_cast<long>(in.readInt());
+            record.dropped = static_cast<long>(in.readInt());
+
+            auto island = std::make_unique<Island>();
+            island->model = *model_;
+            island->population = record.population;
+            island->rng = record.rng;
+            island->inbox = std::make_unique<CSpscQueue<Individual>>(std::max(1, 4 * settings_.migrants));
+            island->best_history = record.best_history;
+            island->generation = record.generation;
+            island->best = record.population.front().fitness;
+            island->sent = record.sent;
+            island->accepted = record.accepted;
+            island->dropped = record.dropped;
+            islands_.push_back(std::move(island));
+        }
+        if (islands_.empty()) {
+            last_error_ = "Checkpoint holds no islands";
+            return false;
+        }
+    }
+    catch (const std::exception& e) {
+        last_error_ = e.what();
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Results
+// ============================================================================
+
+template<class T>
+std::vector<double> CIslandGA<T>::getIslandBestFitness() const
+{
+    std::vector<double> best;
+    for (const auto& island : islands_) {
+        best.push_back(island->best);
+    }
+    return best;
+}
+
+template<class T>
+std::vector<std::vector<double>> CIslandGA<T>::getBestIndividuals(size_t count) const
+{
+    std::vector<const Individual*> all;
+    for (const auto& island : islands_) {
+        for (const Individual& individual : island->population) {
+            if (std::isfinite(individual.fitness)) all.push_back(&individual);
+        }
+    }
+    std::stable_sort(all.begin(), all.end(),
+                     [](const Individual* a, const Individual* b) { return a->fitness > b->fitness; });
+
+    // Migrants and elites leave copies on several islands
+    std::vector<std::vector<double>> genes, best;
+    for (const Individual* individual : all) {
+        if (best.size() == count) break;
+        if (std::find(genes.begin(), genes.end(), individual->x) != genes.end()) continue;
+        genes.push_back(individual->x);
+        best.push_back(toPhysical(individual->x));
+    }
+    return best;
+}
+
+template<class T>
+long CIslandGA<T>::getMigrantsSent() const
+{
+    long total = 0;
+    for (const auto& island : islands_) total += island->sent;
+    return total;
+}
+
+template<class T>
+long CIslandGA<T>::getMigrantsAccepted() const
+{
+    long total = 0;
+    for (const auto& island : islands_) total += island->accepted;
+    return total;
+}
+
+template<class T>
+long CIslandGA<T>::getMigrantsDropped() const
+{
+    long total = 0;
+    for (const auto& island : islands_) total += island->dropped;
+    return total;
+}
+
+template<class T>
+bool CIslandGA<T>::writeOutput() const
+{
+    std::ofstream file(settings_.pathname + settings_.outputfile);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << std::setprecision(10);
+
+    size_t generations = 0;
+    file << "generation";
+    for (size_t i = 0; i < islands_.size(); ++i) {
+        file << ", island_" << i + 1;
+        generations = std::max(generations, islands_[i]->best_history.size());
+    }
+    file << "\n";
+    for (size_t g = 0; g < generations; ++g) {
+        file << g + 1;
+        for (const auto& island : islands_) {
+            file << ", ";
+            if (g < island->best_history.size()) file << island->best_history[g];
+        }
+        file << "\n";
+    }
+
+    file << "\n# Migrants sent: " << getMigrantsSent()
+         << ", accepted: " << getMigrantsAccepted()
+         << ", dropped: " << getMigrantsDropped() << "\n";
+    file << "# Best fitness: " << best_fitness_ << "\n";
+    for (size_t i = 0; i < best_params_.size(); ++i) {
+        file << space_.getName(i) << ", " << best_params_[i] << "\n";
+    }
+    return true;
+}
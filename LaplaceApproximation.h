@@ -0,0 +1,142 @@
+#pragma once
+
+#include <string>
+#include <utility>
+#include <vector>
+#include <armadillo>
+#include "ParameterSpace.h"
+
+#ifdef Q_GUI_SUPPORT
+class ProgressWindow;
+#endif
+
+/**
+ * @brief Settings for CLaplaceApproximation
+ */
+struct LaplaceSettings
+{
+    int number_of_samples = 1000;        ///< Draws from the Gaussian posterior
+    bool refine = true;                  ///< Run Levenberg-Marquardt from the current values first
+    double jacobian_step = 1e-4;         ///< Central-difference step as a fraction of the range
+    unsigned long random_seed = 0;       ///< 0 = seed from random_device
+    std::string samples_filename = "laplace_samples.txt";
+    std::string outputfile = "laplace_summary.txt";
+    std::string pathname;                ///< Directory for output files
+};
+
+/**
+ * @brief Gaussian (Laplace) approximation of the posterior at the LM optimum
+ *
+ * A fast alternative to MCMC for screening. The weighted residuals are
+ * linearized at the least-squares optimum, and the Gauss-Newton Hessian
+ * JᵀJ of the negative log-likelihood is inverted for the covariance of a
+ * Gaussian posterior in the CParameterSpace sampling space, so
+ * log-transformed parameters get a log-normal marginal. The Jacobian costs
+ * two forward runs per parameter; sampling costs none.
+ *
+ * Directions the data do not constrain have tiny Hessian eigenvalues. Their
+ * variance is capped at the squared width of the widest parameter range,
+ * and the number of such directions is reported. Draws outside the bounds
+ * are redrawn and, failing that, reflected. Error standard deviation
+ * parameters are held at their values at the optimum.
+ *
+ * Writes Posterior_Percentiles.txt and Posterior_Distributions.txt like
+ * MCMC, the samples to samples_filename and the optimum, standard
+ * deviations and correlations to outputfile. The samples can be passed to
+ * CPosteriorPredictive for realizations.
+ *
+ * @tparam T Model type providing Parameters(), getParameterValues(),
+ *           setAllParameterValues(), calculateWeightedResiduals(),
+ *           isErrorStdParameter() and GetObjectiveFunctionValue()
+ */
+template<class T>
+class CLaplaceApproximation
+{
+public:
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CLaplaceApproximation();
+    explicit CLaplaceApproximation(T* model);
+
+    void SetModel(T* model) { model_ = model; }
+
+    // ========================================================================
+    // Settings
+    // ========================================================================
+
+    /**
+     * @brief Set a property by name (laplace_* keys plus pathname, outputfile)
+     *
+     * lm_* keys are passed on to the Levenberg-Marquardt refinement.
+     * @return true if the property is recognized
+     */
+    bool SetProperty(const std::string& prop, const std::string& value);
+
+    const LaplaceSettings& GetSettings() const { return settings_; }
+
+    std::string getLastError() const { return last_error_; }
+
+#ifdef Q_GUI_SUPPORT
+    void SetProgressWindow(ProgressWindow* window) { rtw_ = window; }
+#endif
+
+    // ========================================================================
+    // Approximation
+    // ========================================================================
+
+    /**
+     * @brief Locate the optimum, build the Gaussian posterior and sample it
+     * @return true if the approximation and its output files were produced
+     */
+    bool compute();
+
+    // ========================================================================
+    // Results
+    // ========================================================================
+
+    const std::vector<double>& getOptimum() const { return optimum_; }
+    double getMaxFitness() const { return objective_; }
+
+    /**
+     * @brief Posterior samples in physical units, one row per draw
+     */
+    const std::vector<std::vector<double>>& getSamples() const { return samples_; }
+
+    /**
+     * @brief Posterior covariance in the sampling space (zero for fixed parameters)
+     */
+    const arma::mat& getCovariance() const { return covariance_; }
+
+    const std::vector<std::string>& getParamNames() const { return space_.getNames(); }
+    int getUnconstrainedDirections() const { return unconstrained_; }
+    long getModelEvaluations() const { return evaluations_; }
+
+private:
+    bool jacobian(const std::vector<double>& u, arma::mat& J);
+    bool residuals(const std::vector<double>& u, arma::vec& r);
+    void draw();
+    bool writeOutput() const;
+
+    T* model_ = nullptr;
+    T workspace_;
+    LaplaceSettings settings_;
+    std::vector<std::pair<std::string, std::string>> lm_properties_;
+    CParameterSpace space_;
+    std::vector<size_t> free_;              ///< Indices of parameters with posterior variance
+    std::string last_error_;
+
+    std::vector<double> optimum_;           ///< Physical values
+    double objective_ = 0.0;
+    arma::mat covariance_;
+    std::vector<std::vector<double>> samples_;
+    int unconstrained_ = 0;
+    long evaluations_ = 0;
+
+#ifdef Q_GUI_SUPPORT
+    ProgressWindow* rtw_ = nullptr;
+#endif
+};
+
+#include "LaplaceApproximation.hpp"
@@ -0,0 +1,328 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <iomanip>
+#include <algorithm>
+#include <fstream>
+#include <random>
+#include "MultiStartLM.h"
+#include "PosteriorSummary.h"
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#endif
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+template<class T>
+CLaplaceApproximation<T>::CLaplaceApproximation()
+{
+}
+
+template<class T>
+CLaplaceApproximation<T>::CLaplaceApproximation(T* model)
+    : model_(model)
+{
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+template<class T>
+bool CLaplaceApproximation<T>::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "laplace_samples") settings_.number_of_samples = std::max(1, std::stoi(value));
+        else if (key == "laplace_refine") settings_.refine = (value != "no" && value != "false" && value != "0");
+        else if (key == "laplace_jacobian_step") settings_.jacobian_step = std::max(1e-12, std::stod(value));
+        else if (key == "laplace_random_seed") settings_.random_seed = std::stoul(value);
+        else if (key == "laplace_samples_filename") settings_.samples_filename = value;
+        else if (key == "outputfile") settings_.outputfile = value;
+        else if (key == "pathname") settings_.pathname = value;
+        else if (key.rfind("lm_", 0) == 0) {
+            CMultiStartLM<T> check;
+            if (!check.SetProperty(key, value)) {
+                last_error_ = check.getLastError();
+                return false;
+            }
+            lm_properties_.emplace_back(key, value);
+        }
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Approximation
+// ============================================================================
+
+template<class T>
+bool CLaplaceApproximation<T>::compute()
+{
+    if (!model_) {
+        last_error_ = "No model assigned to Laplace approximation";
+        return false;
+    }
+
+    space_ = CParameterSpace(model_->Parameters());
+    const size_t n = space_.size();
+    last_error_.clear();
+    samples_.clear();
+    evaluations_ = 0;
+    unconstrained_ = 0;
+
+    free_.clear();
+    for (size_t i = 0; i < n; ++i) {
+        if (!model_->isErrorStdParameter(i) && space_.getSamplingHigh(i) > space_.getSamplingLow(i)) {
+            free_.push_back(i);
+        }
+    }
+    if (free_.empty()) {
+        last_error_ = "No parameters to estimate";
+        return false;
+    }
+
+    // Optimum: a single Levenberg-Marquardt start from the current values
+    optimum_ = model_->getParameterValues();
+    if (settings_.refine) {
+#ifdef Q_GUI_SUPPORT
+        if (rtw_) {
+            rtw_->SetStatus("Refining optimum...");
+            rtw_->AppendLog("Refining optimum with Levenberg-Marquardt...");
+            QApplication::processEvents();
+        }
+#endif
+        CMultiStartLM<T> lm(model_);
+        for (const auto& property : lm_properties_) {
+            lm.SetProperty(property.first, property.second);
+        }
+        lm.SetProperty("lm_starts", "1");
+        lm.SetProperty("numthreads", "1");
+        lm.SetProperty("pathname", settings_.pathname);
+        lm.SetProperty("outputfile", "laplace_optimum.txt");
+        lm.SetStartingPoints({optimum_});
+        lm.optimize();
+        evaluations_ += lm.getModelEvaluations();
+        if (lm.getFinalParams().empty()) {
+            last_error_ = "Levenberg-Marquardt failed: " + lm.getLastError();
+            return false;
+        }
+        optimum_ = lm.getFinalParams();
+    }
+
+    workspace_ = *model_;
+    const std::vector<double> u_opt = space_.toSampling(optimum_);
+
+    try {
+        workspace_.setAllParameterValues(optimum_);
+        objective_ = workspace_.GetObjectiveFunctionValue();
+        ++evaluations_;
+    }
+    catch (const std::exception& e) {
+        last_error_ = std::string("Forward run failed at the optimum: ") + e.what();
+        return false;
+    }
+
+#ifdef Q_GUI_SUPPORT
+    if (rtw_) {
+        rtw_->SetProgress(0.3);
+        rtw_->SetStatus("Computing Jacobian...");
+        rtw_->AppendLog(QString("Objective at optimum: %1").arg(objective_, 0, 'e', 6));
+        rtw_->AppendLog(QString("Computing Jacobian (%1 parameters)...").arg(free_.size()));
+        QApplication::processEvents();
+    }
+#endif
+
+    arma::mat J;
+    if (!jacobian(u_opt, J)) {
+        return false;
+    }
+
+    // Gauss-Newton Hessian; cap the variance of unconstrained directions
+    const arma::mat H = J.t() * J;
+    arma::vec eigval;
+    arma::mat eigvec;
+    if (!arma::eig_sym(eigval, eigvec, H)) {
+        last_error_ = "Eigendecomposition of the Hessian failed";
+        return false;
+    }
+
+    double max_width = 0.0;
+    for (size_t i : free_) {
+        max_width = std::max(max_width, space_.getSamplingHigh(i) - space_.getSamplingLow(i));
+    }
+    const double min_eigenvalue = 1.0 / (max_width * max_width);
+    for (arma::uword k = 0; k < eigval.n_elem; ++k) {
+        if (!(eigval(k) > min_eigenvalue)) {
+            eigval(k) = min_eigenvalue;
+            ++unconstrained_;
+        }
+    }
+
+    const arma::mat L = eigvec * arma::diagmat(1.0 / arma::sqrt(eigval));
+    const arma::mat C = L * L.t();
+    covariance_.zeros(n, n);
+    for (size_t a = 0; a < free_.size(); ++a) {
+        for (size_t b = 0; b < free_.size(); ++b) {
+            covariance_(free_[a], free_[b]) = C(a, b);
+        }
+    }
+
+    // Draws from the truncated Gaussian
+    unsigned long seed = settings_.random_seed;
+    if (seed == 0) {
+        seed = std::random_device{}();
+    }
+    std::mt19937_64 rng(seed);
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    samples_.reserve(settings_.number_of_samples);
+    arma::vec z(free_.size());
+    for (int s = 0; s < settings_.number_of_samples; ++s) {
+        std::vector<double> u = u_opt;
+        for (int attempt = 0; attempt < 100; ++attempt) {
+            for (arma::uword k = 0; k < z.n_elem; ++k) z(k) = normal(rng);
+            const arma::vec du = L * z;
+            u = u_opt;
+            for (size_t a = 0; a < free_.size(); ++a) u[free_[a]] += du(a);
+            if (space_.inSamplingBounds(u)) break;
+        }
+        space_.reflectIntoBounds(u);
+        samples_.push_back(space_.fromSampling(u));
+    }
+
+#ifdef Q_GUI_SUPPORT
+    if (rtw_) {
+        rtw_->SetProgress(0.9);
+        rtw_->AppendLog(QString("Drew %1 samples from the Gaussian posterior").arg(samples_.size()));
+        if (unconstrained_ > 0) {
+            rtw_->AppendLog(QString("Directions not constrained by the data: %1").arg(unconstrained_));
+        }
+        QApplication::processEvents();
+    }
+#endif
+
+    if (!writeOutput()) {
+        last_error_ = "Cannot write posterior output to " + settings_.pathname;
+        return false;
+    }
+    return true;
+}
+
+template<class T>
+bool CLaplaceApproximation<T>::residuals(const std::vector<double>& u, arma::vec& r)
+{
+    ++evaluations_;
+    try {
+        workspace_.setAllParameterValues(space_.fromSampling(u));
+        r = arma::conv_to<arma::vec>::from(workspace_.calculateWeightedResiduals());
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    return r.is_finite();
+}
+
+template<class T>
+bool CLaplaceApproximation<T>::jacobian(const std::vector<double>& u, arma::mat& J)
+{
+    arma::vec r0;
+    if (!residuals(u, r0)) {
+        last_error_ = "Forward run failed at the optimum";
+        return false;
+    }
+
+    // Central differences in the sampling space, one-sided at the bounds
+    J.zeros(r0.n_elem, free_.size());
+    for (size_t c = 0; c < free_.size(); ++c) {
+        const size_t i = free_[c];
+        const double lo = space_.getSamplingLow(i);
+        const double hi = space_.getSamplingHigh(i);
+        const double h = settings_.jacobian_step * (hi - lo);
+
+        std::vector<double> up = u, down = u;
+        up[i] = std::min(hi, u[i] + h);
+        down[i] = std::max(lo, u[i] - h);
+
+        arma::vec r_up, r_down;
+        bool ok_up = up[i] > u[i] && residuals(up, r_up) && r_up.n_elem == r0.n_elem;
+        bool ok_down = down[i] < u[i] && residuals(down, r_down) && r_down.n_elem == r0.n_elem;
+
+        if (ok_up && ok_down) J.col(c) = (r_up - r_down) / (up[i] - down[i]);
+        else if (ok_up) J.col(c) = (r_up - r0) / (up[i] - u[i]);
+        else if (ok_down) J.col(c) = (r0 - r_down) / (u[i] - down[i]);
+        else {
+            last_error_ = "Forward runs failed around the optimum for " + space_.getName(i);
+            return false;
+        }
+    }
+    return true;
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+template<class T>
+bool CLaplaceApproximation<T>::writeOutput() const
+{
+    const size_t n = space_.size();
+
+    std::ofstream summary(settings_.pathname + settings_.outputfile);
+    if (!summary.is_open()) {
+        return false;
+    }
+    summary << std::setprecision(10);
+    summary << "# Laplace approximation at the least-squares optimum\n";
+    summary << "# Objective at optimum: " << objective_ << "\n";
+    summary << "# Model evaluations: " << evaluations_ << "\n";
+    summary << "# Directions not constrained by the data: " << unconstrained_ << "\n";
+    summary << "parameter, optimum, sampling_std, log_transformed\n";
+    for (size_t i = 0; i < n; ++i) {
+        summary << space_.getName(i) << ", " << optimum_[i] << ", " << std::sqrt(covariance_(i, i)) << ", "
+                << (space_.isLogTransformed(i) ? "yes" : "no") << "\n";
+    }
+    summary << "\ncorrelation";
+    for (size_t i = 0; i < n; ++i) summary << ", " << space_.getName(i);
+    summary << "\n";
+    for (size_t i = 0; i < n; ++i) {
+        summary << space_.getName(i);
+        for (size_t j = 0; j < n; ++j) {
+            double s = std::sqrt(covariance_(i, i) * covariance_(j, j));
+            summary << ", " << (s > 0.0 ? covariance_(i, j) / s : (i == j ? 1.0 : 0.0));
+        }
+        summary << "\n";
+    }
+
+    std::ofstream file(settings_.pathname + settings_.samples_filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "sample_no";
+    for (size_t i = 0; i < n; ++i) file << ", " << space_.getName(i);
+    file << "\n";
+    file << std::scientific << std::setprecision(6);
+    for (size_t s = 0; s < samples_.size(); ++s) {
+        file << s;
+        for (double value : samples_[s]) file << ", " << value;
+        file << "\n";
+    }
+
+    return CPosteriorSummary(space_, samples_).write(settings_.pathname);
+}
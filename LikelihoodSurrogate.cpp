@@ -0,0 +1,181 @@
+#include "LikelihoodSurrogate.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+CLikelihoodSurrogate::CLikelihoodSurrogate(const std::string& method, size_t max_points)
+    : method_(method), max_points_(std::max<size_t>(max_points, 2))
+{
+}
+
+void CLikelihoodSurrogate::addPoint(const std::vector<double>& u, double value)
+{
+    if (!std::isfinite(value)) {
+        return;
+    }
+    pending_u_.push_back(u);
+    pending_y_.push_back(value);
+
+    // Only the newest max_points can enter the training set
+    if (pending_u_.size() > 2 * max_points_) {
+        pending_u_.erase(pending_u_.begin(), pending_u_.end() - max_points_);
+        pending_y_.erase(pending_y_.begin(), pending_y_.end() - max_points_);
+    }
+}
+
+bool CLikelihoodSurrogate::fit()
+{
+    train_u_.insert(train_u_.end(), pending_u_.begin(), pending_u_.end());
+    train_y_.insert(train_y_.end(), pending_y_.begin(), pending_y_.end());
+    pending_u_.clear();
+    pending_y_.clear();
+
+    // Keep the newest points
+    if (train_u_.size() > max_points_) {
+        const size_t drop = train_u_.size() - max_points_;
+        train_u_.erase(train_u_.begin(), train_u_.begin() + drop);
+        train_y_.erase(train_y_.begin(), train_y_.begin() + drop);
+    }
+    return refit();
+}
+
+void CLikelihoodSurrogate::restore(const std::vector<std::vector<double>>& train_u, const std::vector<double>& train_y,
+                                   const std::vector<std::vector<double>>& pending_u, const std::vector<double>& pending_y)
+{
+    train_u_ = train_u;
+    train_y_ = train_y;
+    pending_u_ = pending_u;
+    pending_y_ = pending_y;
+    refit();
+}
+
+arma::vec CLikelihoodSurrogate::standardize(const std::vector<double>& u) const
+{
+    return (arma::vec(u) - center_) / spread_;
+}
+
+arma::rowvec CLikelihoodSurrogate::features(const arma::vec& z, int order) const
+{
+    const arma::uword d = z.n_elem;
+    const arma::uword p = order == 2 ? (d + 1) * (d + 2) / 2 : (order == 1 ? d + 1 : 1);
+    arma::rowvec f(p);
+    f(0) = 1.0;
+    if (order >= 1) {
+        for (arma::uword i = 0; i < d; ++i) f(1 + i) = z(i);
+    }
+    if (order == 2) {
+        arma::uword c = d + 1;
+        for (arma::uword i = 0; i < d; ++i) {
+            for (arma::uword j = i; j < d; ++j) f(c++) = z(i) * z(j);
+        }
+    }
+    return f;
+}
+
+bool CLikelihoodSurrogate::refit()
+{
+    ready_ = false;
+    const size_t n = train_u_.size();
+    if (n < 2) {
+        return false;
+    }
+    const size_t d = train_u_[0].size();
+    const size_t quadratic_terms = (d + 1) * (d + 2) / 2;
+
+    if (method_ == "quadratic") {
+        if (n <= quadratic_terms) return false;
+        order_ = 2;
+    }
+    else {
+        order_ = n >= 2 * quadratic_terms ? 2 : (n >= 2 * (d + 1) ? 1 : 0);
+    }
+
+    // Standardized inputs
+    Z_.set_size(d, n);
+    for (size_t k = 0; k < n; ++k) Z_.col(k) = arma::vec(train_u_[k]);
+    center_ = arma::mean(Z_, 1);
+    spread_ = arma::stddev(Z_, 0, 1);
+    for (arma::uword i = 0; i < spread_.n_elem; ++i) {
+        if (!(spread_(i) > 0.0)) spread_(i) = 1.0;
+    }
+    Z_.each_col() -= center_;
+    Z_.each_col() /= spread_;
+
+    // Polynomial (trend) by ridge-regularized least squares
+    arma::mat F(n, features(Z_.col(0), order_).n_elem);
+    for (size_t k = 0; k < n; ++k) F.row(k) = features(Z_.col(k), order_);
+    const arma::vec y(train_y_);
+    arma::mat A = F.t() * F;
+    A.diag() += 1e-8 * (arma::trace(A) / A.n_rows + 1.0);
+    if (!arma::solve(beta_, A, F.t() * y)) {
+        return false;
+    }
+
+    if (method_ == "quadratic") {
+        loo_error_ = std::numeric_limits<double>::quiet_NaN();
+        ready_ = true;
+        return true;
+    }
+
+    // GP on the trend residuals; length scale and nugget by profile marginal likelihood
+    const arma::vec r = y - F * beta_;
+    arma::mat D2(n, n);
+    for (size_t a = 0; a < n; ++a) {
+        D2(a, a) = 0.0;
+        for (size_t b = a + 1; b < n; ++b) {
+            D2(a, b) = D2(b, a) = arma::accu(arma::square(Z_.col(a) - Z_.col(b)));
+        }
+    }
+
+    const double base = std::sqrt(static_cast<double>(d));
+    double best = std::numeric_limits<double>::infinity();
+    double best_nugget = 0.0;
+    for (double length_factor : {0.25, 0.5, 1.0, 2.0}) {
+        const double length = length_factor * base;
+        for (double nugget : {1e-8, 1e-5, 1e-3, 1e-1}) {
+            arma::mat R = arma::exp(-0.5 * D2 / (length * length));
+            R.diag() += nugget;
+            arma::mat U;  // R = U^T U
+            if (!arma::chol(U, R)) continue;
+            const arma::vec w = arma::solve(arma::trimatl(U.t()), r);
+            const double sigma2 = arma::dot(w, w) / n;
+            const double nll = 0.5 * n * std::log(std::max(sigma2, 1e-300)) + arma::accu(arma::log(U.diag()));
+            if (nll < best) {
+                best = nll;
+                length_ = length;
+                best_nugget = nugget;
+                alpha_ = arma::solve(arma::trimatu(U), w);
+            }
+        }
+    }
+    if (!std::isfinite(best)) {
+        return false;
+    }
+
+    // Leave-one-out residuals e_i = alpha_i / (R^-1)_ii
+    arma::mat R = arma::exp(-0.5 * D2 / (length_ * length_));
+    R.diag() += best_nugget;
+    arma::mat R_inv;
+    if (arma::inv_sympd(R_inv, R)) {
+        loo_error_ = std::sqrt(arma::mean(arma::square(alpha_ / R_inv.diag())));
+    }
+    else {
+        loo_error_ = std::numeric_limits<double>::quiet_NaN();
+    }
+
+    ready_ = true;
+    return true;
+}
+
+double CLikelihoodSurrogate::predict(const std::vector<double>& u) const
+{
+    const arma::vec z = standardize(u);
+    double value = arma::dot(features(z, order_), beta_);
+    if (method_ != "quadratic") {
+        const double scale = -0.5 / (length_ * length_);
+        for (arma::uword k = 0; k < Z_.n_cols; ++k) {
+            value += alpha_(k) * std::exp(scale * arma::accu(arma::square(z - Z_.col(k))));
+        }
+    }
+    return value;
+}
@@ -0,0 +1,94 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <armadillo>
+
+/**
+ * @brief Cheap regression of the log-likelihood on sampling-space coordinates
+ *
+ * Fitted to forward runs already made and used to screen MCMC proposals
+ * (delayed acceptance in CMCMCEngine). Two methods:
+ * - quadratic: full second-order polynomial, ridge-regularized least
+ *   squares. Exact for linear-Gaussian problems, robust far from the data.
+ * - gp: Gaussian process with squared-exponential kernel around a
+ *   polynomial trend (quadratic, linear or constant depending on the number
+ *   of points). The length scale and nugget are chosen on a small grid by
+ *   maximizing the profile marginal likelihood. Interpolates non-Gaussian
+ *   posteriors and reverts to the trend away from the data.
+ *
+ * Inputs are standardized by the mean and spread of the training points.
+ * New points are queued by addPoint() and enter the training set at the
+ * next fit(), which keeps the newest max_points. The fit depends only on
+ * the training set, so a surrogate restored from a checkpoint predicts
+ * exactly as the original.
+ */
+class CLikelihoodSurrogate
+{
+public:
+    explicit CLikelihoodSurrogate(const std::string& method = "gp", size_t max_points = 300);
+
+    /**
+     * @brief Queue an evaluated point for the next fit()
+     */
+    void addPoint(const std::vector<double>& u, double value);
+
+    /**
+     * @brief Move queued points into the training set and refit
+     * @return true if the surrogate can predict
+     */
+    bool fit();
+
+    bool isReady() const { return ready_; }
+
+    /**
+     * @brief Predicted log-likelihood (only valid if isReady())
+     */
+    double predict(const std::vector<double>& u) const;
+
+    const std::string& method() const { return method_; }
+    size_t pointCount() const { return train_u_.size(); }
+
+    /**
+     * @brief Root-mean-square leave-one-out error of the last fit (gp only, else NaN)
+     */
+    double looError() const { return loo_error_; }
+
+    // ========================================================================
+    // Checkpointing
+    // ========================================================================
+
+    const std::vector<std::vector<double>>& trainingPoints() const { return train_u_; }
+    const std::vector<double>& trainingValues() const { return train_y_; }
+    const std::vector<std::vector<double>>& pendingPoints() const { return pending_u_; }
+    const std::vector<double>& pendingValues() const { return pending_y_; }
+
+    /**
+     * @brief Restore the state saved from the accessors above and refit
+     */
+    void restore(const std::vector<std::vector<double>>& train_u, const std::vector<double>& train_y,
+                 const std::vector<std::vector<double>>& pending_u, const std::vector<double>& pending_y);
+
+private:
+    bool refit();
+    arma::rowvec features(const arma::vec& z, int order) const;
+    arma::vec standardize(const std::vector<double>& u) const;
+
+    std::string method_;
+    size_t max_points_;
+
+    std::vector<std::vector<double>> train_u_;
+    std::vector<double> train_y_;
+    std::vector<std::vector<double>> pending_u_;
+    std::vector<double> pending_y_;
+
+    bool ready_ = false;
+    arma::vec center_;              ///< Input standardization
+    arma::vec spread_;
+    int order_ = 0;                 ///< Order of the polynomial (trend)
+    arma::vec beta_;                ///< Polynomial coefficients
+    arma::mat Z_;                   ///< Standardized training inputs, one column per point
+    arma::vec alpha_;               ///< GP weights (R + g I)^-1 (y - trend)
+    double length_ = 1.0;           ///< GP length scale in standardized units
+    double loo_error_ = 0.0;
+};
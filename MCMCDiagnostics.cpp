@@ -0,0 +1,474 @@
+#include "MCMCDiagnostics.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <limits>
+#include <numeric>
+#include <armadillo>
+
+namespace {
+
+const double kNaN = std::numeric_limits<double>::quiet_NaN();
+
+/**
+ * @brief Biased autocovariance (divided by n) of a series via FFT
+ */
+std::vector<double> autocovariance(const std::vector<double>& x)
+{
+    const size_t n = x.size();
+    double mean = std::accumulate(x.begin(), x.end(), 0.0) / n;
+
+    size_t padded = 1;
+    while (padded < 2 * n) padded <<= 1;
+
+    arma::cx_vec y(padded, arma::fill::zeros);
+    for (size_t i = 0; i < n; ++i) {
+        y(i) = std::complex<double>(x[i] - mean, 0.0);
+    }
+    arma::cx_vec f = arma::fft(y);
+    arma::cx_vec power = f % arma::conj(f);
+    arma::cx_vec r = arma::ifft(power);
+
+    std::vector<double> acov(n);
+    for (size_t t = 0; t < n; ++t) {
+        acov[t] = r(t).real() / n;
+    }
+    return acov;
+}
+
+double quantile(std::vector<double> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    double pos = p * (values.size() - 1);
+    size_t lo = static_cast<size_t>(std::floor(pos));
+    size_t hi = std::min(lo + 1, values.size() - 1);
+    return values[lo] + (pos - lo) * (values[hi] - values[lo]);
+}
+
+std::vector<double> pool(const std::vector<std::vector<double>>& chains)
+{
+    std::vector<double> all;
+    for (const auto& chain : chains) all.insert(all.end(), chain.begin(), chain.end());
+    return all;
+}
+
+} // namespace
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+CMCMCDiagnostics::CMCMCDiagnostics(size_t number_of_chains, const std::vector<std::string>& names, size_t max_draws)
+    : names_(names)
+    , max_draws_(max_draws > 0 ? std::max<size_t>(max_draws, 8) : 0)
+    , counts_(number_of_chains, 0)
+    , draws_(names.size(), std::vector<std::vector<double>>(number_of_chains))
+    , shift_(names.size(), std::vector<double>(number_of_chains, 0.0))
+    , sum_(names.size(), std::vector<std::vector<double>>(number_of_chains))
+    , sum_sq_(names.size(), std::vector<std::vector<double>>(number_of_chains))
+    , rhat_(names.size(), kNaN)
+    , bulk_ess_(names.size(), kNaN)
+    , tail_ess_(names.size(), kNaN)
+    , mcse_(names.size(), kNaN)
+{
+}
+
+// ============================================================================
+// Data
+// ============================================================================
+
+void CMCMCDiagnostics::addDraw(size_t chain, const std::vector<double>& values)
+{
+    if (values.size() < names_.size()) {
+        return;
+    }
+    const size_t index = counts_[chain]++;
+    for (size_t i = 0; i < names_.size(); ++i) {
+        if (index == 0) shift_[i][chain] = values[i];
+        const double x = values[i] - shift_[i][chain];
+        if (index % stride_ == 0) {
+            draws_[i][chain].push_back(values[i]);
+            sum_[i][chain].push_back(x);
+            sum_sq_[i][chain].push_back(x * x);
+        }
+        else {
+            sum_[i][chain].back() += x;
+            sum_sq_[i][chain].back() += x * x;
+        }
+    }
+    if (max_draws_ > 0 && !draws_.empty() && draws_[0][chain].size() > 2 * max_draws_) {
+        thin();
+    }
+}
+
+size_t CMCMCDiagnostics::drawsPerChain() const
+{
+    if (counts_.empty() || names_.empty()) {
+        return 0;
+    }
+    return *std::min_element(counts_.begin(), counts_.end());
+}
+
+bool CMCMCDiagnostics::update()
+{
+    const size_t n = drawsPerChain();
+    if (n < 4) {
+        return false;
+    }
+
+    // Chains may differ by one draw while sampling; use a common length,
+    // n draws in total and buffered the first of every stride_. The split
+    // halves over all draws are made of the complete batches, the first and
+    // last half_batches of them (exactly the split halves when stride_ is 1)
+    const size_t buffered = (n - 1) / stride_ + 1;
+    const size_t batches = n / stride_;
+    const size_t half_batches = batches / 2;
+    const size_t half = half_batches * stride_;
+    const size_t m = counts_.size();
+
+    for (size_t p = 0; p < names_.size(); ++p) {
+        // Split-half moments over all draws from the batch sums
+        std::vector<double> means, vars;
+        for (size_t c = 0; c < m; ++c) {
+            const std::vector<double>& s1 = sum_[p][c];
+            const std::vector<double>& s2 = sum_sq_[p][c];
+            for (size_t begin : {size_t(0), batches - half_batches}) {
+                const double s = std::accumulate(s1.begin() + begin, s1.begin() + begin + half_batches, 0.0);
+                const double q = std::accumulate(s2.begin() + begin, s2.begin() + begin + half_batches, 0.0);
+                means.push_back(shift_[p][c] + s / half);
+                vars.push_back(std::max(0.0, (q - s * s / half) / (half - 1.0)));
+            }
+        }
+        const double grand = std::accumulate(means.begin(), means.end(), 0.0) / means.size();
+        double ss = 0.0;
+        for (size_t k = 0; k < means.size(); ++k) {
+            ss += (half - 1.0) * vars[k] + half * (means[k] - grand) * (means[k] - grand);
+        }
+        const double sd = std::sqrt(ss / (means.size() * half - 1.0));
+
+        std::vector<std::vector<double>> chains;
+        for (const auto& chain : draws_[p]) {
+            chains.emplace_back(chain.begin(), chain.begin() + buffered);
+        }
+        std::vector<std::vector<double>> split = splitChains(chains);
+        std::vector<double> all = pool(split);
+
+        // R-hat: maximum of rank-normalized bulk and folded (tail) versions,
+        // and of the split R-hat over all draws when the buffer is thinned
+        double median = quantile(all, 0.5);
+        std::vector<std::vector<double>> folded = split;
+        for (auto& chain : folded) {
+            for (double& x : chain) x = std::fabs(x - median);
+        }
+        std::vector<std::vector<double>> z = rankNormalize(split);
+        rhat_[p] = std::max(splitRhat(z), splitRhat(rankNormalize(folded)));
+        if (stride_ > 1 && means.size() > 1) {
+            double b = 0.0;
+            for (double mu : means) b += (mu - grand) * (mu - grand);
+            b *= static_cast<double>(half) / (means.size() - 1);
+            const double w = std::accumulate(vars.begin(), vars.end(), 0.0) / vars.size();
+            if (w > 0.0) {
+                rhat_[p] = std::max(rhat_[p], std::sqrt(((half - 1.0) / half * w + b / half) / w));
+            }
+        }
+
+        bulk_ess_[p] = effectiveSampleSize(z);
+
+        // Tail ESS: minimum over the 5% and 95% quantile indicators
+        double q05 = quantile(all, 0.05);
+        double q95 = quantile(all, 0.95);
+        std::vector<std::vector<double>> lower = split, upper = split;
+        for (size_t c = 0; c < split.size(); ++c) {
+            for (size_t i = 0; i < split[c].size(); ++i) {
+                lower[c][i] = split[c][i] <= q05 ? 1.0 : 0.0;
+                upper[c][i] = split[c][i] <= q95 ? 1.0 : 0.0;
+            }
+        }
+        tail_ess_[p] = std::min(effectiveSampleSize(lower), effectiveSampleSize(upper));
+
+        // MCSE of the mean: ESS of the untransformed draws, or batch means
+        // over all draws when the buffer is thinned, joining stored batches
+        // into batches of about sqrt(n) draws while they are shorter
+        if (stride_ == 1) {
+            double ess_mean = effectiveSampleSize(split);
+            mcse_[p] = ess_mean > 0.0 ? sd / std::sqrt(ess_mean) : kNaN;
+        }
+        else {
+            const size_t group = std::max<size_t>(1, static_cast<size_t>(std::sqrt(static_cast<double>(n)) / stride_));
+            const size_t b = group * stride_;
+            std::vector<double> batch_means;
+            for (size_t c = 0; c < m; ++c) {
+                const std::vector<double>& s1 = sum_[p][c];
+                for (size_t k = 0; k + group <= batches; k += group) {
+                    batch_means.push_back(shift_[p][c] + std::accumulate(s1.begin() + k, s1.begin() + k + group, 0.0) / b);
+                }
+            }
+            const double mean = std::accumulate(batch_means.begin(), batch_means.end(), 0.0) / batch_means.size();
+            double var = 0.0;
+            for (double x : batch_means) var += (x - mean) * (x - mean);
+            var /= batch_means.size() - 1.0;
+            mcse_[p] = std::sqrt(var / batch_means.size());
+        }
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Results
+// ============================================================================
+
+double CMCMCDiagnostics::maxRhat() const
+{
+    double value = kNaN;
+    for (double r : rhat_) {
+        if (std::isnan(r)) return kNaN;
+        value = std::isnan(value) ? r : std::max(value, r);
+    }
+    return value;
+}
+
+double CMCMCDiagnostics::minBulkESS() const
+{
+    double value = kNaN;
+    for (double e : bulk_ess_) {
+        if (std::isnan(e)) return kNaN;
+        value = std::isnan(value) ? e : std::min(value, e);
+    }
+    return value;
+}
+
+double CMCMCDiagnostics::minTailESS() const
+{
+    double value = kNaN;
+    for (double e : tail_ess_) {
+        if (std::isnan(e)) return kNaN;
+        value = std::isnan(value) ? e : std::min(value, e);
+    }
+    return value;
+}
+
+bool CMCMCDiagnostics::isConverged(double rhat_limit, double min_ess) const
+{
+    double rhat = maxRhat();
+    double bulk = minBulkESS();
+    double tail = minTailESS();
+    if (std::isnan(rhat) || std::isnan(bulk) || std::isnan(tail)) {
+        return false;
+    }
+    return rhat < rhat_limit && bulk > min_ess && tail > min_ess;
+}
+
+void CMCMCDiagnostics::write(std::ostream& out) const
+{
+    out << "Parameter,R_hat,Bulk_ESS,Tail_ESS,MCSE_mean\n";
+    for (size_t p = 0; p < names_.size(); ++p) {
+        out << names_[p] << "," << std::setprecision(4) << std::fixed << rhat_[p] << ","
+            << std::setprecision(0) << bulk_ess_[p] << "," << tail_ess_[p] << ","
+            << std::scientific << std::setprecision(3) << mcse_[p] << std::fixed << "\n";
+    }
+}
+
+// ============================================================================
+// Statistics on explicit chains
+// ============================================================================
+
+double CMCMCDiagnostics::splitRhat(const std::vector<std::vector<double>>& chains)
+{
+    const size_t m = chains.size();
+    if (m < 2) {
+        return kNaN;
+    }
+    const size_t n = chains[0].size();
+
+    std::vector<double> means(m), vars(m);
+    for (size_t c = 0; c < m; ++c) {
+        means[c] = std::accumulate(chains[c].begin(), chains[c].end(), 0.0) / n;
+        double ss = 0.0;
+        for (double x : chains[c]) ss += (x - means[c]) * (x - means[c]);
+        vars[c] = ss / (n - 1);
+    }
+    double grand = std::accumulate(means.begin(), means.end(), 0.0) / m;
+    double b = 0.0;
+    for (double mu : means) b += (mu - grand) * (mu - grand);
+    b *= static_cast<double>(n) / (m - 1);
+    double w = std::accumulate(vars.begin(), vars.end(), 0.0) / m;
+    if (!(w > 0.0)) {
+        return kNaN;
+    }
+
+    double var_plus = (n - 1.0) / n * w + b / n;
+    return std::sqrt(var_plus / w);
+}
+
+double CMCMCDiagnostics::effectiveSampleSize(const std::vector<std::vector<double>>& chains)
+{
+    const size_t m = chains.size();
+    if (m == 0 || chains[0].size() < 4) {
+        return kNaN;
+    }
+    const size_t n = chains[0].size();
+
+    std::vector<std::vector<double>> acov(m);
+    std::vector<double> means(m);
+    for (size_t c = 0; c < m; ++c) {
+        acov[c] = autocovariance(chains[c]);
+        means[c] = std::accumulate(chains[c].begin(), chains[c].end(), 0.0) / n;
+    }
+
+    std::vector<double> acov_mean(n, 0.0);
+    double w = 0.0;
+    for (size_t c = 0; c < m; ++c) {
+        for (size_t t = 0; t < n; ++t) acov_mean[t] += acov[c][t] / m;
+        w += acov[c][0] * n / (n - 1.0) / m;
+    }
+    double var_plus = w * (n - 1.0) / n;
+    if (m > 1) {
+        double grand = std::accumulate(means.begin(), means.end(), 0.0) / m;
+        double b = 0.0;
+        for (double mu : means) b += (mu - grand) * (mu - grand);
+        var_plus += b / (m - 1);
+    }
+    if (!(var_plus > 0.0)) {
+        return kNaN;
+    }
+
+    // Geyer's initial positive sequence on pairs of autocorrelations
+    std::vector<double> rho(n, 0.0);
+    rho[0] = 1.0;
+    double rho_even = 1.0;
+    double rho_odd = 1.0 - (w - acov_mean[1]) / var_plus;
+    rho[1] = rho_odd;
+    size_t s = 1;
+    while (s + 4 < n && rho_even + rho_odd > 0.0) {
+        rho_even = 1.0 - (w - acov_mean[s + 1]) / var_plus;
+        rho_odd = 1.0 - (w - acov_mean[s + 2]) / var_plus;
+        if (rho_even + rho_odd >= 0.0) {
+            rho[s + 1] = rho_even;
+            rho[s + 2] = rho_odd;
+        }
+        s += 2;
+    }
+    size_t max_s = s;
+    if (rho_even > 0.0 && max_s + 1 < n) {
+        rho[max_s + 1] = rho_even;
+    }
+
+    // Initial monotone sequence
+    for (s = 1; s + 3 <= max_s; s += 2) {
+        if (rho[s + 1] + rho[s + 2] > rho[s - 1] + rho[s]) {
+            rho[s + 1] = (rho[s - 1] + rho[s]) / 2.0;
+            rho[s + 2] = rho[s + 1];
+        }
+    }
+
+    double total = static_cast<double>(m * n);
+    double tau = -1.0;
+    for (s = 0; s < max_s; ++s) tau += 2.0 * rho[s];
+    if (max_s + 1 < n) tau += rho[max_s + 1];
+    tau = std::max(tau, 1.0 / std::log10(total));
+    return total / tau;
+}
+
+double CMCMCDiagnostics::normalQuantile(double p)
+{
+    // Acklam's rational approximation, relative error < 1.2e-9
+    static const double a[] = {-3.969683028665376e+01, 2.209460984245205e+02, -2.759285104469687e+02,
+                               1.383577518672690e+02, -3.066479806614716e+01, 2.506628277459239e+00};
+    static const double b[] = {-5.447609879822406e+01, 1.615858368580409e+02, -1.556989798598866e+02,
+                               6.680131188771972e+01, -1.328068155288572e+01};
+    static const double c[] = {-7.784894002430293e-03, -3.223964580411365e-01, -2.400758277161838e+00,
+                               -2.549732539343734e+00, 4.374664141464968e+00, 2.938163982698783e+00};
+    static const double d[] = {7.784695709041462e-03, 3.224671290700398e-01, 2.445134137142996e+00,
+                               3.754408661907416e+00};
+
+    if (p <= 0.0) return -std::numeric_limits<double>::infinity();
+    if (p >= 1.0) return std::numeric_limits<double>::infinity();
+
+    const double p_low = 0.02425;
+    if (p < p_low) {
+        double q = std::sqrt(-2.0 * std::log(p));
+        return (((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    if (p > 1.0 - p_low) {
+        double q = std::sqrt(-2.0 * std::log(1.0 - p));
+        return -(((((c[0] * q + c[1]) * q + c[2]) * q + c[3]) * q + c[4]) * q + c[5]) /
+               ((((d[0] * q + d[1]) * q + d[2]) * q + d[3]) * q + 1.0);
+    }
+    double q = p - 0.5;
+    double r = q * q;
+    return (((((a[0] * r + a[1]) * r + a[2]) * r + a[3]) * r + a[4]) * r + a[5]) * q /
+           (((((b[0] * r + b[1]) * r + b[2]) * r + b[3]) * r + b[4]) * r + 1.0);
+}
+
+// ============================================================================
+// Private Helpers
+// ============================================================================
+
+std::vector<std::vector<double>> CMCMCDiagnostics::splitChains(const std::vector<std::vector<double>>& chains) const
+{
+    // Each chain contributes its first and last half; a middle draw of an
+    // odd-length chain is dropped
+    std::vector<std::vector<double>> split;
+    for (const auto& chain : chains) {
+        size_t half = chain.size() / 2;
+        split.emplace_back(chain.begin(), chain.begin() + half);
+        split.emplace_back(chain.end() - half, chain.end());
+    }
+    return split;
+}
+
+void CMCMCDiagnostics::thin()
+{
+    // Keep every other buffered draw: indices that are multiples of 2 stride_,
+    // and merge the batch sums in pairs to match
+    for (auto& parameter : draws_) {
+        for (auto& chain : parameter) {
+            size_t kept = 0;
+            for (size_t i = 0; i < chain.size(); i += 2) chain[kept++] = chain[i];
+            chain.resize(kept);
+        }
+    }
+    for (auto* sums : {&sum_, &sum_sq_}) {
+        for (auto& parameter : *sums) {
+            for (auto& chain : parameter) {
+                size_t kept = 0;
+                for (size_t i = 0; i < chain.size(); i += 2) {
+                    chain[kept++] = chain[i] + (i + 1 < chain.size() ? chain[i + 1] : 0.0);
+                }
+                chain.resize(kept);
+            }
+        }
+    }
+    stride_ *= 2;
+}
+
+std::vector<std::vector<double>> CMCMCDiagnostics::rankNormalize(const std::vector<std::vector<double>>& chains) const
+{
+    std::vector<double> all = pool(chains);
+    const size_t total = all.size();
+
+    std::vector<size_t> order(total);
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&all](size_t a, size_t b) { return all[a] < all[b]; });
+
+    // Average ranks for ties (1-based)
+    std::vector<double> ranks(total);
+    for (size_t i = 0; i < total;) {
+        size_t j = i;
+        while (j + 1 < total && all[order[j + 1]] == all[order[i]]) ++j;
+        double rank = 0.5 * (i + j) + 1.0;
+        for (size_t k = i; k <= j; ++k) ranks[order[k]] = rank;
+        i = j + 1;
+    }
+
+    std::vector<std::vector<double>> z = chains;
+    size_t index = 0;
+    for (auto& chain : z) {
+        for (double& x : chain) {
+            x = normalQuantile((ranks[index++] - 0.375) / (total + 0.25));
+        }
+    }
+    return z;
+}
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <ostream>
+
+/**
+ * @brief Convergence diagnostics for multiple MCMC chains
+ *
+ * Implements the rank-normalized split-R-hat, bulk and tail effective
+ * sample sizes and the Monte Carlo standard error of the mean following
+ * Vehtari, Gelman, Simpson, Carpenter & Buerkner (2021). Draws are
+ * appended per chain while sampling and update() refreshes the statistics.
+ *
+ * The rank-based statistics (R-hat, bulk and tail ESS) need the draws
+ * themselves; with max_draws set they are computed on a per-chain buffer
+ * thinned to between max_draws and 2 max_draws evenly spaced draws, so the
+ * memory and the cost of an update stay bounded however long the run.
+ * Alongside each buffered draw the sum and sum of squares of the batch of
+ * draws it starts are kept (pairs of batches merge when the buffer is
+ * thinned), which gives the split-half means and variances over all draws
+ * to within one batch. R-hat is then the larger of the rank-based value on
+ * the buffer and the classic split R-hat over all draws, the ESS, being
+ * that of the thinned chains, is a lower bound (conservative for a stop
+ * rule) and the MCSE of the mean comes from batch means over all draws.
+ * Without max_draws every draw is kept and the statistics are exact.
+ */
+class CMCMCDiagnostics
+{
+public:
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CMCMCDiagnostics() = default;
+
+    /**
+     * @brief Create diagnostics for a fixed number of chains
+     * @param number_of_chains Chains contributing draws
+     * @param names Parameter names
+     * @param max_draws Draws per chain kept for the rank-based statistics (0 = all)
+     */
+    CMCMCDiagnostics(size_t number_of_chains, const std::vector<std::string>& names, size_t max_draws = 0);
+
+    // ========================================================================
+    // Data
+    // ========================================================================
+
+    /**
+     * @brief Append one draw of all parameters to a chain
+     */
+    void addDraw(size_t chain, const std::vector<double>& values);
+
+    /**
+     * @brief Smallest number of draws held by any chain
+     */
+    size_t drawsPerChain() const;
+
+    /**
+     * @brief Refresh the statistics from the draws added so far
+     * @return false if there are too few draws (fewer than 4 per chain)
+     */
+    bool update();
+
+    // ========================================================================
+    // Results
+    // ========================================================================
+
+    size_t size() const { return names_.size(); }
+    const std::string& getName(size_t index) const { return names_[index]; }
+
+    double getRhat(size_t index) const { return rhat_[index]; }
+    double getBulkESS(size_t index) const { return bulk_ess_[index]; }
+    double getTailESS(size_t index) const { return tail_ess_[index]; }
+    double getMCSE(size_t index) const { return mcse_[index]; }
+
+    double maxRhat() const;
+    double minBulkESS() const;
+    double minTailESS() const;
+
+    /**
+     * @brief Stop rule: all R-hat below rhat_limit and all bulk and tail ESS above min_ess
+     */
+    bool isConverged(double rhat_limit, double min_ess) const;
+
+    /**
+     * @brief Write a table of the current statistics
+     */
+    void write(std::ostream& out) const;
+
+    // ========================================================================
+    // Statistics on explicit chains
+    // ========================================================================
+
+    /**
+     * @brief Split R-hat of the given chains (no rank normalization)
+     */
+    static double splitRhat(const std::vector<std::vector<double>>& chains);
+
+    /**
+     * @brief Multi-chain effective sample size (Geyer initial monotone sequence)
+     */
+    static double effectiveSampleSize(const std::vector<std::vector<double>>& chains);
+
+    /**
+     * @brief Inverse of the standard normal CDF
+     */
+    static double normalQuantile(double p);
+
+private:
+    std::vector<std::vector<double>> splitChains(const std::vector<std::vector<double>>& chains) const;
+    std::vector<std::vector<double>> rankNormalize(const std::vector<std::vector<double>>& chains) const;
+    void thin();
+
+    std::vector<std::string> names_;
+    size_t max_draws_ = 0;
+    size_t stride_ = 1;                                    ///< Buffered draws are those with index % stride_ == 0
+    std::vector<size_t> counts_;                           ///< Draws added per chain
+    std::vector<std::vector<std::vector<double>>> draws_;  ///< [parameter][chain][buffered draw]
+    std::vector<std::vector<double>> shift_;               ///< [parameter][chain] first draw, subtracted in the sums
+    std::vector<std::vector<std::vector<double>>> sum_;    ///< [parameter][chain][k] sum of draws k stride_ to (k + 1) stride_ - 1
+    std::vector<std::vector<std::vector<double>>> sum_sq_; ///< [parameter][chain][k] sum of their squares
+
+    std::vector<double> rhat_;
+    std::vector<double> bulk_ess_;
+    std::vector<double> tail_ess_;
+    std::vector<double> mcse_;
+};
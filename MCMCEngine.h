@@ -0,0 +1,460 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <armadillo>
+#include "ParameterSpace.h"
+#include "MCMCDiagnostics.h"
+#include "LikelihoodSurrogate.h"
+
+#ifdef Q_GUI_SUPPORT
+class ProgressWindow;
+#endif
+
+/**
+ * @brief Settings for the adaptive samplers of CMCMCEngine
+ *
+ * Keys shared with CMCMC (number_of_samples, number_of_chains, ...) carry
+ * the same meaning so a single .mcmcsettings file configures both.
+ */
+struct MCMCEngineSettings
+{
+    std::string sampler = "standard";        ///< standard | adaptive_metropolis | robust_adaptive_metropolis | dream | parallel_tempering | nuts
+    int total_number_of_samples = 1000;      ///< Total samples over all chains
+    int number_of_chains = 1;                ///< Number of chains
+    int burnout_samples = 0;                 ///< Total burn-in samples over all chains
+    int save_interval = 1;                   ///< Write every n-th sample to file
+    double perturbation_factor = 0.05;       ///< Initial proposal std as fraction of range
+    double acceptance_rate = 0.234;          ///< Target acceptance rate
+    int numberOfThreads = 1;                 ///< Threads used to advance chains
+    bool no_initial_perturbation = false;    ///< Start chain 0 from current values only
+    int initial_covariance_weight = 200;     ///< Sample weight of the initial proposal covariance
+    double adaptation_decay = 0.66;          ///< Exponent of adaptation step size n^-gamma
+    double adaptation_epsilon = 1e-10;       ///< Regularization added to proposal covariance
+    unsigned long random_seed = 0;           ///< 0 = seed from random_device
+    int dream_pairs = 3;                     ///< Maximum number of chain pairs per DREAM jump
+    int dream_crossover_values = 3;          ///< Number of crossover probabilities (CR = m/n)
+    int dream_archive_interval = 10;         ///< Generations between archive updates
+    int pt_temperatures = 8;                 ///< Rungs of each parallel tempering ladder
+    double pt_initial_spacing = 1.5;         ///< Initial ratio between adjacent temperatures
+    int pt_swap_interval = 1;                ///< Steps between replica exchange rounds
+    double pt_swap_rate = 0.234;             ///< Target swap acceptance rate between rungs
+    int nuts_max_depth = 10;                 ///< Maximum NUTS tree depth
+    double nuts_target_accept = 0.8;         ///< Dual-averaging target acceptance statistic
+    std::string nuts_metric = "diagonal";    ///< diagonal | dense mass matrix
+    bool nuts_finite_differences = false;    ///< Accept nuts with finite-difference gradients (see below)
+    bool early_rejection = true;             ///< Stop likelihood evaluation once rejection is certain
+    bool delayed_acceptance = false;         ///< Screen proposals with a log-likelihood surrogate first
+    std::string surrogate = "gp";            ///< gp | quadratic
+    int surrogate_max_points = 300;          ///< Newest forward runs the surrogate is fitted to
+    int surrogate_refit_interval = 50;       ///< Steps per chain between refits during burn-in (doubling afterwards)
+    int diagnostics_interval = 0;            ///< Steps per chain between diagnostics updates (0 = auto)
+    int diagnostics_max_draws = 1000;        ///< Draws per chain for the rank-based diagnostics while sampling (0 = all)
+    double stop_rhat = 0.0;                  ///< Stop when all R-hat fall below this (0 = never stop early)
+    double stop_min_ess = 400.0;             ///< ... and all bulk/tail ESS exceed this
+    int checkpoint_interval = 0;             ///< Steps per chain between checkpoints (0 = off)
+    std::string checkpoint_filename = "mcmc_checkpoint.bin";
+    std::string samples_format = "binary";   ///< binary (compressed columnar store) | text
+    std::string samples_filename;            ///< Empty: mcmc_samples.bin or mcmc_samples.txt
+    bool store_observation_loglik = true;    ///< Write each observation's log-likelihood for every stored row
+    bool async_output = true;                ///< Write samples on a separate thread
+    int output_queue_size = 1024;            ///< Rows queued before sampling waits for the writer
+    std::string output_path;                 ///< Directory for output files
+};
+
+/**
+ * @brief Adaptive Markov Chain Monte Carlo samplers
+ *
+ * Complements CMCMC with samplers that learn the full proposal covariance
+ * online instead of independent per-parameter perturbations:
+ * - adaptive_metropolis: Haario et al. (2001) with global scale adaptation.
+ *   The empirical covariance is kept as a Cholesky factor and refreshed with
+ *   a rank-one update per step.
+ * - robust_adaptive_metropolis: Vihola (2012). The proposal shape is
+ *   adjusted by rank-one Cholesky updates/downdates to reach the target
+ *   acceptance rate.
+ * - dream: DREAM(ZS) (ter Braak & Vrugt 2008). Chains jump along differences
+ *   of archived past states with randomized subspace crossover. Crossover
+ *   probabilities are adapted and outlier chains reset during burn-in.
+ * - parallel_tempering: every chain is the cold end of a ladder of replicas
+ *   sampling the likelihood raised to 1/T. Replicas use adaptive_metropolis
+ *   proposals, adjacent rungs exchange states periodically and the
+ *   temperature gaps are adapted during burn-in. Only cold chains are
+ *   recorded.
+ * - nuts: No-U-Turn Sampler (Hoffman & Gelman 2014) driven by the model's
+ *   log-posterior gradient. Step size is tuned by dual averaging and the
+ *   diagonal or dense mass matrix is estimated in doubling windows during
+ *   burn-in. Without an analytic gradient every leapfrog step costs 2d + 1
+ *   forward runs (central differences) and a draw takes up to
+ *   2^nuts_max_depth steps, far more runs per effective sample than the
+ *   adaptive Metropolis samplers; nuts is therefore refused unless
+ *   nuts_finite_differences is set.
+ *
+ * With delayed_acceptance (all samplers but nuts), proposals are first
+ * screened against a surrogate S of the log-likelihood (CLikelihoodSurrogate)
+ * fitted to the forward runs already made. A proposal y from x survives with
+ * probability min(1, exp(r)), where r is the log-target ratio with S in
+ * place of the likelihood; only survivors run the full model and are
+ * accepted with probability min(1, exp(log-target ratio - r)) (Christen &
+ * Fox 2005). For any fixed surrogate this kernel is reversible with respect
+ * to the exact posterior, so a poor surrogate costs efficiency, not
+ * accuracy. The surrogate is refitted from the points of all chains between
+ * steps, every surrogate_refit_interval steps during burn-in and at doubling
+ * intervals afterwards, so that its adaptation diminishes like the proposal
+ * adaptation.
+ *
+ * Sampling takes place in the space defined by CParameterSpace (log space
+ * for log-normal parameters). Each chain owns a copy of the model so chains
+ * advance in parallel.
+ *
+ * With store_observation_loglik, the log-likelihood of every observation
+ * at each stored row is written to <samples>_obsloglik (same format as the
+ * samples, matched by sample_no), so CPosteriorReweighting can use the
+ * likelihood the chain was actually sampled with. The terms come from the
+ * likelihood evaluation that was accepted, so they cost no forward runs;
+ * only nuts, whose states come from trajectories, evaluates them again
+ * when a row is stored and the chain has moved since its last stored row.
+ *
+ * @tparam T Model type providing Parameters(), setAllParameterValues(),
+ *           calculateLogLikelihood(), calculateLogLikelihood(threshold,
+ *           terms) and calculateLogPrior(); nuts also requires
+ *           calculateLogPosteriorGradient() and store_observation_loglik
+ *           requires calculateObservationLogLikelihoods(),
+ *           getObservationCount() and getObservation(i).GetName()
+ */
+template<class T>
+class CMCMCEngine
+{
+public:
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CMCMCEngine();
+    explicit CMCMCEngine(T* model);
+
+    /**
+     * @brief Set the model whose parameters will be sampled
+     */
+    void SetModel(T* model) { model_ = model; }
+
+    // ========================================================================
+    // Settings
+    // ========================================================================
+
+    /**
+     * @brief Set a property by name (same keys as .mcmcsettings)
+     * @return true if the property is recognized by the engine
+     */
+    bool SetProperty(const std::string& prop, const std::string& value);
+
+    const MCMCEngineSettings& GetSettings() const { return settings_; }
+
+    /**
+     * @brief All settings as (key, value) pairs accepted by SetProperty()
+     */
+    std::vector<std::pair<std::string, std::string>> GetProperties() const;
+
+    /**
+     * @brief Whether a sampler other than the standard CMCMC is selected
+     */
+    bool IsEnabled() const { return settings_.sampler != "standard"; }
+
+    std::string getLastError() const { return last_error_; }
+
+#ifdef Q_GUI_SUPPORT
+    void SetRunTimeWindow(ProgressWindow* window) { rtw_ = window; }
+#endif
+
+    // ========================================================================
+    // Sampling
+    // ========================================================================
+
+    /**
+     * @brief Initialize chains
+     * @param random_start Start all chains from random points in the prior range
+     * @return true if every chain has a finite log-posterior
+     */
+    bool Initialize(bool random_start = false);
+
+    /**
+     * @brief Run the sampler and write samples to file
+     * @return true if sampling completed; false if it was cancelled
+     *         (getLastError() empty) or output could not be written
+     */
+    bool Perform();
+
+    /**
+     * @brief Continue an interrupted run from a checkpoint written by Perform()
+     * @param checkpoint_filename Checkpoint file (see checkpoint_interval)
+     * @return true if sampling completed without cancellation
+     *
+     * Restores settings, chain states, adaptation state and random number
+     * generators, truncates the samples file to the checkpointed position
+     * and continues. The samples recorded before the checkpoint are read
+     * back from the samples file rather than stored in the checkpoint, so a
+     * checkpoint costs the same at any point of the run (with a binary
+     * store they only rebuild the diagnostics and are not kept); with
+     * record_interval > 1 only the rows written to the file are restored,
+     * and text files restore them to the six digits written. The samples
+     * file and the continued chains are identical to an uninterrupted run.
+     */
+    bool Resume(const std::string& checkpoint_filename);
+
+    // ========================================================================
+    // Results
+    // ========================================================================
+
+    double GetAcceptanceRate() const;
+
+    /**
+     * @brief Draws of the cold chains held in memory, in sample_no order
+     *
+     * With the text format every draw of the run is kept. A binary store
+     * holds the run on disk, so only the draws of the last step are kept;
+     * use GetPosteriorSamples() for the full set.
+     */
+    const std::vector<std::vector<double>>& GetParameterSamples() const { return samples_; }
+    const std::vector<double>& GetLogPosteriors() const { return sample_logp_; }
+
+    /**
+     * @brief Draws of the cold chains so far, including burn-in and those not kept in memory
+     */
+    long GetSampleCount() const { return sample_count_; }
+
+    /**
+     * @brief Post burn-in draws, from memory or read back from the binary store
+     * @return false if the samples file cannot be read (see getLastError())
+     *
+     * Read from a store, the draws are the rows written to the file, every
+     * record_interval-th draw.
+     */
+    bool GetPosteriorSamples(std::vector<std::vector<double>>& samples) const;
+    const CParameterSpace& GetParameterSpace() const { return space_; }
+
+    /**
+     * @brief Full path of the samples file (read binary stores with CSampleStoreReader)
+     */
+    std::string GetSamplesFilename() const;
+
+    /**
+     * @brief Full path of the per-observation log-likelihood file (<samples>_obsloglik)
+     */
+    std::string GetObservationTermsFilename() const;
+
+    /**
+     * @brief Number of DREAM outlier chains reset during burn-in
+     */
+    int GetOutlierResetCount() const { return outlier_resets_; }
+
+    /**
+     * @brief Parallel tempering temperatures, cold chain first
+     */
+    const std::vector<double>& GetTemperatures() const { return temperatures_; }
+
+    /**
+     * @brief Swap acceptance rate between rung j and j+1, pooled over ladders
+     */
+    std::vector<double> GetSwapAcceptanceRates() const;
+
+    /**
+     * @brief NUTS divergent transitions after burn-in, summed over chains
+     */
+    long GetDivergentTransitions() const;
+
+    /**
+     * @brief Number of gradient evaluations, summed over chains
+     */
+    long GetGradientEvaluations() const;
+
+    /**
+     * @brief Convergence diagnostics of the post burn-in draws
+     */
+    const CMCMCDiagnostics& GetDiagnostics() const { return diagnostics_; }
+
+    /**
+     * @brief Whether Perform() stopped because the stop rule was met
+     */
+    bool StoppedOnConvergence() const { return converged_early_; }
+
+    /**
+     * @brief Proposals rejected by the surrogate without a forward run, summed over chains
+     */
+    long GetScreenedProposals() const;
+
+    /**
+     * @brief Full likelihood evaluations during sampling, summed over chains
+     */
+    long GetLikelihoodEvaluations() const;
+
+    const CLikelihoodSurrogate& GetSurrogate() const { return surrogate_; }
+
+private:
+    /**
+     * @brief State of a single chain
+     */
+    struct Chain
+    {
+        T model;                  ///< Private model copy
+        std::vector<double> u;    ///< Current point in sampling space
+        double logp = 0.0;        ///< Log-posterior in physical space
+        double logp_t = 0.0;      ///< Log-posterior including Jacobian
+        double loglik = 0.0;      ///< Log-likelihood
+        double beta = 1.0;        ///< Inverse temperature
+        std::mt19937_64 rng;
+        arma::mat L;              ///< Cholesky factor of proposal shape
+        arma::vec mean;           ///< Running mean (adaptive_metropolis)
+        double weight = 0.0;      ///< Effective sample count of running moments
+        double log_scale = 0.0;   ///< Log of global proposal scale
+        long steps = 0;
+        long accepted = 0;
+        int stuck = 0;
+        bool last_accepted = false;
+        std::vector<double> last_jump;       ///< Last proposed jump
+        int cr_index = 0;                    ///< DREAM crossover index of last jump
+        std::vector<double> logp_history;    ///< DREAM log-posterior trace for outlier detection
+        std::vector<double> obs_loglik;      ///< Per-observation log-likelihoods at obs_loglik_u
+        std::vector<double> obs_loglik_u;
+        std::vector<double> proposal_terms; ///< Terms of the last complete likelihood evaluation
+
+        // NUTS state
+        arma::vec grad;                      ///< Gradient of logp_t at u
+        arma::mat metric;                    ///< Inverse mass matrix
+        arma::mat momentum_L;                ///< Cholesky factor of the mass matrix
+        double step_size = 1.0;
+        double da_mu = 0.0;                  ///< Dual averaging: log(10 eps0)
+        double da_log_step_bar = 0.0;
+        double da_h_bar = 0.0;
+        long da_count = 0;
+        arma::vec welford_mean;
+        arma::mat welford_m2;
+        long welford_count = 0;
+        long window_end = 0;                 ///< Step at which the current metric window closes
+        long window_size = 0;
+        double accept_stat_sum = 0.0;
+        long divergences = 0;
+        long gradient_evaluations = 0;
+
+        // Delayed acceptance
+        long screened = 0;                   ///< Proposals rejected by the surrogate
+        long likelihood_evaluations = 0;
+        std::vector<std::vector<double>> new_u;  ///< Forward runs since the last surrogate update
+        std::vector<double> new_loglik;
+    };
+
+    /**
+     * @brief Subtree built by the NUTS doubling procedure
+     */
+    struct NUTSTree
+    {
+        arma::vec u_minus, p_minus, g_minus;
+        arma::vec u_plus, p_plus, g_plus;
+        arma::vec u_prop, g_prop;
+        double logp_prop = 0.0;
+        double loglik_prop = 0.0;
+        long n = 0;
+        bool valid = true;
+        double alpha = 0.0;
+        long n_alpha = 0;
+    };
+
+    double logPosterior(Chain& chain, const std::vector<double>& u, double& logp_physical, double& loglik);
+    CMCMCDiagnostics recordedDiagnostics(int n_recorded, size_t max_draws) const;
+    void step(Chain& chain);
+    double logPosteriorBounded(Chain& chain, const std::vector<double>& u, double log_threshold,
+                               double& logp_physical, double& loglik);
+    double metropolis(Chain& chain, const std::vector<double>& u_new);
+    void adaptAM(Chain& chain, double alpha);
+    void adaptRAM(Chain& chain, const arma::vec& z, double alpha);
+    bool run(long start_step, long sample_no, long long file_offset, long long terms_offset);
+    bool writeCheckpoint(const std::string& filename, long next_step, long sample_no,
+                         long long file_offset, long long terms_offset) const;
+    bool readCheckpoint(const std::string& filename, long& next_step, long& sample_no,
+                        long long& file_offset, long long& terms_offset);
+    bool restoreSamples(long long file_offset, long long terms_offset);
+    bool readSamplesFile(std::vector<std::vector<double>>& samples, std::vector<double>& logp,
+                         std::vector<long>& numbers) const;
+    std::vector<std::string> storeColumns() const;
+    std::vector<std::string> termsColumns() const;
+    void keepObservationTerms(Chain& chain);
+    void updateObservationTerms(Chain& chain);
+    std::vector<double> termsRow(long sample_no, const Chain& chain) const;
+    void writeTerms(std::ofstream& file, const std::vector<double>& row) const;
+    std::vector<double> storeRow(long sample_no, const Chain& chain, int chain_index) const;
+    void writeHeader(std::ofstream& file) const;
+    std::vector<double> textRow(long sample_no, const Chain& chain) const;
+    void writeSample(std::ofstream& file, const std::vector<double>& row) const;
+    double proposalScale(const Chain& chain, size_t index) const;
+
+    void initializeDREAM(unsigned long seed);
+    arma::vec proposeDREAM(Chain& chain);
+    void updateDREAM(long generation, bool burn_in);
+
+    void swapReplicas(bool adapt);
+
+    void updateSurrogate(long step, bool burn_in);
+    bool usesDelayedAcceptance() const { return settings_.delayed_acceptance && settings_.sampler != "nuts"; }
+
+    double logPosteriorGradient(Chain& chain, const arma::vec& u, arma::vec& grad, double& loglik);
+    void initializeNUTS(Chain& chain);
+    void stepNUTS(Chain& chain);
+    NUTSTree buildTree(Chain& chain, const arma::vec& u, const arma::vec& p, const arma::vec& g,
+                       double log_slice, int direction, int depth, double h0);
+    bool noUTurn(const Chain& chain, const arma::vec& u_minus, const arma::vec& u_plus,
+                 const arma::vec& p_minus, const arma::vec& p_plus) const;
+    double findReasonableStepSize(Chain& chain);
+    void adaptNUTS(Chain& chain, double accept_stat);
+    void setMetric(Chain& chain, const arma::mat& metric);
+    int temperatureRungs() const { return settings_.sampler == "parallel_tempering" ? settings_.pt_temperatures : 1; }
+    bool usesAdaptiveMetropolis() const
+    {
+        return settings_.sampler == "adaptive_metropolis" || settings_.sampler == "parallel_tempering";
+    }
+
+    static bool choleskyRankOne(arma::mat& L, arma::vec x, double sign);
+
+    T* model_ = nullptr;
+    MCMCEngineSettings settings_;
+    CParameterSpace space_;
+    std::vector<Chain> chains_;
+    std::vector<std::vector<double>> samples_;
+    std::vector<double> sample_logp_;
+    std::vector<long> sample_numbers_;       ///< sample_no of each row of samples_
+    long sample_count_ = 0;
+    mutable std::string last_error_;
+    CMCMCDiagnostics diagnostics_;
+    bool converged_early_ = false;
+
+    // DREAM(ZS) state
+    std::vector<std::vector<double>> archive_;
+    std::vector<double> cr_probability_;
+    std::vector<double> cr_jump_distance_;
+    std::vector<long> cr_count_;
+    int outlier_resets_ = 0;
+
+    // Parallel tempering state
+    std::vector<double> temperatures_;
+    std::vector<long> swap_attempts_;
+    std::vector<long> swap_accepts_;
+    long swap_rounds_ = 0;
+    std::mt19937_64 swap_rng_;
+
+    // NUTS warm-up schedule per chain
+    long nuts_warmup_ = 0;
+    long nuts_init_buffer_ = 0;
+    long nuts_term_buffer_ = 0;
+    long nuts_first_window_ = 0;
+
+    // Delayed acceptance surrogate, shared by all chains and refitted between steps
+    CLikelihoodSurrogate surrogate_;
+    long surrogate_next_refit_ = 0;
+    long surrogate_interval_ = 0;
+
+#ifdef Q_GUI_SUPPORT
+    ProgressWindow* rtw_ = nullptr;
+#endif
+};
+
+#include "MCMCEngine.hpp"
@@ -0,0 +1,2058 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <iomanip>
+#include <algorithm>
+#include <sstream>
+#include <filesystem>
+#include <memory>
+#include "Checkpoint.h"
+#include "SampleStore.h"
+#include "AsyncWriter.h"
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#endif
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+template<class T>
+CMCMCEngine<T>::CMCMCEngine()
+{
+}
+
+template<class T>
+CMCMCEngine<T>::CMCMCEngine(T* model)
+    : model_(model)
+{
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+template<class T>
+bool CMCMCEngine<T>::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "sampler") {
+            std::string sampler = value;
+            std::transform(sampler.begin(), sampler.end(), sampler.begin(), ::tolower);
+            if (sampler != "standard" &&
+                sampler != "adaptive_metropolis" &&
+                sampler != "robust_adaptive_metropolis" &&
+                sampler != "dream" &&
+                sampler != "parallel_tempering" &&
+                sampler != "nuts") {
+                last_error_ = "Unknown sampler: " + value;
+                return false;
+            }
+            settings_.sampler = sampler;
+        }
+        else if (key == "number_of_samples") settings_.total_number_of_samples = std::stoi(value);
+        else if (key == "number_of_chains") settings_.number_of_chains = std::max(1, std::stoi(value));
+        else if (key == "number_of_burnout_samples") settings_.burnout_samples = std::stoi(value);
+        else if (key == "record_interval") settings_.save_interval = std::max(1, std::stoi(value));
+        else if (key == "perturbation_factor") settings_.perturbation_factor = std::stod(value);
+        else if (key == "acceptance_rate") settings_.acceptance_rate = std::stod(value);
+        else if (key == "number_of_threads") settings_.numberOfThreads = std::max(1, std::stoi(value));
+        else if (key == "initial_perturbation") settings_.no_initial_perturbation = (value == "no");
+        else if (key == "initial_covariance_weight") settings_.initial_covariance_weight = std::max(1, std::stoi(value));
+        else if (key == "adaptation_decay") settings_.adaptation_decay = std::stod(value);
+        else if (key == "adaptation_epsilon") settings_.adaptation_epsilon = std::stod(value);
+        else if (key == "random_seed") settings_.random_seed = std::stoul(value);
+        else if (key == "dream_pairs") settings_.dream_pairs = std::max(1, std::stoi(value));
+        else if (key == "dream_crossover_values") settings_.dream_crossover_values = std::max(1, std::stoi(value));
+        else if (key == "dream_archive_interval") settings_.dream_archive_interval = std::max(1, std::stoi(value));
+        else if (key == "pt_temperatures") settings_.pt_temperatures = std::max(2, std::stoi(value));
+        else if (key == "pt_initial_spacing") settings_.pt_initial_spacing = std::max(1.0001, std::stod(value));
+        else if (key == "pt_swap_interval") settings_.pt_swap_interval = std::max(1, std::stoi(value));
+        else if (key == "pt_swap_rate") settings_.pt_swap_rate = std::stod(value);
+        else if (key == "nuts_max_depth") settings_.nuts_max_depth = std::max(1, std::stoi(value));
+        else if (key == "nuts_target_accept") settings_.nuts_target_accept = std::stod(value);
+        else if (key == "nuts_metric") {
+            if (value != "diagonal" && value != "dense") {
+                last_error_ = "Unknown NUTS metric: " + value;
+                return false;
+            }
+            settings_.nuts_metric = value;
+        }
+        else if (key == "nuts_finite_differences") settings_.nuts_finite_differences = (value != "no" && value != "false" && value != "0");
+        else if (key == "early_rejection") settings_.early_rejection = (value != "no" && value != "false" && value != "0");
+        else if (key == "delayed_acceptance") settings_.delayed_acceptance = (value != "no" && value != "false" && value != "0");
+        else if (key == "surrogate") {
+            if (value != "gp" && value != "quadratic") {
+                last_error_ = "Unknown surrogate: " + value;
+                return false;
+            }
+            settings_.surrogate = value;
+        }
+        else if (key == "surrogate_max_points") settings_.surrogate_max_points = std::max(10, std::stoi(value));
+        else if (key == "surrogate_refit_interval") settings_.surrogate_refit_interval = std::max(1, std::stoi(value));
+        else if (key == "diagnostics_interval") settings_.diagnostics_interval = std::max(0, std::stoi(value));
+        else if (key == "diagnostics_max_draws") settings_.diagnostics_max_draws = std::max(0, std::stoi(value));
+        else if (key == "stop_rhat") settings_.stop_rhat = std::stod(value);
+        else if (key == "stop_min_ess") settings_.stop_min_ess = std::stod(value);
+        else if (key == "checkpoint_interval") settings_.checkpoint_interval = std::max(0, std::stoi(value));
+        else if (key == "checkpoint_filename") settings_.checkpoint_filename = value;
+        else if (key == "samples_format") {
+            if (value != "binary" && value != "text") {
+                last_error_ = "Unknown samples format: " + value;
+                return false;
+            }
+            settings_.samples_format = value;
+        }
+        else if (key == "async_output") settings_.async_output = (value != "no" && value != "false" && value != "0");
+        else if (key == "output_queue_size") settings_.output_queue_size = std::max(1, std::stoi(value));
+        else if (key == "samples_filename") settings_.samples_filename = value;
+        else if (key == "store_observation_loglik") settings_.store_observation_loglik = (value != "no" && value != "false" && value != "0");
+        else if (key == "output_path") settings_.output_path = value;
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Initialization
+// ============================================================================
+
+template<class T>
+bool CMCMCEngine<T>::Initialize(bool random_start)
+{
+    if (!model_) {
+        last_error_ = "No model assigned to MCMC engine";
+        return false;
+    }
+
+    space_ = CParameterSpace(model_->Parameters());
+    const size_t d = space_.size();
+    if (d == 0) {
+        last_error_ = "No parameters to sample";
+        return false;
+    }
+
+    unsigned long seed = settings_.random_seed;
+    if (seed == 0) {
+        seed = std::random_device{}();
+    }
+
+    // Initial proposal: independent perturbations scaled to the parameter range
+    arma::mat L0(d, d, arma::fill::zeros);
+    for (size_t i = 0; i < d; ++i) {
+        double width = space_.getSamplingHigh(i) - space_.getSamplingLow(i);
+        L0(i, i) = settings_.perturbation_factor * (width > 0.0 ? width : 1.0);
+    }
+
+    std::vector<double> u_current = space_.toSampling(model_->getParameterValues());
+
+    // Parallel tempering runs a temperature ladder per recorded chain;
+    // replica k * rungs + j sits on rung j, rung 0 being the cold chain
+    const int rungs = temperatureRungs();
+    temperatures_.assign(rungs, 1.0);
+    for (int j = 1; j < rungs; ++j) {
+        temperatures_[j] = temperatures_[j - 1] * settings_.pt_initial_spacing;
+    }
+    swap_attempts_.assign(std::max(0, rungs - 1), 0);
+    swap_accepts_.assign(std::max(0, rungs - 1), 0);
+    swap_rounds_ = 0;
+    swap_rng_.seed(seed ^ 0x9E3779B97F4A7C15UL);
+
+    surrogate_ = CLikelihoodSurrogate(settings_.surrogate, settings_.surrogate_max_points);
+    surrogate_interval_ = settings_.surrogate_refit_interval;
+    surrogate_next_refit_ = surrogate_interval_;
+
+    chains_.clear();
+    chains_.resize(static_cast<size_t>(settings_.number_of_chains) * rungs);
+
+    for (size_t k = 0; k < chains_.size(); ++k) {
+        Chain& chain = chains_[k];
+        chain.model = *model_;
+        chain.rng.seed(seed + 7919UL * k);
+        chain.L = L0;
+        chain.log_scale = 0.0;
+        chain.weight = settings_.initial_covariance_weight;
+        chain.steps = 0;
+        chain.accepted = 0;
+        chain.stuck = 0;
+        chain.beta = 1.0 / temperatures_[k % rungs];
+
+        std::uniform_real_distribution<double> unif(0.0, 1.0);
+        bool from_current = (k == 0 && !random_start) ||
+                            (settings_.no_initial_perturbation && !random_start);
+
+        bool found = false;
+        for (int attempt = 0; attempt < 100 && !found; ++attempt) {
+            if (from_current && attempt == 0) {
+                chain.u = u_current;
+            }
+            else {
+                chain.u.resize(d);
+                for (size_t i = 0; i < d; ++i) {
+                    chain.u[i] = space_.getSamplingLow(i) +
+                                 unif(chain.rng) * (space_.getSamplingHigh(i) - space_.getSamplingLow(i));
+                }
+            }
+            chain.logp_t = logPosterior(chain, chain.u, chain.logp, chain.loglik);
+            found = std::isfinite(chain.logp_t);
+            keepObservationTerms(chain);
+        }
+
+        if (!found) {
+            last_error_ = "Could not find a starting point with finite posterior for chain " +
+                          std::to_string(k);
+            return false;
+        }
+
+        chain.mean = arma::vec(chain.u);
+        chain.last_jump.assign(d, 0.0);
+        if (usesDelayedAcceptance()) {
+            chain.new_u.push_back(chain.u);
+            chain.new_loglik.push_back(chain.loglik);
+        }
+    }
+
+    if (settings_.sampler == "dream") {
+        initializeDREAM(seed);
+    }
+
+    if (settings_.sampler == "nuts") {
+        if (!settings_.nuts_finite_differences) {
+            last_error_ = "nuts needs the log-posterior gradient, which is computed by finite differences at " +
+                          std::to_string(2 * d + 1) + " forward runs per leapfrog step and up to 2^" +
+                          std::to_string(settings_.nuts_max_depth) + " steps per draw; use adaptive_metropolis, "
+                          "or set nuts_finite_differences yes to accept the cost";
+            return false;
+        }
+
+        // Metric windows as in Stan: initial and terminal buffers adapt only
+        // the step size, the windows in between double in length
+        nuts_warmup_ = settings_.burnout_samples / settings_.number_of_chains;
+        nuts_init_buffer_ = 75;
+        nuts_term_buffer_ = 50;
+        nuts_first_window_ = 25;
+        if (nuts_warmup_ < nuts_init_buffer_ + nuts_term_buffer_ + nuts_first_window_) {
+            nuts_init_buffer_ = static_cast<long>(0.15 * nuts_warmup_);
+            nuts_term_buffer_ = static_cast<long>(0.1 * nuts_warmup_);
+            nuts_first_window_ = nuts_warmup_ - nuts_init_buffer_ - nuts_term_buffer_;
+        }
+        for (auto& chain : chains_) {
+            initializeNUTS(chain);
+            if (!std::isfinite(chain.logp_t)) {
+                last_error_ = "Log-posterior gradient is not finite at the starting point";
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Sampling
+// ============================================================================
+
+template<class T>
+double CMCMCEngine<T>::logPosterior(Chain& chain, const std::vector<double>& u,
+                                    double& logp_physical, double& loglik)
+{
+    std::vector<double> x = space_.fromSampling(u);
+    if (!space_.inBounds(x)) {
+        logp_physical = -std::numeric_limits<double>::infinity();
+        loglik = logp_physical;
+        return logp_physical;
+    }
+
+    chain.model.setAllParameterValues(x);
+    chain.proposal_terms.clear();
+    if (settings_.store_observation_loglik) {
+        // Without a threshold the bounded form never stops early and also returns the terms
+        loglik = chain.model.calculateLogLikelihood(-std::numeric_limits<double>::infinity(), &chain.proposal_terms);
+    }
+    else {
+        loglik = chain.model.calculateLogLikelihood();
+    }
+    logp_physical = loglik + chain.model.calculateLogPrior();
+    if (!std::isfinite(logp_physical)) {
+        logp_physical = -std::numeric_limits<double>::infinity();
+        return logp_physical;
+    }
+
+    return logp_physical + space_.logJacobian(u);
+}
+
+template<class T>
+void CMCMCEngine<T>::step(Chain& chain)
+{
+    const size_t d = space_.size();
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    if (settings_.sampler == "nuts") {
+        stepNUTS(chain);
+        return;
+    }
+
+    arma::vec z(d);
+    arma::vec du;
+    if (settings_.sampler == "dream") {
+        du = proposeDREAM(chain);
+    }
+    else {
+        for (size_t i = 0; i < d; ++i) z(i) = normal(chain.rng);
+
+        du = std::exp(chain.log_scale) * (chain.L * z);
+        if (usesAdaptiveMetropolis() && settings_.adaptation_epsilon > 0.0) {
+            for (size_t i = 0; i < d; ++i) {
+                du(i) += std::sqrt(settings_.adaptation_epsilon) * normal(chain.rng);
+            }
+        }
+    }
+
+    std::vector<double> u_new(d);
+    for (size_t i = 0; i < d; ++i) {
+        u_new[i] = chain.u[i] + du(i);
+        chain.last_jump[i] = du(i);
+    }
+
+    double alpha = metropolis(chain, u_new);
+
+    if (settings_.sampler == "robust_adaptive_metropolis") {
+        adaptRAM(chain, z, alpha);
+    }
+    else if (usesAdaptiveMetropolis()) {
+        adaptAM(chain, alpha);
+    }
+}
+
+template<class T>
+double CMCMCEngine<T>::logPosteriorBounded(Chain& chain, const std::vector<double>& u, double log_threshold,
+                                           double& logp_physical, double& loglik)
+{
+    const double neg_inf = -std::numeric_limits<double>::infinity();
+    logp_physical = loglik = neg_inf;
+
+    std::vector<double> x = space_.fromSampling(u);
+    if (!space_.inBounds(x)) {
+        return neg_inf;
+    }
+
+    // Prior and Jacobian are cheap, so the likelihood threshold is exact:
+    // beta * L + prior + jacobian >= log_threshold
+    chain.model.setAllParameterValues(x);
+    double log_prior = chain.model.calculateLogPrior();
+    if (!std::isfinite(log_prior)) {
+        return neg_inf;
+    }
+    double log_jacobian = space_.logJacobian(u);
+    double threshold = (log_threshold - log_prior - log_jacobian) / chain.beta;
+
+    chain.proposal_terms.clear();
+    loglik = chain.model.calculateLogLikelihood(threshold,
+                                                settings_.store_observation_loglik ? &chain.proposal_terms : nullptr);
+    logp_physical = loglik + log_prior;
+    if (!std::isfinite(logp_physical)) {
+        logp_physical = loglik = neg_inf;
+        return neg_inf;
+    }
+    return logp_physical + log_jacobian;
+}
+
+template<class T>
+double CMCMCEngine<T>::metropolis(Chain& chain, const std::vector<double>& u_new)
+{
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+    // Drawing the uniform first fixes the target value below which the
+    // proposal is rejected, which lets the likelihood stop early
+    const double log_u = std::log(unif(chain.rng));
+    const double target_old = chain.logp_t - (1.0 - chain.beta) * chain.loglik;
+
+    // Tempered target: beta * log-likelihood + log-prior + log-Jacobian
+    double alpha = 0.0;
+    double log_ratio = -std::numeric_limits<double>::infinity();
+    double logp_new = -std::numeric_limits<double>::infinity();
+    double logp_t_new = -std::numeric_limits<double>::infinity();
+    double loglik_new = -std::numeric_limits<double>::infinity();
+    const bool screen = usesDelayedAcceptance() && surrogate_.isReady();
+    if (space_.inSamplingBounds(u_new)) {
+        // Delayed acceptance, first stage: the same target with the surrogate
+        // in place of the likelihood; prior and Jacobian are exact
+        double log_surrogate_ratio = 0.0;
+        bool survived = true;
+        if (screen) {
+            std::vector<double> x_new = space_.fromSampling(u_new);
+            survived = false;
+            if (space_.inBounds(x_new)) {
+                chain.model.setAllParameterValues(x_new);
+                double log_prior = chain.model.calculateLogPrior();
+                if (std::isfinite(log_prior)) {
+                    log_surrogate_ratio = chain.beta * (surrogate_.predict(u_new) - surrogate_.predict(chain.u)) +
+                                          log_prior + space_.logJacobian(u_new) - (chain.logp_t - chain.loglik);
+                    survived = std::log(unif(chain.rng)) < log_surrogate_ratio;
+                }
+            }
+            if (!survived) {
+                chain.screened++;
+            }
+        }
+
+        // Second stage: the full likelihood corrects for the surrogate error
+        if (survived) {
+            chain.likelihood_evaluations++;
+            if (settings_.early_rejection) {
+                logp_t_new = logPosteriorBounded(chain, u_new, target_old + log_u + log_surrogate_ratio,
+                                                 logp_new, loglik_new);
+            }
+            else {
+                logp_t_new = logPosterior(chain, u_new, logp_new, loglik_new);
+            }
+            if (std::isfinite(logp_t_new)) {
+                log_ratio = (logp_t_new - (1.0 - chain.beta) * loglik_new) - target_old - log_surrogate_ratio;
+                alpha = std::min(1.0, std::exp(log_ratio));
+                if (usesDelayedAcceptance()) {
+                    chain.new_u.push_back(u_new);
+                    chain.new_loglik.push_back(loglik_new);
+                }
+            }
+        }
+    }
+
+    chain.steps++;
+    chain.last_accepted = log_u < log_ratio;
+
+    // With early rejection or screening alpha is unknown for rejected proposals;
+    // the acceptance indicator is an unbiased substitute for scale adaptation
+    if (settings_.early_rejection || screen) {
+        alpha = chain.last_accepted ? 1.0 : 0.0;
+    }
+    if (chain.last_accepted) {
+        chain.u = u_new;
+        chain.logp = logp_new;
+        chain.logp_t = logp_t_new;
+        chain.loglik = loglik_new;
+        chain.accepted++;
+        chain.stuck = 0;
+        keepObservationTerms(chain);
+    }
+    else {
+        chain.stuck++;
+    }
+
+    return alpha;
+}
+
+template<class T>
+void CMCMCEngine<T>::adaptAM(Chain& chain, double alpha)
+{
+    // Global scale: Robbins-Monro towards the target acceptance rate
+    double gamma = std::pow(static_cast<double>(chain.steps), -settings_.adaptation_decay);
+    chain.log_scale += gamma * (alpha - settings_.acceptance_rate);
+
+    // Running moments: C' = w/(w+1) C + w/(w+1)^2 (u-m)(u-m)^T
+    const double w = chain.weight;
+    arma::vec u(chain.u);
+    arma::vec delta = u - chain.mean;
+    chain.mean += delta / (w + 1.0);
+
+    if (choleskyRankOne(chain.L, delta / std::sqrt(w + 1.0), 1.0)) {
+        chain.L *= std::sqrt(w / (w + 1.0));
+    }
+    chain.weight = w + 1.0;
+}
+
+template<class T>
+void CMCMCEngine<T>::adaptRAM(Chain& chain, const arma::vec& z, double alpha)
+{
+    const double d = static_cast<double>(space_.size());
+    double eta = std::min(1.0, d * std::pow(static_cast<double>(chain.steps), -settings_.adaptation_decay));
+    double norm_z = arma::norm(z, 2);
+    double diff = alpha - settings_.acceptance_rate;
+    if (norm_z <= 0.0 || diff == 0.0) {
+        return;
+    }
+
+    // S S^T <- S (I + eta (alpha - alpha*) z z^T / |z|^2) S^T
+    arma::vec v = chain.L * z * (std::sqrt(eta * std::fabs(diff)) / norm_z);
+    choleskyRankOne(chain.L, v, diff > 0.0 ? 1.0 : -1.0);
+}
+
+template<class T>
+bool CMCMCEngine<T>::choleskyRankOne(arma::mat& L, arma::vec x, double sign)
+{
+    // Rank-one update (sign = +1) or downdate (sign = -1) of a lower-triangular
+    // factor. L is left untouched if the downdate would lose positive definiteness.
+    arma::mat Lnew = L;
+    const arma::uword n = Lnew.n_rows;
+
+    for (arma::uword k = 0; k < n; ++k) {
+        double Lkk = Lnew(k, k);
+        double r2 = Lkk * Lkk + sign * x(k) * x(k);
+        if (!(r2 > 0.0) || !std::isfinite(r2) || Lkk == 0.0) {
+            return false;
+        }
+        double r = std::sqrt(r2);
+        double c = r / Lkk;
+        double s = x(k) / Lkk;
+        Lnew(k, k) = r;
+        for (arma::uword i = k + 1; i < n; ++i) {
+            Lnew(i, k) = (Lnew(i, k) + sign * s * x(i)) / c;
+            x(i) = c * x(i) - s * Lnew(i, k);
+        }
+    }
+
+    L = Lnew;
+    return true;
+}
+
+template<class T>
+bool CMCMCEngine<T>::Perform()
+{
+    if (chains_.empty() && !Initialize(false)) {
+        return false;
+    }
+
+    samples_.clear();
+    sample_logp_.clear();
+    sample_numbers_.clear();
+    sample_count_ = 0;
+    return run(0, 0, -1, -1);
+}
+
+template<class T>
+bool CMCMCEngine<T>::Resume(const std::string& checkpoint_filename)
+{
+    long start_step = 0;
+    long sample_no = 0;
+    long long file_offset = 0;
+    long long terms_offset = -1;
+    if (!readCheckpoint(checkpoint_filename, start_step, sample_no, file_offset, terms_offset) ||
+        !restoreSamples(file_offset, terms_offset)) {
+        return false;
+    }
+    return run(start_step, sample_no, file_offset, terms_offset);
+}
+
+template<class T>
+bool CMCMCEngine<T>::restoreSamples(long long file_offset, long long terms_offset)
+{
+    // Drop rows written after the checkpoint so the files continue exactly
+    const std::string filename = GetSamplesFilename();
+    std::error_code ec;
+    std::filesystem::resize_file(filename, static_cast<std::uintmax_t>(file_offset), ec);
+    if (ec) {
+        last_error_ = "Cannot truncate samples file " + filename + ": " + ec.message();
+        return false;
+    }
+    if (terms_offset >= 0) {
+        const std::string terms_filename = GetObservationTermsFilename();
+        std::filesystem::resize_file(terms_filename, static_cast<std::uintmax_t>(terms_offset), ec);
+        if (ec) {
+            last_error_ = "Cannot truncate observation terms file " + terms_filename + ": " + ec.message();
+            return false;
+        }
+    }
+
+    return readSamplesFile(samples_, sample_logp_, sample_numbers_);
+}
+
+template<class T>
+bool CMCMCEngine<T>::readSamplesFile(std::vector<std::vector<double>>& samples, std::vector<double>& logp,
+                                     std::vector<long>& numbers) const
+{
+    const std::string filename = GetSamplesFilename();
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> columns;
+    try {
+        readSampleTable(filename, names, columns);
+    }
+    catch (const std::exception& e) {
+        last_error_ = "Cannot read samples file " + filename + ": " + e.what();
+        return false;
+    }
+
+    auto find = [&names](const std::string& name) {
+        auto it = std::find(names.begin(), names.end(), name);
+        return it == names.end() ? -1 : static_cast<int>(it - names.begin());
+    };
+    std::vector<int> parameter_columns;
+    for (const std::string& name : space_.getNames()) {
+        parameter_columns.push_back(find(name));
+    }
+    const int number_column = find("sample_no");
+    const int logp_column = find("log_posterior");
+    if (number_column < 0 || logp_column < 0 ||
+        std::find(parameter_columns.begin(), parameter_columns.end(), -1) != parameter_columns.end()) {
+        last_error_ = "Samples file " + filename + " does not match the checkpoint";
+        return false;
+    }
+
+    samples.clear();
+    logp.clear();
+    numbers.clear();
+    for (size_t r = 0; r < columns[number_column].size(); ++r) {
+        std::vector<double> x;
+        for (int c : parameter_columns) x.push_back(columns[c][r]);
+        samples.push_back(x);
+        logp.push_back(columns[logp_column][r]);
+        numbers.push_back(static_cast<long>(columns[number_column][r]));
+    }
+    return true;
+}
+
+template<class T>
+CMCMCDiagnostics CMCMCEngine<T>::recordedDiagnostics(int n_recorded, size_t max_draws) const
+{
+    CMCMCDiagnostics diagnostics(n_recorded, space_.getNames(), max_draws);
+    for (size_t i = 0; i < samples_.size(); ++i) {
+        // sample_no counts from 1 over the recorded chains, step by step
+        const long index = sample_numbers_[i] - 1;
+        const long s = index / n_recorded;
+        if ((s + 1) * n_recorded > settings_.burnout_samples) {
+            diagnostics.addDraw(index % n_recorded, samples_[i]);
+        }
+    }
+    return diagnostics;
+}
+
+template<class T>
+bool CMCMCEngine<T>::run(long start_step, long sample_no, long long file_offset, long long terms_offset)
+{
+    last_error_.clear();
+    const std::string filename = GetSamplesFilename();
+
+    // Binary rows are buffered and written chunk-wise; text rows are formatted per sample
+    std::unique_ptr<CSampleStoreWriter> store;
+    std::ofstream file;
+    if (settings_.samples_format == "binary") {
+        try {
+            store = std::make_unique<CSampleStoreWriter>(filename, storeColumns(), file_offset >= 0);
+        }
+        catch (const std::exception& e) {
+            last_error_ = e.what();
+            return false;
+        }
+    }
+    else {
+        file.open(filename, file_offset >= 0 ? std::ios::app : std::ios::trunc);
+        if (!file.is_open()) {
+            last_error_ = "Cannot open samples file: " + filename;
+            return false;
+        }
+        if (file_offset < 0) {
+            writeHeader(file);
+        }
+    }
+
+    // Observation terms of the stored rows go to a second file of the same format
+    const bool store_terms = settings_.store_observation_loglik;
+    std::unique_ptr<CSampleStoreWriter> terms_store;
+    std::ofstream terms_file;
+    if (store_terms) {
+        const std::string terms_filename = GetObservationTermsFilename();
+        const bool append = file_offset >= 0 && terms_offset >= 0;
+        if (store) {
+            try {
+                terms_store = std::make_unique<CSampleStoreWriter>(terms_filename, termsColumns(), append);
+            }
+            catch (const std::exception& e) {
+                last_error_ = e.what();
+                return false;
+            }
+        }
+        else {
+            terms_file.open(terms_filename, append ? std::ios::app : std::ios::trunc);
+            if (!terms_file.is_open()) {
+                last_error_ = "Cannot open observation terms file: " + terms_filename;
+                return false;
+            }
+            if (!append) {
+                const std::vector<std::string> columns = termsColumns();
+                for (size_t c = 0; c < columns.size(); ++c) {
+                    terms_file << (c > 0 ? ", " : "") << columns[c];
+                }
+                terms_file << "\n";
+            }
+        }
+    }
+
+    // Compression and formatting run on the writer thread; the sampling loop only queues rows
+    CAsyncWriter writer(settings_.output_queue_size, settings_.async_output);
+    CSampleStoreWriter* sink = store.get();
+    CSampleStoreWriter* terms_sink = terms_store.get();
+    auto flushSamples = [&](long long& samples_end, long long& terms_end) {
+        writer.submit([&]() {
+            if (sink) {
+                sink->flush();
+                samples_end = sink->bytesWritten();
+            }
+            else {
+                file.flush();
+                samples_end = static_cast<long long>(file.tellp());
+            }
+            terms_end = -1;
+            if (terms_sink) {
+                terms_sink->flush();
+                terms_end = terms_sink->bytesWritten();
+            }
+            else if (store_terms) {
+                terms_file.flush();
+                terms_end = static_cast<long long>(terms_file.tellp());
+            }
+        });
+        writer.flush();
+    };
+
+    const int n_chains = static_cast<int>(chains_.size());
+    const int rungs = temperatureRungs();
+    const int n_recorded = n_chains / rungs;
+    const long steps_per_chain = (settings_.total_number_of_samples + n_recorded - 1) / n_recorded;
+    const long report_every = std::max(1L, steps_per_chain / 200);
+
+    // Diagnostics are rebuilt from the recorded post burn-in samples; while
+    // sampling the rank-based statistics use a bounded thinned buffer
+    diagnostics_ = recordedDiagnostics(n_recorded, settings_.diagnostics_max_draws);
+    sample_count_ = sample_no;
+
+    // A binary store holds the run, so memory keeps only the draws of the
+    // current step; adaptation works on the chain states and diagnostics
+    // on their own buffer
+    const bool keep_all = !store;
+    const size_t kept_rows = keep_all ? static_cast<size_t>(steps_per_chain * n_recorded) : n_recorded;
+    if (!keep_all) {
+        samples_.clear();
+        sample_logp_.clear();
+        sample_numbers_.clear();
+    }
+    samples_.reserve(kept_rows);
+    sample_logp_.reserve(kept_rows);
+    sample_numbers_.reserve(kept_rows);
+    converged_early_ = false;
+    const long diagnostics_every = settings_.diagnostics_interval > 0
+                                       ? settings_.diagnostics_interval
+                                       : std::max(50L, steps_per_chain / 100);
+
+    bool cancelled = false;
+    long s = start_step;
+
+    for (; s < steps_per_chain && !cancelled && !converged_early_; ++s) {
+#pragma omp parallel for num_threads(settings_.numberOfThreads)
+        for (int k = 0; k < n_chains; ++k) {
+            step(chains_[k]);
+        }
+
+        const bool burn_in = (s + 1) * n_recorded <= settings_.burnout_samples;
+        if (settings_.sampler == "dream") {
+            updateDREAM(s + 1, burn_in);
+        }
+        else if (rungs > 1 && (s + 1) % settings_.pt_swap_interval == 0) {
+            swapReplicas(burn_in);
+        }
+        if (usesDelayedAcceptance()) {
+            updateSurrogate(s + 1, burn_in);
+        }
+
+        // Observation terms of the cold chains whose rows are stored in this step
+        if (store_terms) {
+#pragma omp parallel for schedule(dynamic) num_threads(settings_.numberOfThreads)
+            for (int j = 0; j < n_recorded; ++j) {
+                if ((sample_no + j + 1) % settings_.save_interval == 0) {
+                    updateObservationTerms(chains_[j * rungs]);
+                }
+            }
+        }
+
+        // Only cold chains are recorded
+        if (!keep_all) {
+            samples_.clear();
+            sample_logp_.clear();
+            sample_numbers_.clear();
+        }
+        for (int k = 0; k < n_chains; k += rungs) {
+            ++sample_no;
+            samples_.push_back(space_.fromSampling(chains_[k].u));
+            sample_logp_.push_back(chains_[k].logp);
+            sample_numbers_.push_back(sample_no);
+            if (sample_no % settings_.save_interval == 0) {
+                if (sink) {
+                    writer.submit([sink, row = storeRow(sample_no, chains_[k], k / rungs)]() {
+                        sink->append(row);
+                    });
+                }
+                else {
+                    writer.submit([this, &file, row = textRow(sample_no, chains_[k])]() {
+                        writeSample(file, row);
+                    });
+                }
+                if (terms_sink) {
+                    writer.submit([terms_sink, row = termsRow(sample_no, chains_[k])]() {
+                        terms_sink->append(row);
+                    });
+                }
+                else if (store_terms) {
+                    writer.submit([this, &terms_file, row = termsRow(sample_no, chains_[k])]() {
+                        writeTerms(terms_file, row);
+                    });
+                }
+            }
+            if (!burn_in) {
+                diagnostics_.addDraw(k / rungs, samples_.back());
+            }
+        }
+        sample_count_ = sample_no;
+
+        // Convergence diagnostics on post burn-in draws, with optional stop rule
+        bool diagnostics_updated = false;
+        if (!burn_in && ((s + 1) % diagnostics_every == 0 || s == steps_per_chain - 1)) {
+            diagnostics_updated = diagnostics_.update();
+            if (diagnostics_updated && settings_.stop_rhat > 0.0 &&
+                diagnostics_.isConverged(settings_.stop_rhat, settings_.stop_min_ess)) {
+                converged_early_ = true;
+            }
+        }
+
+#ifdef Q_GUI_SUPPORT
+        if (rtw_ && diagnostics_updated) {
+            if (rungs == 1 && std::isfinite(diagnostics_.maxRhat())) {
+                rtw_->AddTertiaryChartPoint(sample_no, diagnostics_.maxRhat());
+            }
+            std::ostringstream table;
+            diagnostics_.write(table);
+            rtw_->SetInfoText(QString::fromStdString(table.str()));
+            if (converged_early_) {
+                rtw_->AppendLog(QString("Convergence criteria met after %1 samples; stopping.").arg(sample_no));
+            }
+        }
+
+        if (rtw_ && (s % report_every == 0 || s == steps_per_chain - 1)) {
+            double mean_scale = 0.0;
+            for (int k = 0; k < n_chains; k += rungs) {
+                if (settings_.sampler == "dream") {
+                    mean_scale += arma::norm(arma::vec(chains_[k].last_jump), 2);
+                }
+                else if (settings_.sampler == "nuts") {
+                    mean_scale += chains_[k].step_size;
+                }
+                else {
+                    mean_scale += std::exp(chains_[k].log_scale);
+                }
+            }
+            mean_scale /= n_recorded;
+
+            rtw_->SetProgress(static_cast<double>(s + 1) / steps_per_chain);
+            rtw_->AddPrimaryChartPoint(sample_no, mean_scale);
+            rtw_->AddSecondaryChartPoint(sample_no, GetAcceptanceRate());
+            if (rungs > 1) {
+                std::vector<double> rates = GetSwapAcceptanceRates();
+                double mean_rate = 0.0;
+                for (double rate : rates) mean_rate += rate;
+                rtw_->AddTertiaryChartPoint(sample_no, mean_rate / rates.size());
+            }
+            QApplication::processEvents();
+            if (rtw_->IsCancelRequested()) {
+                rtw_->AppendLog("MCMC cancelled by user.");
+                cancelled = true;
+            }
+        }
+#else
+        (void)report_every;
+        (void)diagnostics_updated;
+#endif
+
+        if (settings_.checkpoint_interval > 0 && (s + 1) % settings_.checkpoint_interval == 0 &&
+            s + 1 < steps_per_chain) {
+            long long samples_end = 0, terms_end = -1;
+            flushSamples(samples_end, terms_end);
+            if (!writeCheckpoint(settings_.output_path + settings_.checkpoint_filename,
+                                 s + 1, sample_no, samples_end, terms_end)) {
+                return false;
+            }
+        }
+    }
+
+    // A cancelled run can be resumed from where it stopped
+    if (cancelled && settings_.checkpoint_interval > 0) {
+        long long samples_end = 0, terms_end = -1;
+        flushSamples(samples_end, terms_end);
+        writeCheckpoint(settings_.output_path + settings_.checkpoint_filename,
+                        s, sample_no, samples_end, terms_end);
+    }
+
+    writer.close();
+    if (store) {
+        store->close();
+    }
+    else {
+        file.close();
+    }
+    if (terms_store) {
+        terms_store->close();
+    }
+    else if (store_terms) {
+        terms_file.close();
+    }
+    if (!writer.error().empty()) {
+        last_error_ = "Writing samples failed: " + writer.error();
+        return false;
+    }
+
+    // Final statistics from every post burn-in draw; with a binary store
+    // those of the sampling buffer (exact when diagnostics_max_draws is 0)
+    if (diagnostics_.drawsPerChain() >= 4) {
+        if (keep_all) {
+            diagnostics_ = recordedDiagnostics(n_recorded, 0);
+        }
+        diagnostics_.update();
+        std::ofstream diag_file(settings_.output_path + "MCMC_diagnostics.txt");
+        if (diag_file.is_open()) {
+            diagnostics_.write(diag_file);
+        }
+    }
+
+    return !cancelled;
+}
+
+// ============================================================================
+// Delayed acceptance
+// ============================================================================
+
+template<class T>
+void CMCMCEngine<T>::updateSurrogate(long step, bool burn_in)
+{
+    // Points are pooled in chain order, so the fit does not depend on threads
+    for (Chain& chain : chains_) {
+        for (size_t i = 0; i < chain.new_u.size(); ++i) {
+            surrogate_.addPoint(chain.new_u[i], chain.new_loglik[i]);
+        }
+        chain.new_u.clear();
+        chain.new_loglik.clear();
+    }
+    if (step < surrogate_next_refit_) {
+        return;
+    }
+
+    surrogate_.fit();
+    surrogate_interval_ = burn_in ? settings_.surrogate_refit_interval : 2 * surrogate_interval_;
+    surrogate_next_refit_ = step + surrogate_interval_;
+}
+
+// ============================================================================
+// DREAM(ZS)
+// ============================================================================
+
+template<class T>
+void CMCMCEngine<T>::initializeDREAM(unsigned long seed)
+{
+    const size_t d = space_.size();
+    std::mt19937_64 rng(seed ^ 0x5DEECE66DUL);
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+    // Archive of past states, seeded with a Latin hypercube over the prior range
+    const size_t m0 = std::max<size_t>(10 * d, 50);
+    archive_.assign(m0, std::vector<double>(d));
+    for (size_t i = 0; i < d; ++i) {
+        std::vector<size_t> strata(m0);
+        for (size_t m = 0; m < m0; ++m) strata[m] = m;
+        std::shuffle(strata.begin(), strata.end(), rng);
+        double lo = space_.getSamplingLow(i);
+        double hi = space_.getSamplingHigh(i);
+        for (size_t m = 0; m < m0; ++m) {
+            archive_[m][i] = lo + (hi - lo) * (strata[m] + unif(rng)) / m0;
+        }
+    }
+    for (const auto& chain : chains_) {
+        archive_.push_back(chain.u);
+    }
+
+    const int n_cr = settings_.dream_crossover_values;
+    cr_probability_.assign(n_cr, 1.0 / n_cr);
+    cr_jump_distance_.assign(n_cr, 0.0);
+    cr_count_.assign(n_cr, 0);
+
+    for (auto& chain : chains_) {
+        chain.logp_history.clear();
+    }
+}
+
+template<class T>
+arma::vec CMCMCEngine<T>::proposeDREAM(Chain& chain)
+{
+    const size_t d = space_.size();
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::uniform_int_distribution<size_t> pick(0, archive_.size() - 1);
+    std::uniform_int_distribution<int> pick_pairs(1, settings_.dream_pairs);
+
+    // Crossover value from the (adapted) multinomial distribution
+    double r = unif(chain.rng);
+    int cr_index = 0;
+    for (double cum = cr_probability_[0]; cr_index < static_cast<int>(cr_probability_.size()) - 1 && r > cum;) {
+        cum += cr_probability_[++cr_index];
+    }
+    chain.cr_index = cr_index;
+    double cr = static_cast<double>(cr_index + 1) / cr_probability_.size();
+
+    // Subspace: each dimension is updated with probability CR, at least one
+    std::vector<size_t> dims;
+    for (size_t i = 0; i < d; ++i) {
+        if (unif(chain.rng) < cr) dims.push_back(i);
+    }
+    if (dims.empty()) {
+        dims.push_back(std::uniform_int_distribution<size_t>(0, d - 1)(chain.rng));
+    }
+
+    // Differential evolution jump from pairs of archived states
+    int delta = pick_pairs(chain.rng);
+    arma::vec diff(d, arma::fill::zeros);
+    for (int p = 0; p < delta; ++p) {
+        size_t r1 = pick(chain.rng);
+        size_t r2 = pick(chain.rng);
+        while (r2 == r1 && archive_.size() > 1) r2 = pick(chain.rng);
+        for (size_t i : dims) diff(i) += archive_[r1][i] - archive_[r2][i];
+    }
+
+    // Every fifth jump uses gamma = 1 to move between modes
+    double gamma = 2.38 / std::sqrt(2.0 * delta * dims.size());
+    if (unif(chain.rng) < 0.2) gamma = 1.0;
+
+    arma::vec du(d, arma::fill::zeros);
+    for (size_t i : dims) {
+        double e = 0.1 * unif(chain.rng) - 0.05;
+        du(i) = (1.0 + e) * gamma * diff(i) + 1e-6 * normal(chain.rng);
+    }
+    return du;
+}
+
+template<class T>
+void CMCMCEngine<T>::updateDREAM(long generation, bool burn_in)
+{
+    const size_t d = space_.size();
+    const size_t n = chains_.size();
+
+    if (generation % settings_.dream_archive_interval == 0) {
+        for (const auto& chain : chains_) {
+            archive_.push_back(chain.u);
+        }
+    }
+
+    if (!burn_in) {
+        return;
+    }
+
+    // The history is only needed for the outlier test during burn-in
+    for (auto& chain : chains_) {
+        chain.logp_history.push_back(chain.logp_t);
+    }
+
+    // Crossover adaptation: favour CR values giving large normalized jumps
+    std::vector<double> sd(d, 0.0);
+    for (size_t i = 0; i < d; ++i) {
+        double mean = 0.0, sq = 0.0;
+        for (const auto& chain : chains_) mean += chain.u[i];
+        mean /= n;
+        for (const auto& chain : chains_) sq += (chain.u[i] - mean) * (chain.u[i] - mean);
+        sd[i] = n > 1 ? std::sqrt(sq / (n - 1)) : 1.0;
+    }
+    for (const auto& chain : chains_) {
+        cr_count_[chain.cr_index]++;
+        if (!chain.last_accepted) continue;
+        double jump = 0.0;
+        for (size_t i = 0; i < d; ++i) {
+            if (sd[i] > 0.0) jump += chain.last_jump[i] * chain.last_jump[i] / (sd[i] * sd[i]);
+        }
+        cr_jump_distance_[chain.cr_index] += jump;
+    }
+    double total = 0.0;
+    for (size_t m = 0; m < cr_probability_.size(); ++m) {
+        if (cr_count_[m] > 0) total += cr_jump_distance_[m] / cr_count_[m];
+    }
+    if (total > 0.0) {
+        for (size_t m = 0; m < cr_probability_.size(); ++m) {
+            double p = cr_count_[m] > 0 ? cr_jump_distance_[m] / cr_count_[m] / total : 0.0;
+            cr_probability_[m] = std::max(p, 0.01);
+        }
+        double norm = 0.0;
+        for (double p : cr_probability_) norm += p;
+        for (double& p : cr_probability_) p /= norm;
+    }
+
+    // Outlier chains: mean log-posterior over the last half of the history
+    // below Q1 - 2 IQR are reset to the best chain
+    if (n < 4 || generation % 10 != 0) {
+        return;
+    }
+    std::vector<double> means(n, 0.0);
+    for (size_t k = 0; k < n; ++k) {
+        const auto& h = chains_[k].logp_history;
+        size_t start = h.size() / 2;
+        for (size_t j = start; j < h.size(); ++j) means[k] += h[j];
+        means[k] /= std::max<size_t>(1, h.size() - start);
+    }
+    std::vector<double> sorted = means;
+    std::sort(sorted.begin(), sorted.end());
+    double q1 = sorted[n / 4];
+    double q3 = sorted[(3 * n) / 4];
+    double limit = q1 - 2.0 * (q3 - q1);
+    size_t best = std::max_element(means.begin(), means.end()) - means.begin();
+
+    for (size_t k = 0; k < n; ++k) {
+        if (k == best || means[k] >= limit) continue;
+        Chain& chain = chains_[k];
+        chain.u = chains_[best].u;
+        chain.logp = chains_[best].logp;
+        chain.logp_t = chains_[best].logp_t;
+        chain.loglik = chains_[best].loglik;
+        chain.obs_loglik = chains_[best].obs_loglik;
+        chain.obs_loglik_u = chains_[best].obs_loglik_u;
+        chain.logp_history.assign(1, chain.logp_t);
+        outlier_resets_++;
+    }
+}
+
+// ============================================================================
+// Parallel tempering
+// ============================================================================
+
+template<class T>
+void CMCMCEngine<T>::swapReplicas(bool adapt)
+{
+    const int rungs = temperatureRungs();
+    const int ladders = static_cast<int>(chains_.size()) / rungs;
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    std::vector<double> round_rate(rungs - 1, 0.0);
+
+    // Adjacent swaps from the hottest pair down so states can travel to
+    // the cold chain within a single round
+    for (int ladder = 0; ladder < ladders; ++ladder) {
+        for (int j = rungs - 2; j >= 0; --j) {
+            Chain& cold = chains_[ladder * rungs + j];
+            Chain& hot = chains_[ladder * rungs + j + 1];
+
+            double log_ratio = (cold.beta - hot.beta) * (hot.loglik - cold.loglik);
+            double alpha = std::isfinite(log_ratio) ? std::min(1.0, std::exp(log_ratio)) : 0.0;
+            round_rate[j] += alpha / ladders;
+
+            swap_attempts_[j]++;
+            if (unif(swap_rng_) < alpha) {
+                std::swap(cold.u, hot.u);
+                std::swap(cold.logp, hot.logp);
+                std::swap(cold.logp_t, hot.logp_t);
+                std::swap(cold.loglik, hot.loglik);
+                std::swap(cold.stuck, hot.stuck);
+                std::swap(cold.obs_loglik, hot.obs_loglik);
+                std::swap(cold.obs_loglik_u, hot.obs_loglik_u);
+                swap_accepts_[j]++;
+            }
+        }
+    }
+
+    if (!adapt) {
+        return;
+    }
+
+    // Adapt log temperature gaps towards a uniform swap rate
+    // (Miasojedow, Moulines & Vihola 2013); T_0 = 1 stays fixed
+    ++swap_rounds_;
+    double gamma = std::pow(static_cast<double>(swap_rounds_), -settings_.adaptation_decay);
+    std::vector<double> temperatures(rungs, 1.0);
+    for (int j = 0; j < rungs - 1; ++j) {
+        double log_gap = std::log(temperatures_[j + 1] - temperatures_[j]);
+        log_gap += gamma * (round_rate[j] - settings_.pt_swap_rate);
+        log_gap = std::min(std::max(log_gap, -10.0), 20.0);
+        temperatures[j + 1] = temperatures[j] + std::exp(log_gap);
+    }
+    temperatures_ = temperatures;
+
+    for (size_t k = 0; k < chains_.size(); ++k) {
+        chains_[k].beta = 1.0 / temperatures_[k % rungs];
+    }
+}
+
+// ============================================================================
+// No-U-Turn Sampler
+// ============================================================================
+
+template<class T>
+double CMCMCEngine<T>::logPosteriorGradient(Chain& chain, const arma::vec& u, arma::vec& grad, double& loglik)
+{
+    const size_t d = space_.size();
+    std::vector<double> uu(u.begin(), u.end());
+    grad.zeros(d);
+    chain.gradient_evaluations++;
+    if (!u.is_finite() || !space_.inSamplingBounds(uu)) {
+        return -std::numeric_limits<double>::infinity();
+    }
+
+    std::vector<double> x = space_.fromSampling(uu);
+    chain.model.setAllParameterValues(x);
+    std::vector<double> grad_x;
+    double logp = chain.model.calculateLogPosteriorGradient(grad_x);
+    if (!std::isfinite(logp)) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    // The model is left at x, so the prior splits off the log-likelihood
+    loglik = logp - chain.model.calculateLogPrior();
+
+    // Chain rule into sampling space; d(log|dx/du|)/du = 1 for log parameters
+    for (size_t i = 0; i < d; ++i) {
+        grad(i) = space_.isLogTransformed(i) ? grad_x[i] * x[i] + 1.0 : grad_x[i];
+    }
+    return logp + space_.logJacobian(uu);
+}
+
+template<class T>
+void CMCMCEngine<T>::setMetric(Chain& chain, const arma::mat& metric)
+{
+    chain.metric = metric;
+    if (settings_.nuts_metric == "dense") {
+        arma::mat mass, upper;
+        if (arma::inv_sympd(mass, metric) && arma::chol(upper, mass)) {
+            chain.momentum_L = upper.t();
+            return;
+        }
+        chain.metric = arma::diagmat(metric);
+    }
+    chain.momentum_L = arma::diagmat(1.0 / arma::sqrt(chain.metric.diag()));
+}
+
+template<class T>
+void CMCMCEngine<T>::initializeNUTS(Chain& chain)
+{
+    const size_t d = space_.size();
+
+    // Initial metric matches the random-walk proposal scale
+    arma::mat metric(d, d, arma::fill::zeros);
+    for (size_t i = 0; i < d; ++i) {
+        double width = space_.getSamplingHigh(i) - space_.getSamplingLow(i);
+        double sd = settings_.perturbation_factor * (width > 0.0 ? width : 1.0);
+        metric(i, i) = sd * sd;
+    }
+    setMetric(chain, metric);
+
+    chain.logp_t = logPosteriorGradient(chain, arma::vec(chain.u), chain.grad, chain.loglik);
+    chain.logp = chain.logp_t - space_.logJacobian(chain.u);
+
+    chain.step_size = findReasonableStepSize(chain);
+    chain.da_mu = std::log(10.0 * chain.step_size);
+    chain.da_log_step_bar = 0.0;
+    chain.da_h_bar = 0.0;
+    chain.da_count = 0;
+
+    chain.window_size = nuts_first_window_;
+    chain.window_end = nuts_init_buffer_ + nuts_first_window_;
+    if (chain.window_end + 2 * chain.window_size > nuts_warmup_ - nuts_term_buffer_) {
+        chain.window_end = nuts_warmup_ - nuts_term_buffer_;
+        chain.window_size = chain.window_end - nuts_init_buffer_;
+    }
+    chain.welford_mean.zeros(d);
+    chain.welford_m2.zeros(d, d);
+    chain.welford_count = 0;
+    chain.accept_stat_sum = 0.0;
+    chain.divergences = 0;
+}
+
+template<class T>
+double CMCMCEngine<T>::findReasonableStepSize(Chain& chain)
+{
+    const size_t d = space_.size();
+    std::normal_distribution<double> normal(0.0, 1.0);
+
+    double eps = 1.0;
+    arma::vec z(d);
+    for (size_t i = 0; i < d; ++i) z(i) = normal(chain.rng);
+    arma::vec p0 = chain.momentum_L * z;
+    arma::vec u0(chain.u);
+    double h0 = chain.logp_t - 0.5 * arma::dot(p0, chain.metric * p0);
+
+    auto log_accept = [&](double e) {
+        arma::vec g;
+        double loglik;
+        arma::vec p = p0 + 0.5 * e * chain.grad;
+        arma::vec u = u0 + e * (chain.metric * p);
+        double logp = logPosteriorGradient(chain, u, g, loglik);
+        p += 0.5 * e * g;
+        double h = logp - 0.5 * arma::dot(p, chain.metric * p);
+        return std::isfinite(h) ? h - h0 : -std::numeric_limits<double>::infinity();
+    };
+
+    double la = log_accept(eps);
+    int direction = la > std::log(0.5) ? 1 : -1;
+    for (int iter = 0; iter < 50; ++iter) {
+        if (direction == 1 ? !(la > std::log(0.5)) : !(la < std::log(0.5))) break;
+        eps *= direction == 1 ? 2.0 : 0.5;
+        la = log_accept(eps);
+    }
+    return eps;
+}
+
+template<class T>
+bool CMCMCEngine<T>::noUTurn(const Chain& chain, const arma::vec& u_minus, const arma::vec& u_plus,
+                             const arma::vec& p_minus, const arma::vec& p_plus) const
+{
+    arma::vec du = u_plus - u_minus;
+    return arma::dot(du, chain.metric * p_minus) >= 0.0 &&
+           arma::dot(du, chain.metric * p_plus) >= 0.0;
+}
+
+template<class T>
+typename CMCMCEngine<T>::NUTSTree CMCMCEngine<T>::buildTree(Chain& chain, const arma::vec& u, const arma::vec& p,
+                                                             const arma::vec& g, double log_slice, int direction,
+                                                             int depth, double h0)
+{
+    const double max_energy_error = 1000.0;
+    NUTSTree tree;
+
+    if (depth == 0) {
+        // Single leapfrog step
+        double e = direction * chain.step_size;
+        arma::vec p1 = p + 0.5 * e * g;
+        arma::vec u1 = u + e * (chain.metric * p1);
+        arma::vec g1;
+        double loglik1 = -std::numeric_limits<double>::infinity();
+        double logp1 = logPosteriorGradient(chain, u1, g1, loglik1);
+        p1 += 0.5 * e * g1;
+        double h = std::isfinite(logp1) ? logp1 - 0.5 * arma::dot(p1, chain.metric * p1)
+                                        : -std::numeric_limits<double>::infinity();
+
+        tree.u_minus = tree.u_plus = tree.u_prop = u1;
+        tree.p_minus = tree.p_plus = p1;
+        tree.g_minus = tree.g_plus = tree.g_prop = g1;
+        tree.logp_prop = logp1;
+        tree.loglik_prop = loglik1;
+        tree.n = (log_slice <= h) ? 1 : 0;
+        tree.valid = log_slice < h + max_energy_error;
+        if (!tree.valid) chain.divergences += (chain.steps > nuts_warmup_) ? 1 : 0;
+        tree.alpha = std::isfinite(h) ? std::min(1.0, std::exp(h - h0)) : 0.0;
+        tree.n_alpha = 1;
+        return tree;
+    }
+
+    tree = buildTree(chain, u, p, g, log_slice, direction, depth - 1, h0);
+    if (!tree.valid) {
+        return tree;
+    }
+
+    NUTSTree outer = (direction == -1)
+        ? buildTree(chain, tree.u_minus, tree.p_minus, tree.g_minus, log_slice, direction, depth - 1, h0)
+        : buildTree(chain, tree.u_plus, tree.p_plus, tree.g_plus, log_slice, direction, depth - 1, h0);
+
+    if (direction == -1) {
+        tree.u_minus = outer.u_minus;
+        tree.p_minus = outer.p_minus;
+        tree.g_minus = outer.g_minus;
+    }
+    else {
+        tree.u_plus = outer.u_plus;
+        tree.p_plus = outer.p_plus;
+        tree.g_plus = outer.g_plus;
+    }
+
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+    if (outer.n > 0 && unif(chain.rng) * (tree.n + outer.n) < outer.n) {
+        tree.u_prop = outer.u_prop;
+        tree.g_prop = outer.g_prop;
+        tree.logp_prop = outer.logp_prop;
+        tree.loglik_prop = outer.loglik_prop;
+    }
+
+    tree.alpha += outer.alpha;
+    tree.n_alpha += outer.n_alpha;
+    tree.n += outer.n;
+    tree.valid = outer.valid && noUTurn(chain, tree.u_minus, tree.u_plus, tree.p_minus, tree.p_plus);
+    return tree;
+}
+
+template<class T>
+void CMCMCEngine<T>::stepNUTS(Chain& chain)
+{
+    const size_t d = space_.size();
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+    arma::vec z(d);
+    for (size_t i = 0; i < d; ++i) z(i) = normal(chain.rng);
+    arma::vec p0 = chain.momentum_L * z;
+    arma::vec u0(chain.u);
+
+    double h0 = chain.logp_t - 0.5 * arma::dot(p0, chain.metric * p0);
+    double log_slice = h0 + std::log(unif(chain.rng));
+
+    NUTSTree tree;
+    tree.u_minus = tree.u_plus = tree.u_prop = u0;
+    tree.p_minus = tree.p_plus = p0;
+    tree.g_minus = tree.g_plus = tree.g_prop = chain.grad;
+    tree.logp_prop = chain.logp_t;
+    tree.loglik_prop = chain.loglik;
+    tree.n = 1;
+
+    bool moved = false;
+    double alpha = 0.0;
+    long n_alpha = 0;
+    for (int depth = 0; depth < settings_.nuts_max_depth && tree.valid; ++depth) {
+        int direction = unif(chain.rng) < 0.5 ? -1 : 1;
+        NUTSTree sub = (direction == -1)
+            ? buildTree(chain, tree.u_minus, tree.p_minus, tree.g_minus, log_slice, direction, depth, h0)
+            : buildTree(chain, tree.u_plus, tree.p_plus, tree.g_plus, log_slice, direction, depth, h0);
+
+        if (direction == -1) {
+            tree.u_minus = sub.u_minus;
+            tree.p_minus = sub.p_minus;
+            tree.g_minus = sub.g_minus;
+        }
+        else {
+            tree.u_plus = sub.u_plus;
+            tree.p_plus = sub.p_plus;
+            tree.g_plus = sub.g_plus;
+        }
+
+        if (sub.valid && sub.n > 0 && unif(chain.rng) * tree.n < sub.n) {
+            tree.u_prop = sub.u_prop;
+            tree.g_prop = sub.g_prop;
+            tree.logp_prop = sub.logp_prop;
+            tree.loglik_prop = sub.loglik_prop;
+            moved = true;
+        }
+
+        alpha += sub.alpha;
+        n_alpha += sub.n_alpha;
+        tree.n += sub.n;
+        tree.valid = sub.valid && noUTurn(chain, tree.u_minus, tree.u_plus, tree.p_minus, tree.p_plus);
+    }
+
+    chain.steps++;
+    double accept_stat = n_alpha > 0 ? alpha / n_alpha : 0.0;
+    chain.accept_stat_sum += accept_stat;
+    chain.last_accepted = moved;
+    if (moved) {
+        for (size_t i = 0; i < d; ++i) chain.last_jump[i] = tree.u_prop(i) - chain.u[i];
+        chain.u.assign(tree.u_prop.begin(), tree.u_prop.end());
+        chain.grad = tree.g_prop;
+        chain.logp_t = tree.logp_prop;
+        chain.logp = chain.logp_t - space_.logJacobian(chain.u);
+        chain.loglik = tree.loglik_prop;
+        chain.accepted++;
+        chain.stuck = 0;
+    }
+    else {
+        chain.stuck++;
+    }
+
+    if (chain.steps <= nuts_warmup_) {
+        adaptNUTS(chain, accept_stat);
+    }
+}
+
+template<class T>
+void CMCMCEngine<T>::adaptNUTS(Chain& chain, double accept_stat)
+{
+    const double gamma = 0.05, t0 = 10.0, kappa = 0.75;
+
+    // Dual averaging of log step size (Hoffman & Gelman 2014, Alg. 5)
+    chain.da_count++;
+    double m = static_cast<double>(chain.da_count);
+    chain.da_h_bar += (settings_.nuts_target_accept - accept_stat - chain.da_h_bar) / (m + t0);
+    double log_step = chain.da_mu - std::sqrt(m) / gamma * chain.da_h_bar;
+    double eta = std::pow(m, -kappa);
+    chain.da_log_step_bar = eta * log_step + (1.0 - eta) * chain.da_log_step_bar;
+    chain.step_size = std::exp(log_step);
+
+    // Metric estimation inside the adaptation windows
+    long init_buffer = chain.window_end - chain.window_size;
+    if (chain.steps > init_buffer && chain.steps <= chain.window_end) {
+        arma::vec u(chain.u);
+        chain.welford_count++;
+        arma::vec delta = u - chain.welford_mean;
+        chain.welford_mean += delta / static_cast<double>(chain.welford_count);
+        chain.welford_m2 += delta * (u - chain.welford_mean).t();
+    }
+
+    if (chain.steps == chain.window_end && chain.welford_count > 2) {
+        // Regularize towards a small multiple of the identity (as Stan)
+        double n = static_cast<double>(chain.welford_count);
+        arma::mat cov = chain.welford_m2 / (n - 1.0);
+        if (settings_.nuts_metric != "dense") {
+            cov = arma::diagmat(cov);
+        }
+        cov = (n / (n + 5.0)) * cov + 1e-3 * (5.0 / (n + 5.0)) * arma::eye(cov.n_rows, cov.n_cols);
+        setMetric(chain, cov);
+
+        chain.step_size = findReasonableStepSize(chain);
+        chain.da_mu = std::log(10.0 * chain.step_size);
+        chain.da_log_step_bar = 0.0;
+        chain.da_h_bar = 0.0;
+        chain.da_count = 0;
+
+        // Next window doubles; the last one stretches to the terminal buffer
+        long term_start = nuts_warmup_ - nuts_term_buffer_;
+        chain.window_size *= 2;
+        long next_end = chain.window_end + chain.window_size;
+        if (next_end + 2 * chain.window_size > term_start) {
+            chain.window_size = term_start - chain.window_end;
+            next_end = term_start;
+        }
+        chain.window_end = next_end;
+        chain.welford_mean.zeros();
+        chain.welford_m2.zeros();
+        chain.welford_count = 0;
+    }
+
+    if (chain.steps == nuts_warmup_) {
+        chain.step_size = std::exp(chain.da_log_step_bar);
+    }
+}
+
+// ============================================================================
+// Checkpoint / Restart
+// ============================================================================
+
+template<class T>
+std::vector<std::pair<std::string, std::string>> CMCMCEngine<T>::GetProperties() const
+{
+    auto num = [](double value) {
+        std::ostringstream out;
+        out << std::setprecision(17) << value;
+        return out.str();
+    };
+    const MCMCEngineSettings& st = settings_;
+    return {
+        {"sampler", st.sampler},
+        {"number_of_samples", std::to_string(st.total_number_of_samples)},
+        {"number_of_chains", std::to_string(st.number_of_chains)},
+        {"number_of_burnout_samples", std::to_string(st.burnout_samples)},
+        {"record_interval", std::to_string(st.save_interval)},
+        {"perturbation_factor", num(st.perturbation_factor)},
+        {"acceptance_rate", num(st.acceptance_rate)},
+        {"number_of_threads", std::to_string(st.numberOfThreads)},
+        {"initial_perturbation", st.no_initial_perturbation ? "no" : "yes"},
+        {"initial_covariance_weight", std::to_string(st.initial_covariance_weight)},
+        {"adaptation_decay", num(st.adaptation_decay)},
+        {"adaptation_epsilon", num(st.adaptation_epsilon)},
+        {"random_seed", std::to_string(st.random_seed)},
+        {"dream_pairs", std::to_string(st.dream_pairs)},
+        {"dream_crossover_values", std::to_string(st.dream_crossover_values)},
+        {"dream_archive_interval", std::to_string(st.dream_archive_interval)},
+        {"pt_temperatures", std::to_string(st.pt_temperatures)},
+        {"pt_initial_spacing", num(st.pt_initial_spacing)},
+        {"pt_swap_interval", std::to_string(st.pt_swap_interval)},
+        {"pt_swap_rate", num(st.pt_swap_rate)},
+        {"nuts_max_depth", std::to_string(st.nuts_max_depth)},
+        {"nuts_target_accept", num(st.nuts_target_accept)},
+        {"nuts_metric", st.nuts_metric},
+        {"nuts_finite_differences", st.nuts_finite_differences ? "yes" : "no"},
+        {"early_rejection", st.early_rejection ? "yes" : "no"},
+        {"delayed_acceptance", st.delayed_acceptance ? "yes" : "no"},
+        {"surrogate", st.surrogate},
+        {"surrogate_max_points", std::to_string(st.surrogate_max_points)},
+        {"surrogate_refit_interval", std::to_string(st.surrogate_refit_interval)},
+        {"diagnostics_interval", std::to_string(st.diagnostics_interval)},
+        {"diagnostics_max_draws", std::to_string(st.diagnostics_max_draws)},
+        {"stop_rhat", num(st.stop_rhat)},
+        {"stop_min_ess", num(st.stop_min_ess)},
+        {"checkpoint_interval", std::to_string(st.checkpoint_interval)},
+        {"checkpoint_filename", st.checkpoint_filename},
+        {"samples_format", st.samples_format},
+        {"async_output", st.async_output ? "yes" : "no"},
+        {"output_queue_size", std::to_string(st.output_queue_size)},
+        {"samples_filename", st.samples_filename},
+        {"store_observation_loglik", st.store_observation_loglik ? "yes" : "no"},
+        {"output_path", st.output_path},
+    };
+}
+
+template<class T>
+bool CMCMCEngine<T>::writeCheckpoint(const std::string& filename, long next_step, long sample_no,
+                                     long long file_offset, long long terms_offset) const
+{
+    try {
+        CCheckpointWriter out(filename, "mcmc_engine");
+
+        std::vector<std::string> keys, values;
+        for (const auto& property : GetProperties()) {
+            keys.push_back(property.first);
+            values.push_back(property.second);
+        }
+        out.write(keys);
+        out.write(values);
+        out.write(space_.getNames());
+
+        out.write(static_cast<int64_t>(next_step));
+        out.write(static_cast<int64_t>(sample_no));
+        out.write(static_cast<int64_t>(file_offset));
+        out.write(static_cast<int64_t>(terms_offset));
+
+        out.write(static_cast<int64_t>(chains_.size()));
+        for (const Chain& chain : chains_) {
+            out.write(chain.u);
+            out.write(chain.logp);
+            out.write(chain.logp_t);
+            out.write(chain.loglik);
+            out.write(chain.beta);
+            out.write(chain.rng);
+            out.write(chain.L);
+            out.write(arma::mat(chain.mean));
+            out.write(chain.weight);
+            out.write(chain.log_scale);
+            out.write(static_cast<int64_t>(chain.steps));
+            out.write(static_cast<int64_t>(chain.accepted));
+            out.write(static_cast<int64_t>(chain.stuck));
+            out.write(chain.last_accepted);
+            out.write(chain.last_jump);
+            out.write(static_cast<int64_t>(chain.cr_index));
+            out.write(chain.logp_history);
+
+            out.write(arma::mat(chain.grad));
+            out.write(chain.metric);
+            out.write(chain.momentum_L);
+            out.write(chain.step_size);
+            out.write(chain.da_mu);
+            out.write(chain.da_log_step_bar);
+            out.write(chain.da_h_bar);
+            out.write(static_cast<int64_t>(chain.da_count));
+            out.write(arma::mat(chain.welford_mean));
+            out.write(chain.welford_m2);
+            out.write(static_cast<int64_t>(chain.welford_count));
+            out.write(static_cast<int64_t>(chain.window_end));
+            out.write(static_cast<int64_t>(chain.window_size));
+            out.write(chain.accept_stat_sum);
+            out.write(static_cast<int64_t>(chain.divergences));
+            out.write(static_cast<int64_t>(chain.gradient_evaluations));
+        }
+
+        out.write(archive_);
+        out.write(cr_probability_);
+        out.write(cr_jump_distance_);
+        out.write(std::vector<int64_t>(cr_count_.begin(), cr_count_.end()));
+        out.write(static_cast<int64_t>(outlier_resets_));
+
+        out.write(temperatures_);
+        out.write(std::vector<int64_t>(swap_attempts_.begin(), swap_attempts_.end()));
+        out.write(std::vector<int64_t>(swap_accepts_.begin(), swap_accepts_.end()));
+        out.write(static_cast<int64_t>(swap_rounds_));
+        out.write(swap_rng_);
+
+        out.write(static_cast<int64_t>(nuts_warmup_));
+        out.write(static_cast<int64_t>(nuts_init_buffer_));
+        out.write(static_cast<int64_t>(nuts_term_buffer_));
+        out.write(static_cast<int64_t>(nuts_first_window_));
+
+        std::vector<int64_t> screened, evaluations;
+        for (const Chain& chain : chains_) {
+            screened.push_back(chain.screened);
+            evaluations.push_back(chain.likelihood_evaluations);
+        }
+        out.write(screened);
+        out.write(evaluations);
+        out.write(surrogate_.trainingPoints());
+        out.write(surrogate_.trainingValues());
+        out.write(surrogate_.pendingPoints());
+        out.write(surrogate_.pendingValues());
+        out.write(static_cast<int64_t>(surrogate_next_refit_));
+        out.write(static_cast<int64_t>(surrogate_interval_));
+
+        out.close();
+    }
+    catch (const std::exception& e) {
+        last_error_ = e.what();
+        return false;
+    }
+    return true;
+}
+
+template<class T>
+bool CMCMCEngine<T>::readCheckpoint(const std::string& filename, long& next_step, long& sample_no,
+                                    long long& file_offset, long long& terms_offset)
+{
+    if (!model_) {
+        last_error_ = "No model assigned to MCMC engine";
+        return false;
+    }
+
+    try {
+        CCheckpointReader in(filename, "mcmc_engine");
+
+        // Settings of the interrupted run take precedence
+        std::vector<std::string> keys = in.readStringVector();
+        std::vector<std::string> values = in.readStringVector();
+        for (size_t i = 0; i < keys.size() && i < values.size(); ++i) {
+            if (!SetProperty(keys[i], values[i])) {
+                return false;
+            }
+        }
+
+        space_ = CParameterSpace(model_->Parameters());
+        if (in.readStringVector() != space_.getNames()) {
+            last_error_ = "Checkpoint parameters do not match the model";
+            return false;
+        }
+
+        next_step = static_cast<long>(in.readInt());
+        sample_no = static_cast<long>(in.readInt());
+        file_offset = static_cast<long long>(in.readInt());
+        terms_offset = static_cast<long long>(in.readInt());
+
+        chains_.clear();
+        chains_.resize(static_cast<size_t>(in.readInt()));
+        for (Chain& chain : chains_) {
+            chain.model = *model_;
+            chain.u = in.readDoubleVector();
+            chain.logp = in.readDouble();
+            chain.logp_t = in.readDouble();
+            chain.loglik = in.readDouble();
+            chain.beta = in.readDouble();
+            in.readRng(chain.rng);
+            chain.L = in.readMat();
+            chain.mean = arma::vectorise(in.readMat());
+            chain.weight = in.readDouble();
+            chain.log_scale = in.readDouble();
+            chain.steps = static_cast<long>(in.readInt());
+            chain.accepted = static_cast<long>(in.readInt());
+            chain.stuck = static_cast<int>(in.readInt());
+            chain.last_accepted = in.readBool();
+            chain.last_jump = in.readDoubleVector();
+            chain.cr_index = static_cast<int>(in.readInt());
+            chain.logp_history = in.readDoubleVector();
+
+            chain.grad = arma::vectorise(in.readMat());
+            chain.metric = in.readMat();
+            chain.momentum_L = in.readMat();
+            chain.step_size = in.readDouble();
+            chain.da_mu = in.readDouble();
+            chain.da_log_step_bar = in.readDouble();
+            chain.da_h_bar = in.readDouble();
+            chain.da_count = static_cast<long>(in.readInt());
+            chain.welford_mean = arma::vectorise(in.readMat());
+            chain.welford_m2 = in.readMat();
+            chain.welford_count = static_cast<long>(in.readInt());
+            chain.window_end = static_cast<long>(in.readInt());
+            chain.window_size = static_cast<long>(in.readInt());
+            chain.accept_stat_sum = in.readDouble();
+            chain.divergences = static_cast<long>(in.readInt());
+            chain.gradient_evaluations = static_cast<long>(in.readInt());
+
+            chain.model.setAllParameterValues(space_.fromSampling(chain.u));
+        }
+
+        archive_ = in.readDoubleMatrix();
+        cr_probability_ = in.readDoubleVector();
+        cr_jump_distance_ = in.readDoubleVector();
+        std::vector<int64_t> cr_count = in.readIntVector();
+        cr_count_.assign(cr_count.begin(), cr_count.end());
+        outlier_resets_ = static_cast<int>(in.readInt());
+
+        temperatures_ = in.readDoubleVector();
+        std::vector<int64_t> attempts = in.readIntVector();
+        std::vector<int64_t> accepts = in.readIntVector();
+        swap_attempts_.assign(attempts.begin(), attempts.end());
+        swap_accepts_.assign(accepts.begin(), accepts.end());
+        swap_rounds_ = static_cast<long>(in.readInt());
+        in.readRng(swap_rng_);
+
+        nuts_warmup_ = static_cast<long>(in.readInt());
+        nuts_init_buffer_ = static_cast<long>(in.readInt());
+        nuts_term_buffer_ = static_cast<long>(in.readInt());
+        nuts_first_window_ = static_cast<long>(in.readInt());
+
+        std::vector<int64_t> screened = in.readIntVector();
+        std::vector<int64_t> evaluations = in.readIntVector();
+        for (size_t k = 0; k < chains_.size() && k < screened.size() && k < evaluations.size(); ++k) {
+            chains_[k].screened = static_cast<long>(screened[k]);
+            chains_[k].likelihood_evaluations = static_cast<long>(evaluations[k]);
+        }
+        std::vector<std::vector<double>> train_u = in.readDoubleMatrix();
+        std::vector<double> train_y = in.readDoubleVector();
+        std::vector<std::vector<double>> pending_u = in.readDoubleMatrix();
+        std::vector<double> pending_y = in.readDoubleVector();
+        surrogate_ = CLikelihoodSurrogate(settings_.surrogate, settings_.surrogate_max_points);
+        surrogate_.restore(train_u, train_y, pending_u, pending_y);
+        surrogate_next_refit_ = static_cast<long>(in.readInt());
+        surrogate_interval_ = static_cast<long>(in.readInt());
+    }
+    catch (const std::exception& e) {
+        last_error_ = e.what();
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Results
+// ============================================================================
+
+template<class T>
+long CMCMCEngine<T>::GetScreenedProposals() const
+{
+    long screened = 0;
+    for (const Chain& chain : chains_) screened += chain.screened;
+    return screened;
+}
+
+template<class T>
+long CMCMCEngine<T>::GetLikelihoodEvaluations() const
+{
+    long evaluations = 0;
+    for (const Chain& chain : chains_) evaluations += chain.likelihood_evaluations;
+    return evaluations;
+}
+
+template<class T>
+double CMCMCEngine<T>::GetAcceptanceRate() const
+{
+    long steps = 0;
+    long accepted = 0;
+    double accept_stat = 0.0;
+    for (size_t k = 0; k < chains_.size(); k += temperatureRungs()) {
+        steps += chains_[k].steps;
+        accepted += chains_[k].accepted;
+        accept_stat += chains_[k].accept_stat_sum;
+    }
+    if (steps == 0) {
+        return 0.0;
+    }
+    // NUTS reports the mean acceptance statistic of its trajectories
+    if (settings_.sampler == "nuts") {
+        return accept_stat / steps;
+    }
+    return static_cast<double>(accepted) / steps;
+}
+
+template<class T>
+std::vector<double> CMCMCEngine<T>::GetSwapAcceptanceRates() const
+{
+    std::vector<double> rates(swap_attempts_.size(), 0.0);
+    for (size_t j = 0; j < rates.size(); ++j) {
+        if (swap_attempts_[j] > 0) {
+            rates[j] = static_cast<double>(swap_accepts_[j]) / swap_attempts_[j];
+        }
+    }
+    return rates;
+}
+
+template<class T>
+long CMCMCEngine<T>::GetDivergentTransitions() const
+{
+    long divergences = 0;
+    for (const auto& chain : chains_) divergences += chain.divergences;
+    return divergences;
+}
+
+template<class T>
+long CMCMCEngine<T>::GetGradientEvaluations() const
+{
+    long evaluations = 0;
+    for (const auto& chain : chains_) evaluations += chain.gradient_evaluations;
+    return evaluations;
+}
+
+template<class T>
+double CMCMCEngine<T>::proposalScale(const Chain& chain, size_t index) const
+{
+    if (settings_.sampler == "dream") {
+        return std::fabs(chain.last_jump[index]);
+    }
+    if (settings_.sampler == "nuts") {
+        return chain.step_size * std::sqrt(chain.metric(index, index));
+    }
+    return std::exp(chain.log_scale) * arma::norm(chain.L.row(index), 2);
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+template<class T>
+bool CMCMCEngine<T>::GetPosteriorSamples(std::vector<std::vector<double>>& samples) const
+{
+    const std::vector<std::vector<double>>* rows = &samples_;
+    const std::vector<long>* numbers = &sample_numbers_;
+    std::vector<std::vector<double>> stored;
+    std::vector<double> logp;
+    std::vector<long> stored_numbers;
+    if (settings_.samples_format == "binary") {
+        if (!readSamplesFile(stored, logp, stored_numbers)) {
+            return false;
+        }
+        rows = &stored;
+        numbers = &stored_numbers;
+    }
+
+    samples.clear();
+    for (size_t i = 0; i < rows->size(); ++i) {
+        if ((*numbers)[i] > settings_.burnout_samples) {
+            samples.push_back((*rows)[i]);
+        }
+    }
+    return true;
+}
+
+template<class T>
+std::string CMCMCEngine<T>::GetSamplesFilename() const
+{
+    std::string name = settings_.samples_filename;
+    if (name.empty()) {
+        name = settings_.samples_format == "binary" ? "mcmc_samples.bin" : "mcmc_samples.txt";
+    }
+    return settings_.output_path + name;
+}
+
+template<class T>
+std::string CMCMCEngine<T>::GetObservationTermsFilename() const
+{
+    std::string name = GetSamplesFilename();
+    const size_t dot = name.find_last_of('.');
+    const size_t slash = name.find_last_of("/\\");
+    std::string extension;
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        extension = name.substr(dot);
+        name = name.substr(0, dot);
+    }
+    return name + "_obsloglik" + extension;
+}
+
+template<class T>
+std::vector<std::string> CMCMCEngine<T>::storeColumns() const
+{
+    // Proposal scales and stuck counters are left out; they are run-time state, not samples
+    std::vector<std::string> columns = {"sample_no"};
+    for (size_t i = 0; i < space_.size(); ++i) {
+        columns.push_back(space_.getName(i));
+    }
+    columns.push_back("log_posterior");
+    columns.push_back("chain");
+    return columns;
+}
+
+template<class T>
+std::vector<double> CMCMCEngine<T>::storeRow(long sample_no, const Chain& chain, int chain_index) const
+{
+    std::vector<double> row;
+    row.reserve(space_.size() + 3);
+    row.push_back(static_cast<double>(sample_no));
+    for (double value : space_.fromSampling(chain.u)) {
+        row.push_back(value);
+    }
+    row.push_back(chain.logp);
+    row.push_back(static_cast<double>(chain_index));
+    return row;
+}
+
+template<class T>
+std::vector<std::string> CMCMCEngine<T>::termsColumns() const
+{
+    std::vector<std::string> columns = {"sample_no"};
+    for (size_t i = 0; i < model_->getObservationCount(); ++i) {
+        columns.push_back(model_->getObservation(i).GetName());
+    }
+    return columns;
+}
+
+template<class T>
+void CMCMCEngine<T>::keepObservationTerms(Chain& chain)
+{
+    // The terms of the evaluation that produced the chain's new state
+    if (chain.proposal_terms.empty()) {
+        return;
+    }
+    chain.obs_loglik.swap(chain.proposal_terms);
+    chain.obs_loglik_u = chain.u;
+    chain.proposal_terms.clear();
+}
+
+template<class T>
+void CMCMCEngine<T>::updateObservationTerms(Chain& chain)
+{
+    // Terms are normally kept from the accepted evaluation; only states
+    // reached without one (nuts trajectories) need a forward run here
+    if (chain.obs_loglik_u == chain.u) {
+        return;
+    }
+
+    const size_t m = chain.model.getObservationCount();
+    chain.obs_loglik.assign(m, std::numeric_limits<double>::quiet_NaN());
+    try {
+        chain.model.setAllParameterValues(space_.fromSampling(chain.u));
+        std::vector<double> terms = chain.model.calculateObservationLogLikelihoods();
+        if (terms.size() == m) chain.obs_loglik = terms;
+    }
+    catch (const std::exception&) {
+    }
+    chain.obs_loglik_u = chain.u;
+}
+
+template<class T>
+std::vector<double> CMCMCEngine<T>::termsRow(long sample_no, const Chain& chain) const
+{
+    std::vector<double> row = {static_cast<double>(sample_no)};
+    row.insert(row.end(), chain.obs_loglik.begin(), chain.obs_loglik.end());
+    return row;
+}
+
+template<class T>
+void CMCMCEngine<T>::writeTerms(std::ofstream& file, const std::vector<double>& row) const
+{
+    // Full precision: the terms are summed and differenced by CPosteriorReweighting
+    file << static_cast<long>(row[0]) << std::setprecision(std::numeric_limits<double>::max_digits10);
+    for (size_t i = 1; i < row.size(); ++i) {
+        file << ", " << row[i];
+    }
+    file << "\n";
+}
+
+template<class T>
+void CMCMCEngine<T>::writeHeader(std::ofstream& file) const
+{
+    // Same column layout as CMCMC so existing post-processing keeps working
+    file << "sample_no, ";
+    for (size_t i = 0; i < space_.size(); ++i) {
+        file << space_.getName(i) << ", ";
+    }
+    file << "log_posterior, log_posterior_transformed, stuck_counter, ";
+    for (size_t i = 0; i < space_.size(); ++i) {
+        file << "perturbation_coeff_" << i << ", ";
+    }
+    file << "\n";
+}
+
+template<class T>
+std::vector<double> CMCMCEngine<T>::textRow(long sample_no, const Chain& chain) const
+{
+    std::vector<double> row = {static_cast<double>(sample_no)};
+    for (double value : space_.fromSampling(chain.u)) {
+        row.push_back(value);
+    }
+    row.push_back(chain.logp);
+    row.push_back(chain.logp_t);
+    row.push_back(static_cast<double>(chain.stuck));
+    for (size_t i = 0; i < space_.size(); ++i) {
+        row.push_back(proposalScale(chain, i));
+    }
+    return row;
+}
+
+template<class T>
+void CMCMCEngine<T>::writeSample(std::ofstream& file, const std::vector<double>& row) const
+{
+    // Layout of textRow(): sample_no, parameters, logp, logp_t, stuck, proposal scales
+    const size_t n = space_.size();
+    file << static_cast<long>(row[0]) << ", " << std::scientific << std::setprecision(6);
+    for (size_t i = 1; i <= n + 2; ++i) {
+        file << row[i] << ", ";
+    }
+    file << std::fixed << row[n + 3] << ", " << std::scientific;
+    for (size_t i = n + 4; i < row.size(); ++i) {
+        file << row[i] << ", ";
+    }
+    file << "\n";
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <random>
+#include <armadillo>
+#include "ParameterSpace.h"
+
+#ifdef Q_GUI_SUPPORT
+class ProgressWindow;
+#endif
+
+/**
+ * @brief Settings for CMultiStartLM
+ */
+struct MultiStartLMSettings
+{
+    int starts = 16;                     ///< Number of starting points (seeds first, then Latin hypercube)
+    int max_iterations = 100;            ///< Accepted steps per start
+    double lambda0 = 1e-3;               ///< Initial Marquardt damping
+    double tolerance = 1e-8;             ///< Stop when the relative cost reduction falls below this
+    double step_tolerance = 1e-8;        ///< Stop when the step falls below this fraction of the range
+    double jacobian_step = 1e-6;         ///< Finite-difference step as a fraction of the range
+    double dedup_tolerance = 1e-3;       ///< Optima closer than this fraction of every range share a basin
+    int numthreads = 1;                  ///< Starts refined concurrently
+    unsigned long random_seed = 0;       ///< 0 = seed from random_device
+    std::string outputfile = "lm_multistart.txt";  ///< Empty = no output file
+    std::string pathname;                ///< Directory for output files
+};
+
+/**
+ * @brief Multi-start Levenberg-Marquardt refinement
+ *
+ * Minimizes the sum of squared weighted residuals
+ * (calculateWeightedResiduals()) from many starting points at once. Starts
+ * are given seeds, typically the best distinct individuals of a genetic
+ * algorithm, topped up with a Latin hypercube over the parameter ranges.
+ * Each start is refined on its own model copy and starts run concurrently.
+ * Converged optima that coincide within dedup_tolerance are merged into
+ * basins, reported by objective (log-likelihood) with the number of starts
+ * that reached them.
+ *
+ * Steps are taken in the CParameterSpace sampling space scaled to [0, 1]
+ * and projected onto the parameter ranges. The Jacobian is obtained by
+ * forward differences. Parameters that serve as observation error
+ * standard deviations only weight the residuals and are kept at their
+ * current values, as are parameters passed to SetFixedParameters().
+ *
+ * @tparam T Model type providing Parameters(), getParameterValues(),
+ *           setAllParameterValues(), calculateWeightedResiduals(),
+ *           isErrorStdParameter() and GetObjectiveFunctionValue()
+ */
+template<class T>
+class CMultiStartLM
+{
+public:
+    /**
+     * @brief A local optimum and the starts that converged to it
+     */
+    struct Basin
+    {
+        std::vector<double> parameters;   ///< Physical parameter values
+        double objective = 0.0;           ///< Log-likelihood at the optimum
+        double cost = 0.0;                ///< 0.5 * sum of squared weighted residuals
+        int starts = 0;                   ///< Starts that ended in this basin
+        int iterations = 0;               ///< Iterations of the best start
+        bool converged = false;           ///< Best start met a convergence criterion
+    };
+
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CMultiStartLM();
+    explicit CMultiStartLM(T* model);
+
+    void SetModel(T* model) { model_ = model; }
+
+    // ========================================================================
+    // Settings
+    // ========================================================================
+
+    /**
+     * @brief Set a property by name (lm_* keys plus numthreads, pathname, outputfile)
+     * @return true if the property is recognized
+     */
+    bool SetProperty(const std::string& prop, const std::string& value);
+
+    const MultiStartLMSettings& GetSettings() const { return settings_; }
+
+    /**
+     * @brief Starting points in physical units, used before the Latin hypercube
+     */
+    void SetStartingPoints(const std::vector<std::vector<double>>& points) { seeds_ = points; }
+
+    /**
+     * @brief Parameters (by index) held at the model's values, e.g. the profiled parameter
+     */
+    void SetFixedParameters(const std::vector<size_t>& indices) { fixed_ = indices; }
+
+    std::string getLastError() const { return last_error_; }
+
+#ifdef Q_GUI_SUPPORT
+    void SetProgressWindow(ProgressWindow* window) { rtw_ = window; }
+#endif
+
+    // ========================================================================
+    // Optimization
+    // ========================================================================
+
+    /**
+     * @brief Refine all starts and group the optima into basins
+     * @return true if at least one start produced a finite objective
+     */
+    bool optimize();
+
+    // ========================================================================
+    // Results
+    // ========================================================================
+
+    /**
+     * @brief Distinct optima, best objective first
+     */
+    const std::vector<Basin>& getBasins() const { return basins_; }
+
+    T* getBestModel() { return best_model_valid_ ? &best_model_ : nullptr; }
+    const std::vector<double>& getFinalParams() const;
+    double getMaxFitness() const;
+    const std::vector<std::string>& getParamNames() const { return space_.getNames(); }
+    long getModelEvaluations() const { return evaluations_; }
+
+private:
+    struct Result
+    {
+        arma::vec x;
+        double cost = 0.0;
+        double objective = 0.0;
+        int iterations = 0;
+        bool converged = false;           ///< Cost or step tolerance met (not damping exhausted)
+        long evaluations = 0;
+    };
+
+    Result refine(T& model, const arma::vec& x0) const;
+    double cost(T& model, const arma::vec& x, arma::vec& residuals, long& evaluations) const;
+    std::vector<double> toPhysical(const arma::vec& x) const;
+    arma::vec toUnit(const std::vector<double>& values) const;
+    std::vector<arma::vec> startingPoints();
+    bool writeOutput() const;
+
+    T* model_ = nullptr;
+    MultiStartLMSettings settings_;
+    CParameterSpace space_;
+    std::vector<bool> free_;                   ///< Parameters adjusted by LM
+    std::vector<std::vector<double>> seeds_;
+    std::vector<size_t> fixed_;
+    std::vector<Basin> basins_;
+    long evaluations_ = 0;
+    std::string last_error_;
+
+    T best_model_;
+    bool best_model_valid_ = false;
+
+#ifdef Q_GUI_SUPPORT
+    ProgressWindow* rtw_ = nullptr;
+#endif
+};
+
+#include "MultiStartLM.hpp"
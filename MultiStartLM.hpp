@@ -0,0 +1,427 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <iomanip>
+#include <algorithm>
+#include <numeric>
+#include <fstream>
+#include <atomic>
+#include "ParallelWorkers.h"
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#endif
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+template<class T>
+CMultiStartLM<T>::CMultiStartLM()
+{
+}
+
+template<class T>
+CMultiStartLM<T>::CMultiStartLM(T* model)
+    : model_(model)
+{
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+template<class T>
+bool CMultiStartLM<T>::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "lm_starts") settings_.starts = std::max(1, std::stoi(value));
+        else if (key == "lm_max_iterations") settings_.max_iterations = std::max(1, std::stoi(value));
+        else if (key == "lm_lambda0") settings_.lambda0 = std::max(1e-12, std::stod(value));
+        else if (key == "lm_tolerance") settings_.tolerance = std::stod(value);
+        else if (key == "lm_step_tolerance") settings_.step_tolerance = std::stod(value);
+        else if (key == "lm_jacobian_step") settings_.jacobian_step = std::max(1e-12, std::stod(value));
+        else if (key == "lm_dedup_tolerance") settings_.dedup_tolerance = std::stod(value);
+        else if (key == "lm_random_seed") settings_.random_seed = std::stoul(value);
+        else if (key == "numthreads") settings_.numthreads = std::max(1, std::stoi(value));
+        else if (key == "outputfile") settings_.outputfile = value;
+        else if (key == "pathname") settings_.pathname = value;
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Optimization
+// ============================================================================
+
+template<class T>
+bool CMultiStartLM<T>::optimize()
+{
+    if (!model_) {
+        last_error_ = "No model assigned to Levenberg-Marquardt";
+        return false;
+    }
+
+    space_ = CParameterSpace(model_->Parameters());
+    const size_t n = space_.size();
+    free_.assign(n, false);
+    size_t n_free = 0;
+    for (size_t i = 0; i < n; ++i) {
+        free_[i] = !model_->isErrorStdParameter(i) && space_.getSamplingHigh(i) > space_.getSamplingLow(i) &&
+                   std::find(fixed_.begin(), fixed_.end(), i) == fixed_.end();
+        if (free_[i]) ++n_free;
+    }
+    if (n_free == 0) {
+        last_error_ = "No parameters to optimize";
+        return false;
+    }
+
+    last_error_.clear();
+    basins_.clear();
+    best_model_valid_ = false;
+    evaluations_ = 0;
+
+    std::vector<arma::vec> points = startingPoints();
+    const long count = static_cast<long>(points.size());
+    std::vector<Result> results(count);
+    std::vector<char> refined(count, 0);
+    const int threads = std::max(1, settings_.numthreads);
+
+    // Starts are handed out one at a time; once cancelled, the remaining ones are skipped
+    std::atomic<bool> cancel{false};
+    std::atomic<long> done{0};
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (long s = 0; s < count; ++s) {
+        if (cancel) continue;
+        T model = *model_;
+        results[s] = refine(model, points[s]);
+        refined[s] = 1;
+        ++done;
+
+#ifdef Q_GUI_SUPPORT
+        if (rtw_ && currentWorker() == 0) {
+            rtw_->SetProgress(static_cast<double>(done) / count);
+            QApplication::processEvents();
+            if (rtw_->IsCancelRequested()) {
+                cancel = true;
+            }
+        }
+#endif
+    }
+    const bool cancelled = cancel;
+
+    for (long s = 0; s < count; ++s) {
+        if (!refined[s]) {
+            results[s].cost = std::numeric_limits<double>::infinity();
+            continue;
+        }
+        evaluations_ += results[s].evaluations;
+    }
+
+#ifdef Q_GUI_SUPPORT
+    if (rtw_) {
+        for (long s = 0; s < count; ++s) {
+            if (!refined[s]) continue;
+            const Result& result = results[s];
+            if (std::isfinite(result.objective)) {
+                rtw_->AddPrimaryChartPoint(s + 1, result.objective);
+            }
+            rtw_->AppendLog(QString("Start %1: objective %2 after %3 iterations%4")
+                                .arg(s + 1)
+                                .arg(result.objective, 0, 'e', 6)
+                                .arg(result.iterations)
+                                .arg(result.converged ? "" : " (not converged)"));
+        }
+        if (cancelled) {
+            rtw_->AppendLog("Levenberg-Marquardt cancelled by user.");
+        }
+        QApplication::processEvents();
+    }
+#endif
+
+    // Group optima into basins, lowest cost first
+    std::vector<size_t> order;
+    for (size_t i = 0; i < results.size(); ++i) {
+        if (std::isfinite(results[i].cost) && std::isfinite(results[i].objective)) order.push_back(i);
+    }
+    std::stable_sort(order.begin(), order.end(),
+                     [&results](size_t a, size_t b) { return results[a].cost < results[b].cost; });
+
+    std::vector<arma::vec> basin_x;
+    for (size_t i : order) {
+        const Result& result = results[i];
+        size_t b = 0;
+        while (b < basin_x.size() && arma::max(arma::abs(basin_x[b] - result.x)) >= settings_.dedup_tolerance) ++b;
+        if (b < basin_x.size()) {
+            ++basins_[b].starts;
+            continue;
+        }
+
+        Basin basin;
+        basin.parameters = toPhysical(result.x);
+        basin.objective = result.objective;
+        basin.cost = result.cost;
+        basin.starts = 1;
+        basin.iterations = result.iterations;
+        basin.converged = result.converged;
+        basins_.push_back(basin);
+        basin_x.push_back(result.x);
+    }
+    std::stable_sort(basins_.begin(), basins_.end(),
+                     [](const Basin& a, const Basin& b) { return a.objective > b.objective; });
+
+    if (basins_.empty()) {
+        last_error_ = "No start produced a finite objective";
+    }
+    else {
+        best_model_ = *model_;
+        best_model_.setAllParameterValues(basins_.front().parameters);
+        best_model_valid_ = true;
+    }
+
+    if (!settings_.outputfile.empty() && !writeOutput() && last_error_.empty()) {
+        last_error_ = "Cannot write " + settings_.pathname + settings_.outputfile;
+    }
+    return best_model_valid_ && !cancelled;
+}
+
+template<class T>
+typename CMultiStartLM<T>::Result CMultiStartLM<T>::refine(T& model, const arma::vec& x0) const
+{
+    Result result;
+    result.x = x0;
+    result.objective = -std::numeric_limits<double>::infinity();
+
+    arma::vec r;
+    result.cost = cost(model, result.x, r, result.evaluations);
+    if (!std::isfinite(result.cost)) {
+        return result;
+    }
+
+    std::vector<arma::uword> columns;
+    for (size_t i = 0; i < free_.size(); ++i) {
+        if (free_[i]) columns.push_back(i);
+    }
+    const arma::uword m = columns.size();
+
+    double lambda = settings_.lambda0;
+    for (int iter = 0; iter < settings_.max_iterations; ++iter) {
+        result.iterations = iter + 1;
+
+        // Forward-difference Jacobian, stepping inward at the upper bound
+        arma::mat J(r.n_elem, m, arma::fill::zeros);
+        for (arma::uword c = 0; c < m; ++c) {
+            const arma::uword j = columns[c];
+            double h = result.x(j) + settings_.jacobian_step > 1.0 ? -settings_.jacobian_step : settings_.jacobian_step;
+            arma::vec xs = result.x;
+            xs(j) += h;
+            arma::vec rs;
+            double cs = cost(model, xs, rs, result.evaluations);
+            if (std::isfinite(cs) && rs.n_elem == r.n_elem) {
+                J.col(c) = (rs - r) / h;
+            }
+        }
+
+        const arma::mat A = J.t() * J;
+        const arma::vec g = J.t() * r;
+        const double damping_floor = 1e-9 * std::max(arma::max(arma::vec(A.diag())), 1e-300);
+
+        bool improved = false;
+        bool converged = false;
+        while (lambda < 1e12) {
+            arma::mat M = A;
+            for (arma::uword c = 0; c < m; ++c) M(c, c) += lambda * (A(c, c) + damping_floor);
+
+            arma::vec delta;
+            if (!arma::solve(delta, M, -g)) {
+                lambda *= 10.0;
+                continue;
+            }
+
+            arma::vec x_new = result.x;
+            for (arma::uword c = 0; c < m; ++c) {
+                x_new(columns[c]) = std::min(1.0, std::max(0.0, result.x(columns[c]) + delta(c)));
+            }
+            const double step = arma::max(arma::abs(x_new - result.x));
+
+            arma::vec r_new;
+            double cost_new = cost(model, x_new, r_new, result.evaluations);
+            if (std::isfinite(cost_new) && cost_new < result.cost && r_new.n_elem == r.n_elem) {
+                const double reduction = result.cost - cost_new;
+                converged = reduction <= settings_.tolerance * std::max(result.cost, 1e-300) ||
+                            step < settings_.step_tolerance;
+                result.x = x_new;
+                result.cost = cost_new;
+                r = r_new;
+                lambda = std::max(lambda / 10.0, 1e-12);
+                improved = true;
+                break;
+            }
+
+            lambda *= 10.0;
+            if (step < settings_.step_tolerance) {   // projected step vanished
+                converged = true;
+                break;
+            }
+        }
+
+        // Running out of damping (lambda >= 1e12) without a small step is not convergence
+        if (converged) {
+            result.converged = true;
+            break;
+        }
+        if (!improved) {
+            break;
+        }
+    }
+
+    try {
+        model.setAllParameterValues(toPhysical(result.x));
+        result.objective = model.GetObjectiveFunctionValue();
+        ++result.evaluations;
+    }
+    catch (const std::exception&) {
+        result.objective = -std::numeric_limits<double>::infinity();
+    }
+    return result;
+}
+
+template<class T>
+double CMultiStartLM<T>::cost(T& model, const arma::vec& x, arma::vec& residuals, long& evaluations) const
+{
+    ++evaluations;
+    try {
+        model.setAllParameterValues(toPhysical(x));
+        residuals = arma::conv_to<arma::vec>::from(model.calculateWeightedResiduals());
+    }
+    catch (const std::exception&) {
+        return std::numeric_limits<double>::infinity();
+    }
+    double c = 0.5 * arma::dot(residuals, residuals);
+    return std::isfinite(c) ? c : std::numeric_limits<double>::infinity();
+}
+
+template<class T>
+std::vector<arma::vec> CMultiStartLM<T>::startingPoints()
+{
+    const size_t n = space_.size();
+    const size_t count = std::max<size_t>(settings_.starts, 1);
+
+    unsigned long seed = settings_.random_seed;
+    if (seed == 0) {
+        seed = std::random_device{}();
+    }
+    std::mt19937_64 rng(seed);
+    std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+    std::vector<arma::vec> points;
+    for (const auto& values : seeds_) {
+        if (points.size() == count) break;
+        if (values.size() == n) points.push_back(toUnit(values));
+    }
+
+    // Latin hypercube for the remaining starts: one point per stratum and dimension
+    const size_t lhs = count - points.size();
+    if (lhs > 0) {
+        std::vector<arma::vec> design(lhs, arma::vec(n));
+        std::vector<size_t> strata(lhs);
+        for (size_t j = 0; j < n; ++j) {
+            std::iota(strata.begin(), strata.end(), 0);
+            std::shuffle(strata.begin(), strata.end(), rng);
+            for (size_t k = 0; k < lhs; ++k) {
+                design[k](j) = (strata[k] + unif(rng)) / lhs;
+            }
+        }
+        points.insert(points.end(), design.begin(), design.end());
+    }
+
+    // Error standard deviations stay at the model's values
+    const arma::vec current = toUnit(model_->getParameterValues());
+    for (arma::vec& point : points) {
+        for (size_t j = 0; j < n; ++j) {
+            if (!free_[j]) point(j) = current(j);
+        }
+    }
+    return points;
+}
+
+template<class T>
+std::vector<double> CMultiStartLM<T>::toPhysical(const arma::vec& x) const
+{
+    std::vector<double> u(x.n_elem);
+    for (size_t i = 0; i < u.size(); ++i) {
+        u[i] = space_.getSamplingLow(i) + x(i) * (space_.getSamplingHigh(i) - space_.getSamplingLow(i));
+    }
+    return space_.fromSampling(u);
+}
+
+template<class T>
+arma::vec CMultiStartLM<T>::toUnit(const std::vector<double>& values) const
+{
+    std::vector<double> u = space_.toSampling(values);
+    arma::vec x(u.size());
+    for (size_t i = 0; i < u.size(); ++i) {
+        double width = space_.getSamplingHigh(i) - space_.getSamplingLow(i);
+        double v = width > 0.0 ? (u[i] - space_.getSamplingLow(i)) / width : 0.5;
+        x(i) = std::isfinite(v) ? std::min(1.0, std::max(0.0, v)) : 0.5;
+    }
+    return x;
+}
+
+// ============================================================================
+// Results
+// ============================================================================
+
+template<class T>
+const std::vector<double>& CMultiStartLM<T>::getFinalParams() const
+{
+    static const std::vector<double> empty;
+    return basins_.empty() ? empty : basins_.front().parameters;
+}
+
+template<class T>
+double CMultiStartLM<T>::getMaxFitness() const
+{
+    return basins_.empty() ? -std::numeric_limits<double>::infinity() : basins_.front().objective;
+}
+
+template<class T>
+bool CMultiStartLM<T>::writeOutput() const
+{
+    std::ofstream file(settings_.pathname + settings_.outputfile);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << std::setprecision(10);
+    file << "# Model evaluations: " << evaluations_ << "\n";
+    file << "basin, objective, cost, starts, iterations, converged";
+    for (const std::string& name : space_.getNames()) {
+        file << ", " << name;
+    }
+    file << "\n";
+
+    for (size_t b = 0; b < basins_.size(); ++b) {
+        const Basin& basin = basins_[b];
+        file << b + 1 << ", " << basin.objective << ", " << basin.cost << ", " << basin.starts << ", "
+             << basin.iterations << ", " << (basin.converged ? "yes" : "no");
+        for (double value : basin.parameters) {
+            file << ", " << value;
+        }
+        file << "\n";
+    }
+    return true;
+}
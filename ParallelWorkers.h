@@ -0,0 +1,43 @@
+#pragma once
+
+#include <vector>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+/**
+ * @brief Index of the calling thread in the current OpenMP team (0 outside one)
+ *
+ * Thread 0 is the thread that entered the parallel loop, so in the GUI it
+ * may process events and poll for cancellation between items.
+ */
+inline int currentWorker()
+{
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Run body(worker, k) for k = first, ..., last - 1 on a pool of model copies
+ * @param workers One private model copy per thread; its size is the thread count
+ *
+ * Items are handed out one at a time (OpenMP dynamic schedule), so a slow
+ * forward run only delays the thread running it instead of every item
+ * statically assigned to that thread. body receives the copy owned by the
+ * calling thread and must write its result to slot k only, so results do
+ * not depend on which thread evaluated an item.
+ */
+template<class W, class F>
+void parallelForWorkers(std::vector<W>& workers, long first, long last, F body)
+{
+    const int threads = static_cast<int>(workers.size());
+
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+    for (long k = first; k < last; ++k) {
+        body(workers[currentWorker()], k);
+    }
+}
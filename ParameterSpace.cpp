@@ -0,0 +1,111 @@
+#include "ParameterSpace.h"
+#include <cmath>
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+CParameterSpace::CParameterSpace(const Parameter_Set& parameters)
+{
+    for (int i = 0; i < static_cast<int>(parameters.size()); ++i) {
+        const Parameter* param = parameters[i];
+        if (!param) continue;
+
+        names_.push_back(param->GetName());
+        low_.push_back(param->GetRange().low);
+        high_.push_back(param->GetRange().high);
+
+        // Log space only makes sense for strictly positive ranges
+        log_transformed_.push_back(param->GetPriorDistribution() == "log-normal" &&
+                                   param->GetRange().low > 0.0);
+    }
+}
+
+// ============================================================================
+// Transformations
+// ============================================================================
+
+double CParameterSpace::toSampling(size_t index, double value) const
+{
+    if (log_transformed_[index]) {
+        return std::log(value);
+    }
+    return value;
+}
+
+double CParameterSpace::fromSampling(size_t index, double value) const
+{
+    if (log_transformed_[index]) {
+        return std::exp(value);
+    }
+    return value;
+}
+
+std::vector<double> CParameterSpace::toSampling(const std::vector<double>& values) const
+{
+    std::vector<double> out(values.size());
+    for (size_t i = 0; i < values.size() && i < size(); ++i) {
+        out[i] = toSampling(i, values[i]);
+    }
+    return out;
+}
+
+std::vector<double> CParameterSpace::fromSampling(const std::vector<double>& values) const
+{
+    std::vector<double> out(values.size());
+    for (size_t i = 0; i < values.size() && i < size(); ++i) {
+        out[i] = fromSampling(i, values[i]);
+    }
+    return out;
+}
+
+double CParameterSpace::logJacobian(const std::vector<double>& sampling_values) const
+{
+    // x = exp(u)  =>  |dx/du| = exp(u)
+    double log_jacobian = 0.0;
+    for (size_t i = 0; i < sampling_values.size() && i < size(); ++i) {
+        if (log_transformed_[i]) {
+            log_jacobian += sampling_values[i];
+        }
+    }
+    return log_jacobian;
+}
+
+bool CParameterSpace::inBounds(const std::vector<double>& values) const
+{
+    for (size_t i = 0; i < values.size() && i < size(); ++i) {
+        if (!(values[i] >= low_[i] && values[i] <= high_[i])) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool CParameterSpace::inSamplingBounds(const std::vector<double>& sampling_values) const
+{
+    for (size_t i = 0; i < sampling_values.size() && i < size(); ++i) {
+        if (!(sampling_values[i] >= getSamplingLow(i) &&
+              sampling_values[i] <= getSamplingHigh(i))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void CParameterSpace::reflectIntoBounds(std::vector<double>& sampling_values) const
+{
+    for (size_t i = 0; i < sampling_values.size() && i < size(); ++i) {
+        double lo = getSamplingLow(i);
+        double hi = getSamplingHigh(i);
+        double width = hi - lo;
+        if (!(width > 0.0) || !std::isfinite(sampling_values[i])) {
+            sampling_values[i] = std::isfinite(lo) ? lo : 0.0;
+            continue;
+        }
+
+        // Fold the value into [lo, lo + 2*width) and mirror the upper half
+        double y = std::fmod(sampling_values[i] - lo, 2.0 * width);
+        if (y < 0.0) y += 2.0 * width;
+        sampling_values[i] = (y <= width) ? lo + y : hi - (y - width);
+    }
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "parameter_set.h"
+
+/**
+ * @brief Mapping between physical parameter values and the sampling space
+ *
+ * Samplers and optimizers work in a transformed space in which parameters
+ * with a log-normal prior are represented by their natural logarithm and
+ * all other parameters are used as-is. This class caches the bounds and
+ * transformation flags of a Parameter_Set so the transformation can be
+ * applied from worker threads without touching the model.
+ */
+class CParameterSpace
+{
+public:
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CParameterSpace() = default;
+    explicit CParameterSpace(const Parameter_Set& parameters);
+
+    // ========================================================================
+    // Parameter Properties
+    // ========================================================================
+
+    /**
+     * @brief Number of parameters
+     */
+    size_t size() const { return names_.size(); }
+
+    const std::string& getName(size_t index) const { return names_[index]; }
+    const std::vector<std::string>& getNames() const { return names_; }
+
+    double getLow(size_t index) const { return low_[index]; }
+    double getHigh(size_t index) const { return high_[index]; }
+
+    /**
+     * @brief Whether parameter is sampled in log space
+     */
+    bool isLogTransformed(size_t index) const { return log_transformed_[index]; }
+
+    // ========================================================================
+    // Transformations
+    // ========================================================================
+
+    /**
+     * @brief Convert a physical value to sampling space
+     */
+    double toSampling(size_t index, double value) const;
+
+    /**
+     * @brief Convert a sampling-space value to a physical value
+     */
+    double fromSampling(size_t index, double value) const;
+
+    std::vector<double> toSampling(const std::vector<double>& values) const;
+    std::vector<double> fromSampling(const std::vector<double>& values) const;
+
+    /**
+     * @brief Lower bound in sampling space
+     */
+    double getSamplingLow(size_t index) const { return toSampling(index, low_[index]); }
+
+    /**
+     * @brief Upper bound in sampling space
+     */
+    double getSamplingHigh(size_t index) const { return toSampling(index, high_[index]); }
+
+    /**
+     * @brief Log of the Jacobian |dx/du| of the inverse transformation
+     * @param sampling_values Point in sampling space
+     *
+     * Must be added to a log-density in physical space to obtain the
+     * log-density in sampling space.
+     */
+    double logJacobian(const std::vector<double>& sampling_values) const;
+
+    /**
+     * @brief Check whether physical values are within [low, high]
+     */
+    bool inBounds(const std::vector<double>& values) const;
+
+    /**
+     * @brief Check whether sampling-space values are within the transformed bounds
+     */
+    bool inSamplingBounds(const std::vector<double>& sampling_values) const;
+
+    /**
+     * @brief Reflect sampling-space values back into the transformed bounds
+     */
+    void reflectIntoBounds(std::vector<double>& sampling_values) const;
+
+private:
+    std::vector<std::string> names_;
+    std::vector<double> low_;
+    std::vector<double> high_;
+    std::vector<bool> log_transformed_;
+};
@@ -0,0 +1,310 @@
+#include "PosteriorPredictive.h"
+#include "ParallelWorkers.h"
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <random>
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#endif
+
+namespace {
+
+/// One block per item: a "# label" line, a header and the series side by side
+bool writeSeriesBlocks(const std::string& filename, const std::vector<std::string>& labels,
+                       const std::vector<TimeSeriesSet<double>>& sets)
+{
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << std::setprecision(8);
+
+    for (size_t k = 0; k < sets.size(); ++k) {
+        const TimeSeriesSet<double>& set = sets[k];
+        if (set.size() == 0 || set[0].size() == 0) continue;
+
+        file << "# " << labels[k] << "\n" << "t";
+        for (size_t j = 0; j < set.size(); ++j) {
+            file << ", " << set.getSeriesName(static_cast<int>(j));
+        }
+        file << "\n";
+
+        size_t rows = set[0].size();
+        for (size_t i = 0; i < rows; ++i) {
+            file << set[0].getTime(i);
+            for (size_t j = 0; j < set.size(); ++j) {
+                file << ", ";
+                if (i < set[j].size()) file << set[j].getValue(i);
+            }
+            file << "\n";
+        }
+        file << "\n";
+    }
+    return true;
+}
+
+/// Legacy layout: the series of all items in one TimeSeriesSet, written by TimeSeriesSet
+bool writeSeriesSet(const std::string& filename, const std::vector<TimeSeriesSet<double>>& sets)
+{
+    TimeSeriesSet<double> all;
+    for (const TimeSeriesSet<double>& set : sets) {
+        if (set.size() == 0 || set[0].size() == 0) continue;
+        for (size_t j = 0; j < set.size(); ++j) {
+            all.append(set[j], set.getSeriesName(static_cast<int>(j)));
+        }
+    }
+
+    // TimeSeriesSet::write does not report failure; check that the file appeared
+    std::remove(filename.c_str());
+    all.write(filename, ",");
+    return std::ifstream(filename).good();
+}
+
+} // namespace
+
+CPosteriorPredictive::CPosteriorPredictive(CGWA* model)
+    : model_(model)
+{
+}
+
+bool CPosteriorPredictive::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "number_of_post_estimate_realizations" || key == "number_of_realizations") {
+            settings_.number_of_realizations = std::max(0, std::stoi(value));
+        }
+        else if (key == "stored_realizations") settings_.stored_realizations = std::max(0, std::stoi(value));
+        else if (key == "number_of_threads") settings_.numberOfThreads = std::max(1, std::stoi(value));
+        else if (key == "batch_size") settings_.batch_size = std::max(0, std::stoi(value));
+        else if (key == "projections") settings_.projections = (value != "no" && value != "false" && value != "0");
+        else if (key == "random_seed") settings_.random_seed = std::stoul(value);
+        else if (key == "output_path") settings_.output_path = value;
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+bool CPosteriorPredictive::Generate(const std::vector<std::vector<double>>& samples, size_t first_sample)
+{
+    if (!model_) {
+        last_error_ = "No model assigned";
+        return false;
+    }
+    if (first_sample >= samples.size()) {
+        last_error_ = "No posterior samples after burn-in";
+        return false;
+    }
+
+    const size_t n_obs = model_->getObservationCount();
+    const size_t n_wells = model_->getWellCount();
+    observation_bands_.assign(n_obs, CPredictionBands());
+    well_bands_.assign(n_wells, CPredictionBands());
+    projection_bands_.clear();
+    projection_names_.clear();
+    observation_realizations_.assign(n_obs, TimeSeriesSet<double>());
+    well_realizations_.assign(n_wells, TimeSeriesSet<double>());
+    projection_realizations_.clear();
+    realizations_done_ = 0;
+    realizations_failed_ = 0;
+
+    // Draws are fixed up front so results do not depend on the thread count
+    const long n = settings_.number_of_realizations;
+    std::mt19937_64 rng(settings_.random_seed != 0 ? settings_.random_seed : std::random_device{}());
+    std::uniform_int_distribution<size_t> pick(first_sample, samples.size() - 1);
+    std::vector<size_t> draws(n);
+    for (auto& draw : draws) draw = pick(rng);
+
+    const int threads = std::max(1, settings_.numberOfThreads);
+    const long batch = settings_.batch_size > 0 ? settings_.batch_size : 8L * threads;
+    std::vector<CGWA> workspaces(threads, *model_);
+    std::vector<Realization> results(std::min(batch, std::max(n, 1L)));
+
+    bool cancelled = false;
+    for (long start = 0; start < n && !cancelled; start += batch) {
+        const long count = std::min(batch, n - start);
+
+        parallelForWorkers(workspaces, 0, count, [&](CGWA& workspace, long r) {
+            evaluate(workspace, samples[draws[start + r]], results[r]);
+        });
+
+        results.resize(count);
+        accumulate(results, start);
+
+#ifdef Q_GUI_SUPPORT
+        if (rtw_) {
+            rtw_->SetProgress(static_cast<double>(start + count) / n);
+            QApplication::processEvents();
+            if (rtw_->IsCancelRequested()) {
+                rtw_->AppendLog("Realizations cancelled by user.");
+                cancelled = true;
+            }
+        }
+#endif
+    }
+
+    for (size_t i = 0; i < n_obs; ++i) {
+        if (observation_bands_[i].count() == 0) continue;
+        Observation& obs = model_->getObservation(i);
+        obs.SetPercentile95(observation_bands_[i].bands());
+        obs.SetRealizations(observation_realizations_[i]);
+    }
+    for (size_t i = 0; i < n_wells; ++i) {
+        if (well_bands_[i].count() == 0) continue;
+        CWell& well = model_->getWell(i);
+        well.SetPercentile95(well_bands_[i].bands());
+        well.SetRealizations(well_realizations_[i]);
+    }
+
+    if (!writeOutput()) {
+        return false;
+    }
+    if (cancelled) {
+        last_error_ = "Cancelled after " + std::to_string(realizations_done_) + " realizations";
+        return false;
+    }
+    return true;
+}
+
+void CPosteriorPredictive::evaluate(CGWA& workspace, const std::vector<double>& parameters,
+                                    Realization& result) const
+{
+    result = Realization();
+    try {
+        workspace.setAllParameterValues(parameters);
+        workspace.runForwardModel();
+
+        const TimeSeriesSet<double>& modeled = workspace.getModeledData();
+        result.observations.resize(workspace.getObservationCount());
+        for (size_t i = 0; i < result.observations.size() && i < modeled.size(); ++i) {
+            result.observations[i] = modeled[i];
+        }
+        for (size_t i = 0; i < workspace.getWellCount(); ++i) {
+            result.wells.push_back(workspace.getWell(i).getYoungAgeDistribution());
+        }
+        if (settings_.projections && workspace.getSettings().project_enabled) {
+            result.projections = workspace.runProjection();
+        }
+        result.valid = true;
+    }
+    catch (const std::exception&) {
+        result.valid = false;
+    }
+}
+
+void CPosteriorPredictive::accumulate(const std::vector<Realization>& batch, long first_index)
+{
+    // Projection series are known once the first realization succeeded
+    if (projection_bands_.empty()) {
+        for (const Realization& result : batch) {
+            if (!result.valid || result.projections.size() == 0) continue;
+            for (size_t k = 0; k < result.projections.size(); ++k) {
+                projection_names_.push_back(result.projections.getSeriesName(static_cast<int>(k)));
+            }
+            projection_bands_.assign(result.projections.size(), CPredictionBands());
+            projection_realizations_.assign(result.projections.size(), TimeSeriesSet<double>());
+            break;
+        }
+    }
+
+    const int n_obs = static_cast<int>(observation_bands_.size());
+    const int n_wells = static_cast<int>(well_bands_.size());
+    const int n_series = n_obs + n_wells + static_cast<int>(projection_bands_.size());
+
+    // Every output series is fed in draw order by exactly one thread
+#pragma omp parallel for schedule(dynamic) num_threads(std::max(1, settings_.numberOfThreads))
+    for (int j = 0; j < n_series; ++j) {
+        for (size_t r = 0; r < batch.size(); ++r) {
+            const Realization& result = batch[r];
+            if (!result.valid) continue;
+
+            const TimeSeries<double>* series;
+            CPredictionBands* bands;
+            TimeSeriesSet<double>* stored;
+            if (j < n_obs) {
+                series = &result.observations[j];
+                bands = &observation_bands_[j];
+                stored = &observation_realizations_[j];
+            }
+            else if (j < n_obs + n_wells) {
+                series = &result.wells[j - n_obs];
+                bands = &well_bands_[j - n_obs];
+                stored = &well_realizations_[j - n_obs];
+            }
+            else {
+                size_t k = j - n_obs - n_wells;
+                if (k >= result.projections.size()) continue;
+                series = &result.projections[k];
+                bands = &projection_bands_[k];
+                stored = &projection_realizations_[k];
+            }
+            if (series->size() == 0) continue;
+
+            bands->add(*series);
+            const long index = first_index + static_cast<long>(r);
+            if (index < settings_.stored_realizations) {
+                stored->append(*series, "Realization_" + std::to_string(index + 1));
+            }
+        }
+    }
+
+    for (const Realization& result : batch) {
+        if (result.valid) ++realizations_done_;
+        else ++realizations_failed_;
+    }
+}
+
+std::vector<TimeSeriesSet<double>> CPosteriorPredictive::GetProjectionBands() const
+{
+    std::vector<TimeSeriesSet<double>> bands;
+    for (const auto& band : projection_bands_) {
+        bands.push_back(band.bands());
+    }
+    return bands;
+}
+
+bool CPosteriorPredictive::writeOutput()
+{
+    std::vector<std::string> obs_labels, well_labels;
+    std::vector<TimeSeriesSet<double>> obs_bands, well_bands;
+    for (size_t i = 0; i < observation_bands_.size(); ++i) {
+        obs_labels.push_back(model_->getObservation(i).GetName());
+        obs_bands.push_back(observation_bands_[i].bands());
+    }
+    for (size_t i = 0; i < well_bands_.size(); ++i) {
+        well_labels.push_back(model_->getWell(i).getName());
+        well_bands.push_back(well_bands_[i].bands());
+    }
+
+    const std::string& path = settings_.output_path;
+    bool ok = writeSeriesSet(path + "Predicted_95p_Bracket_Obs.txt", obs_bands) &&
+              writeSeriesSet(path + "Predicted_95p_Bracket_Well.txt", well_bands) &&
+              writeSeriesSet(path + "Realizations_Obs.txt", observation_realizations_) &&
+              writeSeriesSet(path + "Realizations_Well.txt", well_realizations_) &&
+              writeSeriesBlocks(path + "Predicted_95p_Bracket_Obs_Labeled.txt", obs_labels, obs_bands) &&
+              writeSeriesBlocks(path + "Predicted_95p_Bracket_Well_Labeled.txt", well_labels, well_bands) &&
+              writeSeriesBlocks(path + "Realizations_Obs_Labeled.txt", obs_labels, observation_realizations_) &&
+              writeSeriesBlocks(path + "Realizations_Well_Labeled.txt", well_labels, well_realizations_);
+    if (ok && !projection_bands_.empty()) {
+        ok = writeSeriesBlocks(path + "Predicted_95p_Bracket_Projection.txt", projection_names_, GetProjectionBands()) &&
+             writeSeriesBlocks(path + "Realizations_Projection.txt", projection_names_, projection_realizations_);
+    }
+    if (!ok) {
+        last_error_ = "Cannot write realization output to " + path;
+    }
+    return ok;
+}
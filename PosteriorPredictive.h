@@ -0,0 +1,114 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "GWA.h"
+#include "QuantileSketch.h"
+
+#ifdef Q_GUI_SUPPORT
+class ProgressWindow;
+#endif
+
+/**
+ * @brief Settings for posterior predictive realizations
+ */
+struct PosteriorPredictiveSettings
+{
+    int number_of_realizations = 0;      ///< Posterior draws to evaluate
+    int stored_realizations = 100;       ///< Realizations kept for plotting (bands use all)
+    int numberOfThreads = 1;             ///< Worker threads, each with its own model copy
+    int batch_size = 0;                  ///< Realizations evaluated per parallel batch (0 = 8 per thread)
+    bool projections = true;             ///< Include projections when the model has them enabled
+    unsigned long random_seed = 0;       ///< 0 = draw a seed from std::random_device
+    std::string output_path;             ///< Directory for output files
+};
+
+/**
+ * @brief Parallel posterior predictive realizations
+ *
+ * Draws parameter sets from posterior samples and evaluates them in
+ * parallel. Every thread owns a private copy of the model as workspace, and
+ * a single forward run yields the modeled observations, the well age
+ * distributions and, if enabled in the model, the projections.
+ *
+ * Realizations are evaluated in batches; after each batch the results are
+ * folded into streaming quantiles (CPredictionBands) in draw order, one
+ * thread per output series. Results therefore do not depend on the number
+ * of threads, and memory is bounded by the batch size rather than the
+ * number of realizations. Only the first stored_realizations series are
+ * kept for plotting.
+ *
+ * Results are attached to the model (SetPercentile95/SetRealizations on
+ * observations and wells, with wells holding their age distributions) and
+ * written to Predicted_95p_Bracket_Obs.txt, Predicted_95p_Bracket_Well.txt,
+ * Realizations_Obs.txt and Realizations_Well.txt in the legacy CMCMC
+ * layout (TimeSeriesSet::write, all series side by side). The same series
+ * with a block per observation or well name go to the *_Labeled.txt
+ * files, and projections to Predicted_95p_Bracket_Projection.txt and
+ * Realizations_Projection.txt.
+ */
+class CPosteriorPredictive
+{
+public:
+    explicit CPosteriorPredictive(CGWA* model);
+
+    bool SetProperty(const std::string& key, const std::string& value);
+    const PosteriorPredictiveSettings& GetSettings() const { return settings_; }
+
+    /**
+     * @brief Generate realizations from posterior samples
+     * @param samples Parameter values, one row per sample
+     * @param first_sample Index of the first post burn-in sample
+     * @return false if there are no usable samples, the run was cancelled
+     *         or output cannot be written
+     */
+    bool Generate(const std::vector<std::vector<double>>& samples, size_t first_sample = 0);
+
+    long GetRealizationCount() const { return realizations_done_; }
+    long GetFailedRealizationCount() const { return realizations_failed_; }
+
+    /**
+     * @brief Bands of the projected series (empty without projections)
+     */
+    std::vector<TimeSeriesSet<double>> GetProjectionBands() const;
+
+    std::string getLastError() const { return last_error_; }
+
+#ifdef Q_GUI_SUPPORT
+    void SetRunTimeWindow(ProgressWindow* window) { rtw_ = window; }
+#endif
+
+private:
+    /**
+     * @brief Output of one forward run
+     */
+    struct Realization
+    {
+        bool valid = false;
+        std::vector<TimeSeries<double>> observations;
+        std::vector<TimeSeries<double>> wells;
+        TimeSeriesSet<double> projections;
+    };
+
+    void evaluate(CGWA& workspace, const std::vector<double>& parameters, Realization& result) const;
+    void accumulate(const std::vector<Realization>& batch, long first_index);
+    bool writeOutput();
+
+    CGWA* model_;
+    PosteriorPredictiveSettings settings_;
+
+    std::vector<CPredictionBands> observation_bands_;
+    std::vector<CPredictionBands> well_bands_;
+    std::vector<CPredictionBands> projection_bands_;
+    std::vector<std::string> projection_names_;
+    std::vector<TimeSeriesSet<double>> observation_realizations_;
+    std::vector<TimeSeriesSet<double>> well_realizations_;
+    std::vector<TimeSeriesSet<double>> projection_realizations_;
+    long realizations_done_ = 0;
+    long realizations_failed_ = 0;
+    std::string last_error_;
+
+#ifdef Q_GUI_SUPPORT
+    ProgressWindow* rtw_ = nullptr;
+#endif
+};
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "ParameterSpace.h"
+
+#ifdef Q_GUI_SUPPORT
+class ProgressWindow;
+#endif
+
+/**
+ * @brief Settings for CPosteriorReweighting
+ */
+struct ReweightingSettings
+{
+    long burnin = 0;                     ///< Rows with sample_no <= burnin are skipped when loading
+    int max_samples = 2000;              ///< Samples used (evenly thinned)
+    std::vector<std::string> exclude;    ///< Observations dropped from the likelihood
+    std::vector<std::pair<std::string, double>> scale;  ///< Observations whose log-likelihood is multiplied by a factor
+    bool recompute = false;              ///< Re-evaluate the observations with the current model settings
+    double min_ess_fraction = 0.1;       ///< Reweighting is flagged unreliable below this ESS / samples
+    int numthreads = 1;                  ///< Threads running forward models
+    std::string terms_filename;          ///< Observation terms written while sampling; empty = <samples>_obsloglik
+    std::string samples_filename = "reweighted_samples.txt";
+    std::string outputfile = "reweighting_summary.txt";
+    std::string pathname;                ///< Directory for output files
+};
+
+/**
+ * @brief What-if analysis of a stored posterior by importance reweighting
+ *
+ * Answers questions such as "what if this observation is dropped or its
+ * detection limit changes" without a new MCMC run. Each stored sample is
+ * reweighted by the ratio of the modified likelihood to the one it was
+ * sampled with:
+ *   log w_k = sum_i f_i l_ik' - sum_i l_ik
+ * where l_ik is the log-likelihood of observation i at sample k, f_i is 0
+ * for excluded observations, the scale factor for scaled ones and 1
+ * otherwise, and l_ik' equals l_ik unless recompute is set.
+ *
+ * The per-observation terms l_ik are read from terms_filename, which
+ * CMCMCEngine writes while sampling (store_observation_loglik), so the
+ * baseline is the likelihood the chain was sampled with and analyses that
+ * only exclude or scale observations need no forward runs. To change an
+ * error model, detection limit or data, edit the observation in the
+ * project and set recompute: the samples are then re-evaluated with the
+ * current settings and compared with the stored terms (or, if none are
+ * stored, with log_posterior minus the log prior).
+ *
+ * Samples without stored terms (e.g. from CMCMC) fall back to evaluating
+ * the terms after sampling, at one forward run per sample, and keep them
+ * in <samples>_obsloglik_posthoc.txt for later analyses. That baseline
+ * uses the current observation settings, so it is only correct if they
+ * have not changed since sampling; a warning is logged and written to the
+ * summary.
+ *
+ * Reweighting is only as good as the overlap between the two posteriors.
+ * The effective sample size of the weights is reported; below
+ * min_ess_fraction of the samples the result should be confirmed by a new
+ * MCMC run. For every observation the ESS of dropping it alone is listed as
+ * well, which shows at a glance which observations can be examined this way.
+ *
+ * Writes the reweighted samples (sample_no, parameters, log_posterior,
+ * weight, readable by CSMCSampler), a summary comparing the original and
+ * reweighted posteriors, and the standard Posterior_Percentiles.txt and
+ * Posterior_Distributions.txt.
+ *
+ * @tparam T Model type providing Parameters(), setAllParameterValues(),
+ *           calculateObservationLogLikelihoods(), calculateLogPrior(),
+ *           getObservationCount() and getObservation(i).GetName()
+ */
+template<class T>
+class CPosteriorReweighting
+{
+public:
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CPosteriorReweighting();
+    explicit CPosteriorReweighting(T* model);
+
+    void SetModel(T* model) { model_ = model; }
+
+    // ========================================================================
+    // Settings
+    // ========================================================================
+
+    /**
+     * @brief Set a property by name (reweight_* keys plus numthreads, outputfile, pathname)
+     *
+     * reweight_exclude takes a comma-separated list of observation names,
+     * reweight_scale a list of name:factor pairs. An empty value or "none"
+     * clears either list.
+     * @return true if the property is recognized
+     */
+    bool SetProperty(const std::string& prop, const std::string& value);
+
+    const ReweightingSettings& GetSettings() const { return settings_; }
+
+    std::string getLastError() const { return last_error_; }
+
+#ifdef Q_GUI_SUPPORT
+    void SetProgressWindow(ProgressWindow* window) { rtw_ = window; }
+#endif
+
+    // ========================================================================
+    // Reweighting
+    // ========================================================================
+
+    /**
+     * @brief Load stored posterior samples
+     *
+     * Parameters are matched by name. A weight column (e.g. SMC output) is
+     * carried into the reweighted weights, a log_posterior column is used
+     * as the baseline when recomputing without stored terms.
+     * @return false if the file cannot be read or a parameter is missing
+     */
+    bool LoadSamples(const std::string& filename);
+
+    /**
+     * @brief Reweight the loaded samples for the modified observation set
+     * @return true if weights were computed and output was written
+     */
+    bool run();
+
+    // ========================================================================
+    // Results
+    // ========================================================================
+
+    const std::vector<std::vector<double>>& getSamples() const { return samples_; }
+    const std::vector<double>& getWeights() const { return weights_; }
+    const std::vector<double>& getOriginalWeights() const { return base_weights_; }
+    const std::vector<std::string>& getParamNames() const { return space_.getNames(); }
+    const std::vector<std::string>& getObservationNames() const { return observation_names_; }
+
+    double getESS() const { return ess_; }
+    double getMaxWeight() const { return max_weight_; }
+
+    /**
+     * @brief Whether ESS reaches min_ess_fraction of the samples
+     */
+    bool isReliable() const { return ess_ >= settings_.min_ess_fraction * samples_.size(); }
+
+    /**
+     * @brief ESS when each observation alone is dropped (empty without stored terms)
+     */
+    const std::vector<double>& getDropOneESS() const { return drop_one_ess_; }
+
+    /**
+     * @brief Whether the baseline terms were written while sampling
+     */
+    bool usedStoredTerms() const { return stored_terms_; }
+
+    /**
+     * @brief Whether the baseline terms were evaluated after sampling with the current observation settings
+     */
+    bool usedPostHocTerms() const { return posthoc_terms_; }
+
+    long getModelEvaluations() const { return evaluations_; }
+    long getFailedRuns() const { return failed_runs_; }
+
+private:
+    bool evaluate(std::vector<std::vector<double>>& terms, std::vector<double>& log_prior);
+    bool loadTerms(const std::string& filename);
+    bool saveTerms() const;
+    double normalize(const std::vector<double>& log_weights, std::vector<double>& weights) const;
+    std::string termsFilename() const;
+    std::string postHocTermsFilename() const;
+    bool writeOutput(const std::vector<double>& log_ratio) const;
+
+    T* model_ = nullptr;
+    std::vector<T> workers_;
+    ReweightingSettings settings_;
+    CParameterSpace space_;
+    std::string last_error_;
+
+    std::string source_filename_;
+    std::vector<double> sample_no_;
+    std::vector<std::vector<double>> samples_;      ///< Physical values
+    std::vector<double> log_posterior_;             ///< Stored values, empty if not in the file
+    std::vector<double> base_weights_;              ///< Normalized weights of the stored posterior
+
+    std::vector<std::string> observation_names_;
+    std::vector<std::vector<double>> terms_;        ///< [sample][observation], baseline
+    bool stored_terms_ = false;
+    bool posthoc_terms_ = false;
+
+    std::vector<double> weights_;                   ///< Normalized to sum 1
+    std::vector<double> drop_one_ess_;
+    double ess_ = 0.0;
+    double max_weight_ = 0.0;
+    long evaluations_ = 0;
+    long failed_runs_ = 0;
+
+#ifdef Q_GUI_SUPPORT
+    ProgressWindow* rtw_ = nullptr;
+#endif
+};
+
+#include "PosteriorReweighting.hpp"
@@ -0,0 +1,583 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <iomanip>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include "ParallelWorkers.h"
+#include "SampleStore.h"
+#include "PosteriorSummary.h"
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#endif
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+template<class T>
+CPosteriorReweighting<T>::CPosteriorReweighting()
+{
+}
+
+template<class T>
+CPosteriorReweighting<T>::CPosteriorReweighting(T* model)
+    : model_(model)
+{
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+template<class T>
+bool CPosteriorReweighting<T>::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    auto split = [](const std::string& list) {
+        std::vector<std::string> items;
+        if (list.empty() || list == "none") return items;
+        std::stringstream ss(list);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            size_t first = item.find_first_not_of(" \t");
+            size_t last = item.find_last_not_of(" \t");
+            if (first != std::string::npos) items.push_back(item.substr(first, last - first + 1));
+        }
+        return items;
+    };
+
+    try {
+        if (key == "reweight_burnin") settings_.burnin = std::max(0L, std::stol(value));
+        else if (key == "reweight_max_samples") settings_.max_samples = std::max(2, std::stoi(value));
+        else if (key == "reweight_exclude") settings_.exclude = split(value);
+        else if (key == "reweight_scale") {
+            std::vector<std::pair<std::string, double>> scale;
+            for (const std::string& item : split(value)) {
+                size_t colon = item.rfind(':');
+                if (colon == std::string::npos || colon == 0) {
+                    throw std::invalid_argument(item);
+                }
+                scale.emplace_back(item.substr(0, colon), std::max(0.0, std::stod(item.substr(colon + 1))));
+            }
+            settings_.scale = scale;
+        }
+        else if (key == "reweight_recompute") settings_.recompute = (value != "no" && value != "false" && value != "0");
+        else if (key == "reweight_min_ess_fraction") settings_.min_ess_fraction = std::stod(value);
+        else if (key == "reweight_terms_filename") settings_.terms_filename = value;
+        else if (key == "reweight_samples_filename") settings_.samples_filename = value;
+        else if (key == "outputfile") settings_.outputfile = value;
+        else if (key == "numthreads") settings_.numthreads = std::max(1, std::stoi(value));
+        else if (key == "pathname") settings_.pathname = value;
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Samples
+// ============================================================================
+
+template<class T>
+bool CPosteriorReweighting<T>::LoadSamples(const std::string& filename)
+{
+    if (!model_) {
+        last_error_ = "No model assigned to posterior reweighting";
+        return false;
+    }
+    space_ = CParameterSpace(model_->Parameters());
+
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> columns;
+    try {
+        readSampleTable(filename, names, columns);
+    }
+    catch (const std::exception& e) {
+        last_error_ = "Cannot read samples from " + filename + ": " + e.what();
+        return false;
+    }
+
+    auto find = [&names](const std::string& name) {
+        auto it = std::find(names.begin(), names.end(), name);
+        return it == names.end() ? -1 : static_cast<int>(it - names.begin());
+    };
+
+    std::vector<int> parameter_columns;
+    for (const std::string& name : space_.getNames()) {
+        int c = find(name);
+        if (c < 0) {
+            last_error_ = "Parameter " + name + " not found in " + filename;
+            return false;
+        }
+        parameter_columns.push_back(c);
+    }
+    const int sample_column = find("sample_no");
+    const int logp_column = find("log_posterior");
+    const int weight_column = find("weight");
+
+    std::vector<size_t> rows;
+    const size_t total = columns.empty() ? 0 : columns[0].size();
+    for (size_t r = 0; r < total; ++r) {
+        if (sample_column < 0 || columns[sample_column][r] > settings_.burnin) rows.push_back(r);
+    }
+    if (rows.empty()) {
+        last_error_ = "No samples after burn-in in " + filename;
+        return false;
+    }
+
+    // Thin evenly to the requested number of samples
+    const size_t count = std::min<size_t>(rows.size(), settings_.max_samples);
+    source_filename_ = filename;
+    sample_no_.clear();
+    samples_.clear();
+    log_posterior_.clear();
+    std::vector<double> weights;
+    for (size_t k = 0; k < count; ++k) {
+        const size_t r = rows[k * rows.size() / count];
+        std::vector<double> x;
+        for (int c : parameter_columns) x.push_back(columns[c][r]);
+        samples_.push_back(x);
+        sample_no_.push_back(sample_column >= 0 ? columns[sample_column][r] : static_cast<double>(r + 1));
+        if (logp_column >= 0) log_posterior_.push_back(columns[logp_column][r]);
+        weights.push_back(weight_column >= 0 ? columns[weight_column][r] : 1.0);
+    }
+
+    std::vector<double> log_weights(count);
+    for (size_t k = 0; k < count; ++k) {
+        log_weights[k] = weights[k] > 0.0 ? std::log(weights[k]) : -std::numeric_limits<double>::infinity();
+    }
+    if (!(normalize(log_weights, base_weights_) > 0.0)) {
+        last_error_ = "All sample weights are zero in " + filename;
+        return false;
+    }
+
+    terms_.clear();
+    stored_terms_ = false;
+    posthoc_terms_ = false;
+    return true;
+}
+
+// ============================================================================
+// Reweighting
+// ============================================================================
+
+template<class T>
+bool CPosteriorReweighting<T>::run()
+{
+    if (!model_) {
+        last_error_ = "No model assigned to posterior reweighting";
+        return false;
+    }
+    if (samples_.empty()) {
+        last_error_ = "No samples loaded";
+        return false;
+    }
+
+    last_error_.clear();
+    evaluations_ = 0;
+    failed_runs_ = 0;
+    weights_.clear();
+    drop_one_ess_.clear();
+
+    observation_names_.clear();
+    for (size_t i = 0; i < model_->getObservationCount(); ++i) {
+        observation_names_.push_back(model_->getObservation(i).GetName());
+    }
+    const size_t m = observation_names_.size();
+
+    // Likelihood factor of each observation
+    std::vector<double> factor(m, 1.0);
+    auto index = [this](const std::string& name) {
+        auto it = std::find(observation_names_.begin(), observation_names_.end(), name);
+        return it == observation_names_.end() ? -1 : static_cast<int>(it - observation_names_.begin());
+    };
+    for (const auto& item : settings_.scale) {
+        int i = index(item.first);
+        if (i < 0) {
+            last_error_ = "Observation " + item.first + " not found";
+            return false;
+        }
+        factor[i] = item.second;
+    }
+    for (const std::string& name : settings_.exclude) {
+        int i = index(name);
+        if (i < 0) {
+            last_error_ = "Observation " + name + " not found";
+            return false;
+        }
+        factor[i] = 0.0;
+    }
+
+    // Baseline terms: written while sampling or, for legacy samples, evaluated now
+    stored_terms_ = loadTerms(termsFilename());
+    posthoc_terms_ = false;
+    if (!stored_terms_ && !settings_.recompute) {
+        posthoc_terms_ = true;
+        if (!loadTerms(postHocTermsFilename())) {
+            std::vector<double> log_prior;
+            if (!evaluate(terms_, log_prior)) {
+                return false;
+            }
+            if (!saveTerms()) {
+                last_error_ = "Cannot write observation terms to " + postHocTermsFilename();
+                return false;
+            }
+        }
+#ifdef Q_GUI_SUPPORT
+        if (rtw_) {
+            rtw_->AppendLog("WARNING: no observation terms were stored while sampling; the original likelihood "
+                            "is evaluated with the current observation settings, which must not have changed "
+                            "since the samples were drawn.");
+            QApplication::processEvents();
+        }
+#endif
+    }
+    const bool have_terms = !terms_.empty();
+
+    const size_t N = samples_.size();
+    std::vector<double> old_loglik(N, 0.0);
+    std::vector<std::vector<double>> new_terms;
+    if (settings_.recompute) {
+        if (!have_terms && log_posterior_.empty()) {
+            last_error_ = "Recomputing needs stored observation terms (" + termsFilename() +
+                          ") or a log_posterior column in the samples";
+            return false;
+        }
+        std::vector<double> log_prior;
+        if (!evaluate(new_terms, log_prior)) {
+            return false;
+        }
+        if (!have_terms) {
+            for (size_t k = 0; k < N; ++k) old_loglik[k] = log_posterior_[k] - log_prior[k];
+        }
+    }
+    if (have_terms) {
+        for (size_t k = 0; k < N; ++k) {
+            for (double term : terms_[k]) old_loglik[k] += term;
+        }
+    }
+    const std::vector<std::vector<double>>& current = settings_.recompute ? new_terms : terms_;
+
+    std::vector<double> log_ratio(N), log_weights(N);
+    for (size_t k = 0; k < N; ++k) {
+        double new_loglik = 0.0;
+        for (size_t i = 0; i < m; ++i) {
+            if (factor[i] != 0.0) new_loglik += factor[i] * current[k][i];
+        }
+        log_ratio[k] = new_loglik - old_loglik[k];
+        if (!std::isfinite(log_ratio[k])) log_ratio[k] = -std::numeric_limits<double>::infinity();
+        log_weights[k] = std::log(base_weights_[k]) + log_ratio[k];
+    }
+    if (!(normalize(log_weights, weights_) > 0.0)) {
+        last_error_ = "No sample has a finite likelihood under the modified observations";
+        return false;
+    }
+
+    double sum_squares = 0.0;
+    max_weight_ = 0.0;
+    for (double w : weights_) {
+        sum_squares += w * w;
+        max_weight_ = std::max(max_weight_, w);
+    }
+    ess_ = 1.0 / sum_squares;
+
+    // ESS of dropping each observation alone from the stored posterior
+    if (have_terms) {
+        std::vector<double> weights;
+        for (size_t i = 0; i < m; ++i) {
+            for (size_t k = 0; k < N; ++k) {
+                log_weights[k] = std::isfinite(terms_[k][i]) ? std::log(base_weights_[k]) - terms_[k][i]
+                                                              : -std::numeric_limits<double>::infinity();
+            }
+            double ess = 0.0;
+            if (normalize(log_weights, weights) > 0.0) {
+                double s = 0.0;
+                for (double w : weights) s += w * w;
+                ess = 1.0 / s;
+            }
+            drop_one_ess_.push_back(ess);
+        }
+    }
+
+#ifdef Q_GUI_SUPPORT
+    if (rtw_) {
+        rtw_->SetProgress(1.0);
+        rtw_->AppendLog(QString("Effective sample size: %1 of %2").arg(ess_, 0, 'f', 1).arg(N));
+        QApplication::processEvents();
+    }
+#endif
+
+    if (!writeOutput(log_ratio)) {
+        last_error_ = "Cannot write reweighting output to " + settings_.pathname;
+        return false;
+    }
+    return true;
+}
+
+template<class T>
+bool CPosteriorReweighting<T>::evaluate(std::vector<std::vector<double>>& terms, std::vector<double>& log_prior)
+{
+    const long n = static_cast<long>(samples_.size());
+    const size_t m = observation_names_.size();
+    const int threads = std::max(1, settings_.numthreads);
+    const long batch = 8L * threads;
+    workers_.assign(threads, *model_);
+    terms.assign(n, std::vector<double>(m, std::numeric_limits<double>::quiet_NaN()));
+    log_prior.assign(n, std::numeric_limits<double>::quiet_NaN());
+
+#ifdef Q_GUI_SUPPORT
+    if (rtw_) {
+        rtw_->SetStatus("Evaluating observations...");
+        rtw_->AppendLog(QString("Evaluating %1 observations at %2 samples...").arg(m).arg(n));
+        QApplication::processEvents();
+    }
+#endif
+
+    for (long start = 0; start < n; start += batch) {
+        const long end = std::min(n, start + batch);
+
+        parallelForWorkers(workers_, start, end, [&](T& worker, long k) {
+            try {
+                worker.setAllParameterValues(samples_[k]);
+                std::vector<double> values = worker.calculateObservationLogLikelihoods();
+                if (values.size() == m) terms[k] = values;
+                log_prior[k] = worker.calculateLogPrior();
+            }
+            catch (const std::exception&) {
+            }
+        });
+        evaluations_ += end - start;
+
+#ifdef Q_GUI_SUPPORT
+        if (rtw_) {
+            rtw_->SetProgress(0.95 * end / n);
+            QApplication::processEvents();
+            if (rtw_->IsCancelRequested()) {
+                rtw_->AppendLog("Reweighting cancelled by user.");
+                last_error_ = "Cancelled";
+                return false;
+            }
+        }
+#endif
+    }
+
+    for (const std::vector<double>& row : terms) {
+        if (!std::all_of(row.begin(), row.end(), [](double v) { return std::isfinite(v); })) ++failed_runs_;
+    }
+    return true;
+}
+
+template<class T>
+double CPosteriorReweighting<T>::normalize(const std::vector<double>& log_weights, std::vector<double>& weights) const
+{
+    double max_log = -std::numeric_limits<double>::infinity();
+    for (double lw : log_weights) max_log = std::max(max_log, lw);
+
+    weights.assign(log_weights.size(), 0.0);
+    if (!std::isfinite(max_log)) {
+        return 0.0;
+    }
+    double total = 0.0;
+    for (size_t k = 0; k < log_weights.size(); ++k) {
+        weights[k] = std::exp(log_weights[k] - max_log);
+        total += weights[k];
+    }
+    for (double& w : weights) w /= total;
+    return total;
+}
+
+// ============================================================================
+// Stored observation terms
+// ============================================================================
+
+template<class T>
+std::string CPosteriorReweighting<T>::termsFilename() const
+{
+    if (!settings_.terms_filename.empty()) {
+        return settings_.terms_filename;
+    }
+    std::string stem = source_filename_;
+    const size_t dot = stem.find_last_of('.');
+    const size_t slash = stem.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        stem = stem.substr(0, dot);
+    }
+    return stem + "_obsloglik" + source_filename_.substr(stem.size());
+}
+
+template<class T>
+std::string CPosteriorReweighting<T>::postHocTermsFilename() const
+{
+    std::string stem = source_filename_;
+    const size_t dot = stem.find_last_of('.');
+    const size_t slash = stem.find_last_of("/\\");
+    if (dot != std::string::npos && (slash == std::string::npos || dot > slash)) {
+        stem = stem.substr(0, dot);
+    }
+    return stem + "_obsloglik_posthoc.txt";
+}
+
+template<class T>
+bool CPosteriorReweighting<T>::loadTerms(const std::string& filename)
+{
+    terms_.clear();
+
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> columns;
+    try {
+        readSampleTable(filename, names, columns);
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+
+    // Terms are matched to the samples by sample_no and to the observations by name
+    auto find = [&names](const std::string& name) {
+        auto it = std::find(names.begin(), names.end(), name);
+        return it == names.end() ? -1 : static_cast<int>(it - names.begin());
+    };
+    const int sample_column = find("sample_no");
+    if (sample_column < 0) {
+        return false;
+    }
+    std::vector<int> observation_columns;
+    for (const std::string& name : observation_names_) {
+        int c = find(name);
+        if (c < 0) return false;
+        observation_columns.push_back(c);
+    }
+
+    std::map<double, size_t> rows;
+    for (size_t r = 0; r < columns[sample_column].size(); ++r) {
+        rows[columns[sample_column][r]] = r;
+    }
+
+    std::vector<std::vector<double>> terms;
+    for (double sample_no : sample_no_) {
+        auto it = rows.find(sample_no);
+        if (it == rows.end()) return false;
+        std::vector<double> row;
+        for (int c : observation_columns) row.push_back(columns[c][it->second]);
+        terms.push_back(row);
+    }
+    terms_ = terms;
+    return true;
+}
+
+template<class T>
+bool CPosteriorReweighting<T>::saveTerms() const
+{
+    std::ofstream file(postHocTermsFilename());
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "# Log-likelihood of each observation at the samples of " << source_filename_
+         << ", evaluated after sampling with the observation settings of the analysis\n";
+    file << "sample_no";
+    for (const std::string& name : observation_names_) file << ", " << name;
+    file << "\n";
+    file << std::setprecision(std::numeric_limits<double>::max_digits10);
+    for (size_t k = 0; k < terms_.size(); ++k) {
+        file << sample_no_[k];
+        for (double term : terms_[k]) file << ", " << term;
+        file << "\n";
+    }
+    return true;
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+template<class T>
+bool CPosteriorReweighting<T>::writeOutput(const std::vector<double>& log_ratio) const
+{
+    const size_t N = samples_.size();
+
+    std::ofstream file(settings_.pathname + settings_.samples_filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "sample_no";
+    for (const std::string& name : space_.getNames()) file << ", " << name;
+    if (!log_posterior_.empty()) file << ", log_posterior";
+    file << ", weight\n";
+    file << std::scientific << std::setprecision(8);
+    for (size_t k = 0; k < N; ++k) {
+        file << k + 1;
+        for (double value : samples_[k]) file << ", " << value;
+        if (!log_posterior_.empty()) file << ", " << log_posterior_[k] + log_ratio[k];
+        file << ", " << weights_[k] << "\n";
+    }
+
+    std::ofstream summary(settings_.pathname + settings_.outputfile);
+    if (!summary.is_open()) {
+        return false;
+    }
+    summary << std::setprecision(6);
+    summary << "# Importance reweighting of " << source_filename_ << "\n";
+    summary << "# Samples: " << N << ", model evaluations: " << evaluations_
+            << ", failed: " << failed_runs_ << "\n";
+    if (terms_.empty()) {
+        summary << "# Observation terms: none stored, baseline from log_posterior\n";
+    }
+    else if (stored_terms_) {
+        summary << "# Observation terms: written while sampling, read from " << termsFilename() << "\n";
+    }
+    else {
+        summary << "# Observation terms: evaluated after sampling, " << postHocTermsFilename() << "\n";
+        summary << "# WARNING: the original likelihood uses the current observation settings; the result "
+                   "is only valid if they have not changed since sampling\n";
+    }
+    summary << "# Excluded:";
+    for (const std::string& name : settings_.exclude) summary << " " << name;
+    summary << "\n# Scaled:";
+    for (const auto& item : settings_.scale) summary << " " << item.first << ":" << item.second;
+    summary << "\n# Recomputed with current observation settings: " << (settings_.recompute ? "yes" : "no") << "\n";
+    summary << "# Effective sample size: " << ess_ << " (" << 100.0 * ess_ / N << "%)\n";
+    summary << "# Largest normalized weight: " << max_weight_ << "\n";
+    if (!isReliable()) {
+        summary << "# WARNING: effective sample size below " << 100.0 * settings_.min_ess_fraction
+                << "% of the samples; confirm with a new MCMC run\n";
+    }
+
+    const CPosteriorSummary before(space_, samples_, base_weights_);
+    const CPosteriorSummary after(space_, samples_, weights_);
+    summary << "\nparameter, mean, 2.5%, 97.5%, reweighted_mean, reweighted_2.5%, reweighted_97.5%\n";
+    for (size_t i = 0; i < space_.size(); ++i) {
+        summary << space_.getName(i) << ", " << before.mean(i) << ", " << before.percentile(i, 0.025) << ", "
+                << before.percentile(i, 0.975) << ", " << after.mean(i) << ", " << after.percentile(i, 0.025)
+                << ", " << after.percentile(i, 0.975) << "\n";
+    }
+
+    if (!drop_one_ess_.empty()) {
+        summary << "\nobservation, mean_loglik, ess_if_dropped\n";
+        for (size_t i = 0; i < observation_names_.size(); ++i) {
+            double mean = 0.0, total = 0.0;
+            for (size_t k = 0; k < N; ++k) {
+                if (!std::isfinite(terms_[k][i])) continue;
+                mean += base_weights_[k] * terms_[k][i];
+                total += base_weights_[k];
+            }
+            mean = total > 0.0 ? mean / total : std::numeric_limits<double>::quiet_NaN();
+            summary << observation_names_[i] << ", " << mean << ", " << drop_one_ess_[i] << "\n";
+        }
+    }
+
+    return after.write(settings_.pathname);
+}
@@ -0,0 +1,161 @@
+#include "PosteriorSummary.h"
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <numeric>
+
+CPosteriorSummary::CPosteriorSummary(const CParameterSpace& space,
+                                     const std::vector<std::vector<double>>& samples,
+                                     const std::vector<double>& weights)
+    : space_(space)
+{
+    const size_t n = space_.size();
+    for (size_t k = 0; k < samples.size(); ++k) {
+        if (samples[k].size() != n) continue;
+        double w = weights.empty() ? 1.0 : (k < weights.size() ? weights[k] : 0.0);
+        if (!(w > 0.0) || !std::isfinite(w)) continue;
+        samples_.push_back(samples[k]);
+        weights_.push_back(w);
+    }
+
+    const double total = std::accumulate(weights_.begin(), weights_.end(), 0.0);
+    for (double& w : weights_) w /= total;
+
+    order_.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        order_[i].resize(samples_.size());
+        std::iota(order_[i].begin(), order_[i].end(), 0);
+        std::stable_sort(order_[i].begin(), order_[i].end(),
+                         [this, i](size_t a, size_t b) { return samples_[a][i] < samples_[b][i]; });
+    }
+}
+
+double CPosteriorSummary::percentile(size_t index, double probability) const
+{
+    const std::vector<size_t>& order = order_[index];
+    if (order.empty()) return std::numeric_limits<double>::quiet_NaN();
+
+    // Piecewise-linear CDF through the midpoints of the sorted weights
+    double cumulative = 0.0;
+    double previous_position = 0.0;
+    double previous_value = samples_[order.front()][index];
+    for (size_t k = 0; k < order.size(); ++k) {
+        const double w = weights_[order[k]];
+        const double value = samples_[order[k]][index];
+        const double position = cumulative + 0.5 * w;
+        if (probability <= position) {
+            if (k == 0 || position <= previous_position) return value;
+            double f = (probability - previous_position) / (position - previous_position);
+            return previous_value + f * (value - previous_value);
+        }
+        cumulative += w;
+        previous_position = position;
+        previous_value = value;
+    }
+    return previous_value;
+}
+
+double CPosteriorSummary::mean(size_t index) const
+{
+    double m = 0.0;
+    for (size_t k = 0; k < samples_.size(); ++k) {
+        m += weights_[k] * samples_[k][index];
+    }
+    return samples_.empty() ? std::numeric_limits<double>::quiet_NaN() : m;
+}
+
+double CPosteriorSummary::stddev(size_t index) const
+{
+    const double m = mean(index);
+    double v = 0.0;
+    for (size_t k = 0; k < samples_.size(); ++k) {
+        const double d = samples_[k][index] - m;
+        v += weights_[k] * d * d;
+    }
+    return std::sqrt(v);
+}
+
+double CPosteriorSummary::effectiveSampleSize() const
+{
+    double sum_sq = 0.0;
+    for (double w : weights_) sum_sq += w * w;
+    return sum_sq > 0.0 ? 1.0 / sum_sq : 0.0;
+}
+
+bool CPosteriorSummary::writePercentiles(const std::string& filename) const
+{
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    const size_t n = space_.size();
+    file << "Statistic";
+    for (size_t i = 0; i < n; ++i) file << "," << space_.getName(i);
+    file << "\n";
+
+    for (double p : {0.025, 0.5, 0.975}) {
+        file << p;
+        for (size_t i = 0; i < n; ++i) file << "," << percentile(i, p);
+        file << "\n";
+    }
+    file << "mean";
+    for (size_t i = 0; i < n; ++i) file << "," << mean(i);
+    file << "\n";
+    return true;
+}
+
+bool CPosteriorSummary::writeDistributions(const std::string& filename, int bins) const
+{
+    std::ofstream file(filename);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    const size_t n = space_.size();
+    bins = std::max(1, bins);
+
+    // Bin centres and densities per parameter over the sampled range
+    std::vector<std::vector<double>> centers(n, std::vector<double>(bins, 0.0));
+    std::vector<std::vector<double>> density(n, std::vector<double>(bins, 0.0));
+    for (size_t i = 0; i < n && !samples_.empty(); ++i) {
+        double lo = space_.toSampling(i, samples_[order_[i].front()][i]);
+        double hi = space_.toSampling(i, samples_[order_[i].back()][i]);
+        if (!(hi > lo)) {
+            double pad = std::max(std::abs(lo) * 1e-6, 1e-12);
+            lo -= pad;
+            hi += pad;
+        }
+        const double width = (hi - lo) / bins;
+
+        for (size_t k = 0; k < samples_.size(); ++k) {
+            int b = static_cast<int>((space_.toSampling(i, samples_[k][i]) - lo) / width);
+            density[i][std::min(bins - 1, std::max(0, b))] += weights_[k];
+        }
+        for (int b = 0; b < bins; ++b) {
+            const double left = space_.fromSampling(i, lo + b * width);
+            const double right = space_.fromSampling(i, lo + (b + 1) * width);
+            centers[i][b] = space_.fromSampling(i, lo + (b + 0.5) * width);
+            density[i][b] /= (right - left);
+        }
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+        file << (i == 0 ? "" : ",") << "t, " << space_.getName(i);
+    }
+    file << "\n";
+    for (int b = 0; b < bins; ++b) {
+        for (size_t i = 0; i < n; ++i) {
+            file << (i == 0 ? "" : ",") << centers[i][b] << "," << density[i][b];
+        }
+        file << "\n";
+    }
+    return true;
+}
+
+bool CPosteriorSummary::write(const std::string& path) const
+{
+    return writePercentiles(path + "Posterior_Percentiles.txt") &&
+           writeDistributions(path + "Posterior_Distributions.txt");
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "ParameterSpace.h"
+
+/**
+ * @brief Marginal posterior summaries from a (weighted) parameter sample
+ *
+ * Writes the standard posterior files produced after MCMC:
+ * Posterior_Percentiles.txt (2.5%, 50%, 97.5% and mean of every
+ * parameter) and Posterior_Distributions.txt (marginal densities as
+ * "t, value" column pairs). Samplers other than CMCMC use it so their
+ * output can be read by the same downstream tools.
+ *
+ * Samples are rows of physical parameter values. Weights are optional and
+ * need not be normalized; an empty weight vector means equal weights.
+ * Histogram bins are equally spaced in the CParameterSpace sampling space,
+ * i.e. logarithmically for log-transformed parameters.
+ */
+class CPosteriorSummary
+{
+public:
+    CPosteriorSummary(const CParameterSpace& space,
+                      const std::vector<std::vector<double>>& samples,
+                      const std::vector<double>& weights = std::vector<double>());
+
+    size_t sampleCount() const { return samples_.size(); }
+
+    /**
+     * @brief Weighted percentile of a parameter
+     * @param probability In [0, 1]
+     */
+    double percentile(size_t index, double probability) const;
+
+    double mean(size_t index) const;
+    double stddev(size_t index) const;
+
+    /**
+     * @brief Kish effective sample size of the weights
+     */
+    double effectiveSampleSize() const;
+
+    bool writePercentiles(const std::string& filename) const;
+    bool writeDistributions(const std::string& filename, int bins = 80) const;
+
+    /**
+     * @brief Write Posterior_Percentiles.txt and Posterior_Distributions.txt to a directory
+     */
+    bool write(const std::string& path) const;
+
+private:
+    CParameterSpace space_;
+    std::vector<std::vector<double>> samples_;
+    std::vector<double> weights_;                 ///< Normalized to sum 1
+    std::vector<std::vector<size_t>> order_;      ///< Sample indices sorted by each parameter
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <utility>
+#include "ParameterSpace.h"
+
+#ifdef Q_GUI_SUPPORT
+class ProgressWindow;
+#endif
+
+/**
+ * @brief Settings for CProfileLikelihood
+ */
+struct ProfileLikelihoodSettings
+{
+    std::vector<std::string> parameters; ///< Parameters to profile (empty = all but error standard deviations)
+    int points = 21;                     ///< Grid points per parameter, evenly spaced over the range
+    int passes = 3;                      ///< Neighbour warm-start passes after the first
+    double confidence = 0.95;            ///< Level of the likelihood-ratio intervals
+    double tolerance = 1e-3;             ///< A pass improves a point if its objective rises by more than this
+    bool refine = true;                  ///< Re-optimize all parameters before profiling
+    int numthreads = 1;                  ///< Grid points optimized concurrently
+    std::string profiles_filename = "Profile_Likelihood.txt";
+    std::string outputfile = "Profile_Intervals.txt";
+    std::string pathname;                ///< Directory for output files
+};
+
+/**
+ * @brief Profile likelihood of selected parameters with likelihood-ratio confidence intervals
+ *
+ * For every profiled parameter the objective (log-likelihood) is maximized
+ * over the other parameters at each point of a grid over the parameter's
+ * range, using Levenberg-Marquardt (CMultiStartLM) with the profiled
+ * parameter fixed. Error standard deviations stay at their current values.
+ *
+ * All grid points of all parameters are optimized concurrently, each on its
+ * own model copy. The first pass starts every point from the overall
+ * optimum; each further pass restarts every point from the optimum of its
+ * better neighbour and keeps the result if it improves, so good solutions
+ * propagate along the profile while the points stay independent within a
+ * pass. Passes stop early when no point improves by more than tolerance.
+ * Results do not depend on the number of threads.
+ *
+ * The interval at the given confidence contains the values with
+ *   2 (l_max - l_p(theta)) <= chi2_1(confidence)
+ * found by linear interpolation of the root deviance between grid points
+ * (exact for a quadratic profile). An interval that reaches a bound of
+ * the range is reported as open on that side: the data do not constrain
+ * the parameter there (practical non-identifiability).
+ * If the profile finds a higher objective than the optimum, l_max is taken
+ * from the profile.
+ *
+ * Writes the profiles (value, objective, deviance and the re-optimized
+ * values of all parameters) to profiles_filename and the intervals to
+ * outputfile.
+ *
+ * @tparam T Model type as required by CMultiStartLM
+ */
+template<class T>
+class CProfileLikelihood
+{
+public:
+    /**
+     * @brief Profile of one parameter
+     */
+    struct Profile
+    {
+        size_t parameter = 0;                     ///< Index in the parameter set
+        std::vector<double> values;               ///< Grid, physical units
+        std::vector<double> objective;            ///< Maximized objective per grid point
+        std::vector<std::vector<double>> optima;  ///< Re-optimized parameters per grid point
+        double lower = 0.0;                       ///< Confidence interval, physical units
+        double upper = 0.0;
+        bool lower_open = false;                  ///< Interval reaches the lower bound
+        bool upper_open = false;
+    };
+
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CProfileLikelihood();
+    explicit CProfileLikelihood(T* model);
+
+    void SetModel(T* model) { model_ = model; }
+
+    // ========================================================================
+    // Settings
+    // ========================================================================
+
+    /**
+     * @brief Set a property by name (profile_* and lm_* keys plus numthreads, outputfile, pathname)
+     *
+     * profile_parameters takes a comma-separated list of parameter names;
+     * an empty value or "all" profiles every parameter except error
+     * standard deviations.
+     * @return true if the property is recognized
+     */
+    bool SetProperty(const std::string& prop, const std::string& value);
+
+    const ProfileLikelihoodSettings& GetSettings() const { return settings_; }
+
+    std::string getLastError() const { return last_error_; }
+
+#ifdef Q_GUI_SUPPORT
+    void SetProgressWindow(ProgressWindow* window) { rtw_ = window; }
+#endif
+
+    // ========================================================================
+    // Profiling
+    // ========================================================================
+
+    /**
+     * @brief Compute the profiles and intervals and write the output files
+     * @return false if the optimum cannot be evaluated, the run was
+     *         cancelled or output cannot be written
+     */
+    bool run();
+
+    // ========================================================================
+    // Results
+    // ========================================================================
+
+    const std::vector<Profile>& getProfiles() const { return profiles_; }
+    const std::vector<double>& getOptimum() const { return optimum_; }
+    double getMaxObjective() const { return max_objective_; }
+
+    /**
+     * @brief Deviance threshold chi2_1(confidence) of the intervals
+     */
+    double getThreshold() const { return threshold_; }
+
+    const std::vector<std::string>& getParamNames() const { return space_.getNames(); }
+    long getModelEvaluations() const { return evaluations_; }
+
+private:
+    /**
+     * @brief Optimum of the other parameters with one parameter fixed
+     */
+    struct Fit
+    {
+        std::vector<double> parameters;
+        double objective = 0.0;
+        long evaluations = 0;
+    };
+
+    Fit fit(size_t parameter, double value, const std::vector<double>& start) const;
+    bool runPasses();
+    void intervals();
+    bool writeOutput() const;
+
+    T* model_ = nullptr;
+    ProfileLikelihoodSettings settings_;
+    std::vector<std::pair<std::string, std::string>> lm_properties_;
+    CParameterSpace space_;
+    std::string last_error_;
+
+    std::vector<double> optimum_;
+    double max_objective_ = 0.0;
+    double threshold_ = 0.0;
+    std::vector<Profile> profiles_;
+    long evaluations_ = 0;
+
+#ifdef Q_GUI_SUPPORT
+    ProgressWindow* rtw_ = nullptr;
+#endif
+};
+
+#include "ProfileLikelihood.hpp"
@@ -0,0 +1,449 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <iomanip>
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <atomic>
+#include "MultiStartLM.h"
+#include "ParallelWorkers.h"
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#endif
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+template<class T>
+CProfileLikelihood<T>::CProfileLikelihood()
+{
+}
+
+template<class T>
+CProfileLikelihood<T>::CProfileLikelihood(T* model)
+    : model_(model)
+{
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+template<class T>
+bool CProfileLikelihood<T>::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "profile_parameters") {
+            std::vector<std::string> names;
+            if (!value.empty() && value != "all") {
+                std::stringstream ss(value);
+                std::string item;
+                while (std::getline(ss, item, ',')) {
+                    size_t first = item.find_first_not_of(" \t");
+                    size_t last = item.find_last_not_of(" \t");
+                    if (first != std::string::npos) names.push_back(item.substr(first, last - first + 1));
+                }
+            }
+            settings_.parameters = names;
+        }
+        else if (key == "profile_points") settings_.points = std::max(3, std::stoi(value));
+        else if (key == "profile_passes") settings_.passes = std::max(0, std::stoi(value));
+        else if (key == "profile_confidence") {
+            double confidence = std::stod(value);
+            if (!(confidence > 0.0 && confidence < 1.0)) throw std::invalid_argument(value);
+            settings_.confidence = confidence;
+        }
+        else if (key == "profile_tolerance") settings_.tolerance = std::max(0.0, std::stod(value));
+        else if (key == "profile_refine") settings_.refine = (value != "no" && value != "false" && value != "0");
+        else if (key == "profile_filename") settings_.profiles_filename = value;
+        else if (key == "numthreads") settings_.numthreads = std::max(1, std::stoi(value));
+        else if (key == "outputfile") settings_.outputfile = value;
+        else if (key == "pathname") settings_.pathname = value;
+        else if (key.rfind("lm_", 0) == 0) {
+            CMultiStartLM<T> check;
+            if (!check.SetProperty(key, value)) {
+                last_error_ = check.getLastError();
+                return false;
+            }
+            lm_properties_.emplace_back(key, value);
+        }
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Profiling
+// ============================================================================
+
+template<class T>
+bool CProfileLikelihood<T>::run()
+{
+    if (!model_) {
+        last_error_ = "No model assigned";
+        return false;
+    }
+
+    space_ = CParameterSpace(model_->Parameters());
+    profiles_.clear();
+    evaluations_ = 0;
+
+    // Parameters to profile
+    std::vector<size_t> selected;
+    if (settings_.parameters.empty()) {
+        for (size_t i = 0; i < space_.size(); ++i) {
+            if (!model_->isErrorStdParameter(i) && space_.getSamplingHigh(i) > space_.getSamplingLow(i)) {
+                selected.push_back(i);
+            }
+        }
+    }
+    else {
+        for (const std::string& name : settings_.parameters) {
+            const auto it = std::find(space_.getNames().begin(), space_.getNames().end(), name);
+            if (it == space_.getNames().end()) {
+                last_error_ = "Unknown parameter: " + name;
+                return false;
+            }
+            const size_t i = static_cast<size_t>(it - space_.getNames().begin());
+            if (!(space_.getSamplingHigh(i) > space_.getSamplingLow(i))) {
+                last_error_ = "Parameter " + name + " has no range to profile";
+                return false;
+            }
+            selected.push_back(i);
+        }
+    }
+    if (selected.empty()) {
+        last_error_ = "No parameters to profile";
+        return false;
+    }
+
+    // Overall optimum: a single Levenberg-Marquardt start from the current values
+    optimum_ = model_->getParameterValues();
+    if (settings_.refine) {
+#ifdef Q_GUI_SUPPORT
+        if (rtw_) {
+            rtw_->SetStatus("Refining optimum...");
+            rtw_->AppendLog("Refining optimum with Levenberg-Marquardt...");
+            QApplication::processEvents();
+        }
+#endif
+        CMultiStartLM<T> lm(model_);
+        for (const auto& property : lm_properties_) {
+            lm.SetProperty(property.first, property.second);
+        }
+        lm.SetProperty("lm_starts", "1");
+        lm.SetProperty("numthreads", "1");
+        lm.SetProperty("outputfile", "");
+        lm.SetStartingPoints({optimum_});
+        lm.optimize();
+        evaluations_ += lm.getModelEvaluations();
+        if (!lm.getFinalParams().empty()) {
+            optimum_ = lm.getFinalParams();
+        }
+    }
+
+    try {
+        T workspace = *model_;
+        workspace.setAllParameterValues(optimum_);
+        max_objective_ = workspace.GetObjectiveFunctionValue();
+        ++evaluations_;
+    }
+    catch (const std::exception& e) {
+        last_error_ = std::string("Forward run failed at the optimum: ") + e.what();
+        return false;
+    }
+    if (!std::isfinite(max_objective_)) {
+        last_error_ = "The objective at the optimum is not finite";
+        return false;
+    }
+
+    // Deviance threshold: P(chi2_1 <= q) = erf(sqrt(q / 2)) = confidence
+    double low = 0.0, high = 100.0;
+    for (int i = 0; i < 200; ++i) {
+        const double mid = 0.5 * (low + high);
+        (std::erf(std::sqrt(0.5 * mid)) < settings_.confidence ? low : high) = mid;
+    }
+    threshold_ = 0.5 * (low + high);
+
+    // Grids evenly spaced in the sampling space
+    const int n = settings_.points;
+    for (size_t i : selected) {
+        Profile profile;
+        profile.parameter = i;
+        const double lo = space_.getSamplingLow(i);
+        const double hi = space_.getSamplingHigh(i);
+        for (int j = 0; j < n; ++j) {
+            profile.values.push_back(space_.fromSampling(i, lo + (hi - lo) * j / (n - 1.0)));
+        }
+        profile.objective.assign(n, -std::numeric_limits<double>::infinity());
+        profile.optima.assign(n, optimum_);
+        profiles_.push_back(profile);
+    }
+
+    if (!runPasses()) {
+        return false;
+    }
+    intervals();
+
+    if (!writeOutput()) {
+        last_error_ = "Cannot write profile output to " + settings_.pathname;
+        return false;
+    }
+    return true;
+}
+
+template<class T>
+typename CProfileLikelihood<T>::Fit CProfileLikelihood<T>::fit(size_t parameter, double value,
+                                                                const std::vector<double>& start) const
+{
+    Fit result;
+    result.parameters = start;
+    result.parameters[parameter] = value;
+    result.objective = -std::numeric_limits<double>::infinity();
+
+    bool others = false;
+    for (size_t i = 0; i < space_.size() && !others; ++i) {
+        others = i != parameter && !model_->isErrorStdParameter(i) &&
+                 space_.getSamplingHigh(i) > space_.getSamplingLow(i);
+    }
+
+    try {
+        T model = *model_;
+        model.setAllParameterValues(result.parameters);
+        if (!others) {
+            result.objective = model.GetObjectiveFunctionValue();
+            result.evaluations = 1;
+            return result;
+        }
+
+        CMultiStartLM<T> lm(&model);
+        for (const auto& property : lm_properties_) {
+            lm.SetProperty(property.first, property.second);
+        }
+        lm.SetProperty("lm_starts", "1");
+        lm.SetProperty("numthreads", "1");
+        lm.SetProperty("outputfile", "");
+        lm.SetFixedParameters({parameter});
+        lm.SetStartingPoints({result.parameters});
+        lm.optimize();
+        result.evaluations = lm.getModelEvaluations();
+        if (!lm.getFinalParams().empty()) {
+            result.parameters = lm.getFinalParams();
+            result.objective = lm.getMaxFitness();
+        }
+    }
+    catch (const std::exception&) {
+        result.objective = -std::numeric_limits<double>::infinity();
+    }
+    if (!std::isfinite(result.objective)) {
+        result.objective = -std::numeric_limits<double>::infinity();
+    }
+    return result;
+}
+
+template<class T>
+bool CProfileLikelihood<T>::runPasses()
+{
+    const int n = settings_.points;
+    const int threads = std::max(1, settings_.numthreads);
+
+    // changed[k][j]: point j of profile k improved in the previous pass
+    std::vector<std::vector<char>> changed(profiles_.size(), std::vector<char>(n, 1));
+
+    for (int pass = 0; pass <= settings_.passes; ++pass) {
+        // Tasks of this pass with their starting points
+        std::vector<std::pair<size_t, int>> tasks;
+        std::vector<std::vector<double>> starts;
+        for (size_t k = 0; k < profiles_.size(); ++k) {
+            const Profile& profile = profiles_[k];
+            for (int j = 0; j < n; ++j) {
+                if (pass == 0) {
+                    tasks.emplace_back(k, j);
+                    starts.push_back(optimum_);
+                    continue;
+                }
+                const bool left = j > 0 && changed[k][j - 1];
+                const bool right = j + 1 < n && changed[k][j + 1];
+                if (!left && !right) continue;
+
+                // Better neighbour, whether or not it changed
+                int neighbour = -1;
+                for (int m : {j - 1, j + 1}) {
+                    if (m < 0 || m >= n || !std::isfinite(profile.objective[m])) continue;
+                    if (neighbour < 0 || profile.objective[m] > profile.objective[neighbour]) neighbour = m;
+                }
+                if (neighbour < 0) continue;
+                tasks.emplace_back(k, j);
+                starts.push_back(profile.optima[neighbour]);
+            }
+        }
+        if (tasks.empty()) {
+            break;
+        }
+
+        // Fits are handed out one at a time; once cancelled, the remaining ones are skipped
+        const long count = static_cast<long>(tasks.size());
+        std::vector<Fit> results(count);
+        std::atomic<bool> cancel{false};
+        std::atomic<long> done{0};
+#pragma omp parallel for schedule(dynamic) num_threads(threads)
+        for (long t = 0; t < count; ++t) {
+            if (cancel) continue;
+            const Profile& profile = profiles_[tasks[t].first];
+            results[t] = fit(profile.parameter, profile.values[tasks[t].second], starts[t]);
+            ++done;
+
+#ifdef Q_GUI_SUPPORT
+            if (rtw_ && currentWorker() == 0) {
+                rtw_->SetProgress((pass + static_cast<double>(done) / count) / (settings_.passes + 1));
+                QApplication::processEvents();
+                if (rtw_->IsCancelRequested()) {
+                    cancel = true;
+                }
+            }
+#endif
+        }
+        if (cancel) {
+#ifdef Q_GUI_SUPPORT
+            if (rtw_) rtw_->AppendLog("Profile likelihood cancelled by user.");
+#endif
+            last_error_ = "Cancelled by user";
+            return false;
+        }
+
+        // Keep improvements; all points of a pass started from the previous pass
+        for (auto& flags : changed) std::fill(flags.begin(), flags.end(), 0);
+        int improved = 0;
+        for (size_t t = 0; t < tasks.size(); ++t) {
+            evaluations_ += results[t].evaluations;
+            Profile& profile = profiles_[tasks[t].first];
+            const int j = tasks[t].second;
+            const bool better = !std::isfinite(profile.objective[j])
+                                    ? std::isfinite(results[t].objective)
+                                    : results[t].objective > profile.objective[j] + settings_.tolerance;
+            if (better) {
+                profile.objective[j] = results[t].objective;
+                profile.optima[j] = results[t].parameters;
+                changed[tasks[t].first][j] = 1;
+                if (pass > 0) ++improved;
+            }
+        }
+
+#ifdef Q_GUI_SUPPORT
+        if (rtw_) {
+            rtw_->AppendLog(pass == 0 ? QString("Pass 1: %1 grid points optimized from the optimum").arg(tasks.size())
+                                      : QString("Pass %1: %2 of %3 restarted points improved")
+                                            .arg(pass + 1).arg(improved).arg(tasks.size()));
+            QApplication::processEvents();
+        }
+#endif
+        if (pass > 0 && improved == 0) {
+            break;
+        }
+    }
+    return true;
+}
+
+template<class T>
+void CProfileLikelihood<T>::intervals()
+{
+    // A profile above the optimum means the optimum was not global
+    for (const Profile& profile : profiles_) {
+        for (size_t j = 0; j < profile.objective.size(); ++j) {
+            if (profile.objective[j] > max_objective_) {
+                max_objective_ = profile.objective[j];
+                optimum_ = profile.optima[j];
+            }
+        }
+    }
+
+    for (Profile& profile : profiles_) {
+        const size_t i = profile.parameter;
+        const int n = static_cast<int>(profile.values.size());
+        std::vector<double> u(n), deviance(n);
+        for (int j = 0; j < n; ++j) {
+            u[j] = space_.toSampling(i, profile.values[j]);
+            deviance[j] = 2.0 * (max_objective_ - profile.objective[j]);
+        }
+
+        // Region around the best grid point below the threshold. The crossing is
+        // interpolated in the root deviance, which is linear for a quadratic profile
+        const int best = static_cast<int>(std::min_element(deviance.begin(), deviance.end()) - deviance.begin());
+        auto crossing = [&](int inside, int outside) {
+            if (!std::isfinite(deviance[outside])) return u[inside];
+            const double root_in = std::sqrt(std::max(0.0, deviance[inside]));
+            const double root_out = std::sqrt(std::max(0.0, deviance[outside]));
+            const double f = (std::sqrt(threshold_) - root_in) / (root_out - root_in);
+            return u[inside] + std::min(1.0, std::max(0.0, f)) * (u[outside] - u[inside]);
+        };
+
+        int j = best;
+        while (j > 0 && deviance[j - 1] <= threshold_) --j;
+        profile.lower_open = j == 0;
+        profile.lower = space_.fromSampling(i, profile.lower_open ? u[0] : crossing(j, j - 1));
+
+        j = best;
+        while (j + 1 < n && deviance[j + 1] <= threshold_) ++j;
+        profile.upper_open = j == n - 1;
+        profile.upper = space_.fromSampling(i, profile.upper_open ? u[n - 1] : crossing(j, j + 1));
+    }
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+template<class T>
+bool CProfileLikelihood<T>::writeOutput() const
+{
+    std::ofstream file(settings_.pathname + settings_.profiles_filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << std::setprecision(10);
+    for (const Profile& profile : profiles_) {
+        file << "# " << space_.getName(profile.parameter) << "\n";
+        file << "value, objective, deviance";
+        for (const std::string& name : space_.getNames()) file << ", " << name;
+        file << "\n";
+        for (size_t j = 0; j < profile.values.size(); ++j) {
+            file << profile.values[j] << ", " << profile.objective[j] << ", "
+                 << 2.0 * (max_objective_ - profile.objective[j]);
+            for (double value : profile.optima[j]) file << ", " << value;
+            file << "\n";
+        }
+        file << "\n";
+    }
+
+    std::ofstream summary(settings_.pathname + settings_.outputfile);
+    if (!summary.is_open()) {
+        return false;
+    }
+    summary << std::setprecision(10);
+    summary << "# Likelihood-ratio intervals at confidence " << settings_.confidence
+            << " (deviance threshold " << threshold_ << ")\n";
+    summary << "# Maximum objective: " << max_objective_ << ", model evaluations: " << evaluations_ << "\n";
+    summary << "parameter, optimum, lower, upper, lower_open, upper_open\n";
+    for (const Profile& profile : profiles_) {
+        summary << space_.getName(profile.parameter) << ", " << optimum_[profile.parameter] << ", "
+                << profile.lower << ", " << profile.upper << ", " << (profile.lower_open ? "yes" : "no") << ", "
+                << (profile.upper_open ? "yes" : "no") << "\n";
+    }
+    return true;
+}
@@ -0,0 +1,158 @@
+#include "QuantileSketch.h"
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+// ============================================================================
+// P-square quantile
+// ============================================================================
+
+CP2Quantile::CP2Quantile(double probability)
+    : p_(probability)
+{
+    dn_[0] = 0.0;
+    dn_[1] = p_ / 2.0;
+    dn_[2] = p_;
+    dn_[3] = (1.0 + p_) / 2.0;
+    dn_[4] = 1.0;
+}
+
+void CP2Quantile::add(double x)
+{
+    if (count_ < 5) {
+        q_[count_++] = x;
+        if (count_ == 5) {
+            std::sort(q_, q_ + 5);
+            for (int i = 0; i < 5; ++i) {
+                n_[i] = i;
+                np_[i] = 4.0 * dn_[i];
+            }
+        }
+        return;
+    }
+
+    // Cell containing x; extremes move with the data
+    int k;
+    if (x < q_[0]) {
+        q_[0] = x;
+        k = 0;
+    }
+    else if (x >= q_[4]) {
+        q_[4] = x;
+        k = 3;
+    }
+    else {
+        k = 0;
+        while (k < 3 && x >= q_[k + 1]) ++k;
+    }
+
+    for (int i = k + 1; i < 5; ++i) n_[i] += 1.0;
+    for (int i = 0; i < 5; ++i) np_[i] += dn_[i];
+    ++count_;
+
+    for (int i = 1; i < 4; ++i) {
+        double d = np_[i] - n_[i];
+        if ((d >= 1.0 && n_[i + 1] - n_[i] > 1.0) || (d <= -1.0 && n_[i - 1] - n_[i] < -1.0)) {
+            int ds = d > 0 ? 1 : -1;
+            double candidate = parabolic(i, ds);
+            if (q_[i - 1] < candidate && candidate < q_[i + 1]) {
+                q_[i] = candidate;
+            }
+            else {
+                q_[i] = linear(i, ds);
+            }
+            n_[i] += ds;
+        }
+    }
+}
+
+double CP2Quantile::parabolic(int i, double d) const
+{
+    return q_[i] + d / (n_[i + 1] - n_[i - 1]) *
+                       ((n_[i] - n_[i - 1] + d) * (q_[i + 1] - q_[i]) / (n_[i + 1] - n_[i]) +
+                        (n_[i + 1] - n_[i] - d) * (q_[i] - q_[i - 1]) / (n_[i] - n_[i - 1]));
+}
+
+double CP2Quantile::linear(int i, int d) const
+{
+    return q_[i] + d * (q_[i + d] - q_[i]) / (n_[i + d] - n_[i]);
+}
+
+double CP2Quantile::value() const
+{
+    if (count_ >= 5) {
+        return q_[2];
+    }
+    if (count_ == 0) {
+        return 0.0;
+    }
+
+    // Exact interpolated quantile of the few values seen so far
+    std::vector<double> sorted(q_, q_ + count_);
+    std::sort(sorted.begin(), sorted.end());
+    double position = p_ * (count_ - 1);
+    int lower = static_cast<int>(std::floor(position));
+    int upper = std::min(lower + 1, static_cast<int>(count_ - 1));
+    return sorted[lower] + (position - lower) * (sorted[upper] - sorted[lower]);
+}
+
+// ============================================================================
+// Prediction bands
+// ============================================================================
+
+CPredictionBands::CPredictionBands(const std::vector<double>& probabilities)
+    : probabilities_(probabilities)
+{
+}
+
+void CPredictionBands::add(const TimeSeries<double>& realization)
+{
+    if (count_ == 0) {
+        times_.resize(realization.size());
+        for (size_t i = 0; i < realization.size(); ++i) {
+            times_[i] = realization.getTime(i);
+        }
+        mean_.assign(times_.size(), 0.0);
+        quantiles_.assign(times_.size(), std::vector<CP2Quantile>());
+        for (auto& point : quantiles_) {
+            for (double p : probabilities_) point.emplace_back(p);
+        }
+    }
+
+    ++count_;
+    const size_t n = std::min(times_.size(), static_cast<size_t>(realization.size()));
+    for (size_t i = 0; i < n; ++i) {
+        double value = realization.getValue(i);
+        mean_[i] += (value - mean_[i]) / count_;
+        for (auto& quantile : quantiles_[i]) {
+            quantile.add(value);
+        }
+    }
+}
+
+TimeSeriesSet<double> CPredictionBands::bands() const
+{
+    std::vector<std::string> names = seriesNames();
+    TimeSeriesSet<double> result(static_cast<int>(names.size()));
+    for (size_t j = 0; j < names.size(); ++j) {
+        result.setname(static_cast<int>(j), names[j]);
+    }
+
+    for (size_t i = 0; i < times_.size(); ++i) {
+        result[0].append(times_[i], mean_[i]);
+        for (size_t j = 0; j < probabilities_.size(); ++j) {
+            result[j + 1].append(times_[i], quantiles_[i][j].value());
+        }
+    }
+    return result;
+}
+
+std::vector<std::string> CPredictionBands::seriesNames() const
+{
+    // Same names as the percentile series of the legacy CMCMC output
+    std::vector<std::string> names = {"Mean"};
+    for (double p : probabilities_) {
+        names.push_back(std::to_string(p * 100.0) + " %");
+    }
+    return names;
+}
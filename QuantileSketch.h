@@ -0,0 +1,70 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "TimeSeries.h"
+#include "TimeSeriesSet.h"
+
+/**
+ * @brief Streaming estimate of a single quantile (P-square algorithm)
+ *
+ * Jain & Chlamtac (1985): five markers track the minimum, the target
+ * quantile, the maximum and two intermediate quantiles; marker heights are
+ * adjusted with piecewise-parabolic interpolation as values arrive. Memory
+ * is constant. Exact for fewer than five values.
+ */
+class CP2Quantile
+{
+public:
+    explicit CP2Quantile(double probability = 0.5);
+
+    void add(double x);
+    double value() const;
+    long count() const { return count_; }
+    double probability() const { return p_; }
+
+private:
+    double parabolic(int i, double d) const;
+    double linear(int i, int d) const;
+
+    double p_;
+    long count_ = 0;
+    double q_[5] = {0, 0, 0, 0, 0};     ///< Marker heights
+    double n_[5] = {0, 1, 2, 3, 4};     ///< Marker positions
+    double np_[5] = {0, 0, 0, 0, 0};    ///< Desired marker positions
+    double dn_[5] = {0, 0, 0, 0, 0};    ///< Desired position increments
+};
+
+/**
+ * @brief Streaming prediction bands over realizations sharing a time grid
+ *
+ * Keeps a running mean and one CP2Quantile per probability at every time
+ * point, so bands over any number of realizations use memory proportional
+ * to the grid length only. bands() returns the mean followed by one series
+ * per probability, the layout expected by SetPercentile95().
+ */
+class CPredictionBands
+{
+public:
+    explicit CPredictionBands(const std::vector<double>& probabilities = {0.025, 0.5, 0.975});
+
+    /**
+     * @brief Add a realization; the first one defines the time grid
+     */
+    void add(const TimeSeries<double>& realization);
+
+    long count() const { return count_; }
+    TimeSeriesSet<double> bands() const;
+
+    /**
+     * @brief Series names matching bands(): "Mean", "2.500000 %", ...
+     */
+    std::vector<std::string> seriesNames() const;
+
+private:
+    std::vector<double> probabilities_;
+    std::vector<double> times_;
+    std::vector<double> mean_;
+    std::vector<std::vector<CP2Quantile>> quantiles_;  ///< [time][probability]
+    long count_ = 0;
+};
@@ -0,0 +1,182 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <random>
+#include <armadillo>
+#include "ParameterSpace.h"
+
+#ifdef Q_GUI_SUPPORT
+class ProgressWindow;
+#endif
+
+/**
+ * @brief Settings for CSMCSampler
+ */
+struct SMCSettings
+{
+    int particles = 1000;                ///< Particles taken from the previous posterior (evenly thinned)
+    long burnin = 0;                     ///< Rows with sample_no <= burnin are skipped when loading
+    double ess_threshold = 0.5;          ///< Resample when ESS / particles falls below this
+    int move_steps = 5;                  ///< Metropolis moves per particle after resampling
+    double proposal_scale = 2.38;        ///< Proposal std factor (times sqrt(1/d) and the particle covariance)
+    int numthreads = 1;                  ///< Threads evaluating particles
+    unsigned long random_seed = 0;       ///< 0 = seed from random_device
+    std::string samples_filename = "smc_particles.txt";
+    std::string pathname;                ///< Directory for output files
+};
+
+/**
+ * @brief Sequential Monte Carlo update of a posterior for added observations
+ *
+ * Iterated batch importance sampling (Chopin, 2002). Particles from a
+ * previous posterior, e.g. the MCMC samples of last quarter's data, are
+ * reweighted by the likelihood ratio of the extended observation set to
+ * the old one. Since the prior cancels, the weight of a particle is
+ * exp(log_posterior_new - log_posterior_old), where the old value is the
+ * log_posterior stored with the sample. When the effective sample size
+ * drops below ess_threshold the particles are resampled (systematic
+ * resampling) and moved by move_steps random-walk Metropolis steps
+ * targeting the new posterior, with a proposal covariance taken from the
+ * particles. Only the model with the new observations is needed.
+ *
+ * Particle evaluations are independent and run in parallel on per-thread
+ * model copies. Each particle has its own random stream, so results do
+ * not depend on the number of threads.
+ *
+ * The particles are written in the layout they are loaded from (sample_no,
+ * parameters, log_posterior, weight), so the next update can start from
+ * them, together with the standard Posterior_Percentiles.txt and
+ * Posterior_Distributions.txt.
+ *
+ * @tparam T Model type providing Parameters(), setAllParameterValues(),
+ *           calculateLogLikelihood() and calculateLogPrior()
+ */
+template<class T>
+class CSMCSampler
+{
+public:
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CSMCSampler();
+    explicit CSMCSampler(T* model);
+
+    void SetModel(T* model) { model_ = model; }
+
+    // ========================================================================
+    // Settings
+    // ========================================================================
+
+    /**
+     * @brief Set a property by name (smc_* keys plus numthreads, pathname)
+     * @return true if the property is recognized
+     */
+    bool SetProperty(const std::string& prop, const std::string& value);
+
+    const SMCSettings& GetSettings() const { return settings_; }
+
+    std::string getLastError() const { return last_error_; }
+
+#ifdef Q_GUI_SUPPORT
+    void SetProgressWindow(ProgressWindow* window) { rtw_ = window; }
+#endif
+
+    // ========================================================================
+    // Particles
+    // ========================================================================
+
+    /**
+     * @brief Load previous posterior samples
+     *
+     * Accepts binary sample stores and text files with a header line
+     * (mcmc_samples.txt, smc_particles.txt). Parameters are matched by
+     * name; a log_posterior column is required, a weight column is used
+     * if present.
+     * @return false if the file cannot be read or lacks required columns
+     */
+    bool LoadParticles(const std::string& filename);
+
+    /**
+     * @brief Set particles directly
+     * @param samples Physical parameter values, one row per particle
+     * @param log_posterior Log-posterior of each particle under the old observations
+     * @param weights Optional unnormalized weights (empty = equal)
+     */
+    bool SetParticles(const std::vector<std::vector<double>>& samples,
+                      const std::vector<double>& log_posterior,
+                      const std::vector<double>& weights = std::vector<double>());
+
+    // ========================================================================
+    // Update
+    // ========================================================================
+
+    /**
+     * @brief Reweight, resample and move the particles for the current observations
+     * @return true if the update completed and output was written
+     */
+    bool update();
+
+    // ========================================================================
+    // Results
+    // ========================================================================
+
+    const std::vector<std::vector<double>>& getParticles() const { return particles_; }
+    const std::vector<double>& getWeights() const { return weights_; }
+
+    /**
+     * @brief Equally weighted copy of the particles (systematic resampling)
+     *
+     * For consumers that treat every sample alike, e.g. CPosteriorPredictive.
+     */
+    std::vector<std::vector<double>> getResampledParticles() const;
+
+    const std::vector<std::string>& getParamNames() const { return space_.getNames(); }
+
+    double getESSAfterReweighting() const { return ess_reweighted_; }
+    double getESS() const { return ess_final_; }
+    bool wasResampled() const { return resampled_; }
+    double getAcceptanceRate() const { return acceptance_rate_; }
+
+    /**
+     * @brief Log of the mean incremental weight, log p(new data | old data)
+     */
+    double getLogEvidenceIncrement() const { return log_evidence_increment_; }
+
+    long getModelEvaluations() const { return evaluations_; }
+    long getFailedRuns() const { return failed_runs_; }
+
+private:
+    double logPosterior(T& model, const std::vector<double>& x) const;
+    void evaluateAll(std::vector<double>& log_posterior);
+    void move();
+    double ess(const std::vector<double>& weights) const;
+    std::vector<size_t> systematicResample(double u) const;
+    bool writeOutput() const;
+
+    T* model_ = nullptr;
+    std::vector<T> workers_;
+    SMCSettings settings_;
+    CParameterSpace space_;
+    std::string last_error_;
+
+    std::vector<std::vector<double>> particles_;    ///< Physical values
+    std::vector<double> log_posterior_;             ///< Under the observations of the last evaluation
+    std::vector<double> weights_;                   ///< Normalized to sum 1
+
+    double ess_reweighted_ = 0.0;
+    double ess_final_ = 0.0;
+    bool resampled_ = false;
+    double acceptance_rate_ = 0.0;
+    double log_evidence_increment_ = 0.0;
+    long evaluations_ = 0;
+    long failed_runs_ = 0;
+    unsigned long seed_ = 0;
+
+#ifdef Q_GUI_SUPPORT
+    ProgressWindow* rtw_ = nullptr;
+#endif
+};
+
+#include "SMCSampler.hpp"
@@ -0,0 +1,442 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <iomanip>
+#include <algorithm>
+#include <fstream>
+#include "ParallelWorkers.h"
+#include "SampleStore.h"
+#include "PosteriorSummary.h"
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#endif
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+template<class T>
+CSMCSampler<T>::CSMCSampler()
+{
+}
+
+template<class T>
+CSMCSampler<T>::CSMCSampler(T* model)
+    : model_(model)
+{
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+template<class T>
+bool CSMCSampler<T>::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "smc_particles") settings_.particles = std::max(2, std::stoi(value));
+        else if (key == "smc_burnin") settings_.burnin = std::max(0L, std::stol(value));
+        else if (key == "smc_ess_threshold") settings_.ess_threshold = std::stod(value);
+        else if (key == "smc_move_steps") settings_.move_steps = std::max(0, std::stoi(value));
+        else if (key == "smc_proposal_scale") settings_.proposal_scale = std::max(1e-6, std::stod(value));
+        else if (key == "smc_random_seed") settings_.random_seed = std::stoul(value);
+        else if (key == "smc_samples_filename") settings_.samples_filename = value;
+        else if (key == "numthreads") settings_.numthreads = std::max(1, std::stoi(value));
+        else if (key == "pathname") settings_.pathname = value;
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Particles
+// ============================================================================
+
+template<class T>
+bool CSMCSampler<T>::LoadParticles(const std::string& filename)
+{
+    if (!model_) {
+        last_error_ = "No model assigned to SMC sampler";
+        return false;
+    }
+    space_ = CParameterSpace(model_->Parameters());
+
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> columns;
+    try {
+        readSampleTable(filename, names, columns);
+    }
+    catch (const std::exception& e) {
+        last_error_ = "Cannot read samples from " + filename + ": " + e.what();
+        return false;
+    }
+
+    auto find = [&names](const std::string& name) {
+        auto it = std::find(names.begin(), names.end(), name);
+        return it == names.end() ? -1 : static_cast<int>(it - names.begin());
+    };
+
+    std::vector<int> parameter_columns;
+    for (const std::string& name : space_.getNames()) {
+        int c = find(name);
+        if (c < 0) {
+            last_error_ = "Parameter " + name + " not found in " + filename;
+            return false;
+        }
+        parameter_columns.push_back(c);
+    }
+    const int logp_column = find("log_posterior");
+    if (logp_column < 0) {
+        last_error_ = "No log_posterior column in " + filename;
+        return false;
+    }
+    const int sample_column = find("sample_no");
+    const int weight_column = find("weight");
+
+    std::vector<size_t> rows;
+    const size_t total = columns.empty() ? 0 : columns[0].size();
+    for (size_t r = 0; r < total; ++r) {
+        if (sample_column < 0 || columns[sample_column][r] > settings_.burnin) rows.push_back(r);
+    }
+    if (rows.empty()) {
+        last_error_ = "No samples after burn-in in " + filename;
+        return false;
+    }
+
+    // Thin evenly to the requested number of particles
+    const size_t count = std::min<size_t>(rows.size(), settings_.particles);
+    std::vector<std::vector<double>> samples;
+    std::vector<double> log_posterior, weights;
+    for (size_t k = 0; k < count; ++k) {
+        const size_t r = rows[k * rows.size() / count];
+        std::vector<double> x;
+        for (int c : parameter_columns) x.push_back(columns[c][r]);
+        samples.push_back(x);
+        log_posterior.push_back(columns[logp_column][r]);
+        if (weight_column >= 0) weights.push_back(columns[weight_column][r]);
+    }
+    return SetParticles(samples, log_posterior, weights);
+}
+
+template<class T>
+bool CSMCSampler<T>::SetParticles(const std::vector<std::vector<double>>& samples,
+                                  const std::vector<double>& log_posterior,
+                                  const std::vector<double>& weights)
+{
+    if (samples.empty() || samples.size() != log_posterior.size() ||
+        (!weights.empty() && weights.size() != samples.size())) {
+        last_error_ = "Particles, log-posteriors and weights differ in number";
+        return false;
+    }
+
+    particles_ = samples;
+    log_posterior_ = log_posterior;
+    weights_ = weights.empty() ? std::vector<double>(samples.size(), 1.0) : weights;
+
+    double total = 0.0;
+    for (double& w : weights_) {
+        if (!(w > 0.0) || !std::isfinite(w)) w = 0.0;
+        total += w;
+    }
+    if (!(total > 0.0)) {
+        last_error_ = "All particle weights are zero";
+        return false;
+    }
+    for (double& w : weights_) w /= total;
+    return true;
+}
+
+// ============================================================================
+// Update
+// ============================================================================
+
+template<class T>
+bool CSMCSampler<T>::update()
+{
+    if (!model_) {
+        last_error_ = "No model assigned to SMC sampler";
+        return false;
+    }
+    space_ = CParameterSpace(model_->Parameters());
+    if (particles_.empty() || particles_[0].size() != space_.size()) {
+        last_error_ = "No particles matching the model parameters";
+        return false;
+    }
+
+    last_error_.clear();
+    evaluations_ = 0;
+    failed_runs_ = 0;
+    resampled_ = false;
+    acceptance_rate_ = 0.0;
+    workers_.assign(std::max(1, settings_.numthreads), *model_);
+
+    seed_ = settings_.random_seed;
+    if (seed_ == 0) {
+        seed_ = std::random_device{}();
+    }
+
+    const size_t N = particles_.size();
+
+#ifdef Q_GUI_SUPPORT
+    if (rtw_) {
+        rtw_->SetStatus("Reweighting particles...");
+        rtw_->AppendLog(QString("Evaluating %1 particles against the new observations...").arg(N));
+        QApplication::processEvents();
+    }
+#endif
+
+    // Reweight by the likelihood ratio; the prior cancels
+    std::vector<double> log_posterior_new;
+    evaluateAll(log_posterior_new);
+
+    std::vector<double> log_w(N);
+    double max_log_w = -std::numeric_limits<double>::infinity();
+    for (size_t k = 0; k < N; ++k) {
+        const double increment = log_posterior_new[k] - log_posterior_[k];
+        log_w[k] = weights_[k] > 0.0 && std::isfinite(increment) ? std::log(weights_[k]) + increment
+                                                                  : -std::numeric_limits<double>::infinity();
+        max_log_w = std::max(max_log_w, log_w[k]);
+    }
+    if (!std::isfinite(max_log_w)) {
+        last_error_ = "No particle has a finite likelihood under the new observations";
+        return false;
+    }
+
+    double total = 0.0;
+    for (size_t k = 0; k < N; ++k) {
+        weights_[k] = std::exp(log_w[k] - max_log_w);
+        total += weights_[k];
+    }
+    for (double& w : weights_) w /= total;
+    log_evidence_increment_ = max_log_w + std::log(total);
+    log_posterior_ = log_posterior_new;
+    ess_reweighted_ = ess(weights_);
+
+#ifdef Q_GUI_SUPPORT
+    if (rtw_) {
+        rtw_->SetProgress(1.0 / (settings_.move_steps + 1));
+        rtw_->AppendLog(QString("ESS after reweighting: %1 of %2").arg(ess_reweighted_, 0, 'f', 1).arg(N));
+        QApplication::processEvents();
+    }
+#endif
+
+    // Systematic resampling, then moves to restore diversity
+    if (ess_reweighted_ < settings_.ess_threshold * N) {
+        std::mt19937_64 rng(seed_);
+        std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+        std::vector<std::vector<double>> particles;
+        std::vector<double> log_posterior;
+        for (size_t source : systematicResample(unif(rng))) {
+            particles.push_back(particles_[source]);
+            log_posterior.push_back(log_posterior_[source]);
+        }
+        particles_.swap(particles);
+        log_posterior_.swap(log_posterior);
+        weights_.assign(N, 1.0 / N);
+        resampled_ = true;
+
+        move();
+    }
+    ess_final_ = ess(weights_);
+
+    if (!writeOutput()) {
+        last_error_ = "Cannot write SMC output to " + settings_.pathname;
+        return false;
+    }
+    return true;
+}
+
+template<class T>
+std::vector<size_t> CSMCSampler<T>::systematicResample(double u) const
+{
+    const size_t N = weights_.size();
+    std::vector<size_t> sources;
+    sources.reserve(N);
+    double cumulative = weights_.empty() ? 0.0 : weights_[0];
+    size_t source = 0;
+    for (size_t k = 0; k < N; ++k) {
+        const double position = (u + static_cast<double>(k)) / N;
+        while (position > cumulative && source + 1 < N) {
+            cumulative += weights_[++source];
+        }
+        sources.push_back(source);
+    }
+    return sources;
+}
+
+template<class T>
+std::vector<std::vector<double>> CSMCSampler<T>::getResampledParticles() const
+{
+    std::vector<std::vector<double>> particles;
+    for (size_t source : systematicResample(0.5)) {
+        particles.push_back(particles_[source]);
+    }
+    return particles;
+}
+
+template<class T>
+double CSMCSampler<T>::logPosterior(T& model, const std::vector<double>& x) const
+{
+    if (!space_.inBounds(x)) {
+        return -std::numeric_limits<double>::infinity();
+    }
+    try {
+        model.setAllParameterValues(x);
+        const double logp = model.calculateLogLikelihood() + model.calculateLogPrior();
+        return std::isfinite(logp) ? logp : -std::numeric_limits<double>::infinity();
+    }
+    catch (const std::exception&) {
+        return -std::numeric_limits<double>::infinity();
+    }
+}
+
+template<class T>
+void CSMCSampler<T>::evaluateAll(std::vector<double>& log_posterior)
+{
+    const int count = static_cast<int>(particles_.size());
+    log_posterior.assign(count, -std::numeric_limits<double>::infinity());
+
+    parallelForWorkers(workers_, 0, count, [&](T& worker, long k) {
+        log_posterior[k] = logPosterior(worker, particles_[k]);
+    });
+
+    evaluations_ += count;
+    for (double logp : log_posterior) {
+        if (!std::isfinite(logp)) ++failed_runs_;
+    }
+}
+
+template<class T>
+void CSMCSampler<T>::move()
+{
+    const size_t N = particles_.size();
+    const size_t n = space_.size();
+    const int count = static_cast<int>(N);
+    if (settings_.move_steps == 0 || n == 0) {
+        return;
+    }
+
+    // Proposal covariance from the resampled particles in sampling space
+    std::vector<std::vector<double>> u(N);
+    arma::mat U(n, N);
+    for (size_t k = 0; k < N; ++k) {
+        u[k] = space_.toSampling(particles_[k]);
+        for (size_t i = 0; i < n; ++i) U(i, k) = u[k][i];
+    }
+    arma::mat C = arma::cov(U.t());
+    for (size_t i = 0; i < n; ++i) {
+        const double width = space_.getSamplingHigh(i) - space_.getSamplingLow(i);
+        C(i, i) += 1e-10 * width * width;
+    }
+    arma::mat L;
+    if (!arma::chol(L, C)) {
+        L = arma::diagmat(arma::sqrt(arma::abs(arma::vec(C.diag()))));
+    }
+    else {
+        L = L.t();
+    }
+    L *= settings_.proposal_scale / std::sqrt(static_cast<double>(n));
+
+    std::vector<double> log_target(N);
+    for (size_t k = 0; k < N; ++k) {
+        log_target[k] = log_posterior_[k] + space_.logJacobian(u[k]);
+    }
+
+    long accepted = 0;
+    long proposed = 0;
+    for (int step = 0; step < settings_.move_steps; ++step) {
+        std::vector<char> moved(N, 0);
+
+        // Every particle has its own stream so results do not depend on the thread count
+        parallelForWorkers(workers_, 0, count, [&](T& worker, long k) {
+            std::seed_seq seq{static_cast<unsigned long>(seed_), static_cast<unsigned long>(step + 1),
+                              static_cast<unsigned long>(k)};
+            std::mt19937_64 rng(seq);
+            std::normal_distribution<double> normal(0.0, 1.0);
+            std::uniform_real_distribution<double> unif(0.0, 1.0);
+
+            arma::vec z(n);
+            for (size_t i = 0; i < n; ++i) z(i) = normal(rng);
+            const arma::vec du = L * z;
+            std::vector<double> proposal = u[k];
+            for (size_t i = 0; i < n; ++i) proposal[i] += du(i);
+            const double log_u = std::log(unif(rng));
+            if (!space_.inSamplingBounds(proposal)) return;
+
+            std::vector<double> x = space_.fromSampling(proposal);
+            const double logp = logPosterior(worker, x);
+            const double target = logp + space_.logJacobian(proposal);
+            if (std::isfinite(target) && log_u < target - log_target[k]) {
+                u[k] = proposal;
+                particles_[k] = x;
+                log_posterior_[k] = logp;
+                log_target[k] = target;
+                moved[k] = 1;
+            }
+        });
+
+        for (size_t k = 0; k < N; ++k) accepted += moved[k];
+        proposed += count;
+        evaluations_ += count;
+
+#ifdef Q_GUI_SUPPORT
+        if (rtw_) {
+            rtw_->AddPrimaryChartPoint(step + 1, static_cast<double>(accepted) / proposed);
+            rtw_->SetProgress(static_cast<double>(step + 2) / (settings_.move_steps + 1));
+            QApplication::processEvents();
+            if (rtw_->IsCancelRequested()) {
+                rtw_->AppendLog("Move steps cancelled by user; particles kept as they are.");
+                break;
+            }
+        }
+#endif
+    }
+    acceptance_rate_ = proposed > 0 ? static_cast<double>(accepted) / proposed : 0.0;
+}
+
+template<class T>
+double CSMCSampler<T>::ess(const std::vector<double>& weights) const
+{
+    double sum_sq = 0.0;
+    for (double w : weights) sum_sq += w * w;
+    return sum_sq > 0.0 ? 1.0 / sum_sq : 0.0;
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+template<class T>
+bool CSMCSampler<T>::writeOutput() const
+{
+    std::ofstream file(settings_.pathname + settings_.samples_filename);
+    if (!file.is_open()) {
+        return false;
+    }
+    file << "sample_no";
+    for (const std::string& name : space_.getNames()) file << ", " << name;
+    file << ", log_posterior, weight\n";
+    file << std::scientific << std::setprecision(8);
+    for (size_t k = 0; k < particles_.size(); ++k) {
+        file << k + 1;
+        for (double value : particles_[k]) file << ", " << value;
+        file << ", " << log_posterior_[k] << ", " << weights_[k] << "\n";
+    }
+
+    return CPosteriorSummary(space_, particles_, weights_).write(settings_.pathname);
+}
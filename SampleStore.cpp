@@ -0,0 +1,430 @@
+#include "SampleStore.h"
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char kMagic[8] = {'C', 'G', 'W', 'S', 'M', 'P', 'L', '\0'};
+const char kChunkTag[4] = {'C', 'H', 'N', 'K'};
+const uint32_t kVersion = 1;
+
+uint64_t toBits(double value)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+double fromBits(uint64_t bits)
+{
+    double value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+uint32_t readU32(const unsigned char* p)
+{
+    uint32_t value;
+    std::memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+/// PackBits: control byte h < 128 copies h+1 literals, h > 128 repeats the next byte 257-h times
+void packBits(const std::vector<unsigned char>& in, std::vector<unsigned char>& out)
+{
+    const size_t n = in.size();
+    size_t i = 0;
+    while (i < n) {
+        size_t j = i + 1;
+        while (j < n && j - i < 128 && in[j] == in[i]) ++j;
+        if (j - i >= 2) {
+            out.push_back(static_cast<unsigned char>(257 - (j - i)));
+            out.push_back(in[i]);
+            i = j;
+            continue;
+        }
+
+        j = i + 1;
+        while (j < n && j - i < 128 && !(j + 1 < n && in[j] == in[j + 1])) ++j;
+        out.push_back(static_cast<unsigned char>(j - i - 1));
+        out.insert(out.end(), in.begin() + i, in.begin() + j);
+        i = j;
+    }
+}
+
+bool unpackBits(const unsigned char* in, size_t size, unsigned char* out, size_t expected)
+{
+    size_t i = 0, o = 0;
+    while (i < size) {
+        unsigned int h = in[i++];
+        if (h < 128) {
+            size_t count = h + 1;
+            if (i + count > size || o + count > expected) return false;
+            std::memcpy(out + o, in + i, count);
+            i += count;
+            o += count;
+        }
+        else if (h > 128) {
+            size_t count = 257 - h;
+            if (i >= size || o + count > expected) return false;
+            std::memset(out + o, in[i++], count);
+            o += count;
+        }
+    }
+    return o == expected;
+}
+
+} // namespace
+
+// ============================================================================
+// Writer
+// ============================================================================
+
+CSampleStoreWriter::CSampleStoreWriter(const std::string& filename,
+                                       const std::vector<std::string>& columns,
+                                       bool append, size_t rows_per_chunk)
+    : columns_(columns)
+    , buffer_(columns.size())
+    , rows_per_chunk_(rows_per_chunk > 0 ? rows_per_chunk : 1)
+{
+    out_.open(filename, std::ios::binary | (append ? std::ios::app : std::ios::trunc));
+    if (!out_.is_open()) {
+        throw std::runtime_error("Cannot open sample store: " + filename);
+    }
+    for (auto& column : buffer_) column.reserve(rows_per_chunk_);
+
+    if (!append) {
+        out_.write(kMagic, sizeof(kMagic));
+        out_.write(reinterpret_cast<const char*>(&kVersion), sizeof(kVersion));
+        uint32_t n = static_cast<uint32_t>(columns_.size());
+        out_.write(reinterpret_cast<const char*>(&n), sizeof(n));
+        for (const auto& name : columns_) {
+            uint32_t length = static_cast<uint32_t>(name.size());
+            out_.write(reinterpret_cast<const char*>(&length), sizeof(length));
+            out_.write(name.data(), length);
+        }
+    }
+}
+
+CSampleStoreWriter::~CSampleStoreWriter()
+{
+    if (out_.is_open()) {
+        close();
+    }
+}
+
+void CSampleStoreWriter::append(const std::vector<double>& row)
+{
+    if (row.size() != columns_.size()) {
+        throw std::invalid_argument("Sample row has " + std::to_string(row.size()) +
+                                    " values, store has " + std::to_string(columns_.size()) + " columns");
+    }
+    for (size_t j = 0; j < row.size(); ++j) {
+        buffer_[j].push_back(row[j]);
+    }
+    if (++buffered_rows_ >= rows_per_chunk_) {
+        writeChunk();
+    }
+}
+
+void CSampleStoreWriter::flush()
+{
+    if (buffered_rows_ > 0) {
+        writeChunk();
+    }
+    out_.flush();
+}
+
+void CSampleStoreWriter::close()
+{
+    flush();
+    out_.close();
+}
+
+long long CSampleStoreWriter::bytesWritten()
+{
+    return static_cast<long long>(out_.tellp());
+}
+
+void CSampleStoreWriter::writeChunk()
+{
+    const size_t n = buffered_rows_;
+    std::vector<std::vector<unsigned char>> payloads(columns_.size());
+    std::vector<unsigned char> planes(n * 8);
+
+    for (size_t j = 0; j < columns_.size(); ++j) {
+        // XOR with the previous value; chunks start from zero so each decodes on its own
+        uint64_t previous = 0;
+        for (size_t i = 0; i < n; ++i) {
+            uint64_t bits = toBits(buffer_[j][i]);
+            uint64_t delta = bits ^ previous;
+            previous = bits;
+            for (size_t p = 0; p < 8; ++p) {
+                planes[p * n + i] = static_cast<unsigned char>(delta >> (8 * (7 - p)));
+            }
+        }
+        payloads[j].reserve(n);
+        packBits(planes, payloads[j]);
+        buffer_[j].clear();
+    }
+
+    uint32_t rows = static_cast<uint32_t>(n);
+    out_.write(kChunkTag, sizeof(kChunkTag));
+    out_.write(reinterpret_cast<const char*>(&rows), sizeof(rows));
+    for (const auto& payload : payloads) {
+        uint32_t size = static_cast<uint32_t>(payload.size());
+        out_.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    }
+    for (const auto& payload : payloads) {
+        out_.write(reinterpret_cast<const char*>(payload.data()), static_cast<std::streamsize>(payload.size()));
+    }
+    buffered_rows_ = 0;
+}
+
+// ============================================================================
+// Reader
+// ============================================================================
+
+CSampleStoreReader::CSampleStoreReader(const std::string& filename)
+{
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        throw std::runtime_error("Cannot open sample store: " + filename);
+    }
+    file_handle_ = file;
+    LARGE_INTEGER file_size;
+    GetFileSizeEx(file, &file_size);
+    size_ = static_cast<size_t>(file_size.QuadPart);
+    if (size_ > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            mapping_handle_ = mapping;
+            data_ = static_cast<const unsigned char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+        }
+    }
+#else
+    fd_ = ::open(filename.c_str(), O_RDONLY);
+    if (fd_ < 0) {
+        throw std::runtime_error("Cannot open sample store: " + filename);
+    }
+    struct stat info;
+    if (fstat(fd_, &info) == 0) {
+        size_ = static_cast<size_t>(info.st_size);
+    }
+    if (size_ > 0) {
+        void* mapped = mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd_, 0);
+        if (mapped != MAP_FAILED) {
+            data_ = static_cast<const unsigned char*>(mapped);
+        }
+    }
+#endif
+
+    const size_t header_size = sizeof(kMagic) + 2 * sizeof(uint32_t);
+    if (!data_ || size_ < header_size || std::memcmp(data_, kMagic, sizeof(kMagic)) != 0) {
+        unmap();
+        throw std::runtime_error("Not a sample store: " + filename);
+    }
+
+    size_t pos = sizeof(kMagic);
+    uint32_t version = readU32(data_ + pos);
+    pos += sizeof(uint32_t);
+    if (version != kVersion) {
+        unmap();
+        throw std::runtime_error("Unsupported sample store version " + std::to_string(version));
+    }
+    uint32_t n_columns = readU32(data_ + pos);
+    pos += sizeof(uint32_t);
+    for (uint32_t j = 0; j < n_columns; ++j) {
+        if (pos + sizeof(uint32_t) > size_) break;
+        uint32_t length = readU32(data_ + pos);
+        pos += sizeof(uint32_t);
+        if (pos + length > size_) break;
+        columns_.emplace_back(reinterpret_cast<const char*>(data_ + pos), length);
+        pos += length;
+    }
+    if (columns_.size() != n_columns) {
+        unmap();
+        throw std::runtime_error("Truncated sample store header: " + filename);
+    }
+
+    // Index chunks; stop at the first incomplete one
+    const size_t chunk_header = sizeof(kChunkTag) + sizeof(uint32_t) * (1 + n_columns);
+    while (pos + chunk_header <= size_ && std::memcmp(data_ + pos, kChunkTag, sizeof(kChunkTag)) == 0) {
+        Chunk chunk;
+        chunk.rows = readU32(data_ + pos + sizeof(kChunkTag));
+        chunk.first_row = rows_;
+        size_t payload = pos + chunk_header;
+        bool complete = true;
+        for (uint32_t j = 0; j < n_columns; ++j) {
+            size_t size = readU32(data_ + pos + sizeof(kChunkTag) + sizeof(uint32_t) * (1 + j));
+            if (payload + size > size_) {
+                complete = false;
+                break;
+            }
+            chunk.data.push_back(data_ + payload);
+            chunk.sizes.push_back(size);
+            payload += size;
+        }
+        if (!complete) break;
+        rows_ += chunk.rows;
+        chunks_.push_back(std::move(chunk));
+        pos = payload;
+    }
+}
+
+CSampleStoreReader::~CSampleStoreReader()
+{
+    unmap();
+}
+
+void CSampleStoreReader::unmap()
+{
+#ifdef _WIN32
+    if (data_) UnmapViewOfFile(data_);
+    if (mapping_handle_) CloseHandle(static_cast<HANDLE>(mapping_handle_));
+    if (file_handle_) CloseHandle(static_cast<HANDLE>(file_handle_));
+    mapping_handle_ = nullptr;
+    file_handle_ = nullptr;
+#else
+    if (data_) munmap(const_cast<unsigned char*>(data_), size_);
+    if (fd_ >= 0) ::close(fd_);
+    fd_ = -1;
+#endif
+    data_ = nullptr;
+}
+
+int CSampleStoreReader::findColumn(const std::string& name) const
+{
+    for (size_t j = 0; j < columns_.size(); ++j) {
+        if (columns_[j] == name) return static_cast<int>(j);
+    }
+    return -1;
+}
+
+std::vector<double> CSampleStoreReader::column(size_t index) const
+{
+    if (index >= columns_.size()) {
+        throw std::out_of_range("Sample store column index out of range");
+    }
+    std::vector<double> values(rows_);
+    for (const Chunk& chunk : chunks_) {
+        decodeColumn(chunk, index, values.data() + chunk.first_row);
+    }
+    return values;
+}
+
+void CSampleStoreReader::decodeColumn(const Chunk& chunk, size_t index, double* values) const
+{
+    const size_t n = chunk.rows;
+    std::vector<unsigned char> planes(n * 8);
+    if (!unpackBits(chunk.data[index], chunk.sizes[index], planes.data(), planes.size())) {
+        throw std::runtime_error("Corrupt chunk in sample store");
+    }
+
+    uint64_t previous = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t delta = 0;
+        for (size_t p = 0; p < 8; ++p) {
+            delta |= static_cast<uint64_t>(planes[p * n + i]) << (8 * (7 - p));
+        }
+        previous ^= delta;
+        values[i] = fromBits(previous);
+    }
+}
+
+void CSampleStoreReader::exportCSV(std::ostream& out) const
+{
+    for (size_t j = 0; j < columns_.size(); ++j) {
+        out << (j ? "," : "") << columns_[j];
+    }
+    out << "\n";
+
+    out << std::setprecision(std::numeric_limits<double>::max_digits10);
+    std::vector<std::vector<double>> values(columns_.size());
+    for (const Chunk& chunk : chunks_) {
+        for (size_t j = 0; j < columns_.size(); ++j) {
+            values[j].resize(chunk.rows);
+            decodeColumn(chunk, j, values[j].data());
+        }
+        for (size_t i = 0; i < chunk.rows; ++i) {
+            for (size_t j = 0; j < columns_.size(); ++j) {
+                out << (j ? "," : "") << values[j][i];
+            }
+            out << "\n";
+        }
+    }
+}
+
+bool CSampleStoreReader::isSampleStore(const std::string& filename)
+{
+    std::ifstream in(filename, std::ios::binary);
+    char magic[sizeof(kMagic)];
+    return in.read(magic, sizeof(magic)) && std::memcmp(magic, kMagic, sizeof(kMagic)) == 0;
+}
+
+void readSampleTable(const std::string& filename, std::vector<std::string>& names,
+                     std::vector<std::vector<double>>& columns)
+{
+    names.clear();
+    columns.clear();
+
+    if (CSampleStoreReader::isSampleStore(filename)) {
+        CSampleStoreReader store(filename);
+        names = store.columnNames();
+        for (size_t c = 0; c < names.size(); ++c) {
+            columns.push_back(store.column(c));
+        }
+        return;
+    }
+
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Cannot open " + filename);
+    }
+
+    auto split = [](const std::string& line) {
+        std::vector<std::string> fields;
+        std::stringstream ss(line);
+        std::string field;
+        while (std::getline(ss, field, ',')) {
+            size_t first = field.find_first_not_of(" \t\r");
+            size_t last = field.find_last_not_of(" \t\r");
+            fields.push_back(first == std::string::npos ? "" : field.substr(first, last - first + 1));
+        }
+        while (!fields.empty() && fields.back().empty()) fields.pop_back();
+        return fields;
+    };
+
+    std::string line;
+    while (std::getline(file, line) && (line.empty() || line[0] == '#')) {
+    }
+    names = split(line);
+    columns.resize(names.size());
+    while (std::getline(file, line)) {
+        std::vector<std::string> fields = split(line);
+        if (fields.size() < names.size()) continue;
+        for (size_t c = 0; c < names.size(); ++c) {
+            columns[c].push_back(std::stod(fields[c]));
+        }
+    }
+}
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Writer for the binary columnar sample store
+ *
+ * The file starts with a header (magic, version, column names) followed by
+ * self-delimiting chunks. Each chunk holds up to rows_per_chunk rows stored
+ * column by column; every column is compressed independently by XOR-ing
+ * the bit pattern of each value with its predecessor, transposing the bytes
+ * into eight planes and run-length encoding the result. Rejected MCMC
+ * proposals repeat the previous row, which then costs almost nothing.
+ *
+ * Rows are buffered in memory and written one chunk at a time, so the
+ * sampling loop does no formatting and at most one write per chunk.
+ * Because chunks are self-delimiting, a file truncated after any complete
+ * chunk is valid and can be appended to.
+ */
+class CSampleStoreWriter
+{
+public:
+    /**
+     * @brief Create a store, or append to an existing one
+     * @param filename Store file
+     * @param columns Column names, written to the header of a new file
+     * @param append Continue an existing file instead of creating a new one
+     * @param rows_per_chunk Rows buffered before a chunk is written
+     * @throws std::runtime_error if the file cannot be opened
+     */
+    CSampleStoreWriter(const std::string& filename, const std::vector<std::string>& columns,
+                       bool append = false, size_t rows_per_chunk = 4096);
+    ~CSampleStoreWriter();
+
+    /**
+     * @brief Append one row (must have one value per column)
+     */
+    void append(const std::vector<double>& row);
+
+    /**
+     * @brief Write buffered rows as a (possibly short) chunk
+     */
+    void flush();
+
+    void close();
+
+    /**
+     * @brief Bytes in the file after the last flush
+     */
+    long long bytesWritten();
+
+    size_t columnCount() const { return columns_.size(); }
+
+private:
+    void writeChunk();
+
+    std::vector<std::string> columns_;
+    std::vector<std::vector<double>> buffer_;  ///< [column][row]
+    size_t buffered_rows_ = 0;
+    size_t rows_per_chunk_;
+    std::ofstream out_;
+};
+
+/**
+ * @brief Memory-mapped reader for files written by CSampleStoreWriter
+ *
+ * Opening the store maps the file and indexes the chunk headers; columns
+ * are decompressed on request. An incomplete trailing chunk (e.g. from a
+ * run that was killed while writing) is ignored.
+ */
+class CSampleStoreReader
+{
+public:
+    /**
+     * @brief Map and index a store
+     * @throws std::runtime_error if the file is missing or not a sample store
+     */
+    explicit CSampleStoreReader(const std::string& filename);
+    ~CSampleStoreReader();
+
+    CSampleStoreReader(const CSampleStoreReader&) = delete;
+    CSampleStoreReader& operator=(const CSampleStoreReader&) = delete;
+
+    size_t columnCount() const { return columns_.size(); }
+    size_t rowCount() const { return rows_; }
+    const std::vector<std::string>& columnNames() const { return columns_; }
+
+    /**
+     * @brief Index of a column by name, or -1 if absent
+     */
+    int findColumn(const std::string& name) const;
+
+    /**
+     * @brief All values of one column
+     */
+    std::vector<double> column(size_t index) const;
+
+    /**
+     * @brief Write the store as comma-separated text with a header line
+     */
+    void exportCSV(std::ostream& out) const;
+
+    /**
+     * @brief Check whether a file starts with the sample store magic
+     */
+    static bool isSampleStore(const std::string& filename);
+
+private:
+    struct Chunk
+    {
+        size_t rows;
+        size_t first_row;
+        std::vector<const unsigned char*> data;  ///< Compressed column payloads
+        std::vector<size_t> sizes;
+    };
+
+    void decodeColumn(const Chunk& chunk, size_t index, double* values) const;
+    void unmap();
+
+    std::vector<std::string> columns_;
+    std::vector<Chunk> chunks_;
+    size_t rows_ = 0;
+
+    const unsigned char* data_ = nullptr;
+    size_t size_ = 0;
+#ifdef _WIN32
+    void* file_handle_ = nullptr;
+    void* mapping_handle_ = nullptr;
+#else
+    int fd_ = -1;
+#endif
+};
+
+/**
+ * @brief Read all columns of a sample file
+ *
+ * Accepts sample stores and comma-separated text with a header line of
+ * column names (mcmc_samples.txt, smc_particles.txt, ...). Comment lines
+ * starting with '#' before the header are skipped, as are incomplete rows.
+ * @throws std::runtime_error if the file cannot be opened or parsed
+ */
+void readSampleTable(const std::string& filename, std::vector<std::string>& names,
+                     std::vector<std::vector<double>>& columns);
@@ -0,0 +1,488 @@
+#include "ScenarioProjection.h"
+#include "ParallelWorkers.h"
+#include "ParameterSpace.h"
+#include "SampleStore.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <numeric>
+#include <sstream>
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#endif
+
+namespace {
+
+/// Weighted mean and 2.5, 50 and 97.5 percentiles
+struct Statistics
+{
+    double mean = 0.0;
+    double lower = 0.0;
+    double median = 0.0;
+    double upper = 0.0;
+};
+
+Statistics weightedStatistics(const std::vector<double>& values, const std::vector<double>& weights)
+{
+    Statistics statistics;
+    std::vector<size_t> order(values.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&values](size_t a, size_t b) { return values[a] < values[b]; });
+
+    const double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+    if (order.empty() || !(total > 0.0)) {
+        return statistics;
+    }
+    for (size_t k = 0; k < values.size(); ++k) {
+        statistics.mean += weights[k] * values[k] / total;
+    }
+
+    auto quantile = [&](double p) {
+        double cumulative = 0.0;
+        for (size_t k : order) {
+            cumulative += weights[k] / total;
+            if (cumulative >= p) return values[k];
+        }
+        return values[order.back()];
+    };
+    statistics.lower = quantile(0.025);
+    statistics.median = quantile(0.5);
+    statistics.upper = quantile(0.975);
+    return statistics;
+}
+
+} // namespace
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+CScenarioProjection::CScenarioProjection()
+{
+}
+
+CScenarioProjection::CScenarioProjection(CGWA* model)
+    : model_(model)
+{
+}
+
+bool CScenarioProjection::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "scenario_burnin") settings_.burnin = std::max(0L, std::stol(value));
+        else if (key == "scenario_max_samples") settings_.max_samples = std::max(1, std::stoi(value));
+        else if (key == "scenario_filename") settings_.projections_filename = value;
+        else if (key == "numthreads") settings_.numthreads = std::max(1, std::stoi(value));
+        else if (key == "outputfile") settings_.outputfile = value;
+        else if (key == "pathname") settings_.pathname = value;
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+// ============================================================================
+// Scenarios and samples
+// ============================================================================
+
+bool CScenarioProjection::LoadScenarios(const std::string& filename)
+{
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        last_error_ = "Cannot read scenarios from " + filename;
+        return false;
+    }
+    const std::filesystem::path directory = std::filesystem::path(filename).parent_path();
+
+    std::vector<Scenario> scenarios;
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        ++line_number;
+        std::istringstream tokens(line);
+        std::string name, tracer;
+        if (!(tokens >> name) || name[0] == '#') continue;
+
+        const std::string where = filename + ", line " + std::to_string(line_number);
+        if (!(tokens >> tracer)) {
+            last_error_ = "No tracer given in " + where;
+            return false;
+        }
+        if (name == "baseline") {
+            last_error_ = "The name baseline is reserved for the unchanged inputs (" + where + ")";
+            return false;
+        }
+
+        ScenarioInput input;
+        input.tracer = tracer;
+        std::string item;
+        while (tokens >> item) {
+            const size_t separator = item.find('=');
+            const std::string key = item.substr(0, separator);
+            const std::string value = separator == std::string::npos ? "" : item.substr(separator + 1);
+            try {
+                if (key == "input") {
+                    std::filesystem::path path(value);
+                    if (path.is_relative()) path = directory / path;
+                    input.input = TimeSeries<double>(path.string());
+                    if (input.input.size() == 0) {
+                        last_error_ = "Cannot read input " + path.string() + " in " + where;
+                        return false;
+                    }
+                }
+                else if (key == "scale") input.scale = std::stod(value);
+                else if (key == "from") input.from = std::stod(value);
+                else if (key == "ramp") input.ramp = std::max(0.0, std::stod(value));
+                else {
+                    last_error_ = "Unknown scenario setting " + key + " in " + where;
+                    return false;
+                }
+            }
+            catch (const std::exception&) {
+                last_error_ = "Invalid value '" + value + "' for " + key + " in " + where;
+                return false;
+            }
+        }
+
+        auto it = std::find_if(scenarios.begin(), scenarios.end(),
+                               [&name](const Scenario& scenario) { return scenario.name == name; });
+        if (it == scenarios.end()) {
+            scenarios.push_back(Scenario{name, {}});
+            it = scenarios.end() - 1;
+        }
+        it->inputs.push_back(input);
+    }
+
+    if (scenarios.empty()) {
+        last_error_ = "No scenarios in " + filename;
+        return false;
+    }
+    scenarios_.insert(scenarios_.end(), scenarios.begin(), scenarios.end());
+    return true;
+}
+
+bool CScenarioProjection::LoadSamples(const std::string& filename)
+{
+    if (!model_) {
+        last_error_ = "No model assigned";
+        return false;
+    }
+    const CParameterSpace space(model_->Parameters());
+
+    std::vector<std::string> names;
+    std::vector<std::vector<double>> columns;
+    try {
+        readSampleTable(filename, names, columns);
+    }
+    catch (const std::exception& e) {
+        last_error_ = "Cannot read samples from " + filename + ": " + e.what();
+        return false;
+    }
+
+    auto find = [&names](const std::string& name) {
+        auto it = std::find(names.begin(), names.end(), name);
+        return it == names.end() ? -1 : static_cast<int>(it - names.begin());
+    };
+
+    std::vector<int> parameter_columns;
+    for (const std::string& name : space.getNames()) {
+        int c = find(name);
+        if (c < 0) {
+            last_error_ = "Parameter " + name + " not found in " + filename;
+            return false;
+        }
+        parameter_columns.push_back(c);
+    }
+    const int sample_column = find("sample_no");
+    const int weight_column = find("weight");
+
+    std::vector<size_t> rows;
+    const size_t total = columns.empty() ? 0 : columns[0].size();
+    for (size_t r = 0; r < total; ++r) {
+        if (sample_column < 0 || columns[sample_column][r] > settings_.burnin) rows.push_back(r);
+    }
+    if (rows.empty()) {
+        last_error_ = "No samples after burn-in in " + filename;
+        return false;
+    }
+
+    // Thin evenly to the requested number of samples
+    const size_t count = std::min<size_t>(rows.size(), settings_.max_samples);
+    samples_.clear();
+    weights_.clear();
+    for (size_t k = 0; k < count; ++k) {
+        const size_t r = rows[k * rows.size() / count];
+        std::vector<double> x;
+        for (int c : parameter_columns) x.push_back(columns[c][r]);
+        samples_.push_back(x);
+        weights_.push_back(weight_column >= 0 ? std::max(0.0, columns[weight_column][r]) : 1.0);
+    }
+    return true;
+}
+
+void CScenarioProjection::SetSamples(const std::vector<std::vector<double>>& samples)
+{
+    samples_ = samples;
+    weights_.assign(samples.size(), 1.0);
+}
+
+// ============================================================================
+// Projection
+// ============================================================================
+
+double CScenarioProjection::InputFunction::operator()(double t, const TimeSeries<double>& own) const
+{
+    const double value = (series ? *series : own).interpol(t);
+    if (t < from) return value;
+    if (t < from + ramp) return value * (1.0 + (scale - 1.0) * (t - from) / ramp);
+    return value * scale;
+}
+
+bool CScenarioProjection::run()
+{
+    if (!model_) {
+        last_error_ = "No model assigned";
+        return false;
+    }
+    const ModelSettings& model_settings = model_->getSettings();
+    if (!model_settings.project_enabled) {
+        last_error_ = "Projections are not enabled in the project (project_start, project_end)";
+        return false;
+    }
+    if (samples_.empty()) {
+        last_error_ = "No posterior samples loaded";
+        return false;
+    }
+    if (scenarios_.empty()) {
+        last_error_ = "No scenarios defined";
+        return false;
+    }
+
+    // Scenario inputs per tracer; scenario 0 is the baseline
+    const size_t n_tracers = model_->getTracerCount();
+    std::vector<std::vector<InputFunction>> inputs(1, std::vector<InputFunction>(n_tracers));
+    scenario_names_ = {"baseline"};
+    for (const Scenario& scenario : scenarios_) {
+        std::vector<InputFunction> functions(n_tracers);
+        std::vector<bool> changed(n_tracers, false);
+        for (const ScenarioInput& input : scenario.inputs) {
+            const int j = model_->findTracer(input.tracer);
+            if (j < 0) {
+                last_error_ = "Unknown tracer " + input.tracer + " in scenario " + scenario.name;
+                return false;
+            }
+            if (changed[j]) {
+                last_error_ = "Tracer " + input.tracer + " is changed twice in scenario " + scenario.name;
+                return false;
+            }
+            changed[j] = true;
+            functions[j].series = input.input.size() > 0 ? &input.input : nullptr;
+            functions[j].scale = input.scale;
+            functions[j].from = input.from;
+            functions[j].ramp = input.ramp;
+        }
+        inputs.push_back(functions);
+        scenario_names_.push_back(scenario.name);
+    }
+
+    // Source tracers drive the young water of their daughters
+    std::vector<int> parents(n_tracers, -1);
+    for (size_t j = 0; j < n_tracers; ++j) {
+        const CTracer& tracer = model_->getTracer(j);
+        if (tracer.hasSourceTracer()) parents[j] = model_->findTracer(tracer.getSourceTracer()->getName());
+    }
+
+    // Same series and times as CGWA::runProjection()
+    series_names_.clear();
+    for (size_t w = 0; w < model_->getWellCount(); ++w) {
+        for (size_t j = 0; j < n_tracers; ++j) {
+            series_names_.push_back(model_->getWell(w).getName() + "_" + model_->getTracer(j).getName());
+        }
+    }
+    times_.clear();
+    for (double t = model_settings.project_start; t < model_settings.project_finish; t += model_settings.project_interval) {
+        times_.push_back(t);
+    }
+    if (times_.empty()) {
+        last_error_ = "The projection period contains no times";
+        return false;
+    }
+
+    const size_t n = samples_.size();
+    values_.assign(inputs.size(), std::vector<std::vector<std::vector<double>>>(
+                                      series_names_.size(), std::vector<std::vector<double>>(n)));
+    baseline_errors_.assign(n, 0.0);
+    std::vector<char> valid(n, 0);
+    evaluations_ = 0;
+    failed_samples_ = 0;
+
+    const int threads = std::max(1, settings_.numthreads);
+    const size_t batch = 8 * static_cast<size_t>(threads);
+    std::vector<CGWA> workspaces(threads, *model_);
+
+    bool cancelled = false;
+    for (size_t start = 0; start < n && !cancelled; start += batch) {
+        const size_t count = std::min(batch, n - start);
+
+        parallelForWorkers(workspaces, static_cast<long>(start), static_cast<long>(start + count),
+                           [&](CGWA& workspace, long k) {
+                               valid[k] = evaluate(workspace, k, inputs, parents) ? 1 : 0;
+                           });
+        evaluations_ += static_cast<long>(count);
+
+#ifdef Q_GUI_SUPPORT
+        if (rtw_) {
+            rtw_->SetProgress(static_cast<double>(start + count) / n);
+            QApplication::processEvents();
+            if (rtw_->IsCancelRequested()) {
+                rtw_->AppendLog("Scenario projection cancelled by user.");
+                cancelled = true;
+            }
+        }
+#endif
+    }
+
+    baseline_error_ = 0.0;
+    for (size_t k = 0; k < n; ++k) {
+        if (!valid[k]) ++failed_samples_;
+        else baseline_error_ = std::max(baseline_error_, baseline_errors_[k]);
+    }
+    if (cancelled) {
+        last_error_ = "Cancelled after " + std::to_string(evaluations_) + " samples";
+        return false;
+    }
+    if (failed_samples_ == static_cast<long>(n)) {
+        last_error_ = "All projection runs failed";
+        return false;
+    }
+
+    if (!writeOutput()) {
+        last_error_ = "Cannot write scenario output to " + settings_.pathname;
+        return false;
+    }
+    return true;
+}
+
+bool CScenarioProjection::evaluate(CGWA& workspace, size_t sample,
+                                   const std::vector<std::vector<InputFunction>>& inputs,
+                                   const std::vector<int>& parents)
+{
+    try {
+        // One projection run applies the parameters and builds the age distributions
+        workspace.setAllParameterValues(samples_[sample]);
+        const TimeSeriesSet<double> projected = workspace.runProjection();
+        const bool fixed_old = workspace.getSettings().fixed_old_tracer;
+
+        size_t q = 0;
+        for (size_t w = 0; w < workspace.getWellCount(); ++w) {
+            const CWell& well = workspace.getWell(w);
+            for (size_t j = 0; j < workspace.getTracerCount(); ++j, ++q) {
+                const TracerResponse response = workspace.getTracer(j).calculateResponse(
+                    well.getYoungAgeDistribution(), well.getFractionOld(), well.getVzDelay(),
+                    fixed_old, well.getAgeOld(), well.getFractionMineral());
+                const TimeSeries<double>& own = workspace.getTracer(j).getInput();
+                const int parent = parents[j];
+
+                for (size_t s = 0; s < inputs.size(); ++s) {
+                    std::vector<double>& values = values_[s][q][sample];
+                    values.assign(times_.size(), response.constant);
+                    for (size_t i = 0; i < times_.size(); ++i) {
+                        const double t = times_[i];
+                        for (size_t m = 0; m < response.lags.size(); ++m) {
+                            values[i] += response.weights[m] * inputs[s][j](t - response.lags[m], own);
+                        }
+                        if (parent < 0) continue;
+                        const TimeSeries<double>& parent_own = workspace.getTracer(parent).getInput();
+                        for (size_t m = 0; m < response.parent_lags.size(); ++m) {
+                            values[i] += response.parent_weights[m] *
+                                         inputs[s][parent](t - response.parent_lags[m], parent_own);
+                        }
+                    }
+                }
+
+                // The baseline convolution reproduces the projection run
+                if (q < projected.size()) {
+                    const std::vector<double>& baseline = values_[0][q][sample];
+                    for (size_t i = 0; i < baseline.size() && i < projected[q].size(); ++i) {
+                        baseline_errors_[sample] = std::max(baseline_errors_[sample],
+                                                            std::fabs(baseline[i] - projected[q].getValue(i)));
+                    }
+                }
+            }
+        }
+        return true;
+    }
+    catch (const std::exception&) {
+        for (auto& scenario : values_) {
+            for (auto& series : scenario) series[sample].clear();
+        }
+        return false;
+    }
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+bool CScenarioProjection::writeOutput() const
+{
+    std::ofstream projections(settings_.pathname + settings_.projections_filename);
+    std::ofstream summary(settings_.pathname + settings_.outputfile);
+    if (!projections.is_open() || !summary.is_open()) {
+        return false;
+    }
+    projections << std::setprecision(8);
+    summary << std::setprecision(8);
+
+    std::vector<size_t> used;
+    for (size_t k = 0; k < samples_.size(); ++k) {
+        if (!values_[0].empty() && !values_[0][0][k].empty()) used.push_back(k);
+    }
+    std::vector<double> weights;
+    for (size_t k : used) weights.push_back(weights_[k]);
+
+    summary << "# Scenario projections at t = " << (times_.empty() ? 0.0 : times_.back())
+            << " over " << used.size() << " samples (" << failed_samples_ << " failed)\n";
+    summary << "# Largest baseline deviation from the projection run: " << baseline_error_ << "\n";
+    summary << "scenario, series, mean, p2.5, p97.5, change_mean, change_p2.5, change_p97.5\n";
+
+    std::vector<double> values(used.size()), changes(used.size());
+    for (size_t s = 0; s < scenario_names_.size(); ++s) {
+        for (size_t q = 0; q < series_names_.size(); ++q) {
+            projections << "# " << scenario_names_[s] << ": " << series_names_[q] << "\n"
+                        << "t, mean, p2.5, p50, p97.5, change_mean, change_p2.5, change_p50, change_p97.5\n";
+            for (size_t i = 0; i < times_.size(); ++i) {
+                for (size_t u = 0; u < used.size(); ++u) {
+                    values[u] = values_[s][q][used[u]][i];
+                    changes[u] = values[u] - values_[0][q][used[u]][i];
+                }
+                const Statistics value = weightedStatistics(values, weights);
+                const Statistics change = weightedStatistics(changes, weights);
+                projections << times_[i] << ", " << value.mean << ", " << value.lower << ", " << value.median
+                            << ", " << value.upper << ", " << change.mean << ", " << change.lower << ", "
+                            << change.median << ", " << change.upper << "\n";
+                if (i + 1 == times_.size()) {
+                    summary << scenario_names_[s] << ", " << series_names_[q] << ", " << value.mean << ", "
+                            << value.lower << ", " << value.upper << ", " << change.mean << ", "
+                            << change.lower << ", " << change.upper << "\n";
+                }
+            }
+            projections << "\n";
+        }
+    }
+    return projections.good() && summary.good();
+}
@@ -0,0 +1,167 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <armadillo>
+#include "ParameterSpace.h"
+
+#ifdef Q_GUI_SUPPORT
+class ProgressWindow;
+#endif
+
+/**
+ * @brief Settings for CSensitivityMatrix
+ */
+struct SensitivityMatrixSettings
+{
+    std::string method = "central";      ///< central | forward | richardson
+    double step = 1e-2;                  ///< Largest step as a fraction of the range (sampling space)
+    int step_candidates = 4;             ///< Steps tried per parameter, each a quarter of the previous
+    int numthreads = 1;                  ///< Threads running forward models
+    std::string outputfile = "Sensitivity_Summary.txt";
+    std::string pathname;                ///< Directory for output files
+};
+
+/**
+ * @brief Jacobian of the weighted residuals and identifiability metrics at the current parameters
+ *
+ * Differentiates the weighted residuals (calculateWeightedResiduals()) with
+ * respect to the parameters in the CParameterSpace sampling space, so
+ * columns of log-transformed parameters are relative sensitivities. Error
+ * standard deviation parameters are skipped.
+ *
+ * Every parameter is perturbed with step_candidates steps h, h/4, h/16, ...
+ * (h = step times the range) and the step is chosen per parameter where
+ * successive difference quotients agree best, i.e. between the truncation
+ * error of large steps and the round-off or solver noise of small ones.
+ * Methods:
+ * - central: (r(u + h) - r(u - h)) / 2h
+ * - forward: (r(u + h) - r(u)) / h, half the runs of central
+ * - richardson: central differences at h and h/4 extrapolated to
+ *   fourth order, (16 D(h/4) - D(h)) / 15
+ * Near a bound the difference is taken one-sided towards the interior.
+ * All perturbed runs are independent and evaluated in parallel on
+ * per-thread model copies; the model itself is left unchanged.
+ *
+ * Identifiability metrics (Brun et al., 2001), from the sensitivities
+ * scaled by the parameter ranges:
+ * - importance: root-mean-square scaled sensitivity of each parameter,
+ * - collinearity index 1 / sqrt(lambda_min) of the column-normalized
+ *   sensitivities, for every pair, for all parameters together and for
+ *   all parameters but one (values above 10-15 indicate parameters that
+ *   cannot be identified jointly),
+ * - parameter correlation and standard errors from the Gauss-Newton
+ *   covariance (J^T J)^-1 (pseudo-inverse if singular).
+ *
+ * Writes Jacobian.txt (one row per residual, in observation order),
+ * Collinearity.txt, Parameter_Correlation.txt and a per-parameter summary
+ * (outputfile).
+ *
+ * @tparam T Model type providing Parameters(), getParameterValues(),
+ *           setAllParameterValues(), calculateWeightedResiduals() and
+ *           isErrorStdParameter()
+ */
+template<class T>
+class CSensitivityMatrix
+{
+public:
+    // ========================================================================
+    // Constructors
+    // ========================================================================
+
+    CSensitivityMatrix();
+    explicit CSensitivityMatrix(T* model);
+
+    void SetModel(T* model) { model_ = model; }
+
+    // ========================================================================
+    // Settings
+    // ========================================================================
+
+    /**
+     * @brief Set a property by name (sensitivity_* keys plus numthreads, outputfile, pathname)
+     * @return true if the property is recognized
+     */
+    bool SetProperty(const std::string& prop, const std::string& value);
+
+    const SensitivityMatrixSettings& GetSettings() const { return settings_; }
+
+    std::string getLastError() const { return last_error_; }
+
+#ifdef Q_GUI_SUPPORT
+    void SetProgressWindow(ProgressWindow* window) { rtw_ = window; }
+#endif
+
+    // ========================================================================
+    // Computation
+    // ========================================================================
+
+    /**
+     * @brief Compute the Jacobian and metrics at the current parameter values
+     * @return true if all columns were obtained and output was written
+     */
+    bool compute();
+
+    // ========================================================================
+    // Results (columns: varied parameters, see getParamNames())
+    // ========================================================================
+
+    std::vector<std::string> getParamNames() const;
+
+    const arma::mat& getJacobian() const { return jacobian_; }
+
+    /**
+     * @brief Chosen step per parameter in the sampling space
+     */
+    const std::vector<double>& getSteps() const { return steps_; }
+
+    const arma::vec& getImportance() const { return importance_; }
+    const arma::mat& getPairwiseCollinearity() const { return pairwise_collinearity_; }
+    double getCollinearityIndex() const { return collinearity_index_; }
+
+    /**
+     * @brief Collinearity index of all parameters but one, per left-out parameter
+     */
+    const arma::vec& getLeaveOneOutCollinearity() const { return leave_one_out_; }
+
+    const arma::mat& getCorrelation() const { return correlation_; }
+
+    /**
+     * @brief Gauss-Newton standard errors in the sampling space
+     */
+    const arma::vec& getStandardErrors() const { return std_errors_; }
+
+    long getModelEvaluations() const { return evaluations_; }
+
+private:
+    bool residuals(T& workspace, const std::vector<double>& u, arma::vec& r) const;
+    bool evaluateAll(const std::vector<std::vector<double>>& points, std::vector<arma::vec>& results, std::vector<char>& valid);
+    void identifiability();
+    double collinearity(const arma::mat& normalized, const std::vector<arma::uword>& columns) const;
+    bool writeOutput() const;
+
+    T* model_ = nullptr;
+    std::vector<T> workers_;
+    SensitivityMatrixSettings settings_;
+    CParameterSpace space_;
+    std::vector<size_t> free_;              ///< Varied parameters
+    std::vector<double> u0_;                ///< Current values, sampling space
+    std::string last_error_;
+
+    arma::mat jacobian_;
+    std::vector<double> steps_;
+    std::vector<bool> one_sided_;
+    arma::vec importance_;
+    arma::mat pairwise_collinearity_;
+    double collinearity_index_ = 0.0;
+    arma::vec leave_one_out_;
+    arma::mat correlation_;
+    arma::vec std_errors_;
+    long evaluations_ = 0;
+
+#ifdef Q_GUI_SUPPORT
+    ProgressWindow* rtw_ = nullptr;
+#endif
+};
+
+#include "SensitivityMatrix.hpp"
@@ -0,0 +1,409 @@
+#pragma once
+
+#include <cmath>
+#include <limits>
+#include <iomanip>
+#include <algorithm>
+#include <fstream>
+#include "ParallelWorkers.h"
+
+#ifdef Q_GUI_SUPPORT
+#include "ProgressWindow.h"
+#include <QApplication>
+#endif
+
+// ============================================================================
+// Constructors
+// ============================================================================
+
+template<class T>
+CSensitivityMatrix<T>::CSensitivityMatrix()
+{
+}
+
+template<class T>
+CSensitivityMatrix<T>::CSensitivityMatrix(T* model)
+    : model_(model)
+{
+}
+
+// ============================================================================
+// Settings
+// ============================================================================
+
+template<class T>
+bool CSensitivityMatrix<T>::SetProperty(const std::string& prop, const std::string& value)
+{
+    std::string key = prop;
+    std::transform(key.begin(), key.end(), key.begin(), ::tolower);
+
+    try {
+        if (key == "sensitivity_method") {
+            if (value != "central" && value != "forward" && value != "richardson") {
+                last_error_ = "Unknown difference method: " + value;
+                return false;
+            }
+            settings_.method = value;
+        }
+        else if (key == "sensitivity_step") settings_.step = std::min(0.5, std::max(1e-12, std::stod(value)));
+        else if (key == "sensitivity_step_candidates") settings_.step_candidates = std::max(1, std::stoi(value));
+        else if (key == "numthreads") settings_.numthreads = std::max(1, std::stoi(value));
+        else if (key == "outputfile") settings_.outputfile = value;
+        else if (key == "pathname") settings_.pathname = value;
+        else {
+            last_error_ = "Unknown property: " + prop;
+            return false;
+        }
+    }
+    catch (const std::exception&) {
+        last_error_ = "Invalid value '" + value + "' for property " + prop;
+        return false;
+    }
+
+    return true;
+}
+
+template<class T>
+std::vector<std::string> CSensitivityMatrix<T>::getParamNames() const
+{
+    std::vector<std::string> names;
+    for (size_t i : free_) names.push_back(space_.getName(i));
+    return names;
+}
+
+// ============================================================================
+// Computation
+// ============================================================================
+
+template<class T>
+bool CSensitivityMatrix<T>::residuals(T& workspace, const std::vector<double>& u, arma::vec& r) const
+{
+    try {
+        workspace.setAllParameterValues(space_.fromSampling(u));
+        r = arma::conv_to<arma::vec>::from(workspace.calculateWeightedResiduals());
+    }
+    catch (const std::exception&) {
+        return false;
+    }
+    return r.is_finite();
+}
+
+template<class T>
+bool CSensitivityMatrix<T>::evaluateAll(const std::vector<std::vector<double>>& points,
+                                        std::vector<arma::vec>& results, std::vector<char>& valid)
+{
+    const long n = static_cast<long>(points.size());
+    const int threads = static_cast<int>(workers_.size());
+    const long batch = 8L * threads;
+    results.assign(n, arma::vec());
+    valid.assign(n, 0);
+
+    for (long start = 0; start < n; start += batch) {
+        const long count = std::min(batch, n - start);
+
+        parallelForWorkers(workers_, start, start + count, [&](T& worker, long k) {
+            valid[k] = residuals(worker, points[k], results[k]);
+        });
+        evaluations_ += count;
+
+#ifdef Q_GUI_SUPPORT
+        if (rtw_) {
+            rtw_->SetProgress(0.9 * (start + count) / n);
+            QApplication::processEvents();
+            if (rtw_->IsCancelRequested()) {
+                rtw_->AppendLog("Sensitivity matrix cancelled by user.");
+                last_error_ = "Cancelled by user";
+                return false;
+            }
+        }
+#endif
+    }
+    return true;
+}
+
+template<class T>
+bool CSensitivityMatrix<T>::compute()
+{
+    if (!model_) {
+        last_error_ = "No model assigned";
+        return false;
+    }
+
+    space_ = CParameterSpace(model_->Parameters());
+    u0_ = space_.toSampling(model_->getParameterValues());
+    free_.clear();
+    for (size_t i = 0; i < space_.size(); ++i) {
+        if (!model_->isErrorStdParameter(i) && space_.getSamplingHigh(i) > space_.getSamplingLow(i)) {
+            free_.push_back(i);
+        }
+    }
+    if (free_.empty()) {
+        last_error_ = "No parameters with a range to vary";
+        return false;
+    }
+    evaluations_ = 0;
+
+    // Base point first, then every step candidate of every parameter
+    const int K = settings_.step_candidates;
+    std::vector<std::vector<double>> points(1, u0_);
+    std::vector<std::vector<long>> up(free_.size(), std::vector<long>(K, -1));
+    std::vector<std::vector<long>> down(free_.size(), std::vector<long>(K, -1));
+    std::vector<std::vector<double>> h(free_.size(), std::vector<double>(K));
+    for (size_t c = 0; c < free_.size(); ++c) {
+        const size_t i = free_[c];
+        const double lo = space_.getSamplingLow(i);
+        const double hi = space_.getSamplingHigh(i);
+        for (int k = 0; k < K; ++k) {
+            h[c][k] = settings_.step * (hi - lo) * std::pow(0.25, k);
+            const bool fits_up = u0_[i] + h[c][k] <= hi;
+            const bool fits_down = u0_[i] - h[c][k] >= lo;
+            if (fits_up) {
+                up[c][k] = static_cast<long>(points.size());
+                points.push_back(u0_);
+                points.back()[i] += h[c][k];
+            }
+            if (fits_down && (!fits_up || settings_.method != "forward")) {
+                down[c][k] = static_cast<long>(points.size());
+                points.push_back(u0_);
+                points.back()[i] -= h[c][k];
+            }
+        }
+    }
+
+#ifdef Q_GUI_SUPPORT
+    if (rtw_) {
+        rtw_->AppendLog(QString("Sensitivity matrix: %1 parameters, %2 forward runs (%3 differences, %4 steps each)")
+                            .arg(free_.size()).arg(points.size())
+                            .arg(QString::fromStdString(settings_.method)).arg(K));
+        QApplication::processEvents();
+    }
+#endif
+
+    workers_.assign(std::max(1, settings_.numthreads), *model_);
+    std::vector<arma::vec> results;
+    std::vector<char> valid;
+    if (!evaluateAll(points, results, valid)) {
+        return false;
+    }
+    if (!valid[0]) {
+        last_error_ = "Forward run failed at the current parameter values";
+        return false;
+    }
+    const arma::vec& r0 = results[0];
+
+    // Difference quotient of one step candidate; order 2 if central
+    auto quotient = [&](size_t c, int k, arma::vec& d, int& order) {
+        const long a = up[c][k], b = down[c][k];
+        const bool ok_up = a >= 0 && valid[a] && results[a].n_elem == r0.n_elem;
+        const bool ok_down = b >= 0 && valid[b] && results[b].n_elem == r0.n_elem;
+        if (ok_up && ok_down) { d = (results[a] - results[b]) / (2.0 * h[c][k]); order = 2; }
+        else if (ok_up) { d = (results[a] - r0) / h[c][k]; order = 1; }
+        else if (ok_down) { d = (r0 - results[b]) / h[c][k]; order = 1; }
+        else return false;
+        return true;
+    };
+
+    jacobian_.zeros(r0.n_elem, free_.size());
+    steps_.assign(free_.size(), 0.0);
+    one_sided_.assign(free_.size(), false);
+    for (size_t c = 0; c < free_.size(); ++c) {
+        std::vector<arma::vec> D(K);
+        std::vector<int> order(K, 0);
+        std::vector<bool> ok(K);
+        for (int k = 0; k < K; ++k) ok[k] = quotient(c, k, D[k], order[k]);
+
+        // Successive steps that agree best bracket the usable step range
+        int best = -1;
+        double best_change = std::numeric_limits<double>::infinity();
+        for (int k = 0; k + 1 < K; ++k) {
+            if (!ok[k] || !ok[k + 1]) continue;
+            const double scale = std::max(arma::norm(D[k + 1], 2), 1e-300);
+            const double change = arma::norm(D[k] - D[k + 1], 2) / scale;
+            if (change < best_change) {
+                best_change = change;
+                best = k;
+            }
+        }
+
+        if (best >= 0) {
+            const int k = best + 1;
+            if (settings_.method == "richardson") {
+                const double f = std::pow(4.0, std::min(order[best], order[k]));
+                jacobian_.col(c) = (f * D[k] - D[best]) / (f - 1.0);
+            }
+            else {
+                jacobian_.col(c) = D[k];
+            }
+            steps_[c] = h[c][k];
+            one_sided_[c] = order[k] < 2;
+            continue;
+        }
+
+        // A single usable step
+        int k = 0;
+        while (k < K && !ok[k]) ++k;
+        if (k == K) {
+            last_error_ = "Forward runs failed around the current values for " + space_.getName(free_[c]);
+            return false;
+        }
+        jacobian_.col(c) = D[k];
+        steps_[c] = h[c][k];
+        one_sided_[c] = order[k] < 2;
+    }
+
+    identifiability();
+
+#ifdef Q_GUI_SUPPORT
+    if (rtw_) {
+        rtw_->SetProgress(1.0);
+    }
+#endif
+
+    if (!writeOutput()) {
+        last_error_ = "Cannot write sensitivity output to " + settings_.pathname;
+        return false;
+    }
+    return true;
+}
+
+// ============================================================================
+// Identifiability
+// ============================================================================
+
+template<class T>
+double CSensitivityMatrix<T>::collinearity(const arma::mat& normalized, const std::vector<arma::uword>& columns) const
+{
+    arma::mat S(normalized.n_rows, columns.size());
+    for (size_t k = 0; k < columns.size(); ++k) S.col(k) = normalized.col(columns[k]);
+    arma::vec eigenvalues;
+    if (!arma::eig_sym(eigenvalues, S.t() * S) || !(eigenvalues(0) > 1e-300)) {
+        return std::numeric_limits<double>::infinity();
+    }
+    return 1.0 / std::sqrt(eigenvalues(0));
+}
+
+template<class T>
+void CSensitivityMatrix<T>::identifiability()
+{
+    const arma::uword d = free_.size();
+    const arma::uword n = jacobian_.n_rows;
+
+    // Sensitivities scaled by the parameter ranges, and unit-length columns
+    arma::mat scaled = jacobian_;
+    arma::mat normalized(n, d, arma::fill::zeros);
+    importance_.zeros(d);
+    for (arma::uword c = 0; c < d; ++c) {
+        scaled.col(c) *= space_.getSamplingHigh(free_[c]) - space_.getSamplingLow(free_[c]);
+        const double length = arma::norm(scaled.col(c), 2);
+        importance_(c) = n > 0 ? length / std::sqrt(static_cast<double>(n)) : 0.0;
+        if (length > 0.0) normalized.col(c) = scaled.col(c) / length;
+    }
+
+    pairwise_collinearity_.ones(d, d);
+    for (arma::uword a = 0; a < d; ++a) {
+        for (arma::uword b = a + 1; b < d; ++b) {
+            pairwise_collinearity_(a, b) = pairwise_collinearity_(b, a) = collinearity(normalized, {a, b});
+        }
+        if (!(arma::norm(normalized.col(a), 2) > 0.0)) {
+            pairwise_collinearity_(a, a) = std::numeric_limits<double>::infinity();
+        }
+    }
+
+    std::vector<arma::uword> all(d);
+    for (arma::uword c = 0; c < d; ++c) all[c] = c;
+    collinearity_index_ = collinearity(normalized, all);
+    leave_one_out_.ones(d);
+    if (d > 1) {
+        for (arma::uword c = 0; c < d; ++c) {
+            std::vector<arma::uword> rest = all;
+            rest.erase(rest.begin() + c);
+            leave_one_out_(c) = collinearity(normalized, rest);
+        }
+    }
+
+    // Gauss-Newton covariance; the pseudo-inverse leaves unidentified directions at zero
+    arma::mat covariance;
+    if (!arma::pinv(covariance, jacobian_.t() * jacobian_)) {
+        covariance.zeros(d, d);
+    }
+    std_errors_ = arma::sqrt(arma::abs(covariance.diag()));
+    correlation_.set_size(d, d);
+    for (arma::uword a = 0; a < d; ++a) {
+        for (arma::uword b = 0; b < d; ++b) {
+            const double denominator = std_errors_(a) * std_errors_(b);
+            correlation_(a, b) = denominator > 0.0 ? covariance(a, b) / denominator
+                                                   : std::numeric_limits<double>::quiet_NaN();
+        }
+    }
+}
+
+// ============================================================================
+// Output
+// ============================================================================
+
+template<class T>
+bool CSensitivityMatrix<T>::writeOutput() const
+{
+    const std::string& path = settings_.pathname;
+    auto header = [this](std::ofstream& file, const std::string& first) {
+        file << first;
+        for (size_t i : free_) file << ", " << space_.getName(i);
+        file << "\n";
+    };
+
+    std::ofstream jacobian(path + "Jacobian.txt");
+    if (!jacobian.is_open()) {
+        return false;
+    }
+    jacobian << std::setprecision(8);
+    jacobian << "# d(weighted residual) / d(parameter in sampling space)\n";
+    header(jacobian, "residual");
+    for (arma::uword r = 0; r < jacobian_.n_rows; ++r) {
+        jacobian << r + 1;
+        for (arma::uword c = 0; c < jacobian_.n_cols; ++c) jacobian << ", " << jacobian_(r, c);
+        jacobian << "\n";
+    }
+
+    std::ofstream collinearity(path + "Collinearity.txt");
+    if (!collinearity.is_open()) {
+        return false;
+    }
+    collinearity << std::setprecision(6);
+    collinearity << "# Pairwise collinearity indices; all parameters: " << collinearity_index_ << "\n";
+    header(collinearity, "parameter");
+    for (size_t a = 0; a < free_.size(); ++a) {
+        collinearity << space_.getName(free_[a]);
+        for (size_t b = 0; b < free_.size(); ++b) collinearity << ", " << pairwise_collinearity_(a, b);
+        collinearity << "\n";
+    }
+
+    std::ofstream correlation(path + "Parameter_Correlation.txt");
+    if (!correlation.is_open()) {
+        return false;
+    }
+    correlation << std::setprecision(6);
+    header(correlation, "parameter");
+    for (size_t a = 0; a < free_.size(); ++a) {
+        correlation << space_.getName(free_[a]);
+        for (size_t b = 0; b < free_.size(); ++b) correlation << ", " << correlation_(a, b);
+        correlation << "\n";
+    }
+
+    std::ofstream summary(path + settings_.outputfile);
+    if (!summary.is_open()) {
+        return false;
+    }
+    summary << std::setprecision(8);
+    summary << "# Sensitivity of the weighted residuals at the current parameter values\n";
+    summary << "# Method: " << settings_.method << ", model evaluations: " << evaluations_ << "\n";
+    summary << "# Collinearity index of all parameters: " << collinearity_index_ << "\n";
+    summary << "parameter, value, log_transformed, step, one_sided, importance, std_error, collinearity_without\n";
+    for (size_t c = 0; c < free_.size(); ++c) {
+        const size_t i = free_[c];
+        summary << space_.getName(i) << ", " << space_.fromSampling(i, u0_[i]) << ", "
+                << (space_.isLogTransformed(i) ? "yes" : "no") << ", " << steps_[c] << ", "
+                << (one_sided_[c] ? "yes" : "no") << ", " << importance_(c) << ", " << std_errors_(c) << ", "
+                << leave_one_out_(c) << "\n";
+    }
+    return true;
+}
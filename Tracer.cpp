@@ -1,6 +1,7 @@
 #include "Tracer.h"
 #include "Utilities.h"
 #include <cmath>
+#include <algorithm>
 #include <sstream>
 #include <iomanip>
 #include "Well.h"
@@ -170,6 +171,74 @@ double CTracer::calculateConcentration(double time, CWell *well, bool fixed_old_
     return young_component * (1.0 - well->getFractionOld()) + old_component * well->getFractionOld();
 }
 
+TracerResponse CTracer::calculateResponse(
+    const TimeSeries<double>& age_distribution,
+    double fraction_old,
+    double vz_delay,
+    bool fixed_old_conc,
+    double age_old,
+    double fraction_modern) const
+{
+    // Same terms as calculateConcentration(): the trapezoidal rule gives
+    // every age node half of each adjacent interval
+    TracerResponse response;
+    const double young = (1.0 - fraction_modern * fm_max_) * (1.0 - fraction_old);
+    const size_t n = age_distribution.size();
+
+    for (size_t i = 0; i < n && n > 1; ++i) {
+        const double age = age_distribution.getTime(i);
+        const double width = 0.5 * (age_distribution.getTime(std::min(i + 1, n - 1)) -
+                                    age_distribution.getTime(i > 0 ? i - 1 : 0));
+        const double pdf = age_distribution.getValue(i) * width * young;
+
+        if (!hasSourceTracer()) {
+            const double vz = vz_delay_ ? vz_delay : 0.0;
+            const double delay = retardation_ * (age + vz);
+            if (!linear_production_) {
+                response.lags.push_back(delay);
+                response.weights.push_back(input_multiplier_ * pdf * std::exp(-decay_rate_ * delay));
+            }
+            else {
+                response.lags.push_back(delay);
+                response.weights.push_back(input_multiplier_ * pdf);
+                response.constant += input_multiplier_ * pdf * decay_rate_ * delay;
+            }
+        }
+        else {
+            const CTracer& parent = *source_tracer_;
+            const double vz = parent.vz_delay_ ? vz_delay : 0.0;
+            response.parent_lags.push_back(parent.retardation_ * (age + vz));
+            response.parent_weights.push_back(
+                parent.input_multiplier_ * pdf *
+                (1.0 - std::exp(-parent.decay_rate_ * parent.retardation_ * age)) *
+                std::exp(-parent.decay_rate_ * parent.retardation_ * vz));
+        }
+    }
+
+    if (fraction_old != 0.0) {
+        const double vz = vz_delay_ ? vz_delay : 0.0;
+        const double old = (1.0 - fraction_modern * fm_max_) * fraction_old;
+        response.constant += fraction_modern * fm_max_ * c_modern_ * fraction_old;
+
+        if (fixed_old_conc) {
+            response.constant += old * c_old_;
+        }
+        else {
+            const double delay = retardation_ * (age_old + vz);
+            response.lags.push_back(delay);
+            if (!linear_production_) {
+                response.weights.push_back(old * input_multiplier_ * std::exp(-decay_rate_ * delay));
+            }
+            else {
+                response.weights.push_back(old * input_multiplier_);
+                response.constant += old * input_multiplier_ * decay_rate_ * delay;
+            }
+        }
+    }
+
+    return response;
+}
+
 // ============================================================================
 // Concentration Calculation - Helper Methods
 // ============================================================================
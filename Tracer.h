@@ -1,11 +1,32 @@
 #pragma once
 #include "TimeSeries.h"
 #include <string>
+#include <vector>
 #include <memory>
 #include <optional>
 
 class CWell;
 
+/**
+ * @brief Tracer concentration as a linear function of the tracer inputs
+ *
+ * For fixed well and tracer properties the concentration at time t is
+ *   constant + sum_i weights[i] * input(t - lags[i])
+ *            + sum_i parent_weights[i] * parent_input(t - parent_lags[i])
+ * where input is the tracer's own input series (before the input
+ * multiplier, which is part of the weights) and parent_input that of the
+ * source tracer. The terms reproduce calculateConcentration() node by node,
+ * so a response computed once can be applied to any modified input.
+ */
+struct TracerResponse
+{
+    std::vector<double> lags;            ///< Delay of each input sample
+    std::vector<double> weights;
+    std::vector<double> parent_lags;     ///< Terms driven by the source tracer's input
+    std::vector<double> parent_weights;
+    double constant = 0.0;               ///< Input-independent part (fixed old water, production)
+};
+
 /**
  * @brief Represents a tracer in groundwater with transport and transformation properties
  *
@@ -126,6 +147,18 @@ public:
 
 
     double calculateConcentration(double time, CWell *well, bool fixed_old_conc) const;
+
+    /**
+     * @brief Concentration as a linear function of the inputs (arguments as in calculateConcentration)
+     */
+    TracerResponse calculateResponse(
+        const TimeSeries<double>& age_distribution,
+        double fraction_old,
+        double vz_delay = 0.0,
+        bool fixed_old_conc = false,
+        double age_old = 100000.0,
+        double fraction_modern = 0.0) const;
+
 private:
     // ========================================================================
     // Private Helper Methods
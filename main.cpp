@@ -3,9 +3,9 @@
 #include "GWA.h"
 #include <iostream>
 #include <fstream>
-#include "GA.h"
-#include "MCMC.h"
-#include "levenbergmarquardt.h"
+#include "MCMCEngine.h"
+#include "SampleStore.h"
+#include "BatchRunner.h"
 
 void example_tracer_output()
 {
@@ -100,25 +100,124 @@ void example_during_optimization()
     std::cout << "Optimization progress logged to optimization_log.txt\n" << std::endl;
 }
 
-int main()
+// Continue an interrupted MCMC run: chronogw resume-mcmc <model file> <checkpoint>
+int resume_mcmc(const std::string& model_file, const std::string& checkpoint)
+{
+    CGWA system(model_file);
+    CMCMCEngine<CGWA> mcmc(&system);
+    if (!mcmc.Resume(checkpoint)) {
+        std::cerr << "Error: " << mcmc.getLastError() << std::endl;
+        return 1;
+    }
+    std::cout << "Resumed run finished with " << mcmc.GetSampleCount()
+              << " samples, acceptance rate " << mcmc.GetAcceptanceRate() << std::endl;
+    return 0;
+}
+
+// Convert a binary sample store to CSV: chronogw export-samples <store> <csv file>
+int export_samples(const std::string& store_file, const std::string& csv_file)
+{
+    CSampleStoreReader store(store_file);
+    std::ofstream out(csv_file);
+    if (!out.is_open()) {
+        std::cerr << "Error: cannot write " << csv_file << std::endl;
+        return 1;
+    }
+    store.exportCSV(out);
+    std::cout << "Exported " << store.rowCount() << " samples to " << csv_file << std::endl;
+    return 0;
+}
+
+void print_usage()
+{
+    std::cout <<
+        "Usage: chronogw <command> [options] <project|pattern|@list>...\n"
+        "\n"
+        "Commands:\n"
+        "  forward       Forward run, modeled observations to Modeled.txt\n"
+        "  project       Projection, projected series to Projected.txt\n"
+        "  ga            Genetic algorithm (settings from <project>.gasettings)\n"
+        "  lm            Multi-start Levenberg-Marquardt (lm_* keys of <project>.gasettings)\n"
+        "  mcmc          MCMC sampling (settings from <project>.mcmcsettings)\n"
+        "  sensitivity   Sensitivity matrix and identifiability (sensitivity_* keys of <project>.mcmcsettings)\n"
+        "  resume-mcmc <project> <checkpoint>   Continue an interrupted MCMC run\n"
+        "  export-samples <store> <csv file>    Convert a binary sample store to CSV\n"
+        "\n"
+        "Projects are .gwa files; * and ? in file names are expanded, and @list\n"
+        "reads one project or pattern per line. Each project writes to its own\n"
+        "<name>_<command>_output folder next to it, as in the GUI.\n"
+        "\n"
+        "Options:\n"
+        "  --jobs N          Projects run at once (default: one per core)\n"
+        "  --threads N       Threads per project (default: cores / jobs)\n"
+        "  --clean           Empty each output folder before its run\n"
+        "  --set key=value   Override a setting of the settings files (repeatable)\n"
+        "  --save-project    ga, lm: write the optimized values back to the project\n"
+        "  --global          sensitivity: Sobol/Morris (gsa_* keys) instead\n"
+        "  --summary FILE    Write one line per project to FILE\n";
+}
+
+// Run a command over projects: chronogw <command> [options] <projects>...
+int run_batch(int argc, char** argv)
+{
+    CBatchRunner batch;
+    batch.SetProperty("command", argv[1]);
+
+    for (int i = 2; i < argc; ++i) {
+        std::string argument = argv[i];
+        bool ok = true;
+        if (argument == "--jobs" || argument == "--threads" || argument == "--set" || argument == "--summary") {
+            if (i + 1 >= argc) {
+                std::cerr << "Error: " << argument << " needs a value" << std::endl;
+                return 1;
+            }
+            ok = batch.SetProperty(argument.substr(2), argv[++i]);
+        }
+        else if (argument == "--clean" || argument == "--global") {
+            ok = batch.SetProperty(argument.substr(2), "yes");
+        }
+        else if (argument == "--save-project") {
+            ok = batch.SetProperty("save_project", "yes");
+        }
+        else if (argument.rfind("--", 0) == 0) {
+            std::cerr << "Error: unknown option " << argument << std::endl;
+            return 1;
+        }
+        else {
+            ok = batch.AddProjects(argument);
+        }
+        if (!ok) {
+            std::cerr << "Error: " << batch.getLastError() << std::endl;
+            return 1;
+        }
+    }
+
+    const int failed = batch.run();
+    if (failed < 0) {
+        std::cerr << "Error: " << batch.getLastError() << std::endl;
+        return 1;
+    }
+    return failed > 0 ? 2 : 0;
+}
+
+int main(int argc, char** argv)
 {
     try {
-        CGWA system("../../Single_well.txt");
-        system.exportToFile("output/Inputfile.txt");
-        CGA<CGWA> ga(&system);
-        ga.SetProperty("maxpop","100");
-        ga.SetProperty("ngen", "100");
-        ga.SetProperty("pcross", "1");
-        ga.SetProperty("pmute","0.075");
-        ga.SetProperty("shakescale","0.05");
-        ga.SetProperty("shakescalered","75");
-        ga.SetProperty("outputfile","GA_Output.txt");
-
-        ga.optimize();
-        CMCMC<CGWA> mcmc(&system);
-        LevenbergMarquardt<CGWA> lm(&system);
-
-        return 0;
+        if (argc == 4 && std::string(argv[1]) == "resume-mcmc") {
+            return resume_mcmc(argv[2], argv[3]);
+        }
+        if (argc == 4 && std::string(argv[1]) == "export-samples") {
+            return export_samples(argv[2], argv[3]);
+        }
+
+        const std::string command = argc > 1 ? argv[1] : "";
+        if (command == "forward" || command == "project" || command == "ga" || command == "lm" ||
+            command == "mcmc" || command == "sensitivity") {
+            return run_batch(argc, argv);
+        }
+
+        print_usage();
+        return (command == "help" || command == "--help" || command == "-h") ? 0 : 1;
     }
     catch (const std::exception& e) {
         std::cerr << "Error: " << e.what() << std::endl;
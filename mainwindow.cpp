@@ -8,14 +8,22 @@
 #include <QGridLayout>
 #include <QLabel>
 #include <QWidget>
+#include <QDialog>
+#include <QDialogButtonBox>
+#include <QListWidget>
+#include <QCheckBox>
 #include "welldialog.h"
 #include "tracerdialog.h"
 #include "parameterdialog.h"
 #include "observationdialog.h"
 #include "chartwindow.h"
 #include <QStandardPaths>
+#include <QTimer>
 #include "GASettingsDialog.h"
 #include "MCMCSettingsDialog.h"
+#include "SampleStore.h"
+#include "PosteriorPredictive.h"
+#include "PosteriorSummary.h"
 
 
 MainWindow::MainWindow(QWidget *parent)
@@ -39,12 +47,87 @@ MainWindow::MainWindow(QWidget *parent)
     connect(ui->actionMCMC_Settings, &QAction::triggered, this, &MainWindow::onMCMCSettingsTriggered);
     connect(ui->actionDeterministic_GA, &QAction::triggered, this, &MainWindow::onRunDeterministicGA);
     connect(ui->actionBayesian_MCMC, &QAction::triggered, this, &MainWindow::onRunMCMC);
+
+    QAction* actionCMAES = new QAction("CMA-ES Optimization", this);
+    QList<QAction*> gaActions = ui->menuParameter_Estimation->actions();
+    int gaIndex = gaActions.indexOf(ui->actionDeterministic_GA);
+    ui->menuParameter_Estimation->insertAction(gaActions.value(gaIndex + 1, nullptr), actionCMAES);
+    connect(actionCMAES, &QAction::triggered, this, &MainWindow::onRunCMAES);
+
+    QAction* actionIslandGA = new QAction("Island-Model GA", this);
+    ui->menuParameter_Estimation->insertAction(gaActions.value(gaIndex + 1, nullptr), actionIslandGA);
+    connect(actionIslandGA, &QAction::triggered, this, &MainWindow::onRunIslandGA);
+
+    QAction* actionResumeCMAES = new QAction("Resume CMA-ES from Checkpoint...", this);
+    ui->menuParameter_Estimation->insertAction(gaActions.value(gaIndex + 1, nullptr), actionResumeCMAES);
+    connect(actionResumeCMAES, &QAction::triggered, this, &MainWindow::onResumeCMAES);
+
+    QAction* actionResumeIslandGA = new QAction("Resume Island GA from Checkpoint...", this);
+    ui->menuParameter_Estimation->insertAction(gaActions.value(gaIndex + 1, nullptr), actionResumeIslandGA);
+    connect(actionResumeIslandGA, &QAction::triggered, this, &MainWindow::onResumeIslandGA);
+
+    QAction* actionMultiStartLM = new QAction("Multi-Start Levenberg-Marquardt", this);
+    ui->menuParameter_Estimation->insertAction(gaActions.value(gaIndex + 1, nullptr), actionMultiStartLM);
+    connect(actionMultiStartLM, &QAction::triggered, this, &MainWindow::onRunMultiStartLM);
+
+    QAction* actionResumeMCMC = new QAction("Resume MCMC from Checkpoint...", this);
+    QList<QAction*> estimationActions = ui->menuParameter_Estimation->actions();
+    int mcmcIndex = estimationActions.indexOf(ui->actionBayesian_MCMC);
+    ui->menuParameter_Estimation->insertAction(estimationActions.value(mcmcIndex + 1, nullptr), actionResumeMCMC);
+    connect(actionResumeMCMC, &QAction::triggered, this, &MainWindow::onResumeMCMC);
+
+    QAction* actionExportSamples = new QAction("Export MCMC Samples to CSV...", this);
+    ui->menuParameter_Estimation->insertAction(estimationActions.value(mcmcIndex + 1, nullptr), actionExportSamples);
+    connect(actionExportSamples, &QAction::triggered, this, &MainWindow::onExportMCMCSamples);
+
+    QAction* actionLaplace = new QAction("Laplace Approximation (fast uncertainty)", this);
+    ui->menuParameter_Estimation->insertAction(estimationActions.value(mcmcIndex + 1, nullptr), actionLaplace);
+    connect(actionLaplace, &QAction::triggered, this, &MainWindow::onRunLaplace);
+
+    QAction* actionESMDA = new QAction("Ensemble Smoother (ES-MDA)", this);
+    ui->menuParameter_Estimation->insertAction(estimationActions.value(mcmcIndex + 1, nullptr), actionESMDA);
+    connect(actionESMDA, &QAction::triggered, this, &MainWindow::onRunESMDA);
+
+    QAction* actionSMC = new QAction("Update Posterior with New Data (SMC)...", this);
+    ui->menuParameter_Estimation->insertAction(estimationActions.value(mcmcIndex + 1, nullptr), actionSMC);
+    connect(actionSMC, &QAction::triggered, this, &MainWindow::onRunSMCUpdate);
+
+    QAction* actionReweight = new QAction("What-if Reweighting of Posterior Samples...", this);
+    ui->menuParameter_Estimation->insertAction(estimationActions.value(mcmcIndex + 1, nullptr), actionReweight);
+    connect(actionReweight, &QAction::triggered, this, &MainWindow::onReweightPosterior);
+
+    QAction* actionGSA = new QAction("Global Sensitivity Analysis (Sobol/Morris)", this);
+    ui->menuParameter_Estimation->insertAction(estimationActions.value(mcmcIndex + 1, nullptr), actionGSA);
+    connect(actionGSA, &QAction::triggered, this, &MainWindow::onRunGlobalSensitivity);
+
+    QAction* actionSensitivityMatrix = new QAction("Sensitivity Matrix and Identifiability", this);
+    ui->menuParameter_Estimation->insertAction(estimationActions.value(mcmcIndex + 1, nullptr), actionSensitivityMatrix);
+    connect(actionSensitivityMatrix, &QAction::triggered, this, &MainWindow::onRunSensitivityMatrix);
+
+    QAction* actionProfile = new QAction("Profile Likelihood...", this);
+    ui->menuParameter_Estimation->insertAction(estimationActions.value(mcmcIndex + 1, nullptr), actionProfile);
+    connect(actionProfile, &QAction::triggered, this, &MainWindow::onRunProfileLikelihood);
+
+    QAction* actionScenario = new QAction("Scenario Projections...", this);
+    ui->menuParameter_Estimation->insertAction(estimationActions.value(mcmcIndex + 1, nullptr), actionScenario);
+    connect(actionScenario, &QAction::triggered, this, &MainWindow::onRunScenarioProjection);
     connect(ui->actionAbout, &QAction::triggered, this, &MainWindow::onAbout);
     recentFilesMenu = new QMenu("Recent Projects", this);
     ui->actionRecent_Projects->setMenu(recentFilesMenu);
     updateRecentFilesMenu();
 
     ga = CGA<CGWA>(&gwaModel);
+    cmaes = CCMAES<CGWA>(&gwaModel);
+    islandGA.SetModel(&gwaModel);
+    multiStartLM.SetModel(&gwaModel);
+    laplace.SetModel(&gwaModel);
+    esmda.SetModel(&gwaModel);
+    smc.SetModel(&gwaModel);
+    reweighting.SetModel(&gwaModel);
+    gsa.SetModel(&gwaModel);
+    sensitivityMatrix.SetModel(&gwaModel);
+    profileLikelihood.SetModel(&gwaModel);
+    scenarioProjection.SetModel(&gwaModel);
 
 }
 
@@ -187,6 +270,7 @@ void MainWindow::onOpenFile()
 
         // Create fresh MCMC object linked to the loaded model
         mcmc = CMCMC<CGWA>(&gwaModel);
+        mcmcEngine = CMCMCEngine<CGWA>(&gwaModel);
 
         // Load GA settings if available
         QString gaFile = getGASettingsFilename(fileName);
@@ -332,6 +416,7 @@ void MainWindow::onRecentFileTriggered()
 
             // Create fresh MCMC object linked to the loaded model
             mcmc = CMCMC<CGWA>(&gwaModel);
+            mcmcEngine = CMCMCEngine<CGWA>(&gwaModel);
 
             // Load GA settings if available
             QString gaFile = getGASettingsFilename(filePath);
@@ -963,6 +1048,35 @@ void MainWindow::saveGASettings(const QString& filename)
     file << "shakescale " << ga.getShakeScale() << "\n";
     file << "shakescalered " << ga.getShakeScaleRed() << "\n";
     file << "numthreads " << ga.getNumThreads() << "\n";
+    file << "fitness_cache_size " << fitnessCacheSize_ << "\n";
+
+    // CMA-ES settings; budget and threads are taken from the GA at run time
+    const CMAESSettings& cmaesSettings = cmaes.GetSettings();
+    file << "cmaes_max_evaluations " << cmaesSettings.max_evaluations << "\n";
+    file << "cmaes_population " << cmaesSettings.population << "\n";
+    file << "cmaes_sigma0 " << cmaesSettings.sigma0 << "\n";
+    file << "cmaes_restarts " << cmaesSettings.restarts << "\n";
+    file << "cmaes_population_increase " << cmaesSettings.population_increase << "\n";
+    file << "cmaes_tolfun " << cmaesSettings.tolfun << "\n";
+    file << "cmaes_tolx " << cmaesSettings.tolx << "\n";
+    file << "cmaes_checkpoint_interval " << cmaesSettings.checkpoint_interval << "\n";
+
+    // Island GA settings; the GA keys above are taken from the GA at run time
+    const IslandGASettings& islandSettings = islandGA.GetSettings();
+    file << "island_count " << islandSettings.islands << "\n";
+    file << "island_migration_interval " << islandSettings.migration_interval << "\n";
+    file << "island_migrants " << islandSettings.migrants << "\n";
+    file << "island_checkpoint_interval " << islandSettings.checkpoint_interval << "\n";
+
+    // Multi-start Levenberg-Marquardt settings; threads are taken from the GA at run time
+    const MultiStartLMSettings& lmSettings = multiStartLM.GetSettings();
+    file << "lm_starts " << lmSettings.starts << "\n";
+    file << "lm_max_iterations " << lmSettings.max_iterations << "\n";
+    file << "lm_lambda0 " << lmSettings.lambda0 << "\n";
+    file << "lm_tolerance " << lmSettings.tolerance << "\n";
+    file << "lm_step_tolerance " << lmSettings.step_tolerance << "\n";
+    file << "lm_jacobian_step " << lmSettings.jacobian_step << "\n";
+    file << "lm_dedup_tolerance " << lmSettings.dedup_tolerance << "\n";
 
     file.close();
 }
@@ -1010,6 +1124,89 @@ void MainWindow::saveMCMCSettings(const QString& filename)
         out << "continue_based_on_file_name " << QString::fromStdString(settings.continue_filename) << "\n";
     }
 
+    // Adaptive sampler settings (CMCMCEngine)
+    const MCMCEngineSettings& engineSettings = mcmcEngine.GetSettings();
+    out << "sampler " << QString::fromStdString(engineSettings.sampler) << "\n";
+    out << "initial_covariance_weight " << engineSettings.initial_covariance_weight << "\n";
+    out << "adaptation_decay " << engineSettings.adaptation_decay << "\n";
+    out << "dream_pairs " << engineSettings.dream_pairs << "\n";
+    out << "dream_crossover_values " << engineSettings.dream_crossover_values << "\n";
+    out << "dream_archive_interval " << engineSettings.dream_archive_interval << "\n";
+    out << "pt_temperatures " << engineSettings.pt_temperatures << "\n";
+    out << "pt_initial_spacing " << engineSettings.pt_initial_spacing << "\n";
+    out << "pt_swap_interval " << engineSettings.pt_swap_interval << "\n";
+    out << "pt_swap_rate " << engineSettings.pt_swap_rate << "\n";
+    out << "nuts_max_depth " << engineSettings.nuts_max_depth << "\n";
+    out << "nuts_target_accept " << engineSettings.nuts_target_accept << "\n";
+    out << "nuts_metric " << QString::fromStdString(engineSettings.nuts_metric) << "\n";
+    out << "nuts_finite_differences " << (engineSettings.nuts_finite_differences ? "yes" : "no") << "\n";
+    out << "early_rejection " << (engineSettings.early_rejection ? "yes" : "no") << "\n";
+    out << "delayed_acceptance " << (engineSettings.delayed_acceptance ? "yes" : "no") << "\n";
+    out << "surrogate " << QString::fromStdString(engineSettings.surrogate) << "\n";
+    out << "surrogate_max_points " << engineSettings.surrogate_max_points << "\n";
+    out << "surrogate_refit_interval " << engineSettings.surrogate_refit_interval << "\n";
+    out << "diagnostics_interval " << engineSettings.diagnostics_interval << "\n";
+    out << "diagnostics_max_draws " << engineSettings.diagnostics_max_draws << "\n";
+    out << "stop_rhat " << engineSettings.stop_rhat << "\n";
+    out << "stop_min_ess " << engineSettings.stop_min_ess << "\n";
+    out << "checkpoint_interval " << engineSettings.checkpoint_interval << "\n";
+    out << "samples_format " << QString::fromStdString(engineSettings.samples_format) << "\n";
+    out << "async_output " << (engineSettings.async_output ? "yes" : "no") << "\n";
+    out << "store_observation_loglik " << (engineSettings.store_observation_loglik ? "yes" : "no") << "\n";
+    if (engineSettings.random_seed != 0) {
+        out << "random_seed " << engineSettings.random_seed << "\n";
+    }
+
+    // Laplace approximation; realizations and threads follow the settings above
+    const LaplaceSettings& laplaceSettings = laplace.GetSettings();
+    out << "laplace_samples " << laplaceSettings.number_of_samples << "\n";
+    out << "laplace_refine " << (laplaceSettings.refine ? "yes" : "no") << "\n";
+    out << "laplace_jacobian_step " << laplaceSettings.jacobian_step << "\n";
+
+    // Ensemble smoother; realizations and threads follow the settings above
+    const ESMDASettings& esmdaSettings = esmda.GetSettings();
+    out << "esmda_ensemble_size " << esmdaSettings.ensemble_size << "\n";
+    out << "esmda_assimilations " << esmdaSettings.assimilations << "\n";
+    out << "esmda_inflation_ratio " << esmdaSettings.inflation_ratio << "\n";
+
+    // SMC update; burn-in, realizations and threads follow the settings above
+    const SMCSettings& smcSettings = smc.GetSettings();
+    out << "smc_particles " << smcSettings.particles << "\n";
+    out << "smc_ess_threshold " << smcSettings.ess_threshold << "\n";
+    out << "smc_move_steps " << smcSettings.move_steps << "\n";
+    out << "smc_proposal_scale " << smcSettings.proposal_scale << "\n";
+
+    // What-if reweighting; the observation changes are chosen per analysis
+    const ReweightingSettings& reweightSettings = reweighting.GetSettings();
+    out << "reweight_max_samples " << reweightSettings.max_samples << "\n";
+    out << "reweight_min_ess_fraction " << reweightSettings.min_ess_fraction << "\n";
+
+    // Global sensitivity analysis; threads follow the settings above
+    const GSASettings& gsaSettings = gsa.GetSettings();
+    out << "gsa_method " << QString::fromStdString(gsaSettings.method) << "\n";
+    out << "gsa_base_samples " << gsaSettings.base_samples << "\n";
+    out << "gsa_bootstrap " << gsaSettings.bootstrap << "\n";
+    out << "gsa_morris_trajectories " << gsaSettings.morris_trajectories << "\n";
+    out << "gsa_morris_levels " << gsaSettings.morris_levels << "\n";
+    out << "gsa_projections " << (gsaSettings.projections ? "yes" : "no") << "\n";
+
+    // Local sensitivity matrix; threads follow the settings above
+    const SensitivityMatrixSettings& sensitivitySettings = sensitivityMatrix.GetSettings();
+    out << "sensitivity_method " << QString::fromStdString(sensitivitySettings.method) << "\n";
+    out << "sensitivity_step " << sensitivitySettings.step << "\n";
+    out << "sensitivity_step_candidates " << sensitivitySettings.step_candidates << "\n";
+
+    // Profile likelihood; threads follow the settings above
+    const ProfileLikelihoodSettings& profileSettings = profileLikelihood.GetSettings();
+    out << "profile_points " << profileSettings.points << "\n";
+    out << "profile_passes " << profileSettings.passes << "\n";
+    out << "profile_confidence " << profileSettings.confidence << "\n";
+    out << "profile_tolerance " << profileSettings.tolerance << "\n";
+    out << "profile_refine " << (profileSettings.refine ? "yes" : "no") << "\n";
+
+    // Scenario projections; burn-in and threads follow the settings above
+    out << "scenario_max_samples " << scenarioProjection.GetSettings().max_samples << "\n";
+
     file.close();
 }
 
@@ -1040,6 +1237,31 @@ void MainWindow::loadMCMCSettings(const QString& filename)
             QString value = tokens[1];
 
             mcmc.SetProperty(key.toStdString(), value.toStdString());
+            mcmcEngine.SetProperty(key.toStdString(), value.toStdString());
+            if (key.startsWith("laplace_")) {
+                laplace.SetProperty(key.toStdString(), value.toStdString());
+            }
+            if (key.startsWith("esmda_")) {
+                esmda.SetProperty(key.toStdString(), value.toStdString());
+            }
+            if (key.startsWith("smc_")) {
+                smc.SetProperty(key.toStdString(), value.toStdString());
+            }
+            if (key.startsWith("reweight_")) {
+                reweighting.SetProperty(key.toStdString(), value.toStdString());
+            }
+            if (key.startsWith("gsa_")) {
+                gsa.SetProperty(key.toStdString(), value.toStdString());
+            }
+            if (key.startsWith("sensitivity_")) {
+                sensitivityMatrix.SetProperty(key.toStdString(), value.toStdString());
+            }
+            if (key.startsWith("profile_")) {
+                profileLikelihood.SetProperty(key.toStdString(), value.toStdString());
+            }
+            if (key.startsWith("scenario_")) {
+                scenarioProjection.SetProperty(key.toStdString(), value.toStdString());
+            }
         }
     }
 
@@ -1095,10 +1317,23 @@ void MainWindow::loadGASettings(const QString& filename)
                 result = ga.SetProperty("initial_population", value);
             else if (key == "numthreads")
                 result = ga.SetProperty("numthreads", value);
+            else if (key == "fitness_cache_size") {
+                fitnessCacheSize_ = std::max(0, std::atoi(value.c_str()));
+                result = true;
+            }
+            else if (key.rfind("cmaes_", 0) == 0)
+                result = cmaes.SetProperty(key, value);
+            else if (key.rfind("island_", 0) == 0)
+                result = islandGA.SetProperty(key, value);
+            else if (key.rfind("lm_", 0) == 0)
+                result = multiStartLM.SetProperty(key, value) && laplace.SetProperty(key, value);
 
             qDebug() << "DEBUG: SetProperty returned:" << result;
             if (!result) {
-                qDebug() << "ERROR:" << QString::fromStdString(ga.getLastError());
+                qDebug() << "ERROR:" << QString::fromStdString(key.rfind("cmaes_", 0) == 0 ? cmaes.getLastError()
+                                                    : key.rfind("island_", 0) == 0 ? islandGA.getLastError()
+                                                    : key.rfind("lm_", 0) == 0     ? multiStartLM.getLastError()
+                                                                                   : ga.getLastError());
             }
         }
     }
@@ -1177,6 +1412,30 @@ void MainWindow::onRunDeterministicGA()
     // Set the progress window in GA
     ga.SetProgressWindow(progressWindow_);
 
+    // Duplicate chromosomes are looked up instead of re-running the model.
+    // Model copies made by the GA share the cache; the timer fires while the
+    // GA processes events and shows the hit rate.
+    std::shared_ptr<CFitnessCache> fitnessCache;
+    QTimer cacheTimer;
+    if (fitnessCacheSize_ > 0) {
+        fitnessCache = std::make_shared<CFitnessCache>(fitnessCacheSize_);
+        gwaModel.SetFitnessCache(fitnessCache);
+
+        progressWindow_->SetInfoPanelVisible(true);
+        progressWindow_->SetInfoPanelLabel("Fitness Cache");
+        connect(&cacheTimer, &QTimer::timeout, this, [this, fitnessCache]() {
+            if (!progressWindow_) return;
+            progressWindow_->SetInfoText(
+                QString("Hits: %1\nMisses: %2\nHit rate: %3%\nEntries: %4 / %5")
+                    .arg(fitnessCache->hits())
+                    .arg(fitnessCache->misses())
+                    .arg(100.0 * fitnessCache->hitRate(), 0, 'f', 1)
+                    .arg(fitnessCache->size())
+                    .arg(fitnessCache->capacity()));
+        });
+        cacheTimer.start(500);
+    }
+
     // Show window
     progressWindow_->show();
     progressWindow_->SetStatus("Initializing GA...");
@@ -1202,6 +1461,13 @@ void MainWindow::onRunDeterministicGA()
         // Run optimization - progress updates happen automatically in GA
         int bestIndex = ga.optimize();
 
+        if (fitnessCache) {
+            progressWindow_->AppendLog(QString("Fitness cache: %1 hits, %2 model runs (hit rate %3%)")
+                                           .arg(fitnessCache->hits())
+                                           .arg(fitnessCache->misses())
+                                           .arg(100.0 * fitnessCache->hitRate(), 0, 'f', 1));
+        }
+
         CGWA* bestModel = ga.getBestModel();
         if (bestModel != nullptr) {
             progressWindow_->AppendLog("");
@@ -1275,6 +1541,10 @@ void MainWindow::onRunDeterministicGA()
                               QString("Error during optimization:\n%1").arg(e.what()));
     }
 
+    // Cached values are only valid for the model as it was during this run
+    cacheTimer.stop();
+    gwaModel.SetFitnessCache(nullptr);
+
     // Keep window open until user closes it
     if (progressWindow_) {
         progressWindow_->exec();
@@ -1284,55 +1554,25 @@ void MainWindow::onRunDeterministicGA()
 }
 
 
-QString MainWindow::getMCMCSettingsFilename(const QString& projectFilename)
-{
-    QFileInfo fileInfo(projectFilename);
-    QString baseName = fileInfo.completeBaseName();
-    QString path = fileInfo.absolutePath();
-    return path + "/" + baseName + ".mcmcsettings";
-}
-
-void MainWindow::onAbout()
-{
-    AboutDialog dialog(this);
-    dialog.setVersion("1.0.0");
-    dialog.exec();
-}
-
-void MainWindow::onRunMCMC()
+void MainWindow::onRunCMAES()
 {
-    // Check if model is loaded
     if (gwaModel.Parameters().empty()) {
         QMessageBox::warning(this, "No Model",
-                             "Please load a model file before running MCMC.");
-        return;
-    }
-
-    // Check if we have parameters to estimate
-    int numParams = gwaModel.Parameters().size();
-
-    if (numParams == 0) {
-        QMessageBox::warning(this, "No Parameters",
-                             "Please define at least one parameter to estimate.");
+                             "Please load a model file before running optimization.");
         return;
     }
 
-    // Check if we have a current file path
     if (currentFilePath_.isEmpty()) {
         QMessageBox::warning(this, "No File",
                              "Please load or save a file first.");
         return;
     }
 
-    // ========================================================================
-    // Create output folder next to input file
-    // ========================================================================
-
     QFileInfo inputFileInfo(currentFilePath_);
     QString inputDir = inputFileInfo.absolutePath();
     QString baseName = inputFileInfo.completeBaseName();
 
-    QString outputFolderName = QString("%1_MCMC_output").arg(baseName);
+    QString outputFolderName = QString("%1_CMAES_output").arg(baseName);
     QString outputFolderPath = inputDir + "/" + outputFolderName;
 
     QDir dir;
@@ -1344,154 +1584,2058 @@ void MainWindow::onRunMCMC()
         }
     }
 
-    mcmc.SetProperty("samples_filename", "mcmc_samples.txt");
-    
-
-    // Get MCMC settings for display
-    const MCMCSettings& settings = mcmc.GetSettings();
-    int totalSamples = settings.total_number_of_samples;
-    int numChains = settings.number_of_chains;
-    int burnout = settings.burnout_samples;
-
-    // ========================================================================
-    // Create progress window
-    // ========================================================================
+    gwaModel.SetOutputPath(outputFolderPath.toStdString() + "/");
 
-    progressWindow_ = new ProgressWindow(this, "MCMC Sampling");
-    progressWindow_->SetProgressLabel("Sample Progress:");
-    progressWindow_->SetPrimaryChartTitle("Perturbation factor");
+    // Same evaluation budget (maxpop x ngen) and thread count as the GA settings
+    cmaes.SetModel(&gwaModel);
+    cmaes.SetProperty("maxpop", std::to_string(ga.getPopulationSize()));
+    cmaes.SetProperty("ngen", std::to_string(ga.getNumGenerations()));
+    cmaes.SetProperty("numthreads", std::to_string(ga.getNumThreads()));
+    cmaes.SetProperty("pathname", outputFolderPath.toStdString() + "/");
+    cmaes.SetProperty("outputfile", "cmaes_results.txt");
+
+    // A checkpoint restores all settings of the interrupted run
+    const QString checkpointPath = resumeCheckpoint_;
+    resumeCheckpoint_.clear();
+    const bool resuming = !checkpointPath.isEmpty();
+
+    progressWindow_ = new ProgressWindow(this, "CMA-ES Optimization");
+    progressWindow_->SetProgressLabel("Evaluation Budget:");
+    progressWindow_->SetPrimaryChartTitle("Best Fitness");
+    progressWindow_->SetPrimaryChartYAxisTitle("Best Fitness");
+    progressWindow_->SetPrimaryChartXAxisTitle("Generation");
     progressWindow_->SetPrimaryChartVisible(true);
-    progressWindow_->SetPrimaryChartXRange(0, totalSamples);
-    progressWindow_->SetPrimaryChartYAxisTitle("Perturbation factor");
-    progressWindow_->SetPrimaryChartXAxisTitle("Sample");
-
-    progressWindow_->SetSecondaryChartVisible(true);  // Show MCMC-specific charts
+    progressWindow_->SetSecondaryChartTitle("Step Size");
+    progressWindow_->SetSecondaryChartYAxisTitle("Largest step (fraction of range)");
+    progressWindow_->SetSecondaryChartXAxisTitle("Generation");
+    progressWindow_->SetSecondaryChartVisible(true);
     progressWindow_->SetSecondaryProgressVisible(false);
-    progressWindow_->SetSecondaryChartTitle("Acceptance rate");
-    progressWindow_->SetSecondaryChartYAxisTitle("Acceptance rate");
-    progressWindow_->SetSecondaryChartXAxisTitle("Sample");
-    progressWindow_->SetSecondaryChartXRange(0, totalSamples);
 
+    cmaes.SetProgressWindow(progressWindow_);
 
-    // Set the progress window in MCMC
-    mcmc.SetRunTimeWindow(progressWindow_);
-
-    // Show window
     progressWindow_->show();
-    progressWindow_->SetStatus("Initializing MCMC...");
-    progressWindow_->AppendLog("Starting Markov Chain Monte Carlo Sampling");
+    progressWindow_->SetStatus("Running CMA-ES...");
+    progressWindow_->AppendLog("Starting CMA-ES Optimization");
     progressWindow_->AppendLog(QString("Input file: %1").arg(inputFileInfo.fileName()));
     progressWindow_->AppendLog(QString("Output folder: %1").arg(outputFolderName));
-    progressWindow_->AppendLog(QString("Total samples: %1").arg(totalSamples));
-    progressWindow_->AppendLog(QString("Number of chains: %1").arg(numChains));
-    progressWindow_->AppendLog(QString("Burnout samples: %1").arg(burnout));
-    progressWindow_->AppendLog(QString("Parameters to estimate: %1").arg(numParams));
+    progressWindow_->AppendLog(QString("Evaluation budget: %1").arg(cmaes.getEvaluationBudget()));
+    progressWindow_->AppendLog(QString("Threads: %1").arg(cmaes.GetSettings().numthreads));
+    if (resuming) {
+        progressWindow_->AppendLog(QString("Resuming from checkpoint: %1").arg(checkpointPath));
+    }
     progressWindow_->AppendLog("");
-
-    // Process events to show window
     QApplication::processEvents();
 
     try {
-        // Initialize MCMC (use false for non-random start from current values)
-        progressWindow_->SetStatus("Initializing chains...");
-        progressWindow_->AppendLog("Initializing MCMC chains...");
-        QApplication::processEvents();
+        bool completed = resuming ? cmaes.Resume(checkpointPath.toStdString()) : cmaes.optimize();
 
-        mcmc.Initialize(false);
+        CGWA* bestModel = cmaes.getBestModel();
+        if (bestModel == nullptr) {
+            throw std::runtime_error(cmaes.getLastError());
+        }
 
-        progressWindow_->SetStatus("Running MCMC sampling...");
-        progressWindow_->AppendLog("Starting MCMC sampling loop...");
         progressWindow_->AppendLog("");
-        QApplication::processEvents();
+        progressWindow_->AppendLog("=== Updating Model Parameters ===");
 
-        // Run MCMC - progress updates happen automatically through ProgressWindow
-        mcmc.Perform();
+        Parameter_Set& mainParams = gwaModel.Parameters();
+        Parameter_Set& bestParams = bestModel->Parameters();
+        for (size_t i = 0; i < mainParams.size() && i < bestParams.size(); ++i) {
+            double newValue = bestParams[i]->GetValue();
+            mainParams[i]->SetValue(newValue);
 
-        // Get results
-        double acceptanceRate = mcmc.GetAcceptanceRate();
-        const auto& samples = mcmc.GetParameterSamples();
+            progressWindow_->AppendLog(QString("  Updated %1 = %2")
+                                           .arg(QString::fromStdString(mainParams[i]->GetName()), -30)
+                                           .arg(newValue, 0, 'e', 6));
+        }
+
+        double bestFitness = cmaes.getMaxFitness();
+        QString status = completed ? "Optimization Complete!" : "Optimization Stopped";
 
-        // Update progress window with final results
         progressWindow_->SetProgress(1.0);
-        progressWindow_->SetStatus("MCMC Complete!");
         progressWindow_->AppendLog("");
-        progressWindow_->AppendLog("=== MCMC Sampling Complete ===");
-        progressWindow_->AppendLog(QString("Total samples generated: %1").arg(totalSamples));
-        progressWindow_->AppendLog(QString("Acceptance rate: %1%").arg(acceptanceRate * 100.0, 0, 'f', 2));
+        progressWindow_->AppendLog(QString("=== %1 ===").arg(status));
+        progressWindow_->AppendLog(QString("Best fitness: %1").arg(bestFitness, 0, 'e', 6));
+        progressWindow_->AppendLog(QString("Evaluations: %1 in %2 run(s)")
+                                       .arg(cmaes.getEvaluations())
+                                       .arg(cmaes.getRestarts() + 1));
         progressWindow_->AppendLog(QString("Results saved to: %1").arg(outputFolderPath));
-        progressWindow_->AppendLog("");
+        progressWindow_->SetComplete(status);
 
-        // Calculate and display parameter statistics
-        if (!samples.empty() && samples.size() > burnout) {
-            progressWindow_->AppendLog("Parameter posterior statistics (after burnout):");
+        statusBar()->showMessage(
+            QString("CMA-ES Complete: Best Fitness = %1 | Output: %2")
+                .arg(bestFitness, 0, 'e', 6)
+                .arg(outputFolderName),
+            10000
+            );
 
-            for (int i = 0; i < numParams; ++i) {
-                Parameter* param = gwaModel.Parameters()[i];
-                if (param) {
-                    // Calculate mean and std from samples (excluding burnout)
-                    double sum = 0.0;
-                    double sumSq = 0.0;
-                    int count = 0;
+    } catch (const std::exception& e) {
+        if (progressWindow_) {
+            progressWindow_->AppendLog(QString("ERROR: %1").arg(e.what()));
+            progressWindow_->SetComplete("Optimization Failed!");
+        }
 
-                    for (size_t j = burnout; j < samples.size(); ++j) {
-                        if (i < samples[j].size()) {
-                            double val = samples[j][i];
-                            sum += val;
-                            sumSq += val * val;
-                            count++;
-                        }
-                    }
+        QMessageBox::critical(this, "Optimization Error",
+                              QString("Error during optimization:\n%1").arg(e.what()));
+    }
 
-                    if (count > 0) {
-                        double mean = sum / count;
-                        double variance = (sumSq / count) - (mean * mean);
-                        double stddev = sqrt(variance);
+    if (progressWindow_) {
+        progressWindow_->exec();
+        delete progressWindow_;
+        progressWindow_ = nullptr;
+    }
+}
 
-                        progressWindow_->AppendLog(QString("  %1: mean = %2, std = %3")
-                                                       .arg(QString::fromStdString(param->GetName()), -30)
-                                                       .arg(mean, 0, 'e', 4)
-                                                       .arg(stddev, 0, 'e', 4));
-                    }
-                }
-            }
+
+void MainWindow::onRunIslandGA()
+{
+    if (gwaModel.Parameters().empty()) {
+        QMessageBox::warning(this, "No Model",
+                             "Please load a model file before running optimization.");
+        return;
+    }
+
+    if (currentFilePath_.isEmpty()) {
+        QMessageBox::warning(this, "No File",
+                             "Please load or save a file first.");
+        return;
+    }
+
+    QFileInfo inputFileInfo(currentFilePath_);
+    QString inputDir = inputFileInfo.absolutePath();
+    QString baseName = inputFileInfo.completeBaseName();
+
+    QString outputFolderName = QString("%1_GA_output").arg(baseName);
+    QString outputFolderPath = inputDir + "/" + outputFolderName;
+
+    QDir dir;
+    if (!dir.exists(outputFolderPath)) {
+        if (!dir.mkpath(outputFolderPath)) {
+            QMessageBox::critical(this, "Error",
+                                  QString("Failed to create output folder:\n%1").arg(outputFolderPath));
+            return;
         }
+    }
 
-        progressWindow_->SetComplete("MCMC Complete!");
+    gwaModel.SetOutputPath(outputFolderPath.toStdString() + "/");
+
+    // Operators and budget follow the GA settings dialog
+    islandGA.SetModel(&gwaModel);
+    islandGA.SetProperty("maxpop", std::to_string(ga.getPopulationSize()));
+    islandGA.SetProperty("ngen", std::to_string(ga.getNumGenerations()));
+    islandGA.SetProperty("pcross", std::to_string(ga.getCrossoverProb()));
+    islandGA.SetProperty("pmute", std::to_string(ga.getMutationProb()));
+    islandGA.SetProperty("shakescale", std::to_string(ga.getShakeScale()));
+    islandGA.SetProperty("shakescalered", std::to_string(ga.getShakeScaleRed()));
+    islandGA.SetProperty("numthreads", std::to_string(ga.getNumThreads()));
+    islandGA.SetProperty("pathname", outputFolderPath.toStdString() + "/");
+    islandGA.SetProperty("outputfile", "island_ga_results.txt");
+
+    // A checkpoint restores all settings of the interrupted run
+    const QString checkpointPath = resumeCheckpoint_;
+    resumeCheckpoint_.clear();
+    const bool resuming = !checkpointPath.isEmpty();
+
+    const IslandGASettings& settings = islandGA.GetSettings();
+    int numIslands = settings.islands > 0 ? settings.islands : settings.numthreads;
+
+    progressWindow_ = new ProgressWindow(this, "Island-Model GA");
+    progressWindow_->SetProgressLabel("Generation Progress:");
+    progressWindow_->SetPrimaryChartTitle("Best Fitness per Generation");
+    progressWindow_->SetPrimaryChartYAxisTitle("Best Fitness");
+    progressWindow_->SetPrimaryChartXAxisTitle("Mean Island Generation");
+    progressWindow_->SetPrimaryChartVisible(true);
+    progressWindow_->SetPrimaryChartXRange(0, settings.ngen);
+    progressWindow_->SetSecondaryChartVisible(false);
+    progressWindow_->SetSecondaryProgressVisible(false);
+    progressWindow_->SetInfoPanelVisible(true);
+    progressWindow_->SetInfoPanelLabel("Islands");
+
+    islandGA.SetProgressWindow(progressWindow_);
+
+    progressWindow_->show();
+    progressWindow_->SetStatus("Running island GA...");
+    progressWindow_->AppendLog("Starting Island-Model Genetic Algorithm");
+    progressWindow_->AppendLog(QString("Input file: %1").arg(inputFileInfo.fileName()));
+    progressWindow_->AppendLog(QString("Output folder: %1").arg(outputFolderName));
+    progressWindow_->AppendLog(QString("Islands: %1, total population: %2, generations: %3")
+                                   .arg(numIslands)
+                                   .arg(settings.maxpop)
+                                   .arg(settings.ngen));
+    progressWindow_->AppendLog(QString("Migration: %1 individuals every %2 generations")
+                                   .arg(settings.migrants)
+                                   .arg(settings.migration_interval));
+    if (resuming) {
+        progressWindow_->AppendLog(QString("Resuming from checkpoint: %1").arg(checkpointPath));
+    }
+    progressWindow_->AppendLog("");
+    QApplication::processEvents();
+
+    try {
+        bool completed = resuming ? islandGA.Resume(checkpointPath.toStdString()) : islandGA.optimize();
+
+        CGWA* bestModel = islandGA.getBestModel();
+        if (bestModel == nullptr) {
+            throw std::runtime_error(islandGA.getLastError());
+        }
+
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("=== Updating Model Parameters ===");
+
+        Parameter_Set& mainParams = gwaModel.Parameters();
+        Parameter_Set& bestParams = bestModel->Parameters();
+        for (size_t i = 0; i < mainParams.size() && i < bestParams.size(); ++i) {
+            double newValue = bestParams[i]->GetValue();
+            mainParams[i]->SetValue(newValue);
+
+            progressWindow_->AppendLog(QString("  Updated %1 = %2")
+                                           .arg(QString::fromStdString(mainParams[i]->GetName()), -30)
+                                           .arg(newValue, 0, 'e', 6));
+        }
+
+        double bestFitness = islandGA.getMaxFitness();
+        QString status = completed ? "Optimization Complete!" : "Optimization Stopped";
+
+        progressWindow_->SetProgress(1.0);
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog(QString("=== %1 ===").arg(status));
+        progressWindow_->AppendLog(QString("Best fitness: %1").arg(bestFitness, 0, 'e', 6));
+        std::vector<double> islandBest = islandGA.getIslandBestFitness();
+        for (size_t i = 0; i < islandBest.size(); ++i) {
+            progressWindow_->AppendLog(QString("  Island %1 best: %2").arg(i + 1).arg(islandBest[i], 0, 'e', 6));
+        }
+        progressWindow_->AppendLog(QString("Migrants sent: %1, accepted: %2, dropped: %3")
+                                       .arg(islandGA.getMigrantsSent())
+                                       .arg(islandGA.getMigrantsAccepted())
+                                       .arg(islandGA.getMigrantsDropped()));
+        progressWindow_->AppendLog(QString("Results saved to: %1").arg(outputFolderPath));
+        progressWindow_->SetComplete(status);
 
-        // Update status bar
         statusBar()->showMessage(
-            QString("MCMC Complete: Acceptance Rate = %1% | Output: %2")
-                .arg(acceptanceRate * 100.0, 0, 'f', 2)
+            QString("Island GA Complete: Best Fitness = %1 | Output: %2")
+                .arg(bestFitness, 0, 'e', 6)
                 .arg(outputFolderName),
             10000
             );
 
-        // Show results dialog
-        QString resultMsg = QString("MCMC Sampling Complete!\n\n");
-        resultMsg += QString("Acceptance Rate: %1%\n\n").arg(acceptanceRate * 100.0, 0, 'f', 2);
-        resultMsg += QString("Generated %1 samples across %2 chains\n")
-                         .arg(totalSamples)
-                         .arg(numChains);
-        resultMsg += QString("Estimated %1 parameters\n\n").arg(numParams);
-        resultMsg += QString("Results saved to:\n%1\n\n").arg(outputFolderPath);
-        resultMsg += "See progress window for detailed results and parameter statistics.";
-
-        QMessageBox::information(this, "MCMC Complete", resultMsg);
-
     } catch (const std::exception& e) {
         if (progressWindow_) {
             progressWindow_->AppendLog(QString("ERROR: %1").arg(e.what()));
-            progressWindow_->SetComplete("MCMC Failed!");
+            progressWindow_->SetComplete("Optimization Failed!");
         }
 
-        QMessageBox::critical(this, "MCMC Error",
-                              QString("Error during MCMC:\n%1").arg(e.what()));
+        QMessageBox::critical(this, "Optimization Error",
+                              QString("Error during optimization:\n%1").arg(e.what()));
     }
 
-    // Keep window open until user closes it
     if (progressWindow_) {
         progressWindow_->exec();
         delete progressWindow_;
         progressWindow_ = nullptr;
     }
 }
+
+
+void MainWindow::onRunMultiStartLM()
+{
+    if (gwaModel.Parameters().empty()) {
+        QMessageBox::warning(this, "No Model",
+                             "Please load a model file before running optimization.");
+        return;
+    }
+
+    if (currentFilePath_.isEmpty()) {
+        QMessageBox::warning(this, "No File",
+                             "Please load or save a file first.");
+        return;
+    }
+
+    QFileInfo inputFileInfo(currentFilePath_);
+    QString inputDir = inputFileInfo.absolutePath();
+    QString baseName = inputFileInfo.completeBaseName();
+
+    QString outputFolderName = QString("%1_GA_output").arg(baseName);
+    QString outputFolderPath = inputDir + "/" + outputFolderName;
+
+    QDir dir;
+    if (!dir.exists(outputFolderPath)) {
+        if (!dir.mkpath(outputFolderPath)) {
+            QMessageBox::critical(this, "Error",
+                                  QString("Failed to create output folder:\n%1").arg(outputFolderPath));
+            return;
+        }
+    }
+
+    gwaModel.SetOutputPath(outputFolderPath.toStdString() + "/");
+
+    multiStartLM.SetModel(&gwaModel);
+    multiStartLM.SetProperty("numthreads", std::to_string(ga.getNumThreads()));
+    multiStartLM.SetProperty("pathname", outputFolderPath.toStdString() + "/");
+    multiStartLM.SetProperty("outputfile", "lm_multistart.txt");
+
+    // Seed from the last island GA run in this session, if any
+    const MultiStartLMSettings& settings = multiStartLM.GetSettings();
+    std::vector<std::vector<double>> seeds;
+    if (islandGA.getIslandCount() > 0) {
+        seeds = islandGA.getBestIndividuals(settings.starts);
+    }
+    multiStartLM.SetStartingPoints(seeds);
+
+    progressWindow_ = new ProgressWindow(this, "Multi-Start Levenberg-Marquardt");
+    progressWindow_->SetProgressLabel("Starts Refined:");
+    progressWindow_->SetPrimaryChartTitle("Objective per Start");
+    progressWindow_->SetPrimaryChartYAxisTitle("Log-Likelihood");
+    progressWindow_->SetPrimaryChartXAxisTitle("Start");
+    progressWindow_->SetPrimaryChartVisible(true);
+    progressWindow_->SetPrimaryChartXRange(0, settings.starts);
+    progressWindow_->SetSecondaryChartVisible(false);
+    progressWindow_->SetSecondaryProgressVisible(false);
+
+    multiStartLM.SetProgressWindow(progressWindow_);
+
+    progressWindow_->show();
+    progressWindow_->SetStatus("Running Levenberg-Marquardt...");
+    progressWindow_->AppendLog("Starting Multi-Start Levenberg-Marquardt");
+    progressWindow_->AppendLog(QString("Input file: %1").arg(inputFileInfo.fileName()));
+    progressWindow_->AppendLog(QString("Output folder: %1").arg(outputFolderName));
+    progressWindow_->AppendLog(QString("Starts: %1 (%2 from island GA, rest Latin hypercube), threads: %3")
+                                   .arg(settings.starts)
+                                   .arg(std::min<size_t>(seeds.size(), settings.starts))
+                                   .arg(settings.numthreads));
+    progressWindow_->AppendLog("");
+    QApplication::processEvents();
+
+    try {
+        bool completed = multiStartLM.optimize();
+
+        CGWA* bestModel = multiStartLM.getBestModel();
+        if (bestModel == nullptr) {
+            throw std::runtime_error(multiStartLM.getLastError());
+        }
+
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("=== Basins ===");
+        const auto& basins = multiStartLM.getBasins();
+        for (size_t b = 0; b < basins.size(); ++b) {
+            progressWindow_->AppendLog(QString("  Basin %1: objective %2, reached by %3 start(s)%4")
+                                           .arg(b + 1)
+                                           .arg(basins[b].objective, 0, 'e', 6)
+                                           .arg(basins[b].starts)
+                                           .arg(basins[b].converged ? "" : " (not converged)"));
+        }
+
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("=== Updating Model Parameters ===");
+
+        Parameter_Set& mainParams = gwaModel.Parameters();
+        Parameter_Set& bestParams = bestModel->Parameters();
+        for (size_t i = 0; i < mainParams.size() && i < bestParams.size(); ++i) {
+            double newValue = bestParams[i]->GetValue();
+            mainParams[i]->SetValue(newValue);
+
+            progressWindow_->AppendLog(QString("  Updated %1 = %2")
+                                           .arg(QString::fromStdString(mainParams[i]->GetName()), -30)
+                                           .arg(newValue, 0, 'e', 6));
+        }
+
+        double bestFitness = multiStartLM.getMaxFitness();
+        QString status = completed ? "Optimization Complete!" : "Optimization Stopped";
+
+        progressWindow_->SetProgress(1.0);
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog(QString("=== %1 ===").arg(status));
+        progressWindow_->AppendLog(QString("Best fitness: %1").arg(bestFitness, 0, 'e', 6));
+        progressWindow_->AppendLog(QString("Distinct basins: %1, model evaluations: %2")
+                                       .arg(basins.size())
+                                       .arg(multiStartLM.getModelEvaluations()));
+        progressWindow_->AppendLog(QString("Results saved to: %1").arg(outputFolderPath));
+        progressWindow_->SetComplete(status);
+
+        statusBar()->showMessage(
+            QString("Levenberg-Marquardt Complete: Best Fitness = %1 | Output: %2")
+                .arg(bestFitness, 0, 'e', 6)
+                .arg(outputFolderName),
+            10000
+            );
+
+    } catch (const std::exception& e) {
+        if (progressWindow_) {
+            progressWindow_->AppendLog(QString("ERROR: %1").arg(e.what()));
+            progressWindow_->SetComplete("Optimization Failed!");
+        }
+
+        QMessageBox::critical(this, "Optimization Error",
+                              QString("Error during optimization:\n%1").arg(e.what()));
+    }
+
+    if (progressWindow_) {
+        progressWindow_->exec();
+        delete progressWindow_;
+        progressWindow_ = nullptr;
+    }
+}
+
+QString MainWindow::getMCMCSettingsFilename(const QString& projectFilename)
+{
+    QFileInfo fileInfo(projectFilename);
+    QString baseName = fileInfo.completeBaseName();
+    QString path = fileInfo.absolutePath();
+    return path + "/" + baseName + ".mcmcsettings";
+}
+
+void MainWindow::onAbout()
+{
+    AboutDialog dialog(this);
+    dialog.setVersion("1.0.0");
+    dialog.exec();
+}
+
+void MainWindow::onRunMCMC()
+{
+    // Check if model is loaded
+    if (gwaModel.Parameters().empty()) {
+        QMessageBox::warning(this, "No Model",
+                             "Please load a model file before running MCMC.");
+        return;
+    }
+
+    // Check if we have parameters to estimate
+    int numParams = gwaModel.Parameters().size();
+
+    if (numParams == 0) {
+        QMessageBox::warning(this, "No Parameters",
+                             "Please define at least one parameter to estimate.");
+        return;
+    }
+
+    // Check if we have a current file path
+    if (currentFilePath_.isEmpty()) {
+        QMessageBox::warning(this, "No File",
+                             "Please load or save a file first.");
+        return;
+    }
+
+    // ========================================================================
+    // Create output folder next to input file
+    // ========================================================================
+
+    QFileInfo inputFileInfo(currentFilePath_);
+    QString inputDir = inputFileInfo.absolutePath();
+    QString baseName = inputFileInfo.completeBaseName();
+
+    QString outputFolderName = QString("%1_MCMC_output").arg(baseName);
+    QString outputFolderPath = inputDir + "/" + outputFolderName;
+
+    QDir dir;
+    if (!dir.exists(outputFolderPath)) {
+        if (!dir.mkpath(outputFolderPath)) {
+            QMessageBox::critical(this, "Error",
+                                  QString("Failed to create output folder:\n%1").arg(outputFolderPath));
+            return;
+        }
+    }
+
+    mcmc.SetProperty("samples_filename", "mcmc_samples.txt");
+    
+
+    // Get MCMC settings for display
+    const MCMCSettings& settings = mcmc.GetSettings();
+    int totalSamples = settings.total_number_of_samples;
+    int numChains = settings.number_of_chains;
+    int burnout = settings.burnout_samples;
+
+    // A checkpoint restores all sampler settings of the interrupted run
+    const QString checkpointPath = resumeCheckpoint_;
+    resumeCheckpoint_.clear();
+    const bool resuming = !checkpointPath.isEmpty();
+
+    // Settings shared with the adaptive samplers are edited through the MCMC dialog
+    const bool useEngine = resuming || mcmcEngine.IsEnabled();
+    if (useEngine) {
+        mcmcEngine.SetModel(&gwaModel);
+        mcmcEngine.SetProperty("number_of_samples", std::to_string(settings.total_number_of_samples));
+        mcmcEngine.SetProperty("number_of_chains", std::to_string(settings.number_of_chains));
+        mcmcEngine.SetProperty("number_of_burnout_samples", std::to_string(settings.burnout_samples));
+        mcmcEngine.SetProperty("record_interval", std::to_string(settings.save_interval));
+        mcmcEngine.SetProperty("perturbation_factor", std::to_string(settings.perturbation_factor));
+        mcmcEngine.SetProperty("acceptance_rate", std::to_string(settings.acceptance_rate));
+        mcmcEngine.SetProperty("number_of_threads", std::to_string(settings.numberOfThreads));
+        mcmcEngine.SetProperty("initial_perturbation", settings.no_initial_perturbation ? "no" : "yes");
+        mcmcEngine.SetProperty("samples_filename", "");
+        mcmcEngine.SetProperty("output_path", outputFolderPath.toStdString() + "/");
+        mcmcEngine.SetProperty("checkpoint_filename", "mcmc_checkpoint.bin");
+    }
+
+    // ========================================================================
+    // Create progress window
+    // ========================================================================
+
+    progressWindow_ = new ProgressWindow(this, "MCMC Sampling");
+    progressWindow_->SetProgressLabel("Sample Progress:");
+    progressWindow_->SetPrimaryChartTitle("Perturbation factor");
+    progressWindow_->SetPrimaryChartVisible(true);
+    progressWindow_->SetPrimaryChartXRange(0, totalSamples);
+    progressWindow_->SetPrimaryChartYAxisTitle("Perturbation factor");
+    progressWindow_->SetPrimaryChartXAxisTitle("Sample");
+
+    progressWindow_->SetSecondaryChartVisible(true);  // Show MCMC-specific charts
+    progressWindow_->SetSecondaryProgressVisible(false);
+    progressWindow_->SetSecondaryChartTitle("Acceptance rate");
+    progressWindow_->SetSecondaryChartYAxisTitle("Acceptance rate");
+    progressWindow_->SetSecondaryChartXAxisTitle("Sample");
+    progressWindow_->SetSecondaryChartXRange(0, totalSamples);
+
+    if (useEngine && mcmcEngine.GetSettings().sampler == "nuts") {
+        progressWindow_->SetPrimaryChartTitle("Step size");
+        progressWindow_->SetPrimaryChartYAxisTitle("Leapfrog step size");
+        progressWindow_->SetSecondaryChartTitle("Mean acceptance statistic");
+    }
+
+    if (useEngine) {
+        progressWindow_->SetInfoPanelVisible(true);
+        progressWindow_->SetInfoPanelLabel("Convergence diagnostics (post burn-in)");
+        progressWindow_->SetTertiaryChartVisible(true);
+        progressWindow_->SetTertiaryChartTitle("Maximum split R-hat");
+        progressWindow_->SetTertiaryChartYAxisTitle("R-hat");
+        progressWindow_->SetTertiaryChartXAxisTitle("Sample");
+        progressWindow_->SetTertiaryChartXRange(0, totalSamples);
+        progressWindow_->SetTertiaryChartAutoScale(true);
+    }
+
+    if (useEngine && mcmcEngine.GetSettings().sampler == "parallel_tempering") {
+        progressWindow_->SetTertiaryChartVisible(true);
+        progressWindow_->SetTertiaryChartTitle("Replica swap rate");
+        progressWindow_->SetTertiaryChartYAxisTitle("Swap acceptance rate");
+        progressWindow_->SetTertiaryChartXAxisTitle("Sample");
+        progressWindow_->SetTertiaryChartXRange(0, totalSamples);
+        progressWindow_->SetTertiaryChartYRange(0.0, 1.0);
+    }
+
+    // Set the progress window in MCMC
+    mcmc.SetRunTimeWindow(progressWindow_);
+    mcmcEngine.SetRunTimeWindow(progressWindow_);
+
+    // Show window
+    progressWindow_->show();
+    progressWindow_->SetStatus("Initializing MCMC...");
+    progressWindow_->AppendLog("Starting Markov Chain Monte Carlo Sampling");
+    progressWindow_->AppendLog(QString("Input file: %1").arg(inputFileInfo.fileName()));
+    progressWindow_->AppendLog(QString("Output folder: %1").arg(outputFolderName));
+    progressWindow_->AppendLog(QString("Total samples: %1").arg(totalSamples));
+    progressWindow_->AppendLog(QString("Number of chains: %1").arg(numChains));
+    progressWindow_->AppendLog(QString("Burnout samples: %1").arg(burnout));
+    progressWindow_->AppendLog(QString("Parameters to estimate: %1").arg(numParams));
+    if (useEngine) {
+        progressWindow_->AppendLog(QString("Sampler: %1")
+                                       .arg(QString::fromStdString(mcmcEngine.GetSettings().sampler)));
+    }
+    if (useEngine && mcmcEngine.GetSettings().sampler == "nuts") {
+        progressWindow_->AppendLog(QString("WARNING: nuts uses finite-difference gradients: %1 forward runs per "
+                                           "leapfrog step, up to %2 steps per draw. Adaptive Metropolis usually "
+                                           "needs far fewer forward runs per effective sample.")
+                                       .arg(2 * numParams + 1)
+                                       .arg(1L << mcmcEngine.GetSettings().nuts_max_depth));
+    }
+    progressWindow_->AppendLog("");
+
+    // Process events to show window
+    QApplication::processEvents();
+
+    try {
+        // Initialize MCMC (use false for non-random start from current values)
+        progressWindow_->SetStatus("Initializing chains...");
+        progressWindow_->AppendLog("Initializing MCMC chains...");
+        QApplication::processEvents();
+
+        if (resuming) {
+            progressWindow_->AppendLog(QString("Resuming from checkpoint: %1").arg(checkpointPath));
+        }
+        else if (useEngine) {
+            if (!mcmcEngine.Initialize(false)) {
+                throw std::runtime_error(mcmcEngine.getLastError());
+            }
+        }
+        else {
+            mcmc.Initialize(false);
+        }
+
+        progressWindow_->SetStatus("Running MCMC sampling...");
+        progressWindow_->AppendLog("Starting MCMC sampling loop...");
+        progressWindow_->AppendLog("");
+        QApplication::processEvents();
+
+        // Run MCMC - progress updates happen automatically through ProgressWindow
+        bool completed = true;
+        if (resuming) {
+            completed = mcmcEngine.Resume(checkpointPath.toStdString());
+        }
+        else if (useEngine) {
+            completed = mcmcEngine.Perform();
+        }
+        else {
+            mcmc.Perform();
+        }
+
+        // A failed or cancelled run is not summarized and gets no realizations
+        if (!completed && !mcmcEngine.getLastError().empty()) {
+            throw std::runtime_error(mcmcEngine.getLastError());
+        }
+        if (!completed) {
+            progressWindow_->AppendLog("");
+            progressWindow_->AppendLog(QString("MCMC cancelled; the samples drawn so far are in %1")
+                                           .arg(QString::fromStdString(mcmcEngine.GetSamplesFilename())));
+            if (mcmcEngine.GetSettings().checkpoint_interval > 0) {
+                progressWindow_->AppendLog("The run can be continued with Resume MCMC from Checkpoint.");
+            }
+            progressWindow_->SetComplete("MCMC Cancelled");
+            statusBar()->showMessage(QString("MCMC cancelled | Output: %1").arg(outputFolderName), 10000);
+        }
+        else {
+            // Get results
+            double acceptanceRate = useEngine ? mcmcEngine.GetAcceptanceRate() : mcmc.GetAcceptanceRate();
+            std::vector<std::vector<double>> samples;
+            size_t sampleCount = 0;
+            if (useEngine) {
+                samples = mcmcEngine.GetParameterSamples();
+                sampleCount = static_cast<size_t>(mcmcEngine.GetSampleCount());
+            }
+            else {
+                samples = mcmc.GetParameterSamples();
+                sampleCount = samples.size();
+            }
+
+            // Update progress window with final results
+            progressWindow_->SetProgress(1.0);
+            progressWindow_->SetStatus("MCMC Complete!");
+            progressWindow_->AppendLog("");
+            progressWindow_->AppendLog("=== MCMC Sampling Complete ===");
+            progressWindow_->AppendLog(QString("Total samples generated: %1").arg(static_cast<qlonglong>(sampleCount)));
+            progressWindow_->AppendLog(QString("Acceptance rate: %1%").arg(acceptanceRate * 100.0, 0, 'f', 2));
+            if (useEngine && mcmcEngine.GetSettings().sampler == "dream") {
+                progressWindow_->AppendLog(QString("Outlier chains reset: %1").arg(mcmcEngine.GetOutlierResetCount()));
+            }
+            if (useEngine) {
+                const CMCMCDiagnostics& diagnostics = mcmcEngine.GetDiagnostics();
+                progressWindow_->AppendLog(QString("Max R-hat: %1, min bulk ESS: %2, min tail ESS: %3")
+                                               .arg(diagnostics.maxRhat(), 0, 'f', 4)
+                                               .arg(diagnostics.minBulkESS(), 0, 'f', 0)
+                                               .arg(diagnostics.minTailESS(), 0, 'f', 0));
+                if (mcmcEngine.StoppedOnConvergence()) {
+                    progressWindow_->AppendLog("Sampling stopped early: convergence criteria met.");
+                }
+            }
+            if (useEngine && mcmcEngine.GetSettings().delayed_acceptance && mcmcEngine.GetSettings().sampler != "nuts") {
+                const long screened = mcmcEngine.GetScreenedProposals();
+                const long evaluations = mcmcEngine.GetLikelihoodEvaluations();
+                progressWindow_->AppendLog(QString("Delayed acceptance: %1 proposals screened by the %2 surrogate, %3 forward runs (%4% saved)")
+                                               .arg(screened)
+                                               .arg(QString::fromStdString(mcmcEngine.GetSettings().surrogate))
+                                               .arg(evaluations)
+                                               .arg(screened + evaluations > 0 ? 100.0 * screened / (screened + evaluations) : 0.0, 0, 'f', 1));
+            }
+            if (useEngine && mcmcEngine.GetSettings().sampler == "nuts") {
+                progressWindow_->AppendLog(QString("Gradient evaluations: %1").arg(mcmcEngine.GetGradientEvaluations()));
+                progressWindow_->AppendLog(QString("Divergent transitions after burn-in: %1")
+                                               .arg(mcmcEngine.GetDivergentTransitions()));
+            }
+            if (useEngine && mcmcEngine.GetSettings().sampler == "parallel_tempering") {
+                const std::vector<double>& temperatures = mcmcEngine.GetTemperatures();
+                std::vector<double> swapRates = mcmcEngine.GetSwapAcceptanceRates();
+                progressWindow_->AppendLog("Temperature ladder (swap rate to next rung):");
+                for (size_t j = 0; j < temperatures.size(); ++j) {
+                    QString line = QString("  T%1 = %2").arg(j).arg(temperatures[j], 0, 'g', 4);
+                    if (j < swapRates.size()) {
+                        line += QString("  (%1%)").arg(swapRates[j] * 100.0, 0, 'f', 1);
+                    }
+                    progressWindow_->AppendLog(line);
+                }
+            }
+            progressWindow_->AppendLog(QString("Results saved to: %1").arg(outputFolderPath));
+            progressWindow_->AppendLog("");
+
+            // Binary sample stores are summarized straight from the memory-mapped file
+            if (useEngine && mcmcEngine.GetSettings().samples_format == "binary") {
+                CSampleStoreReader store(mcmcEngine.GetSamplesFilename());
+                std::vector<double> sampleNo = store.column(0);
+                progressWindow_->AppendLog(QString("Stored samples: %1 (%2)")
+                                               .arg(static_cast<qlonglong>(store.rowCount()))
+                                               .arg(QString::fromStdString(mcmcEngine.GetSamplesFilename())));
+                progressWindow_->AppendLog("Parameter posterior statistics (after burnout):");
+
+                for (int i = 0; i < numParams; ++i) {
+                    int column = store.findColumn(gwaModel.Parameters()[i]->GetName());
+                    if (column < 0) continue;
+                    std::vector<double> values = store.column(column);
+
+                    double sum = 0.0;
+                    double sumSq = 0.0;
+                    int count = 0;
+                    for (size_t j = 0; j < values.size(); ++j) {
+                        if (sampleNo[j] > burnout) {
+                            sum += values[j];
+                            sumSq += values[j] * values[j];
+                            count++;
+                        }
+                    }
+
+                    if (count > 0) {
+                        double mean = sum / count;
+                        double variance = (sumSq / count) - (mean * mean);
+                        double stddev = sqrt(std::max(variance, 0.0));
+
+                        progressWindow_->AppendLog(QString("  %1: mean = %2, std = %3")
+                                                       .arg(QString::fromStdString(store.columnNames()[column]), -30)
+                                                       .arg(mean, 0, 'e', 4)
+                                                       .arg(stddev, 0, 'e', 4));
+                    }
+                }
+            }
+            // Calculate and display parameter statistics
+            else if (!samples.empty() && samples.size() > burnout) {
+                progressWindow_->AppendLog("Parameter posterior statistics (after burnout):");
+
+                for (int i = 0; i < numParams; ++i) {
+                    Parameter* param = gwaModel.Parameters()[i];
+                    if (param) {
+                        // Calculate mean and std from samples (excluding burnout)
+                        double sum = 0.0;
+                        double sumSq = 0.0;
+                        int count = 0;
+
+                        for (size_t j = burnout; j < samples.size(); ++j) {
+                            if (i < samples[j].size()) {
+                                double val = samples[j][i];
+                                sum += val;
+                                sumSq += val * val;
+                                count++;
+                            }
+                        }
+
+                        if (count > 0) {
+                            double mean = sum / count;
+                            double variance = (sumSq / count) - (mean * mean);
+                            double stddev = sqrt(variance);
+
+                            progressWindow_->AppendLog(QString("  %1: mean = %2, std = %3")
+                                                           .arg(QString::fromStdString(param->GetName()), -30)
+                                                           .arg(mean, 0, 'e', 4)
+                                                           .arg(stddev, 0, 'e', 4));
+                        }
+                    }
+                }
+            }
+
+            // Parallel prediction bands for the adaptive samplers; CMCMC generates its own realizations
+            const int realizations = settings.number_of_post_estimate_realizations;
+            if (useEngine && realizations > 0 && sampleCount > static_cast<size_t>(burnout)) {
+                progressWindow_->SetStatus("Generating posterior realizations...");
+                progressWindow_->AppendLog(QString("Generating %1 posterior realizations...").arg(realizations));
+                QApplication::processEvents();
+
+                // A binary store keeps the draws on disk; they are read back here
+                std::vector<std::vector<double>> posterior;
+                CPosteriorPredictive predictive(&gwaModel);
+                predictive.SetProperty("number_of_realizations", std::to_string(realizations));
+                predictive.SetProperty("output_path", mcmcEngine.GetSettings().output_path);
+                predictive.SetProperty("number_of_threads", std::to_string(settings.numberOfThreads));
+                predictive.SetRunTimeWindow(progressWindow_);
+                if (!mcmcEngine.GetPosteriorSamples(posterior)) {
+                    progressWindow_->AppendLog(QString("Realizations failed: %1")
+                                                   .arg(QString::fromStdString(mcmcEngine.getLastError())));
+                }
+                else if (!predictive.Generate(posterior)) {
+                    progressWindow_->AppendLog(QString("Realizations failed: %1")
+                                                   .arg(QString::fromStdString(predictive.getLastError())));
+                }
+                else {
+                    progressWindow_->AppendLog(QString("Prediction bands computed from %1 realizations")
+                                                   .arg(predictive.GetRealizationCount()));
+                    if (predictive.GetFailedRealizationCount() > 0) {
+                        progressWindow_->AppendLog(QString("Failed forward runs skipped: %1")
+                                                       .arg(predictive.GetFailedRealizationCount()));
+                    }
+                }
+            }
+
+            progressWindow_->SetComplete("MCMC Complete!");
+
+            // Update status bar
+            statusBar()->showMessage(
+                QString("MCMC Complete: Acceptance Rate = %1% | Output: %2")
+                    .arg(acceptanceRate * 100.0, 0, 'f', 2)
+                    .arg(outputFolderName),
+                10000
+                );
+
+            // Show results dialog
+            QString resultMsg = QString("MCMC Sampling Complete!\n\n");
+            resultMsg += QString("Acceptance Rate: %1%\n\n").arg(acceptanceRate * 100.0, 0, 'f', 2);
+            resultMsg += QString("Generated %1 samples across %2 chains\n")
+                             .arg(totalSamples)
+                             .arg(numChains);
+            resultMsg += QString("Estimated %1 parameters\n\n").arg(numParams);
+            resultMsg += QString("Results saved to:\n%1\n\n").arg(outputFolderPath);
+            resultMsg += "See progress window for detailed results and parameter statistics.";
+
+            QMessageBox::information(this, "MCMC Complete", resultMsg);
+        }
+
+    } catch (const std::exception& e) {
+        if (progressWindow_) {
+            progressWindow_->AppendLog(QString("ERROR: %1").arg(e.what()));
+            progressWindow_->SetComplete("MCMC Failed!");
+        }
+
+        QMessageBox::critical(this, "MCMC Error",
+                              QString("Error during MCMC:\n%1").arg(e.what()));
+    }
+
+    // Keep window open until user closes it
+    if (progressWindow_) {
+        progressWindow_->exec();
+        delete progressWindow_;
+        progressWindow_ = nullptr;
+    }
+}
+
+void MainWindow::onRunLaplace()
+{
+    if (gwaModel.Parameters().empty()) {
+        QMessageBox::warning(this, "No Model",
+                             "Please load a model file before running the Laplace approximation.");
+        return;
+    }
+
+    if (currentFilePath_.isEmpty()) {
+        QMessageBox::warning(this, "No File",
+                             "Please load or save a file first.");
+        return;
+    }
+
+    QFileInfo inputFileInfo(currentFilePath_);
+    QString inputDir = inputFileInfo.absolutePath();
+    QString baseName = inputFileInfo.completeBaseName();
+
+    QString outputFolderName = QString("%1_Laplace_output").arg(baseName);
+    QString outputFolderPath = inputDir + "/" + outputFolderName;
+
+    QDir dir;
+    if (!dir.exists(outputFolderPath)) {
+        if (!dir.mkpath(outputFolderPath)) {
+            QMessageBox::critical(this, "Error",
+                                  QString("Failed to create output folder:\n%1").arg(outputFolderPath));
+            return;
+        }
+    }
+
+    gwaModel.SetOutputPath(outputFolderPath.toStdString() + "/");
+
+    laplace.SetModel(&gwaModel);
+    laplace.SetProperty("pathname", outputFolderPath.toStdString() + "/");
+
+    const MCMCSettings& mcmcSettings = mcmc.GetSettings();
+    const LaplaceSettings& settings = laplace.GetSettings();
+
+    progressWindow_ = new ProgressWindow(this, "Laplace Approximation");
+    progressWindow_->SetProgressLabel("Progress:");
+    progressWindow_->SetPrimaryChartVisible(false);
+    progressWindow_->SetSecondaryChartVisible(false);
+    progressWindow_->SetSecondaryProgressVisible(false);
+
+    laplace.SetProgressWindow(progressWindow_);
+
+    progressWindow_->show();
+    progressWindow_->SetStatus("Running Laplace approximation...");
+    progressWindow_->AppendLog("Starting Laplace Approximation of the Posterior");
+    progressWindow_->AppendLog(QString("Input file: %1").arg(inputFileInfo.fileName()));
+    progressWindow_->AppendLog(QString("Output folder: %1").arg(outputFolderName));
+    progressWindow_->AppendLog(QString("Posterior samples: %1").arg(settings.number_of_samples));
+    progressWindow_->AppendLog("");
+    QApplication::processEvents();
+
+    try {
+        if (!laplace.compute()) {
+            throw std::runtime_error(laplace.getLastError());
+        }
+
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("=== Updating Model Parameters to the Optimum ===");
+
+        Parameter_Set& mainParams = gwaModel.Parameters();
+        const std::vector<double>& optimum = laplace.getOptimum();
+        const arma::mat& covariance = laplace.getCovariance();
+        for (size_t i = 0; i < mainParams.size() && i < optimum.size(); ++i) {
+            mainParams[i]->SetValue(optimum[i]);
+
+            progressWindow_->AppendLog(QString("  %1 = %2 (sampling-space std %3)")
+                                           .arg(QString::fromStdString(mainParams[i]->GetName()), -30)
+                                           .arg(optimum[i], 0, 'e', 6)
+                                           .arg(std::sqrt(covariance(i, i)), 0, 'e', 3));
+        }
+
+        const int realizations = mcmcSettings.number_of_post_estimate_realizations;
+        if (realizations > 0) {
+            progressWindow_->SetStatus("Generating posterior realizations...");
+            progressWindow_->AppendLog("");
+            progressWindow_->AppendLog(QString("Generating %1 posterior realizations...").arg(realizations));
+            QApplication::processEvents();
+
+            CPosteriorPredictive predictive(&gwaModel);
+            predictive.SetProperty("number_of_realizations", std::to_string(realizations));
+            predictive.SetProperty("output_path", outputFolderPath.toStdString() + "/");
+            predictive.SetProperty("number_of_threads", std::to_string(mcmcSettings.numberOfThreads));
+            predictive.SetRunTimeWindow(progressWindow_);
+            if (!predictive.Generate(laplace.getSamples())) {
+                progressWindow_->AppendLog(QString("Realizations failed: %1")
+                                               .arg(QString::fromStdString(predictive.getLastError())));
+            }
+            else {
+                progressWindow_->AppendLog(QString("Prediction bands computed from %1 realizations")
+                                               .arg(predictive.GetRealizationCount()));
+            }
+        }
+
+        progressWindow_->SetProgress(1.0);
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("=== Laplace Approximation Complete ===");
+        progressWindow_->AppendLog(QString("Objective at optimum: %1").arg(laplace.getMaxFitness(), 0, 'e', 6));
+        progressWindow_->AppendLog(QString("Model evaluations: %1").arg(laplace.getModelEvaluations()));
+        if (laplace.getUnconstrainedDirections() > 0) {
+            progressWindow_->AppendLog(QString("Warning: %1 parameter direction(s) not constrained by the data; "
+                                               "their spread is capped at the parameter range")
+                                           .arg(laplace.getUnconstrainedDirections()));
+        }
+        progressWindow_->AppendLog(QString("Results saved to: %1").arg(outputFolderPath));
+        progressWindow_->SetComplete("Laplace Approximation Complete!");
+
+        statusBar()->showMessage(
+            QString("Laplace Approximation Complete | Output: %1").arg(outputFolderName),
+            10000
+            );
+
+    } catch (const std::exception& e) {
+        if (progressWindow_) {
+            progressWindow_->AppendLog(QString("ERROR: %1").arg(e.what()));
+            progressWindow_->SetComplete("Laplace Approximation Failed!");
+        }
+
+        QMessageBox::critical(this, "Laplace Approximation Error",
+                              QString("Error during Laplace approximation:\n%1").arg(e.what()));
+    }
+
+    if (progressWindow_) {
+        progressWindow_->exec();
+        delete progressWindow_;
+        progressWindow_ = nullptr;
+    }
+}
+
+void MainWindow::onRunESMDA()
+{
+    if (gwaModel.Parameters().empty()) {
+        QMessageBox::warning(this, "No Model",
+                             "Please load a model file before running the ensemble smoother.");
+        return;
+    }
+
+    if (currentFilePath_.isEmpty()) {
+        QMessageBox::warning(this, "No File",
+                             "Please load or save a file first.");
+        return;
+    }
+
+    QFileInfo inputFileInfo(currentFilePath_);
+    QString inputDir = inputFileInfo.absolutePath();
+    QString baseName = inputFileInfo.completeBaseName();
+
+    QString outputFolderName = QString("%1_ESMDA_output").arg(baseName);
+    QString outputFolderPath = inputDir + "/" + outputFolderName;
+
+    QDir dir;
+    if (!dir.exists(outputFolderPath)) {
+        if (!dir.mkpath(outputFolderPath)) {
+            QMessageBox::critical(this, "Error",
+                                  QString("Failed to create output folder:\n%1").arg(outputFolderPath));
+            return;
+        }
+    }
+
+    gwaModel.SetOutputPath(outputFolderPath.toStdString() + "/");
+
+    const MCMCSettings& mcmcSettings = mcmc.GetSettings();
+    esmda.SetModel(&gwaModel);
+    esmda.SetProperty("numthreads", std::to_string(mcmcSettings.numberOfThreads));
+    esmda.SetProperty("pathname", outputFolderPath.toStdString() + "/");
+
+    const ESMDASettings& settings = esmda.GetSettings();
+
+    progressWindow_ = new ProgressWindow(this, "Ensemble Smoother (ES-MDA)");
+    progressWindow_->SetProgressLabel("Assimilation Progress:");
+    progressWindow_->SetPrimaryChartTitle("Ensemble-Mean Data Mismatch");
+    progressWindow_->SetPrimaryChartYAxisTitle("0.5 * Sum of Squared Weighted Residuals");
+    progressWindow_->SetPrimaryChartXAxisTitle("Assimilation");
+    progressWindow_->SetPrimaryChartVisible(true);
+    progressWindow_->SetPrimaryChartXRange(0, settings.assimilations);
+    progressWindow_->SetSecondaryChartVisible(false);
+    progressWindow_->SetSecondaryProgressVisible(false);
+
+    esmda.SetProgressWindow(progressWindow_);
+
+    progressWindow_->show();
+    progressWindow_->SetStatus("Running ES-MDA...");
+    progressWindow_->AppendLog("Starting Ensemble Smoother with Multiple Data Assimilation");
+    progressWindow_->AppendLog(QString("Input file: %1").arg(inputFileInfo.fileName()));
+    progressWindow_->AppendLog(QString("Output folder: %1").arg(outputFolderName));
+    progressWindow_->AppendLog(QString("Ensemble size: %1, assimilations: %2, threads: %3")
+                                   .arg(settings.ensemble_size)
+                                   .arg(settings.assimilations)
+                                   .arg(settings.numthreads));
+    progressWindow_->AppendLog("");
+    QApplication::processEvents();
+
+    try {
+        bool completed = esmda.run();
+        if (!completed && esmda.getEnsemble().empty()) {
+            throw std::runtime_error(esmda.getLastError());
+        }
+
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("Posterior ensemble (mean, 2.5% - 97.5%):");
+        CPosteriorSummary summary(CParameterSpace(gwaModel.Parameters()), esmda.getEnsemble());
+        for (size_t i = 0; i < esmda.getParamNames().size(); ++i) {
+            progressWindow_->AppendLog(QString("  %1: %2 (%3 - %4)")
+                                           .arg(QString::fromStdString(esmda.getParamNames()[i]), -30)
+                                           .arg(summary.mean(i), 0, 'e', 4)
+                                           .arg(summary.percentile(i, 0.025), 0, 'e', 4)
+                                           .arg(summary.percentile(i, 0.975), 0, 'e', 4));
+        }
+
+        const int realizations = mcmcSettings.number_of_post_estimate_realizations;
+        if (completed && realizations > 0) {
+            progressWindow_->SetStatus("Generating posterior realizations...");
+            progressWindow_->AppendLog("");
+            progressWindow_->AppendLog(QString("Generating %1 posterior realizations...").arg(realizations));
+            QApplication::processEvents();
+
+            CPosteriorPredictive predictive(&gwaModel);
+            predictive.SetProperty("number_of_realizations", std::to_string(realizations));
+            predictive.SetProperty("output_path", outputFolderPath.toStdString() + "/");
+            predictive.SetProperty("number_of_threads", std::to_string(mcmcSettings.numberOfThreads));
+            predictive.SetRunTimeWindow(progressWindow_);
+            if (!predictive.Generate(esmda.getEnsemble())) {
+                progressWindow_->AppendLog(QString("Realizations failed: %1")
+                                               .arg(QString::fromStdString(predictive.getLastError())));
+            }
+            else {
+                progressWindow_->AppendLog(QString("Prediction bands computed from %1 realizations")
+                                               .arg(predictive.GetRealizationCount()));
+            }
+        }
+
+        QString status = completed ? "ES-MDA Complete!" : "ES-MDA Stopped";
+        progressWindow_->SetProgress(1.0);
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog(QString("=== %1 ===").arg(status));
+        progressWindow_->AppendLog(QString("Model evaluations: %1, failed runs replaced: %2")
+                                       .arg(esmda.getModelEvaluations())
+                                       .arg(esmda.getFailedRuns()));
+        progressWindow_->AppendLog(QString("Results saved to: %1").arg(outputFolderPath));
+        progressWindow_->SetComplete(status);
+
+        statusBar()->showMessage(
+            QString("%1 | Output: %2").arg(status).arg(outputFolderName),
+            10000
+            );
+
+    } catch (const std::exception& e) {
+        if (progressWindow_) {
+            progressWindow_->AppendLog(QString("ERROR: %1").arg(e.what()));
+            progressWindow_->SetComplete("ES-MDA Failed!");
+        }
+
+        QMessageBox::critical(this, "ES-MDA Error",
+                              QString("Error during ES-MDA:\n%1").arg(e.what()));
+    }
+
+    if (progressWindow_) {
+        progressWindow_->exec();
+        delete progressWindow_;
+        progressWindow_ = nullptr;
+    }
+}
+
+void MainWindow::onRunSMCUpdate()
+{
+    if (gwaModel.Parameters().empty()) {
+        QMessageBox::warning(this, "No Model",
+                             "Please load a model file before updating the posterior.");
+        return;
+    }
+
+    if (currentFilePath_.isEmpty()) {
+        QMessageBox::warning(this, "No File",
+                             "Please load or save a file first.");
+        return;
+    }
+
+    QFileInfo inputFileInfo(currentFilePath_);
+    QString inputDir = inputFileInfo.absolutePath();
+    QString baseName = inputFileInfo.completeBaseName();
+
+    QString samplesName = QFileDialog::getOpenFileName(
+        this,
+        tr("Open Previous Posterior Samples"),
+        inputDir + "/" + QString("%1_MCMC_output").arg(baseName),
+        tr("Posterior Samples (*.bin *.txt);;All Files (*)")
+        );
+
+    if (samplesName.isEmpty()) {
+        return;
+    }
+
+    QString outputFolderName = QString("%1_SMC_output").arg(baseName);
+    QString outputFolderPath = inputDir + "/" + outputFolderName;
+
+    QDir dir;
+    if (!dir.exists(outputFolderPath)) {
+        if (!dir.mkpath(outputFolderPath)) {
+            QMessageBox::critical(this, "Error",
+                                  QString("Failed to create output folder:\n%1").arg(outputFolderPath));
+            return;
+        }
+    }
+
+    gwaModel.SetOutputPath(outputFolderPath.toStdString() + "/");
+
+    // MCMC burn-in applies to a loaded chain; particles written by an
+    // earlier SMC update have no burn-in
+    const MCMCSettings& mcmcSettings = mcmc.GetSettings();
+    const bool fromSMC = QFileInfo(samplesName).fileName() ==
+                         QString::fromStdString(smc.GetSettings().samples_filename);
+    smc.SetModel(&gwaModel);
+    smc.SetProperty("smc_burnin", fromSMC ? "0" : std::to_string(mcmcSettings.burnout_samples));
+    smc.SetProperty("numthreads", std::to_string(mcmcSettings.numberOfThreads));
+    smc.SetProperty("pathname", outputFolderPath.toStdString() + "/");
+
+    const SMCSettings& settings = smc.GetSettings();
+
+    progressWindow_ = new ProgressWindow(this, "Sequential Monte Carlo Update");
+    progressWindow_->SetProgressLabel("Update Progress:");
+    progressWindow_->SetPrimaryChartTitle("Move Acceptance Rate");
+    progressWindow_->SetPrimaryChartYAxisTitle("Acceptance Rate");
+    progressWindow_->SetPrimaryChartXAxisTitle("Move Step");
+    progressWindow_->SetPrimaryChartVisible(true);
+    progressWindow_->SetPrimaryChartXRange(0, std::max(1, settings.move_steps));
+    progressWindow_->SetSecondaryChartVisible(false);
+    progressWindow_->SetSecondaryProgressVisible(false);
+
+    smc.SetProgressWindow(progressWindow_);
+
+    progressWindow_->show();
+    progressWindow_->SetStatus("Loading particles...");
+    progressWindow_->AppendLog("Starting Sequential Monte Carlo posterior update");
+    progressWindow_->AppendLog(QString("Input file: %1").arg(inputFileInfo.fileName()));
+    progressWindow_->AppendLog(QString("Previous posterior: %1").arg(samplesName));
+    progressWindow_->AppendLog(QString("Output folder: %1").arg(outputFolderName));
+    QApplication::processEvents();
+
+    try {
+        if (!smc.LoadParticles(samplesName.toStdString())) {
+            throw std::runtime_error(smc.getLastError());
+        }
+        progressWindow_->AppendLog(QString("Particles: %1, ESS threshold: %2, move steps: %3, threads: %4")
+                                       .arg(smc.getParticles().size())
+                                       .arg(settings.ess_threshold)
+                                       .arg(settings.move_steps)
+                                       .arg(settings.numthreads));
+        progressWindow_->AppendLog("");
+        QApplication::processEvents();
+
+        if (!smc.update()) {
+            throw std::runtime_error(smc.getLastError());
+        }
+
+        progressWindow_->AppendLog("");
+        if (smc.wasResampled()) {
+            progressWindow_->AppendLog(QString("Resampled and moved; ESS %1, move acceptance %2")
+                                           .arg(smc.getESS(), 0, 'f', 1)
+                                           .arg(smc.getAcceptanceRate(), 0, 'f', 3));
+        }
+        else {
+            progressWindow_->AppendLog(QString("ESS %1 above threshold; particles kept with their weights")
+                                           .arg(smc.getESS(), 0, 'f', 1));
+        }
+        progressWindow_->AppendLog(QString("Log evidence of the new observations: %1")
+                                       .arg(smc.getLogEvidenceIncrement(), 0, 'f', 4));
+
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("Updated posterior (mean, 2.5% - 97.5%):");
+        CPosteriorSummary summary(CParameterSpace(gwaModel.Parameters()), smc.getParticles(), smc.getWeights());
+        for (size_t i = 0; i < smc.getParamNames().size(); ++i) {
+            progressWindow_->AppendLog(QString("  %1: %2 (%3 - %4)")
+                                           .arg(QString::fromStdString(smc.getParamNames()[i]), -30)
+                                           .arg(summary.mean(i), 0, 'e', 4)
+                                           .arg(summary.percentile(i, 0.025), 0, 'e', 4)
+                                           .arg(summary.percentile(i, 0.975), 0, 'e', 4));
+        }
+
+        const int realizations = mcmcSettings.number_of_post_estimate_realizations;
+        if (realizations > 0) {
+            progressWindow_->SetStatus("Generating posterior realizations...");
+            progressWindow_->AppendLog("");
+            progressWindow_->AppendLog(QString("Generating %1 posterior realizations...").arg(realizations));
+            QApplication::processEvents();
+
+            CPosteriorPredictive predictive(&gwaModel);
+            predictive.SetProperty("number_of_realizations", std::to_string(realizations));
+            predictive.SetProperty("output_path", outputFolderPath.toStdString() + "/");
+            predictive.SetProperty("number_of_threads", std::to_string(mcmcSettings.numberOfThreads));
+            predictive.SetRunTimeWindow(progressWindow_);
+            if (!predictive.Generate(smc.getResampledParticles())) {
+                progressWindow_->AppendLog(QString("Realizations failed: %1")
+                                               .arg(QString::fromStdString(predictive.getLastError())));
+            }
+            else {
+                progressWindow_->AppendLog(QString("Prediction bands computed from %1 realizations")
+                                               .arg(predictive.GetRealizationCount()));
+            }
+        }
+
+        progressWindow_->SetProgress(1.0);
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("=== SMC Update Complete! ===");
+        progressWindow_->AppendLog(QString("Model evaluations: %1, failed runs: %2")
+                                       .arg(smc.getModelEvaluations())
+                                       .arg(smc.getFailedRuns()));
+        progressWindow_->AppendLog(QString("Results saved to: %1").arg(outputFolderPath));
+        progressWindow_->SetComplete("SMC Update Complete!");
+
+        statusBar()->showMessage(
+            QString("SMC Update Complete! | Output: %1").arg(outputFolderName),
+            10000
+            );
+
+    } catch (const std::exception& e) {
+        if (progressWindow_) {
+            progressWindow_->AppendLog(QString("ERROR: %1").arg(e.what()));
+            progressWindow_->SetComplete("SMC Update Failed!");
+        }
+
+        QMessageBox::critical(this, "SMC Error",
+                              QString("Error during SMC update:\n%1").arg(e.what()));
+    }
+
+    if (progressWindow_) {
+        progressWindow_->exec();
+        delete progressWindow_;
+        progressWindow_ = nullptr;
+    }
+}
+
+void MainWindow::onReweightPosterior()
+{
+    if (gwaModel.Parameters().empty() || gwaModel.getObservationCount() == 0) {
+        QMessageBox::warning(this, "No Model",
+                             "Please load a model file with observations before reweighting.");
+        return;
+    }
+
+    if (currentFilePath_.isEmpty()) {
+        QMessageBox::warning(this, "No File",
+                             "Please load or save a file first.");
+        return;
+    }
+
+    QFileInfo inputFileInfo(currentFilePath_);
+    QString inputDir = inputFileInfo.absolutePath();
+    QString baseName = inputFileInfo.completeBaseName();
+
+    QString samplesName = QFileDialog::getOpenFileName(
+        this,
+        tr("Open Posterior Samples"),
+        inputDir + "/" + QString("%1_MCMC_output").arg(baseName),
+        tr("Posterior Samples (*.bin *.txt);;All Files (*)")
+        );
+
+    if (samplesName.isEmpty()) {
+        return;
+    }
+
+    // Observations to keep and whether edited observation settings are re-evaluated
+    QDialog dialog(this);
+    dialog.setWindowTitle("What-if Reweighting");
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    layout->addWidget(new QLabel("Observations kept in the likelihood:", &dialog));
+    QListWidget* observationList = new QListWidget(&dialog);
+    for (size_t i = 0; i < gwaModel.getObservationCount(); ++i) {
+        QListWidgetItem* item = new QListWidgetItem(QString::fromStdString(gwaModel.getObservation(i).GetName()),
+                                                    observationList);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(Qt::Checked);
+    }
+    layout->addWidget(observationList);
+    QCheckBox* recomputeBox = new QCheckBox(
+        "Re-evaluate observations with the current project settings\n"
+        "(error model, detection limit or data changed since sampling)", &dialog);
+    layout->addWidget(recomputeBox);
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttons);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    QStringList excluded;
+    for (int i = 0; i < observationList->count(); ++i) {
+        if (observationList->item(i)->checkState() != Qt::Checked) {
+            excluded << observationList->item(i)->text();
+        }
+    }
+
+    QString outputFolderName = QString("%1_Reweighting_output").arg(baseName);
+    QString outputFolderPath = inputDir + "/" + outputFolderName;
+
+    QDir dir;
+    if (!dir.exists(outputFolderPath)) {
+        if (!dir.mkpath(outputFolderPath)) {
+            QMessageBox::critical(this, "Error",
+                                  QString("Failed to create output folder:\n%1").arg(outputFolderPath));
+            return;
+        }
+    }
+
+    gwaModel.SetOutputPath(outputFolderPath.toStdString() + "/");
+
+    // MCMC burn-in applies to a loaded chain, not to SMC or reweighting output
+    const MCMCSettings& mcmcSettings = mcmc.GetSettings();
+    const QString samplesFile = QFileInfo(samplesName).fileName();
+    const bool weighted = samplesFile == QString::fromStdString(smc.GetSettings().samples_filename) ||
+                          samplesFile == QString::fromStdString(reweighting.GetSettings().samples_filename);
+    reweighting.SetModel(&gwaModel);
+    reweighting.SetProperty("reweight_burnin", weighted ? "0" : std::to_string(mcmcSettings.burnout_samples));
+    reweighting.SetProperty("reweight_exclude", excluded.join(",").toStdString());
+    reweighting.SetProperty("reweight_recompute", recomputeBox->isChecked() ? "yes" : "no");
+    reweighting.SetProperty("numthreads", std::to_string(mcmcSettings.numberOfThreads));
+    reweighting.SetProperty("pathname", outputFolderPath.toStdString() + "/");
+
+    progressWindow_ = new ProgressWindow(this, "What-if Reweighting");
+    progressWindow_->SetProgressLabel("Progress:");
+    progressWindow_->SetPrimaryChartVisible(false);
+    progressWindow_->SetSecondaryChartVisible(false);
+    progressWindow_->SetSecondaryProgressVisible(false);
+
+    reweighting.SetProgressWindow(progressWindow_);
+
+    progressWindow_->show();
+    progressWindow_->SetStatus("Loading samples...");
+    progressWindow_->AppendLog("Starting importance reweighting of posterior samples");
+    progressWindow_->AppendLog(QString("Input file: %1").arg(inputFileInfo.fileName()));
+    progressWindow_->AppendLog(QString("Posterior samples: %1").arg(samplesName));
+    progressWindow_->AppendLog(QString("Output folder: %1").arg(outputFolderName));
+    progressWindow_->AppendLog(QString("Excluded observations: %1").arg(excluded.isEmpty() ? "none" : excluded.join(", ")));
+    progressWindow_->AppendLog(QString("Re-evaluate with current settings: %1").arg(recomputeBox->isChecked() ? "yes" : "no"));
+    QApplication::processEvents();
+
+    try {
+        if (!reweighting.LoadSamples(samplesName.toStdString())) {
+            throw std::runtime_error(reweighting.getLastError());
+        }
+        progressWindow_->AppendLog(QString("Samples: %1").arg(reweighting.getSamples().size()));
+        QApplication::processEvents();
+
+        if (!reweighting.run()) {
+            throw std::runtime_error(reweighting.getLastError());
+        }
+
+        const size_t count = reweighting.getSamples().size();
+        progressWindow_->AppendLog(reweighting.usedStoredTerms()
+                                       ? QString("Used stored observation terms (no forward runs for the baseline)")
+                                       : QString("Forward runs: %1").arg(reweighting.getModelEvaluations()));
+        if (reweighting.usedPostHocTerms()) {
+            progressWindow_->AppendLog("WARNING: the original likelihood was evaluated with the current observation "
+                                       "settings; the result is only valid if they are unchanged since sampling");
+        }
+        progressWindow_->AppendLog(QString("Largest weight: %1").arg(reweighting.getMaxWeight(), 0, 'e', 3));
+        if (!reweighting.isReliable()) {
+            progressWindow_->AppendLog(QString("WARNING: effective sample size is only %1% of the samples; "
+                                               "confirm with a new MCMC run")
+                                           .arg(100.0 * reweighting.getESS() / count, 0, 'f', 1));
+        }
+
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("Reweighted posterior (mean, 2.5% - 97.5%):");
+        CParameterSpace space(gwaModel.Parameters());
+        CPosteriorSummary summary(space, reweighting.getSamples(), reweighting.getWeights());
+        for (size_t i = 0; i < reweighting.getParamNames().size(); ++i) {
+            progressWindow_->AppendLog(QString("  %1: %2 (%3 - %4)")
+                                           .arg(QString::fromStdString(reweighting.getParamNames()[i]), -30)
+                                           .arg(summary.mean(i), 0, 'e', 4)
+                                           .arg(summary.percentile(i, 0.025), 0, 'e', 4)
+                                           .arg(summary.percentile(i, 0.975), 0, 'e', 4));
+        }
+
+        const std::vector<double>& dropOne = reweighting.getDropOneESS();
+        if (!dropOne.empty()) {
+            progressWindow_->AppendLog("");
+            progressWindow_->AppendLog("Effective sample size if an observation alone is dropped:");
+            for (size_t i = 0; i < dropOne.size(); ++i) {
+                progressWindow_->AppendLog(QString("  %1: %2")
+                                               .arg(QString::fromStdString(reweighting.getObservationNames()[i]), -30)
+                                               .arg(dropOne[i], 0, 'f', 1));
+            }
+        }
+
+        progressWindow_->SetProgress(1.0);
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("=== Reweighting Complete! ===");
+        progressWindow_->AppendLog(QString("Results saved to: %1").arg(outputFolderPath));
+        progressWindow_->SetComplete("Reweighting Complete!");
+
+        statusBar()->showMessage(
+            QString("Reweighting Complete! | ESS %1 | Output: %2")
+                .arg(reweighting.getESS(), 0, 'f', 0)
+                .arg(outputFolderName),
+            10000
+            );
+
+    } catch (const std::exception& e) {
+        if (progressWindow_) {
+            progressWindow_->AppendLog(QString("ERROR: %1").arg(e.what()));
+            progressWindow_->SetComplete("Reweighting Failed!");
+        }
+
+        QMessageBox::critical(this, "Reweighting Error",
+                              QString("Error during reweighting:\n%1").arg(e.what()));
+    }
+
+    if (progressWindow_) {
+        progressWindow_->exec();
+        delete progressWindow_;
+        progressWindow_ = nullptr;
+    }
+}
+
+void MainWindow::onRunGlobalSensitivity()
+{
+    if (gwaModel.Parameters().empty() || gwaModel.getObservationCount() == 0) {
+        QMessageBox::warning(this, "No Model",
+                             "Please load a model file with parameters and observations before running a sensitivity analysis.");
+        return;
+    }
+
+    if (currentFilePath_.isEmpty()) {
+        QMessageBox::warning(this, "No File",
+                             "Please load or save a file first.");
+        return;
+    }
+
+    QFileInfo inputFileInfo(currentFilePath_);
+    QString inputDir = inputFileInfo.absolutePath();
+    QString baseName = inputFileInfo.completeBaseName();
+
+    QString outputFolderName = QString("%1_Sensitivity_output").arg(baseName);
+    QString outputFolderPath = inputDir + "/" + outputFolderName;
+
+    QDir dir;
+    if (!dir.exists(outputFolderPath)) {
+        if (!dir.mkpath(outputFolderPath)) {
+            QMessageBox::critical(this, "Error",
+                                  QString("Failed to create output folder:\n%1").arg(outputFolderPath));
+            return;
+        }
+    }
+
+    gwaModel.SetOutputPath(outputFolderPath.toStdString() + "/");
+
+    const MCMCSettings& mcmcSettings = mcmc.GetSettings();
+    gsa.SetModel(&gwaModel);
+    gsa.SetProperty("numthreads", std::to_string(mcmcSettings.numberOfThreads));
+    gsa.SetProperty("pathname", outputFolderPath.toStdString() + "/");
+
+    const GSASettings& settings = gsa.GetSettings();
+
+    progressWindow_ = new ProgressWindow(this, "Global Sensitivity Analysis");
+    progressWindow_->SetProgressLabel("Forward Runs:");
+    progressWindow_->SetPrimaryChartVisible(false);
+    progressWindow_->SetSecondaryChartVisible(false);
+    progressWindow_->SetSecondaryProgressVisible(false);
+
+    gsa.SetProgressWindow(progressWindow_);
+
+    progressWindow_->show();
+    progressWindow_->SetStatus("Running sensitivity analysis...");
+    progressWindow_->AppendLog("Starting global sensitivity analysis");
+    progressWindow_->AppendLog(QString("Input file: %1").arg(inputFileInfo.fileName()));
+    progressWindow_->AppendLog(QString("Output folder: %1").arg(outputFolderName));
+    progressWindow_->AppendLog(QString("Method: %1, threads: %2")
+                                   .arg(QString::fromStdString(settings.method))
+                                   .arg(settings.numthreads));
+    progressWindow_->AppendLog("");
+    QApplication::processEvents();
+
+    try {
+        if (!gsa.run()) {
+            throw std::runtime_error(gsa.getLastError());
+        }
+
+        // Most influential parameter per output: total Sobol index, else Morris mu*
+        const bool sobol = settings.method != "morris";
+        const arma::mat& ranking = sobol ? gsa.getTotalOrder() : gsa.getMorrisMuStar();
+        const std::vector<std::string> paramNames = gsa.getParamNames();
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog(sobol ? "Most influential parameter per output (total Sobol index):"
+                                         : "Most influential parameter per output (Morris mu*):");
+        for (size_t o = 0; o < gsa.getOutputNames().size(); ++o) {
+            arma::uword best = 0;
+            for (arma::uword i = 1; i < ranking.n_cols; ++i) {
+                if (ranking(o, i) > ranking(o, best)) best = i;
+            }
+            progressWindow_->AppendLog(QString("  %1: %2 (%3)")
+                                           .arg(QString::fromStdString(gsa.getOutputNames()[o]), -30)
+                                           .arg(QString::fromStdString(paramNames[best]))
+                                           .arg(ranking(o, best), 0, 'f', 3));
+        }
+
+        progressWindow_->SetProgress(1.0);
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("=== Sensitivity Analysis Complete ===");
+        progressWindow_->AppendLog(QString("Model evaluations: %1, failed runs: %2")
+                                       .arg(gsa.getModelEvaluations())
+                                       .arg(gsa.getFailedRuns()));
+        progressWindow_->AppendLog(QString("Results saved to: %1").arg(outputFolderPath));
+        progressWindow_->SetComplete("Sensitivity Analysis Complete!");
+
+        statusBar()->showMessage(
+            QString("Sensitivity analysis complete | Output: %1").arg(outputFolderName),
+            10000
+            );
+
+    } catch (const std::exception& e) {
+        if (progressWindow_) {
+            progressWindow_->AppendLog(QString("ERROR: %1").arg(e.what()));
+            progressWindow_->SetComplete("Sensitivity Analysis Failed!");
+        }
+
+        QMessageBox::critical(this, "Sensitivity Analysis Error",
+                              QString("Error during sensitivity analysis:\n%1").arg(e.what()));
+    }
+
+    if (progressWindow_) {
+        progressWindow_->exec();
+        delete progressWindow_;
+        progressWindow_ = nullptr;
+    }
+}
+
+void MainWindow::onRunSensitivityMatrix()
+{
+    if (gwaModel.Parameters().empty() || gwaModel.getObservationCount() == 0) {
+        QMessageBox::warning(this, "No Model",
+                             "Please load a model file with parameters and observations before computing sensitivities.");
+        return;
+    }
+
+    if (currentFilePath_.isEmpty()) {
+        QMessageBox::warning(this, "No File",
+                             "Please load or save a file first.");
+        return;
+    }
+
+    QFileInfo inputFileInfo(currentFilePath_);
+    QString inputDir = inputFileInfo.absolutePath();
+    QString baseName = inputFileInfo.completeBaseName();
+
+    QString outputFolderName = QString("%1_SensitivityMatrix_output").arg(baseName);
+    QString outputFolderPath = inputDir + "/" + outputFolderName;
+
+    QDir dir;
+    if (!dir.exists(outputFolderPath)) {
+        if (!dir.mkpath(outputFolderPath)) {
+            QMessageBox::critical(this, "Error",
+                                  QString("Failed to create output folder:\n%1").arg(outputFolderPath));
+            return;
+        }
+    }
+
+    gwaModel.SetOutputPath(outputFolderPath.toStdString() + "/");
+
+    const MCMCSettings& mcmcSettings = mcmc.GetSettings();
+    sensitivityMatrix.SetModel(&gwaModel);
+    sensitivityMatrix.SetProperty("numthreads", std::to_string(mcmcSettings.numberOfThreads));
+    sensitivityMatrix.SetProperty("pathname", outputFolderPath.toStdString() + "/");
+
+    progressWindow_ = new ProgressWindow(this, "Sensitivity Matrix");
+    progressWindow_->SetProgressLabel("Forward Runs:");
+    progressWindow_->SetPrimaryChartVisible(false);
+    progressWindow_->SetSecondaryChartVisible(false);
+    progressWindow_->SetSecondaryProgressVisible(false);
+
+    sensitivityMatrix.SetProgressWindow(progressWindow_);
+
+    progressWindow_->show();
+    progressWindow_->SetStatus("Computing sensitivities...");
+    progressWindow_->AppendLog("Computing the sensitivity matrix at the current parameter values");
+    progressWindow_->AppendLog(QString("Input file: %1").arg(inputFileInfo.fileName()));
+    progressWindow_->AppendLog(QString("Output folder: %1").arg(outputFolderName));
+    progressWindow_->AppendLog("");
+    QApplication::processEvents();
+
+    try {
+        if (!sensitivityMatrix.compute()) {
+            throw std::runtime_error(sensitivityMatrix.getLastError());
+        }
+
+        const std::vector<std::string> paramNames = sensitivityMatrix.getParamNames();
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("Parameter: importance, std. error (sampling space), collinearity without it");
+        for (size_t i = 0; i < paramNames.size(); ++i) {
+            progressWindow_->AppendLog(QString("  %1: %2, %3, %4")
+                                           .arg(QString::fromStdString(paramNames[i]), -30)
+                                           .arg(sensitivityMatrix.getImportance()(i), 0, 'e', 3)
+                                           .arg(sensitivityMatrix.getStandardErrors()(i), 0, 'e', 3)
+                                           .arg(sensitivityMatrix.getLeaveOneOutCollinearity()(i), 0, 'g', 4));
+        }
+        progressWindow_->AppendLog(QString("Collinearity index of all parameters: %1")
+                                       .arg(sensitivityMatrix.getCollinearityIndex(), 0, 'g', 4));
+
+        // Pairs that cannot be told apart by the data
+        const arma::mat& correlation = sensitivityMatrix.getCorrelation();
+        for (size_t a = 0; a < paramNames.size(); ++a) {
+            for (size_t b = a + 1; b < paramNames.size(); ++b) {
+                if (std::fabs(correlation(a, b)) > 0.9) {
+                    progressWindow_->AppendLog(QString("  Strongly correlated: %1 and %2 (r = %3)")
+                                                   .arg(QString::fromStdString(paramNames[a]))
+                                                   .arg(QString::fromStdString(paramNames[b]))
+                                                   .arg(correlation(a, b), 0, 'f', 3));
+                }
+            }
+        }
+
+        progressWindow_->SetProgress(1.0);
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("=== Sensitivity Matrix Complete ===");
+        progressWindow_->AppendLog(QString("Model evaluations: %1").arg(sensitivityMatrix.getModelEvaluations()));
+        progressWindow_->AppendLog(QString("Results saved to: %1").arg(outputFolderPath));
+        progressWindow_->SetComplete("Sensitivity Matrix Complete!");
+
+        statusBar()->showMessage(
+            QString("Sensitivity matrix complete | Output: %1").arg(outputFolderName),
+            10000
+            );
+
+    } catch (const std::exception& e) {
+        if (progressWindow_) {
+            progressWindow_->AppendLog(QString("ERROR: %1").arg(e.what()));
+            progressWindow_->SetComplete("Sensitivity Matrix Failed!");
+        }
+
+        QMessageBox::critical(this, "Sensitivity Matrix Error",
+                              QString("Error computing the sensitivity matrix:\n%1").arg(e.what()));
+    }
+
+    if (progressWindow_) {
+        progressWindow_->exec();
+        delete progressWindow_;
+        progressWindow_ = nullptr;
+    }
+}
+
+void MainWindow::onRunProfileLikelihood()
+{
+    if (gwaModel.Parameters().empty() || gwaModel.getObservationCount() == 0) {
+        QMessageBox::warning(this, "No Model",
+                             "Please load a model file with parameters and observations before profiling.");
+        return;
+    }
+
+    if (currentFilePath_.isEmpty()) {
+        QMessageBox::warning(this, "No File",
+                             "Please load or save a file first.");
+        return;
+    }
+
+    // Parameters to profile; error standard deviations stay fixed
+    QDialog dialog(this);
+    dialog.setWindowTitle("Profile Likelihood");
+    QVBoxLayout* layout = new QVBoxLayout(&dialog);
+    layout->addWidget(new QLabel("Parameters to profile:", &dialog));
+    QListWidget* parameterList = new QListWidget(&dialog);
+    for (size_t i = 0; i < gwaModel.Parameters().size(); ++i) {
+        if (gwaModel.isErrorStdParameter(i)) {
+            continue;
+        }
+        QListWidgetItem* item = new QListWidgetItem(QString::fromStdString(gwaModel.Parameters()[i]->GetName()),
+                                                    parameterList);
+        item->setFlags(item->flags() | Qt::ItemIsUserCheckable);
+        item->setCheckState(Qt::Checked);
+    }
+    layout->addWidget(parameterList);
+    QDialogButtonBox* buttons = new QDialogButtonBox(QDialogButtonBox::Ok | QDialogButtonBox::Cancel, &dialog);
+    connect(buttons, &QDialogButtonBox::accepted, &dialog, &QDialog::accept);
+    connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+    layout->addWidget(buttons);
+    if (dialog.exec() != QDialog::Accepted) {
+        return;
+    }
+
+    QStringList selected;
+    for (int i = 0; i < parameterList->count(); ++i) {
+        if (parameterList->item(i)->checkState() == Qt::Checked) {
+            selected << parameterList->item(i)->text();
+        }
+    }
+    if (selected.isEmpty()) {
+        return;
+    }
+
+    QFileInfo inputFileInfo(currentFilePath_);
+    QString inputDir = inputFileInfo.absolutePath();
+    QString baseName = inputFileInfo.completeBaseName();
+
+    QString outputFolderName = QString("%1_Profile_output").arg(baseName);
+    QString outputFolderPath = inputDir + "/" + outputFolderName;
+
+    QDir dir;
+    if (!dir.exists(outputFolderPath)) {
+        if (!dir.mkpath(outputFolderPath)) {
+            QMessageBox::critical(this, "Error",
+                                  QString("Failed to create output folder:\n%1").arg(outputFolderPath));
+            return;
+        }
+    }
+
+    gwaModel.SetOutputPath(outputFolderPath.toStdString() + "/");
+
+    const MCMCSettings& mcmcSettings = mcmc.GetSettings();
+    profileLikelihood.SetModel(&gwaModel);
+    profileLikelihood.SetProperty("profile_parameters", selected.join(",").toStdString());
+    profileLikelihood.SetProperty("numthreads", std::to_string(mcmcSettings.numberOfThreads));
+    profileLikelihood.SetProperty("pathname", outputFolderPath.toStdString() + "/");
+
+    progressWindow_ = new ProgressWindow(this, "Profile Likelihood");
+    progressWindow_->SetProgressLabel("Grid Points:");
+    progressWindow_->SetPrimaryChartVisible(false);
+    progressWindow_->SetSecondaryChartVisible(false);
+    progressWindow_->SetSecondaryProgressVisible(false);
+
+    profileLikelihood.SetProgressWindow(progressWindow_);
+
+    const ProfileLikelihoodSettings& settings = profileLikelihood.GetSettings();
+    progressWindow_->show();
+    progressWindow_->SetStatus("Profiling...");
+    progressWindow_->AppendLog(QString("Profiling %1 parameter(s) on %2 grid points each")
+                                   .arg(selected.size()).arg(settings.points));
+    progressWindow_->AppendLog(QString("Input file: %1").arg(inputFileInfo.fileName()));
+    progressWindow_->AppendLog(QString("Output folder: %1").arg(outputFolderName));
+    progressWindow_->AppendLog("");
+    QApplication::processEvents();
+
+    try {
+        if (!profileLikelihood.run()) {
+            throw std::runtime_error(profileLikelihood.getLastError());
+        }
+
+        const std::vector<std::string>& paramNames = profileLikelihood.getParamNames();
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog(QString("%1% likelihood-ratio intervals (maximum log-likelihood %2):")
+                                       .arg(100.0 * settings.confidence, 0, 'g', 4)
+                                       .arg(profileLikelihood.getMaxObjective(), 0, 'f', 4));
+        for (const auto& profile : profileLikelihood.getProfiles()) {
+            const size_t i = profile.parameter;
+            progressWindow_->AppendLog(QString("  %1: %2 [%3%4, %5%6]")
+                                           .arg(QString::fromStdString(paramNames[i]), -30)
+                                           .arg(profileLikelihood.getOptimum()[i], 0, 'g', 6)
+                                           .arg(profile.lower_open ? "<= " : "")
+                                           .arg(profile.lower, 0, 'g', 6)
+                                           .arg(profile.upper_open ? ">= " : "")
+                                           .arg(profile.upper, 0, 'g', 6));
+            if (profile.lower_open || profile.upper_open) {
+                progressWindow_->AppendLog("    Interval reaches the parameter range: not identifiable from the data");
+            }
+        }
+
+        progressWindow_->SetProgress(1.0);
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("=== Profile Likelihood Complete ===");
+        progressWindow_->AppendLog(QString("Model evaluations: %1").arg(profileLikelihood.getModelEvaluations()));
+        progressWindow_->AppendLog(QString("Results saved to: %1").arg(outputFolderPath));
+        progressWindow_->SetComplete("Profile Likelihood Complete!");
+
+        statusBar()->showMessage(
+            QString("Profile likelihood complete | Output: %1").arg(outputFolderName),
+            10000
+            );
+
+    } catch (const std::exception& e) {
+        if (progressWindow_) {
+            progressWindow_->AppendLog(QString("ERROR: %1").arg(e.what()));
+            progressWindow_->SetComplete("Profile Likelihood Failed!");
+        }
+
+        QMessageBox::critical(this, "Profile Likelihood Error",
+                              QString("Error computing the profile likelihood:\n%1").arg(e.what()));
+    }
+
+    if (progressWindow_) {
+        progressWindow_->exec();
+        delete progressWindow_;
+        progressWindow_ = nullptr;
+    }
+}
+
+void MainWindow::onRunScenarioProjection()
+{
+    if (gwaModel.Parameters().empty() || gwaModel.getWellCount() == 0) {
+        QMessageBox::warning(this, "No Model",
+                             "Please load a model file with wells and parameters before projecting scenarios.");
+        return;
+    }
+
+    if (currentFilePath_.isEmpty()) {
+        QMessageBox::warning(this, "No File",
+                             "Please load or save a file first.");
+        return;
+    }
+
+    if (!gwaModel.getSettings().project_enabled) {
+        QMessageBox::warning(this, "No Projection Period",
+                             "Please set project_start and project_end in the project before projecting scenarios.");
+        return;
+    }
+
+    QFileInfo inputFileInfo(currentFilePath_);
+    QString inputDir = inputFileInfo.absolutePath();
+    QString baseName = inputFileInfo.completeBaseName();
+
+    QString samplesName = QFileDialog::getOpenFileName(
+        this,
+        tr("Open Posterior Samples"),
+        inputDir + "/" + QString("%1_MCMC_output").arg(baseName),
+        tr("Posterior Samples (*.bin *.txt);;All Files (*)")
+        );
+
+    if (samplesName.isEmpty()) {
+        return;
+    }
+
+    QString scenariosName = QFileDialog::getOpenFileName(
+        this,
+        tr("Open Scenarios"),
+        inputDir,
+        tr("Scenarios (*.txt);;All Files (*)")
+        );
+
+    if (scenariosName.isEmpty()) {
+        return;
+    }
+
+    QString outputFolderName = QString("%1_Scenario_output").arg(baseName);
+    QString outputFolderPath = inputDir + "/" + outputFolderName;
+
+    QDir dir;
+    if (!dir.exists(outputFolderPath)) {
+        if (!dir.mkpath(outputFolderPath)) {
+            QMessageBox::critical(this, "Error",
+                                  QString("Failed to create output folder:\n%1").arg(outputFolderPath));
+            return;
+        }
+    }
+
+    gwaModel.SetOutputPath(outputFolderPath.toStdString() + "/");
+
+    // MCMC burn-in applies to a loaded chain, not to SMC or reweighting output
+    const MCMCSettings& mcmcSettings = mcmc.GetSettings();
+    const QString samplesFile = QFileInfo(samplesName).fileName();
+    const bool weighted = samplesFile == QString::fromStdString(smc.GetSettings().samples_filename) ||
+                          samplesFile == QString::fromStdString(reweighting.GetSettings().samples_filename);
+    scenarioProjection.SetModel(&gwaModel);
+    scenarioProjection.ClearScenarios();
+    scenarioProjection.SetProperty("scenario_burnin", weighted ? "0" : std::to_string(mcmcSettings.burnout_samples));
+    scenarioProjection.SetProperty("numthreads", std::to_string(mcmcSettings.numberOfThreads));
+    scenarioProjection.SetProperty("pathname", outputFolderPath.toStdString() + "/");
+
+    progressWindow_ = new ProgressWindow(this, "Scenario Projections");
+    progressWindow_->SetProgressLabel("Samples:");
+    progressWindow_->SetPrimaryChartVisible(false);
+    progressWindow_->SetSecondaryChartVisible(false);
+    progressWindow_->SetSecondaryProgressVisible(false);
+
+    scenarioProjection.SetProgressWindow(progressWindow_);
+
+    progressWindow_->show();
+    progressWindow_->SetStatus("Loading samples and scenarios...");
+    progressWindow_->AppendLog("Starting scenario projections over posterior samples");
+    progressWindow_->AppendLog(QString("Input file: %1").arg(inputFileInfo.fileName()));
+    progressWindow_->AppendLog(QString("Samples: %1").arg(samplesFile));
+    progressWindow_->AppendLog(QString("Scenarios: %1").arg(QFileInfo(scenariosName).fileName()));
+    progressWindow_->AppendLog(QString("Output folder: %1").arg(outputFolderName));
+    progressWindow_->AppendLog("");
+    QApplication::processEvents();
+
+    try {
+        if (!scenarioProjection.LoadSamples(samplesName.toStdString()) ||
+            !scenarioProjection.LoadScenarios(scenariosName.toStdString())) {
+            throw std::runtime_error(scenarioProjection.getLastError());
+        }
+
+        progressWindow_->SetStatus("Projecting...");
+        if (!scenarioProjection.run()) {
+            throw std::runtime_error(scenarioProjection.getLastError());
+        }
+
+        // Mean at the end of the projection period and change from the baseline
+        const std::vector<std::string>& scenarios = scenarioProjection.getScenarioNames();
+        const std::vector<std::string>& series = scenarioProjection.getSeriesNames();
+        const std::vector<double>& weights = scenarioProjection.getWeights();
+        progressWindow_->AppendLog(QString("Mean at t = %1:").arg(scenarioProjection.getTimes().back()));
+        for (size_t s = 0; s < scenarios.size(); ++s) {
+            progressWindow_->AppendLog(QString("  %1").arg(QString::fromStdString(scenarios[s])));
+            for (size_t q = 0; q < series.size(); ++q) {
+                double total = 0.0, mean = 0.0, change = 0.0;
+                const auto& values = scenarioProjection.getValues(s, q);
+                const auto& baseline = scenarioProjection.getValues(0, q);
+                for (size_t k = 0; k < values.size(); ++k) {
+                    if (values[k].empty()) continue;
+                    total += weights[k];
+                    mean += weights[k] * values[k].back();
+                    change += weights[k] * (values[k].back() - baseline[k].back());
+                }
+                if (total <= 0.0) continue;
+                progressWindow_->AppendLog(QString("    %1 %2 (%3%4)")
+                                               .arg(QString::fromStdString(series[q]), -30)
+                                               .arg(mean / total, 0, 'g', 6)
+                                               .arg(change >= 0.0 ? "+" : "")
+                                               .arg(change / total, 0, 'g', 4));
+            }
+        }
+
+        progressWindow_->SetProgress(1.0);
+        progressWindow_->AppendLog("");
+        progressWindow_->AppendLog("=== Scenario Projections Complete ===");
+        progressWindow_->AppendLog(QString("Forward runs: %1 for %2 scenario(s)")
+                                       .arg(scenarioProjection.getModelEvaluations())
+                                       .arg(scenarios.size()));
+        if (scenarioProjection.getFailedSamples() > 0) {
+            progressWindow_->AppendLog(QString("Failed samples: %1").arg(scenarioProjection.getFailedSamples()));
+        }
+        progressWindow_->AppendLog(QString("Baseline check (largest deviation from the projection run): %1")
+                                       .arg(scenarioProjection.getBaselineError(), 0, 'g', 3));
+        progressWindow_->AppendLog(QString("Results saved to: %1").arg(outputFolderPath));
+        progressWindow_->SetComplete("Scenario Projections Complete!");
+
+        statusBar()->showMessage(
+            QString("Scenario projections complete | Output: %1").arg(outputFolderName),
+            10000
+            );
+
+    } catch (const std::exception& e) {
+        if (progressWindow_) {
+            progressWindow_->AppendLog(QString("ERROR: %1").arg(e.what()));
+            progressWindow_->SetComplete("Scenario Projections Failed!");
+        }
+
+        QMessageBox::critical(this, "Scenario Projection Error",
+                              QString("Error projecting scenarios:\n%1").arg(e.what()));
+    }
+
+    if (progressWindow_) {
+        progressWindow_->exec();
+        delete progressWindow_;
+        progressWindow_ = nullptr;
+    }
+}
+
+QString MainWindow::selectCheckpoint(const QString& title, const QString& outputSuffix)
+{
+    QString startDir;
+    if (!currentFilePath_.isEmpty()) {
+        QFileInfo inputFileInfo(currentFilePath_);
+        startDir = inputFileInfo.absolutePath() + "/" +
+                   QString("%1_%2_output").arg(inputFileInfo.completeBaseName(), outputSuffix);
+    }
+
+    return QFileDialog::getOpenFileName(
+        this,
+        title,
+        startDir,
+        tr("Checkpoint Files (*.bin);;All Files (*)")
+        );
+}
+
+void MainWindow::onResumeMCMC()
+{
+    QString fileName = selectCheckpoint(tr("Open MCMC Checkpoint"), "MCMC");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    resumeCheckpoint_ = fileName;
+    onRunMCMC();
+    resumeCheckpoint_.clear();
+}
+
+void MainWindow::onResumeCMAES()
+{
+    QString fileName = selectCheckpoint(tr("Open CMA-ES Checkpoint"), "CMAES");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    resumeCheckpoint_ = fileName;
+    onRunCMAES();
+    resumeCheckpoint_.clear();
+}
+
+void MainWindow::onResumeIslandGA()
+{
+    QString fileName = selectCheckpoint(tr("Open Island GA Checkpoint"), "GA");
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    resumeCheckpoint_ = fileName;
+    onRunIslandGA();
+    resumeCheckpoint_.clear();
+}
+
+void MainWindow::onExportMCMCSamples()
+{
+    QString sourceName = QFileDialog::getOpenFileName(
+        this,
+        tr("Open MCMC Sample Store"),
+        QString(),
+        tr("Sample Stores (*.bin);;All Files (*)")
+        );
+
+    if (sourceName.isEmpty()) {
+        return;
+    }
+
+    QFileInfo sourceInfo(sourceName);
+    QString targetName = QFileDialog::getSaveFileName(
+        this,
+        tr("Export Samples as CSV"),
+        sourceInfo.absolutePath() + "/" + sourceInfo.completeBaseName() + ".csv",
+        tr("CSV Files (*.csv);;All Files (*)")
+        );
+
+    if (targetName.isEmpty()) {
+        return;
+    }
+
+    try {
+        CSampleStoreReader store(sourceName.toStdString());
+        std::ofstream out(targetName.toStdString());
+        if (!out.is_open()) {
+            throw std::runtime_error("Cannot write " + targetName.toStdString());
+        }
+        store.exportCSV(out);
+        statusBar()->showMessage(QString("Exported %1 samples to %2")
+                                     .arg(static_cast<qlonglong>(store.rowCount()))
+                                     .arg(targetName),
+                                 5000);
+    }
+    catch (const std::exception& e) {
+        QMessageBox::critical(this, "Export Error", QString("Failed to export samples:\n%1").arg(e.what()));
+    }
+}
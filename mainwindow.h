@@ -6,6 +6,18 @@
 #include "GWA.h"
 #include "GA.h"
 #include "MCMC.h"
+#include "MCMCEngine.h"
+#include "CMAES.h"
+#include "IslandGA.h"
+#include "MultiStartLM.h"
+#include "LaplaceApproximation.h"
+#include "ESMDA.h"
+#include "SMCSampler.h"
+#include "PosteriorReweighting.h"
+#include "GlobalSensitivity.h"
+#include "SensitivityMatrix.h"
+#include "ProfileLikelihood.h"
+#include "ScenarioProjection.h"
 #include "ProgressWindow.h"
 #include "AboutDialog.h"
 
@@ -43,7 +55,22 @@ private slots:
     void onGASettingsTriggered();
     void onMCMCSettingsTriggered();
     void onRunDeterministicGA();
+    void onRunCMAES();
+    void onRunIslandGA();
+    void onRunMultiStartLM();
     void onRunMCMC();
+    void onRunLaplace();
+    void onRunESMDA();
+    void onRunSMCUpdate();
+    void onReweightPosterior();
+    void onRunGlobalSensitivity();
+    void onRunSensitivityMatrix();
+    void onRunProfileLikelihood();
+    void onRunScenarioProjection();
+    void onResumeMCMC();
+    void onResumeCMAES();
+    void onResumeIslandGA();
+    void onExportMCMCSamples();
     void onAbout();
 
 private:
@@ -73,7 +100,23 @@ private:
     QStringList loadRecentFiles() const;
     void saveRecentFiles(const QStringList& files) const;
     CGA<CGWA> ga;
+    CCMAES<CGWA> cmaes;
+    CIslandGA<CGWA> islandGA;
+    CMultiStartLM<CGWA> multiStartLM;
     CMCMC<CGWA> mcmc;
+    CMCMCEngine<CGWA> mcmcEngine;
+    CLaplaceApproximation<CGWA> laplace;
+    CESMDA<CGWA> esmda;
+    CSMCSampler<CGWA> smc;
+    CPosteriorReweighting<CGWA> reweighting;
+    CGlobalSensitivity gsa;
+    CSensitivityMatrix<CGWA> sensitivityMatrix;
+    CProfileLikelihood<CGWA> profileLikelihood;
+    CScenarioProjection scenarioProjection;
+    int fitnessCacheSize_ = 100000;  // Entries of the GA fitness cache, 0 = off
+    QString resumeCheckpoint_;  // Checkpoint for the next onRunMCMC(), onRunCMAES() or onRunIslandGA(), empty for a new run
+
+    QString selectCheckpoint(const QString& title, const QString& outputSuffix);
 
     QString getGASettingsFilename(const QString& projectFilename);
     void saveGASettings(const QString& filename);
@@ -0,0 +1,73 @@
+#include "TestHarness.h"
+#include "AsyncWriter.h"
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+namespace {
+
+/// Jobs append their index; the writer must run them in submission order
+void checkOrdering(size_t queue_size, bool threaded, bool slow)
+{
+    std::vector<int> order;
+    CAsyncWriter writer(queue_size, threaded);
+    for (int i = 0; i < 2000; ++i) {
+        writer.submit([&order, i, slow] {
+            if (slow && i % 100 == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            order.push_back(i);
+        });
+        if (i == 999) {
+            writer.flush();
+            CHECK(order.size() == 1000);
+        }
+    }
+    writer.close();
+    bool ordered = order.size() == 2000;
+    for (size_t i = 0; ordered && i < order.size(); ++i) ordered = order[i] == static_cast<int>(i);
+    CHECK(ordered);
+    CHECK(writer.error().empty());
+    if (!threaded) CHECK(writer.stalls() == 0);
+}
+
+} // namespace
+
+void testAsyncWriter()
+{
+    checkOrdering(1024, true, false);
+    checkOrdering(1024, false, false);
+    checkOrdering(4, true, true);
+
+    // A slow writer behind a small queue makes submit() wait instead of growing
+    {
+        CAsyncWriter writer(2, true);
+        for (int i = 0; i < 20; ++i)
+            writer.submit([] { std::this_thread::sleep_for(std::chrono::milliseconds(1)); });
+        writer.close();
+        CHECK(writer.stalls() > 0);
+    }
+
+    // The first exception is kept and later jobs still run
+    {
+        int after = 0;
+        CAsyncWriter writer(16, true);
+        writer.submit([] { throw std::runtime_error("disk full"); });
+        writer.submit([] { throw std::runtime_error("second"); });
+        writer.submit([&after] { ++after; });
+        writer.flush();
+        CHECK(writer.error() == "disk full");
+        CHECK(after == 1);
+    }
+
+    // The ring buffer is FIFO, bounded and reusable after wrapping
+    CSpscQueue<int> queue(3);
+    CHECK(queue.capacity() == 3 && queue.empty());
+    int item = 0;
+    for (int round = 0; round < 3; ++round) {
+        CHECK(queue.tryPush(1) && queue.tryPush(2) && queue.tryPush(3));
+        CHECK(!queue.tryPush(4));
+        CHECK(queue.tryPop(item) && item == 1);
+        CHECK(queue.tryPop(item) && item == 2);
+        CHECK(queue.tryPop(item) && item == 3);
+        CHECK(!queue.tryPop(item) && queue.empty());
+    }
+}
@@ -0,0 +1,88 @@
+#include "TestHarness.h"
+#include "Checkpoint.h"
+#include <algorithm>
+#include <filesystem>
+#include <stdexcept>
+
+namespace {
+
+/// True if fn throws std::runtime_error
+template <typename Fn>
+bool throwsRuntimeError(Fn fn)
+{
+    try {
+        fn();
+    }
+    catch (const std::runtime_error&) {
+        return true;
+    }
+    return false;
+}
+
+} // namespace
+
+void testCheckpoint()
+{
+    const std::string filename = test::directory() + "checkpoint.chk";
+    std::filesystem::remove(filename);
+    std::mt19937_64 rng(11);
+    rng.discard(37);
+    const std::vector<std::vector<double>> rows = {{1.5, -2.0}, {}, {3.25}};
+    arma::mat matrix(2, 3);
+    for (arma::uword i = 0; i < matrix.n_elem; ++i) matrix(i) = (i + 1) / 7.0 - 0.5;
+
+    CCheckpointWriter writer(filename, "test");
+    writer.write(0.1);
+    writer.write(int64_t(-1234567890123));
+    writer.write(true);
+    writer.write(std::string("with spaces\nand a newline"));
+    writer.write(std::vector<double>{1.0 / 3.0, -0.0, 1e308});
+    writer.write(std::vector<int64_t>{0, -1, INT64_MAX});
+    writer.write(std::vector<std::string>{"a", "", "c"});
+    writer.write(rows);
+    writer.write(matrix);
+    writer.write(rng);
+    CHECK(!std::filesystem::exists(filename));     // only the temporary file until close()
+    writer.close();
+    CHECK(std::filesystem::exists(filename));
+    CHECK(!std::filesystem::exists(filename + ".tmp"));
+
+    // Every value comes back bit for bit, and the generator continues where it was
+    CCheckpointReader reader(filename, "test");
+    CHECK(reader.readDouble() == 0.1);
+    CHECK(reader.readInt() == -1234567890123);
+    CHECK(reader.readBool());
+    CHECK(reader.readString() == "with spaces\nand a newline");
+    CHECK((reader.readDoubleVector() == std::vector<double>{1.0 / 3.0, -0.0, 1e308}));
+    CHECK((reader.readIntVector() == std::vector<int64_t>{0, -1, INT64_MAX}));
+    CHECK((reader.readStringVector() == std::vector<std::string>{"a", "", "c"}));
+    CHECK(reader.readDoubleMatrix() == rows);
+    const arma::mat restored = reader.readMat();
+    CHECK(restored.n_rows == 2 && restored.n_cols == 3);
+    CHECK(restored.n_elem == matrix.n_elem && std::equal(matrix.begin(), matrix.end(), restored.begin()));
+    std::mt19937_64 restored_rng;
+    reader.readRng(restored_rng);
+    CHECK(restored_rng() == rng());
+
+    // Wrong kind, reading past the end and a truncated file all throw
+    CHECK(throwsRuntimeError([&] { CCheckpointReader(filename, "other"); }));
+    CHECK(throwsRuntimeError([&] { reader.readDouble(); }));
+    CHECK(throwsRuntimeError([&] { CCheckpointReader(test::directory() + "missing.chk", "test"); }));
+
+    const auto size = std::filesystem::file_size(filename);
+    std::filesystem::resize_file(filename, size - 20);
+    CHECK(throwsRuntimeError([&] {
+        CCheckpointReader truncated(filename, "test");
+        truncated.readDouble();
+        truncated.readInt();
+        truncated.readBool();
+        truncated.readString();
+        truncated.readDoubleVector();
+        truncated.readIntVector();
+        truncated.readStringVector();
+        truncated.readDoubleMatrix();
+        truncated.readMat();
+        std::mt19937_64 unused;
+        truncated.readRng(unused);
+    }));
+}
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "parameter_set.h"
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Correlated bivariate normal posterior with known moments
+ *
+ * Implements the model interface CMCMCEngine samples from: flat priors on
+ * [-20, 20] and a Gaussian log-likelihood split into two observation
+ * terms, the marginal of a and the conditional of b given a.
+ */
+class CGaussianModel
+{
+public:
+    struct Observation
+    {
+        std::string name;
+        std::string GetName() const { return name; }
+    };
+
+    static constexpr double mean_a = 1.0;
+    static constexpr double mean_b = -2.0;
+    static constexpr double std_a = 1.0;
+    static constexpr double std_b = 0.5;
+    static constexpr double correlation = 0.8;
+
+    CGaussianModel()
+    {
+        for (const char* name : {"a", "b"}) {
+            Parameter parameter;
+            parameter.SetName(name);
+            parameter.SetLow(-20.0);
+            parameter.SetHigh(20.0);
+            parameter.SetPriorDistribution("uniform");
+            parameter.SetValue(0.0);
+            parameters_.AddParameter(parameter);
+        }
+    }
+
+    Parameter_Set& Parameters() { return parameters_; }
+    const Parameter_Set& Parameters() const { return parameters_; }
+    std::vector<double> getParameterValues() const { return values_; }
+    void setAllParameterValues(const std::vector<double>& values) { values_ = values; }
+
+    size_t getObservationCount() const { return observations_.size(); }
+    const Observation& getObservation(size_t index) const { return observations_[index]; }
+
+    std::vector<double> calculateObservationLogLikelihoods()
+    {
+        const double za = (values_[0] - mean_a) / std_a;
+        const double zb = (values_[1] - mean_b) / std_b;
+        const double residual = zb - correlation * za;
+        return {-0.5 * za * za, -0.5 * residual * residual / (1.0 - correlation * correlation)};
+    }
+
+    double calculateLogLikelihood()
+    {
+        const std::vector<double> terms = calculateObservationLogLikelihoods();
+        return terms[0] + terms[1];
+    }
+
+    /// The likelihood is cheap, so it is always evaluated in full
+    double calculateLogLikelihood(double /*rejection_threshold*/, std::vector<double>* terms = nullptr)
+    {
+        const std::vector<double> values = calculateObservationLogLikelihoods();
+        if (terms) {
+            *terms = values;
+        }
+        return values[0] + values[1];
+    }
+
+    double calculateLogPrior() const
+    {
+        for (double value : values_) {
+            if (value < -20.0 || value > 20.0) {
+                return -std::numeric_limits<double>::infinity();
+            }
+        }
+        return 0.0;
+    }
+
+    double calculateLogPosteriorGradient(std::vector<double>& gradient, double /*relative_step*/ = 1e-5)
+    {
+        const double za = (values_[0] - mean_a) / std_a;
+        const double zb = (values_[1] - mean_b) / std_b;
+        const double scale = 1.0 / (1.0 - correlation * correlation);
+        gradient = {-scale * (za - correlation * zb) / std_a, -scale * (zb - correlation * za) / std_b};
+        return calculateLogLikelihood() + calculateLogPrior();
+    }
+
+private:
+    Parameter_Set parameters_;
+    std::vector<double> values_ = {0.0, 0.0};
+    std::vector<Observation> observations_ = {{"A"}, {"B"}};
+};
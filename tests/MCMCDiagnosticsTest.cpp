@@ -0,0 +1,57 @@
+#include "TestHarness.h"
+#include "MCMCDiagnostics.h"
+#include <random>
+
+namespace {
+
+/// Four chains of an AR(1) process with unit marginal variance; chain 0 shifted by shift
+CMCMCDiagnostics simulate(double phi, double shift, size_t draws, size_t max_draws)
+{
+    CMCMCDiagnostics diagnostics(4, {"x"}, max_draws);
+    std::mt19937_64 rng(7);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::vector<double> state(4);
+    for (double& x : state) x = normal(rng);
+    for (size_t i = 0; i < draws; ++i) {
+        for (size_t c = 0; c < state.size(); ++c) {
+            state[c] = phi * state[c] + std::sqrt(1.0 - phi * phi) * normal(rng);
+            diagnostics.addDraw(c, {state[c] + (c == 0 ? shift : 0.0)});
+        }
+    }
+    diagnostics.update();
+    return diagnostics;
+}
+
+} // namespace
+
+void testMCMCDiagnostics()
+{
+    // Independent draws: R-hat 1 and an ESS near the number of draws
+    const CMCMCDiagnostics iid = simulate(0.0, 0.0, 2000, 0);
+    CHECK(iid.drawsPerChain() == 2000);
+    CHECK(iid.getRhat(0) < 1.01);
+    CHECK_NEAR(iid.getBulkESS(0), 8000.0, 0.15 * 8000.0);
+    CHECK_NEAR(iid.getTailESS(0), 8000.0, 0.15 * 8000.0);
+    CHECK_NEAR(iid.getMCSE(0), 1.0 / std::sqrt(8000.0), 0.15 / std::sqrt(8000.0));
+
+    // AR(1): ESS = n (1 - phi) / (1 + phi)
+    const double phi = 0.9;
+    const double expected_ess = 40000.0 * (1.0 - phi) / (1.0 + phi);
+    const CMCMCDiagnostics ar = simulate(phi, 0.0, 10000, 0);
+    CHECK(ar.getRhat(0) < 1.01);
+    CHECK_NEAR(ar.getBulkESS(0), expected_ess, 0.2 * expected_ess);
+
+    // A chain off the others is flagged and fails the stop rule
+    const CMCMCDiagnostics shifted = simulate(0.0, 1.0, 2000, 0);
+    CHECK(shifted.getRhat(0) > 1.1);
+    CHECK(!shifted.isConverged(1.01, 400.0));
+    CHECK(ar.isConverged(1.01, 400.0));
+
+    // The bounded buffer keeps R-hat and MCSE and gives a conservative ESS
+    const CMCMCDiagnostics thinned = simulate(phi, 0.0, 10000, 100);
+    CHECK(thinned.drawsPerChain() == 10000);
+    CHECK_NEAR(thinned.getRhat(0), ar.getRhat(0), 0.02);
+    CHECK(thinned.getBulkESS(0) <= 1.2 * ar.getBulkESS(0));
+    CHECK_NEAR(thinned.getMCSE(0), ar.getMCSE(0), 0.25 * ar.getMCSE(0));
+    CHECK(simulate(0.0, 1.0, 2000, 100).getRhat(0) > 1.1);
+}
@@ -0,0 +1,69 @@
+#include "TestHarness.h"
+#include "GaussianModel.h"
+#include "MCMCEngine.h"
+
+namespace {
+
+/// Post burn-in moments of a sampler run on the bivariate normal target
+void checkGaussianTarget(const std::string& sampler)
+{
+    CGaussianModel model;
+    CMCMCEngine<CGaussianModel> engine(&model);
+    CHECK(engine.SetProperty("sampler", sampler));
+    CHECK(engine.SetProperty("number_of_samples", "40000"));
+    CHECK(engine.SetProperty("number_of_chains", "8"));
+    CHECK(engine.SetProperty("number_of_burnout_samples", "10000"));
+    CHECK(engine.SetProperty("random_seed", "5"));
+    CHECK(engine.SetProperty("output_path", test::directory()));
+    CHECK(engine.SetProperty("samples_filename", sampler + "_samples.bin"));
+    const bool completed = engine.Initialize(false) && engine.Perform();
+    CHECK(completed);
+    if (!completed) {
+        std::cerr << sampler << ": " << engine.getLastError() << std::endl;
+        return;
+    }
+    CHECK(engine.GetSampleCount() == 40000);
+
+    std::vector<std::vector<double>> samples;
+    CHECK(engine.GetPosteriorSamples(samples));
+    CHECK(samples.size() == 30000);
+    if (samples.size() < 2) {
+        return;
+    }
+
+    double mean[2] = {0.0, 0.0};
+    for (const auto& x : samples) {
+        mean[0] += x[0];
+        mean[1] += x[1];
+    }
+    mean[0] /= samples.size();
+    mean[1] /= samples.size();
+    double var[2] = {0.0, 0.0}, cov = 0.0;
+    for (const auto& x : samples) {
+        var[0] += (x[0] - mean[0]) * (x[0] - mean[0]);
+        var[1] += (x[1] - mean[1]) * (x[1] - mean[1]);
+        cov += (x[0] - mean[0]) * (x[1] - mean[1]);
+    }
+    const double std_a = std::sqrt(var[0] / (samples.size() - 1));
+    const double std_b = std::sqrt(var[1] / (samples.size() - 1));
+    const double correlation = cov / std::sqrt(var[0] * var[1]);
+
+    // About 1000 effective draws: the mean is within 0.1 sd and the sd
+    // within 10% with a wide margin
+    CHECK_NEAR(mean[0], CGaussianModel::mean_a, 0.1 * CGaussianModel::std_a);
+    CHECK_NEAR(mean[1], CGaussianModel::mean_b, 0.1 * CGaussianModel::std_b);
+    CHECK_NEAR(std_a, CGaussianModel::std_a, 0.1 * CGaussianModel::std_a);
+    CHECK_NEAR(std_b, CGaussianModel::std_b, 0.1 * CGaussianModel::std_b);
+    CHECK_NEAR(correlation, CGaussianModel::correlation, 0.05);
+    CHECK(engine.GetAcceptanceRate() > 0.1 && engine.GetAcceptanceRate() < 0.6);
+    CHECK(engine.GetDiagnostics().maxRhat() < 1.05);
+}
+
+} // namespace
+
+void testMCMCEngine()
+{
+    checkGaussianTarget("adaptive_metropolis");
+    checkGaussianTarget("robust_adaptive_metropolis");
+    checkGaussianTarget("dream");
+}
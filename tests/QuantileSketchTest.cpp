@@ -0,0 +1,83 @@
+#include "TestHarness.h"
+#include "QuantileSketch.h"
+#include <algorithm>
+#include <random>
+
+namespace {
+
+/// Exact quantile of a sample with linear interpolation between order statistics
+double exactQuantile(std::vector<double> values, double p)
+{
+    std::sort(values.begin(), values.end());
+    const double position = p * (values.size() - 1);
+    const size_t lower = static_cast<size_t>(position);
+    const size_t upper = std::min(lower + 1, values.size() - 1);
+    return values[lower] + (position - lower) * (values[upper] - values[lower]);
+}
+
+/// Fraction of the sample below x
+double rank(const std::vector<double>& values, double x)
+{
+    return std::count_if(values.begin(), values.end(), [x](double v) { return v < x; }) /
+           static_cast<double>(values.size());
+}
+
+/// The P-square estimate lies within 0.5% in probability of the exact quantile
+void checkSketch(const std::vector<double>& values)
+{
+    for (double p : {0.025, 0.25, 0.5, 0.9, 0.975}) {
+        CP2Quantile sketch(p);
+        for (double x : values) sketch.add(x);
+        CHECK(sketch.count() == static_cast<long>(values.size()));
+        CHECK_NEAR(rank(values, sketch.value()), p, 0.005);
+        const double exact = exactQuantile(values, p);
+        const double spread = exactQuantile(values, 0.75) - exactQuantile(values, 0.25);
+        CHECK_NEAR(sketch.value(), exact, 0.05 * spread);
+    }
+}
+
+} // namespace
+
+void testQuantileSketch()
+{
+    // Exact for fewer than five values
+    const std::vector<double> few = {3.0, -1.0, 7.0, 2.0};
+    for (size_t n = 1; n <= few.size(); ++n) {
+        const std::vector<double> values(few.begin(), few.begin() + n);
+        for (double p : {0.0, 0.1, 0.5, 0.975, 1.0}) {
+            CP2Quantile sketch(p);
+            for (double x : values) sketch.add(x);
+            CHECK(sketch.value() == exactQuantile(values, p));
+        }
+    }
+    CHECK(CP2Quantile(0.5).value() == 0.0);
+
+    // Symmetric and skewed streams
+    std::mt19937_64 rng(17);
+    std::normal_distribution<double> normal(10.0, 2.0);
+    std::exponential_distribution<double> exponential(0.5);
+    std::vector<double> normal_values(100000), skewed_values(100000);
+    for (double& x : normal_values) x = normal(rng);
+    for (double& x : skewed_values) x = exponential(rng);
+    checkSketch(normal_values);
+    checkSketch(skewed_values);
+
+    // Bands keep the time grid, the exact mean and one series per probability
+    CPredictionBands bands({0.025, 0.5, 0.975});
+    for (int r = 0; r < 2000; ++r) {
+        const double shift = normal(rng) - 10.0;
+        TimeSeries<double> realization;
+        for (int i = 0; i < 10; ++i) realization.append(0.5 * i, i + shift);
+        bands.add(realization);
+    }
+    CHECK(bands.count() == 2000);
+    const std::vector<std::string> names = bands.seriesNames();
+    CHECK(names.size() == 4 && names[0] == "Mean" && names[2] == "50.000000 %");
+    const TimeSeriesSet<double> result = bands.bands();
+    CHECK(result.size() == 4 && result[0].size() == 10);
+    CHECK(result[0].getTime(9) == 4.5);
+    CHECK_NEAR(result[0].getValue(3), 3.0, 0.15);
+    CHECK_NEAR(result[1].getValue(3), 3.0 - 1.96 * 2.0, 0.3);
+    CHECK_NEAR(result[2].getValue(3), 3.0, 0.15);
+    CHECK_NEAR(result[3].getValue(3), 3.0 + 1.96 * 2.0, 0.3);
+}
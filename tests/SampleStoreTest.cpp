@@ -0,0 +1,91 @@
+#include "TestHarness.h"
+#include "SampleStore.h"
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <random>
+#include <sstream>
+
+void testSampleStore()
+{
+    const std::string filename = test::directory() + "store.bin";
+    const std::vector<std::string> names = {"sample_no", "logp", "x"};
+
+    // Rows with repeats (rejected proposals), special values and more than one chunk
+    std::mt19937_64 rng(3);
+    std::normal_distribution<double> normal(0.0, 1.0);
+    std::vector<std::vector<double>> rows;
+    std::vector<double> row = {0.0, -1.0, 0.0};
+    for (int i = 0; i < 1000; ++i) {
+        row[0] = i;
+        if (i % 3 != 0) {
+            row[1] = normal(rng);
+            row[2] = normal(rng) * 1e6;
+        }
+        rows.push_back(row);
+    }
+    rows[5][2] = -0.0;
+    rows[6][2] = std::numeric_limits<double>::infinity();
+    rows[7][2] = std::numeric_limits<double>::denorm_min();
+
+    {
+        CSampleStoreWriter writer(filename, names, false, 64);
+        CHECK(writer.columnCount() == 3);
+        for (size_t i = 0; i < 600; ++i) writer.append(rows[i]);
+        writer.flush();                 // a short chunk in the middle of the file
+        CHECK(writer.bytesWritten() == static_cast<long long>(std::filesystem::file_size(filename)));
+        writer.close();
+    }
+    {
+        CSampleStoreWriter writer(filename, names, true, 64);
+        for (size_t i = 600; i < rows.size(); ++i) writer.append(rows[i]);
+        writer.close();
+    }
+    CHECK(CSampleStoreReader::isSampleStore(filename));
+    CHECK(std::filesystem::file_size(filename) < rows.size() * names.size() * sizeof(double));
+
+    // Columns come back bit for bit across chunks and the appended part
+    {
+        CSampleStoreReader reader(filename);
+        CHECK(reader.columnNames() == names);
+        CHECK(reader.rowCount() == rows.size());
+        CHECK(reader.findColumn("x") == 2);
+        CHECK(reader.findColumn("y") == -1);
+        bool identical = true;
+        for (size_t c = 0; c < names.size(); ++c) {
+            const std::vector<double> values = reader.column(c);
+            identical = identical && values.size() == rows.size();
+            for (size_t i = 0; identical && i < rows.size(); ++i)
+                identical = std::memcmp(&values[i], &rows[i][c], sizeof(double)) == 0;
+        }
+        CHECK(identical);
+
+        std::ostringstream csv;
+        reader.exportCSV(csv);
+        CHECK(csv.str().rfind("sample_no,logp,x\n", 0) == 0);
+    }
+
+    // readSampleTable reads stores and text files alike
+    std::vector<std::string> read_names;
+    std::vector<std::vector<double>> columns;
+    readSampleTable(filename, read_names, columns);
+    CHECK(read_names == names && columns.size() == 3 && columns[1].size() == rows.size());
+    CHECK(columns[2][999] == rows[999][2]);
+
+    const std::string text = test::directory() + "samples.txt";
+    {
+        std::ofstream out(text);
+        out << "# comment\nsample_no,logp,x\n0,-1,2.5\n1,-2,3.5\n2,-3\n";
+    }
+    CHECK(!CSampleStoreReader::isSampleStore(text));
+    readSampleTable(text, read_names, columns);
+    CHECK((read_names == std::vector<std::string>{"sample_no", "logp", "x"}));
+    CHECK(columns.size() == 3 && columns[2] == std::vector<double>({2.5, 3.5}));
+
+    // A store cut inside its last chunk (the 16 rows written by close()) keeps the others
+    std::filesystem::resize_file(filename, std::filesystem::file_size(filename) - 10);
+    CSampleStoreReader truncated(filename);
+    CHECK(truncated.rowCount() == rows.size() - 16);
+    CHECK(truncated.column(2).back() == rows[rows.size() - 17][2]);
+}
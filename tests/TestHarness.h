@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cmath>
+#include <iostream>
+#include <string>
+
+/**
+ * @brief Minimal checks for the standalone module tests
+ *
+ * A failed check prints its location and is counted; main() runs every
+ * test and returns non-zero if any check failed, so the target can be run
+ * by "make check" or any CI step.
+ */
+namespace test {
+
+int& failures();
+
+inline void check(bool ok, const char* expression, const char* file, int line)
+{
+    if (!ok) {
+        ++failures();
+        std::cerr << file << ":" << line << ": check failed: " << expression << std::endl;
+    }
+}
+
+inline void checkNear(double value, double expected, double tolerance, const char* expression,
+                      const char* file, int line)
+{
+    if (!(std::fabs(value - expected) <= tolerance)) {
+        ++failures();
+        std::cerr << file << ":" << line << ": check failed: " << expression << " = " << value
+                  << ", expected " << expected << " +/- " << tolerance << std::endl;
+    }
+}
+
+/**
+ * @brief Scratch directory for files written by the tests, with a trailing '/'
+ */
+std::string directory();
+
+} // namespace test
+
+#define CHECK(expression) test::check((expression), #expression, __FILE__, __LINE__)
+#define CHECK_NEAR(value, expected, tolerance) \
+    test::checkNear((value), (expected), (tolerance), #value, __FILE__, __LINE__)
+
+// Test suites, one per module
+void testAsyncWriter();
+void testCheckpoint();
+void testMCMCDiagnostics();
+void testMCMCEngine();
+void testQuantileSketch();
+void testSampleStore();
@@ -0,0 +1,44 @@
+#include "TestHarness.h"
+#include <filesystem>
+
+int& test::failures()
+{
+    static int count = 0;
+    return count;
+}
+
+std::string test::directory()
+{
+    const std::filesystem::path path = std::filesystem::temp_directory_path() / "chronogw_tests";
+    std::filesystem::create_directories(path);
+    return path.string() + "/";
+}
+
+int main()
+{
+    const struct
+    {
+        const char* name;
+        void (*run)();
+    } suites[] = {
+        {"AsyncWriter", testAsyncWriter},
+        {"Checkpoint", testCheckpoint},
+        {"MCMCDiagnostics", testMCMCDiagnostics},
+        {"MCMCEngine", testMCMCEngine},
+        {"QuantileSketch", testQuantileSketch},
+        {"SampleStore", testSampleStore},
+    };
+
+    for (const auto& suite : suites) {
+        const int before = test::failures();
+        try {
+            suite.run();
+        }
+        catch (const std::exception& e) {
+            ++test::failures();
+            std::cerr << suite.name << ": unexpected exception: " << e.what() << std::endl;
+        }
+        std::cout << (test::failures() == before ? "PASS " : "FAIL ") << suite.name << std::endl;
+    }
+    return test::failures() == 0 ? 0 : 1;
+}
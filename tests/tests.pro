@@ -0,0 +1,53 @@
+TEMPLATE = app
+TARGET = chronogw_tests
+CONFIG += console c++17 testcase
+CONFIG -= app_bundle
+CONFIG -= qt
+
+# Standalone checks of the sampling and output modules: "make check" builds and runs them
+
+INCLUDEPATH += ..
+INCLUDEPATH += ../InverseModeling
+INCLUDEPATH += ../Utilities/
+
+DEFINES += GSL
+DEFINES += _arma
+
+SOURCES += \
+    main.cpp \
+    AsyncWriterTest.cpp \
+    CheckpointTest.cpp \
+    MCMCDiagnosticsTest.cpp \
+    MCMCEngineTest.cpp \
+    QuantileSketchTest.cpp \
+    SampleStoreTest.cpp \
+    ../AsyncWriter.cpp \
+    ../Checkpoint.cpp \
+    ../LikelihoodSurrogate.cpp \
+    ../MCMCDiagnostics.cpp \
+    ../ParameterSpace.cpp \
+    ../QuantileSketch.cpp \
+    ../SampleStore.cpp \
+    ../InverseModeling/parameter.cpp \
+    ../InverseModeling/parameter_set.cpp \
+    ../Utilities/Distribution.cpp \
+    ../Utilities/Matrix.cpp \
+    ../Utilities/Matrix_arma.cpp \
+    ../Utilities/NormalDist.cpp \
+    ../Utilities/QuickSort.cpp \
+    ../Utilities/Utilities.cpp \
+    ../Utilities/Vector.cpp \
+    ../Utilities/Vector_arma.cpp
+
+HEADERS += \
+    GaussianModel.h \
+    TestHarness.h
+
+QMAKE_CXXFLAGS += -fopenmp
+QMAKE_LFLAGS += -fopenmp
+LIBS += -fopenmp
+
+linux {
+     DEFINES += ARMA_USE_LAPACK ARMA_USE_BLAS
+     LIBS += -larmadillo -llapack -lblas -lgsl -lopenblas
+}